@@ -44,11 +44,6 @@ struct admissible_state *g_admissible_status(void) {
 	return (struct admissible_state *) &g_pim_state;
 }
 
-static inline
-struct backlog *g_admission_backlog(void) {
-	return &g_pim_state.backlog;
-}
-
 static inline
 struct admission_core_statistics *g_admission_core_stats(uint16_t i) {
 	return &g_pim_state.cores[i].stat;
@@ -98,8 +93,8 @@ struct admissible_state *g_admissible_status(void) {
 }
 
 static inline
-struct backlog *g_admission_backlog(void) {
-	return &g_seq_admissible_status.backlog;
+struct backlog *g_admission_backlog(uint16_t src) {
+	return &seq_intake_of(&g_seq_admissible_status, src)->backlog;
 }
 
 static inline
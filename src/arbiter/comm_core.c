@@ -18,14 +18,17 @@
 #include "bigmap.h"
 #include "admission_core.h"
 #include "admission_core_common.h"
+#include "flow_table.h"
 #include "fp_timer.h"
 #include "igmp.h"
 #include "watchdog.h"
+#include "perf_counters.h"
 #include "../graph-algo/admissible.h"
 #include "../graph-algo/path_selection.h"
 #include "../protocol/flags.h"
 #include "../protocol/fpproto.h"
 #include "../protocol/pacer.h"
+#include "../protocol/probes.h"
 #include "../protocol/stat_print.h"
 #include "../protocol/topology.h"
 #include "../protocol/platform.h"
@@ -35,11 +38,11 @@
 #define PKTDESC_MEMPOOL_SIZE			(FASTPASS_WND_LEN * MAX_NODES + (N_COMM_CORES - 1) * PKTDESC_MEMPOOL_CACHE_SIZE)
 /* should have as many pktdesc objs as number of in-flight packets */
 
-#define ALLOC_REPORT_QUEUE_SIZE		(1UL << (FP_NODES_SHIFT + 1))
-#define ALLOC_REPORT_QUEUE_MASK		(ALLOC_REPORT_QUEUE_SIZE - 1)
-
 #define IGMP_SEND_INTERVAL_SEC		10
 
+/* maximum number of destinations in one A-REQ (6 bit count) */
+#define AREQ_MAX_DSTS				64
+
 /* kill packet to shut off the arbiter remotely */
 #define	IPPROTO_FASTPASS_KILL		225
 
@@ -75,21 +78,6 @@ struct pending_alloc_queue {
 	uint32_t				tail;
 };
 
-/**
- * A queue to record which destination flows have reports that need to be sent
- * to this endpoint.
- * @is_pending: 1 or 0 indicating whether each dst flow is pending or not
- * @q_pending: a queue of dsts that are pending
- * @head: head index for q_pending
- * @tail: tail index for q_pending
- */
-struct alloc_report_queue {
-	uint8_t is_pending[MAX_FLOWS];
-	uint16_t q_pending[ALLOC_REPORT_QUEUE_SIZE];
-	uint32_t head;
-	uint32_t tail;
-};
-
 /**
  * Information about an end node
  * @conn: connection state (ACKs, RESET, retransmission, etc)
@@ -98,10 +86,11 @@ struct alloc_report_queue {
  * @dst_ip: the destination IP for outgoing packets
  * @controller_ip: the controller IP outgoing packets should use
  * @pending_allocs: a queue of pending allocations not yet sent out
- * @demands: the total demand to each destination flow
- * @alloc_to_dst: the total allocation to each destination flow
- * @acked_allocs: the total acked allocation to each destination flow
- * @report_queue: a queue of destination flows that have pending reports
+ * @flows: the total demand, allocation and acked allocation to each
+ *    destination flow the endpoint requested since its last reset, and a
+ *    queue of destination flows that have pending reports
+ * @total_demand: the sum of the demands in @flows. The log core reads this
+ *    rather than @flows, which the comm core may reallocate at any time.
  */
 struct end_node_state {
 	struct fpproto_conn conn;
@@ -113,13 +102,9 @@ struct end_node_state {
 	/* pending allocations */
 	struct pending_alloc_queue pending_allocs;
 
-	/* demands */
-	uint32_t demands[MAX_FLOWS];
-
-	/* allocated timeslots */
-	uint32_t alloc_to_dst[MAX_FLOWS];
-	uint32_t acked_allocs[MAX_FLOWS];
-	struct alloc_report_queue report_queue;
+	/* demands and allocated timeslots */
+	struct flow_table flows;
+	uint64_t total_demand;
 
 	/* timeout timer */
 	struct fp_timer timeout_timer;
@@ -186,6 +171,9 @@ void comm_init_global_structs(uint64_t first_time_slot)
 		fpproto_init_conn(&en->conn, &proto_ops, en,
 						FASTPASS_RESET_WINDOW_NS, send_timeout);
 		en->pending_allocs.tail = en->pending_allocs.head = 0;
+		if (flow_table_init(&en->flows) != 0)
+			rte_exit(EXIT_FAILURE,
+					"Could not allocate flow table for node %u\n", i);
 		fp_init_timer(&en->timeout_timer);
 		fp_init_timer(&en->tx_timer);
 		pacer_init_full(&en->tx_pacer, now, send_cost, max_burst,
@@ -230,32 +218,17 @@ void comm_init_core(uint16_t lcore_id, uint64_t first_time_slot)
 }
 
 /**
- * Trigger a transmission to an endpoint @en to report unACKed info about @dst.
+ * Trigger a transmission to an endpoint @en to report unACKed info about
+ * @flow.
  */
 static inline void trigger_report(struct end_node_state *en,
-		struct alloc_report_queue *q, uint16_t dst) {
-	if (q->is_pending[dst])
+		struct flow_state *flow) {
+	if (!flow_table_push_pending(&en->flows, flow))
 		return;
-	q->is_pending[dst] = 1;
-	q->q_pending[q->tail & ALLOC_REPORT_QUEUE_MASK] = dst;
-	q->tail++;
-	comm_log_triggered_report(en - end_nodes, dst);
+	comm_log_triggered_report(en - end_nodes, flow->flow);
 	trigger_request(en);
 }
 
-static inline bool report_empty(struct alloc_report_queue *q) {
-	return q->head == q->tail;
-}
-
-static inline uint16_t report_pop(struct alloc_report_queue *q) {
-	assert(!report_empty(q));
-	uint16_t node = q->q_pending[q->head & ALLOC_REPORT_QUEUE_MASK];
-	assert(!!q->is_pending[node]);
-	q->is_pending[node] = 0;
-	q->head++;
-	return node;
-}
-
 void benchmark_cost_of_get_time(void)
 {
 	uint32_t i;
@@ -306,12 +279,80 @@ static void set_retrans_timer(void *param, u64 when)
 	comm_log_set_timer(node_id, when, when - now);
 }
 
+/**
+ * Decode the (dst, count) pairs of an A-REQ into @dsts and @counts.
+ * Returns the number of leading pairs with a valid destination.
+ */
+static inline int decode_areq(u32 node_id, u16 *dst_and_count, int n,
+		u16 *dsts, u16 *counts)
+{
+	int i, n_valid;
+
+	/* byte-swap all pairs first, this loop has no branches */
+	for (i = 0; i < n; i++) {
+		dsts[i] = rte_be_to_cpu_16(dst_and_count[2*i]);
+		counts[i] = rte_be_to_cpu_16(dst_and_count[2*i + 1]);
+	}
+
+	for (n_valid = 0; n_valid < n; n_valid++) {
+		if (unlikely(!((dsts[n_valid] >> FLOW_SHIFT) < arbiter_num_nodes))) {
+			comm_log_areq_invalid_dst(node_id, dsts[n_valid]);
+			break;
+		}
+	}
+	return n_valid;
+}
+
+/**
+ * Find the flow state of each decoded pair in the flow table of @en, adding
+ * flows it does not have yet. Returns the number of leading pairs with a flow.
+ */
+static inline int lookup_areq_flows(struct end_node_state *en, u32 node_id,
+		int n, u16 *dsts, struct flow_state **flows)
+{
+	int i;
+
+	/* grow the table first, adding flows must not move the ones found */
+	flow_table_reserve(&en->flows, n);
+
+	for (i = 0; i < n; i++) {
+		flows[i] = flow_table_find_or_add(&en->flows, dsts[i]);
+		if (unlikely(flows[i] == NULL)) {
+			comm_log_flow_table_full(node_id, dsts[i]);
+			break;
+		}
+	}
+	return i;
+}
+
+/**
+ * Compute the new demand for each decoded pair, from the 16 least significant
+ * bits of the demand reported by the endpoint.
+ */
+static inline void compute_areq_demands(int n, struct flow_state **flows,
+		u16 *counts, u32 *orig_demands, u32 *demands)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+		orig_demands[i] = flows[i]->demand;
+
+	/* straight-line arithmetic so the compiler can vectorize it */
+	for (i = 0; i < n; i++) {
+		u32 demand = orig_demands[i] - (1UL << 15);
+		demands[i] = demand + ((counts[i] - demand) & 0xFFFF);
+	}
+}
+
 static void handle_areq(void *param, u16 *dst_and_count, int n)
 {
-	int i, j;
+	int i, j, n_valid;
 	struct end_node_state *en = (struct end_node_state *)param;
 	struct comm_core_state *core = &ccore_state[rte_lcore_id()];
-	u16 dst, dst_node, flow_within_dst, count;
+	u16 dst;
+	u16 dsts[AREQ_MAX_DSTS], counts[AREQ_MAX_DSTS];
+	struct flow_state *flows[AREQ_MAX_DSTS];
+	u32 orig_demands[AREQ_MAX_DSTS], demands[AREQ_MAX_DSTS];
 	u32 demand;
 	u32 orig_demand;
 	u32 node_id = en - end_nodes;
@@ -321,6 +362,13 @@ static void handle_areq(void *param, u16 *dst_and_count, int n)
 
 	COMM_DEBUG("handling A-REQ with %d destinations\n", n);
 
+	if (unlikely(n == 0))
+		goto out;
+	if (unlikely(!(node_id < arbiter_num_nodes))) {
+		comm_log_areq_invalid_src(node_id);
+		return;
+	}
+
 #if defined(EMULATION_ALGO)
 	areq_data_counts = (u8 *) (dst_and_count + 2*n);
 	areq_data = areq_data_counts + n;
@@ -328,22 +376,23 @@ static void handle_areq(void *param, u16 *dst_and_count, int n)
 		areq_data++; /* padded to even number */
 #endif
 
-	for (i = 0; i < n; i++) {
-		dst = rte_be_to_cpu_16(dst_and_count[2*i]);
-		dst_node = dst >> FLOW_SHIFT;
-		count = rte_be_to_cpu_16(dst_and_count[2*i + 1]);
-		if (unlikely(!(node_id < NUM_NODES))) {
-			comm_log_areq_invalid_src(node_id);
-			return;
-		}
-		if (unlikely(!(dst_node < NUM_NODES))) {
-			comm_log_areq_invalid_dst(node_id, dst);
-			return;
+	/* decode and compute demands for the whole A-REQ before touching the
+	 * backlog */
+	n_valid = decode_areq(node_id, dst_and_count, n, dsts, counts);
+	n_valid = lookup_areq_flows(en, node_id, n_valid, dsts, flows);
+	compute_areq_demands(n_valid, flows, counts, orig_demands, demands);
+
+	for (i = 0; i < n_valid; i++) {
+		dst = dsts[i];
+		orig_demand = orig_demands[i];
+		demand = demands[i];
+		if (unlikely(flows[i]->demand != orig_demand)) {
+			/* dst appeared earlier in this A-REQ, recompute */
+			orig_demand = flows[i]->demand;
+			demand = orig_demand - (1UL << 15);
+			demand += (counts[i] - demand) & 0xFFFF;
 		}
 
-		orig_demand = en->demands[dst];
-		demand = orig_demand - (1UL << 15);
-		demand += (count - demand) & 0xFFFF;
 		demand_diff = (s32)demand - (s32)orig_demand;
 		if (demand_diff > 0) {
 			comm_log_demand_increased(node_id, dst, orig_demand, demand, demand_diff);
@@ -367,7 +416,9 @@ static void handle_areq(void *param, u16 *dst_and_count, int n)
 				}
 			}
 
-			/* get the sequential ID from the demand, also pass in areq data */
+			/* get the sequential ID from the demand, also pass in areq data.
+			 * the emulation stages the packets and enqueues them to each
+			 * endpoint group in bulk on flush_backlog() */
 			add_backlog(g_admissible_status(), node_id, dst, demand_diff,
 					orig_demand & 0xFFFF, areq_data);
 			areq_data += emu_req_data_bytes() * (*areq_data_counts);
@@ -377,12 +428,17 @@ static void handle_areq(void *param, u16 *dst_and_count, int n)
 			add_backlog(g_admissible_status(), node_id, dst, demand_diff, 0,
 					NULL);
 #endif
-			en->demands[dst] = demand;
+			en->total_demand += demand - flows[i]->demand;
+			flows[i]->demand = demand;
 		} else {
 			comm_log_demand_remained(node_id, dst, orig_demand, demand);
 		}
 	}
 
+	if (unlikely(n_valid < n))
+		return;
+
+out:
 	trigger_request(en);
 }
 
@@ -394,15 +450,10 @@ static void handle_reset(void *param)
 	comm_log_handle_reset(node_id, en->conn.in_sync);
 
 	reset_sender(g_admissible_status(), node_id);
-	memset(en->demands, 0, sizeof(en->alloc_to_dst));
-	memset(en->alloc_to_dst, 0, sizeof(en->alloc_to_dst));
-	memset(en->acked_allocs, 0, sizeof(en->acked_allocs));
-
-	/* report queue */
-	en->report_queue.head = 0;
-	en->report_queue.tail = 0;
-	memset(en->report_queue.is_pending, 0,
-			sizeof(en->report_queue.is_pending));
+
+	/* flows and report queue */
+	flow_table_reset(&en->flows);
+	en->total_demand = 0;
 }
 
 static void handle_skipped_ack(void *param, struct fpproto_pktdesc *pd)
@@ -413,6 +464,7 @@ static void handle_skipped_ack(void *param, struct fpproto_pktdesc *pd)
 #if defined(RETRANSMIT_UNACKED_ALLOCS)
 	struct pending_alloc_queue *pending_q = &en->pending_allocs;
 	struct pending_alloc *alloc;
+	struct flow_state *flow;
 	u8 descriptor;
 	int i;
 
@@ -431,8 +483,11 @@ static void handle_skipped_ack(void *param, struct fpproto_pktdesc *pd)
 	}
 
 	/* trigger reports for affected dsts */
-	for (i = 0; i < pd->n_dsts; i++)
-		trigger_report(en, &en->report_queue, pd->dsts[i]);
+	for (i = 0; i < pd->n_dsts; i++) {
+		flow = flow_table_find(&en->flows, pd->dsts[i]);
+		if (flow != NULL)
+			trigger_report(en, flow);
+	}
 #endif
 
 	comm_log_skipped_ack(node_id, pd->used_alloc_tslot, pd->seqno, pd->n_dsts);
@@ -443,16 +498,20 @@ static void handle_neg_ack(void *param, struct fpproto_pktdesc *pd)
 	struct end_node_state *en = (struct end_node_state *)param;
 	struct comm_core_state *core = &ccore_state[rte_lcore_id()];
 	uint16_t node_id = en - end_nodes;
+	struct flow_state *flow;
 	int i;
 	uint32_t num_triggered = 0;
 
 	/* if the alloc report was not fully acked, trigger another report */
 	for (i = 0; i < pd->n_areq; i++) {
 		uint16_t dst = (uint16_t)pd->areq[i].src_dst_key;
-		if ((int32_t)pd->areq[i].tslots - (int32_t)en->acked_allocs[dst] > 0) {
+		flow = flow_table_find(&en->flows, dst);
+		if (flow == NULL)
+			continue; /* the endpoint reset since the report */
+		if ((int32_t)pd->areq[i].tslots - (int32_t)flow->acked > 0) {
 
 			/* still not acked, trigger a report to end node*/
-			trigger_report(en, &en->report_queue, dst);
+			trigger_report(en, flow);
 			num_triggered++;
 		}
 	}
@@ -468,24 +527,32 @@ static void handle_ack(void *param, struct fpproto_pktdesc *pd)
 	uint16_t node_id = en - end_nodes;
 	uint32_t total_acked = 0;
 	uint16_t dst_count;
+	struct flow_state *flow;
 	int i;
 
+	/* flows missing from the table were reset since the packet was sent */
 #if defined(RETRANSMIT_UNACKED_ALLOCS)
 	/* ack the ALLOCs in the packet rather than the cumulative counts */
 	for (i = 0; i < pd->used_alloc_tslot; i++) {
 		uint16_t dst = pd->dsts[(pd->tslot_desc[i] >> 4) - 1];
-		en->acked_allocs[dst]++;
+		flow = flow_table_find(&en->flows, dst);
+		if (flow == NULL)
+			continue;
+		flow->acked++;
 		total_acked++;
 	}
 #else
 	for (i = 0; i < pd->n_areq; i++) {
 		uint16_t dst = (uint16_t)pd->areq[i].src_dst_key;
+		flow = flow_table_find(&en->flows, dst);
+		if (flow == NULL)
+			continue;
 		int32_t new_acked =
-				(int32_t)pd->areq[i].tslots - (int32_t)en->acked_allocs[dst];
+				(int32_t)pd->areq[i].tslots - (int32_t)flow->acked;
 
 		if (new_acked > 0) {
 			/* newly acked timeslots, update */
-			en->acked_allocs[dst] += new_acked;
+			flow->acked += new_acked;
 			total_acked += new_acked;
 		}
 	}
@@ -816,6 +883,7 @@ static inline void process_allocated_traffic_one_q(
 	struct end_node_state *en;
 	struct pending_alloc_queue *pending_q;
 	struct pending_alloc *alloc;
+	struct flow_state *flow;
 	uint16_t src;
 	uint16_t dst;
 	uint8_t flags;
@@ -844,6 +912,15 @@ static inline void process_allocated_traffic_one_q(
 			en = &end_nodes[src];
 			pending_q = &en->pending_allocs;
 
+			/* find the flow first, an alloc without one could never be
+			 * reported, so drop it */
+			flow_table_reserve(&en->flows, 1);
+			flow = flow_table_find_or_add(&en->flows, dst);
+			if (unlikely(flow == NULL)) {
+				comm_log_flow_table_full(src, dst);
+				continue;
+			}
+
 			/* is the timeslot queue full? aka is head one more than tail? */
 			if (pending_q->head == pending_q->tail + 1) {
 				tslot = pending_q->allocs[wnd_pos(pending_q->head)].timeslot;
@@ -863,10 +940,11 @@ static inline void process_allocated_traffic_one_q(
 			alloc->flags = flags & FLAGS_MASK;
 			alloc->timeslot = (current_timeslot >> 4) & 0xFFFF;
 			fill_algo_fields_in_alloc(alloc, admitted[i], j);
-			en->alloc_to_dst[dst]++;
+
+			flow->alloc++;
 
 			/* trigger_report will make sure a TX is triggered */
-			trigger_report(en, &en->report_queue, dst);
+			trigger_report(en, flow);
 		}
 	}
 	/* free memory */
@@ -904,20 +982,20 @@ static inline void fill_packet_report(struct comm_core_state *core,
 
 	pd->n_areq = 0;
 
-	while (!report_empty(&en->report_queue)
+	while (flow_table_has_pending(&en->flows)
 			&& pd->n_areq < FASTPASS_PKT_MAX_AREQ) {
-		uint16_t node = report_pop(&en->report_queue);
-		pd->areq[pd->n_areq].src_dst_key = node;
+		struct flow_state *flow = flow_table_pop_pending(&en->flows);
+		pd->areq[pd->n_areq].src_dst_key = flow->flow;
 
 		/* AREQ should not include allocs that have not been sent, due to
 		 * limits on the number of allocs per control packet */
 		unsent_allocs = pending_q->tail - pending_q->head;
-		pd->areq[pd->n_areq].tslots = en->alloc_to_dst[node] - unsent_allocs;
+		pd->areq[pd->n_areq].tslots = flow->alloc - unsent_allocs;
 		pd->n_areq++;
 	}
 
 	/* if report queue is still not empty, we should trigger another packet */
-	if (!report_empty(&en->report_queue))
+	if (flow_table_has_pending(&en->flows))
 		trigger_request(en);
 }
 
@@ -1162,6 +1240,7 @@ void exec_comm_core(struct comm_core_cmd * cmd)
 	qconf = &lcore_conf[lcore_id];
 
 	comm_log_init(&comm_core_logs[lcore_id]);
+	perf_log_open(&perf_logs[lcore_id], "comm loop");
 
 	COMM_DEBUG("starting, on lcore %d, current timeslot %lu\n", rte_lcore_id(),
 			core->latest_timeslot[0]);
@@ -1188,6 +1267,8 @@ void exec_comm_core(struct comm_core_cmd * cmd)
 
 	/* MAIN LOOP */
 	while (1) {
+		perf_phase_begin(&perf_logs[lcore_id]);
+
 		/* read packets from RX queues */
 		saw_watchdog = do_rx_burst(qconf, portid, rx_queue, tx_queue,
 									pktmbuf_pool);
@@ -1205,6 +1286,7 @@ void exec_comm_core(struct comm_core_cmd * cmd)
 
 			/* log */
 			comm_log_retrans_timer_expired(en - end_nodes, now);
+			FP_PROBE2(retrans_timer, en - end_nodes, &en->conn);
 
 			/* call the handler */
 			fpproto_handle_timeout(&en->conn, now);
@@ -1213,13 +1295,9 @@ void exec_comm_core(struct comm_core_cmd * cmd)
 		/* Process newly allocated timeslots */
 		process_allocated_traffic(core, cmd->q_allocated, admitted_traffic_mempool);
 
-		/* Process the spent demands, launching a new demand for demands where
-		 * backlog increased while the original demand was being allocated */
-		handle_spent_demands(g_admissible_status());
-
 		/* RX, retrans timers, and new traffic might push traffic into the
 		 * q_head buffer; flush it now. */
-		flush_backlog(g_admissible_status());
+		flush_backlog(g_admissible_status(), cmd->comm_core_index);
 
 		/* process tx timers */
 		fp_timer_get_expired(&core->tx_timers, now, &lst);
@@ -1250,13 +1328,12 @@ void exec_comm_core(struct comm_core_cmd * cmd)
         /* Flush queued packets */
 		send_queued_packets(portid, tx_queue);
 
+		perf_phase_end(&perf_logs[lcore_id]);
 	}
 }
 
 void comm_dump_stat(uint16_t node_id, struct conn_log_struct *conn_log)
 {
-	int i;
-	uint64_t ctr;
 	struct end_node_state *en = &end_nodes[node_id];
 
 	uint64_t now = rte_get_timer_cycles();
@@ -1266,9 +1343,6 @@ void comm_dump_stat(uint16_t node_id, struct conn_log_struct *conn_log)
 	conn_log->next_tx_gap = en->tx_timer.time * TIMER_GRANULARITY - now;
 	conn_log->pacer_gap = pacer_next_event(&en->tx_pacer) - now;
 
-	/* dump demands */
-	ctr = 0;
-	for (i = 0; i < MAX_FLOWS; i++)
-		ctr += en->demands[i];
-	conn_log->demands = ctr;
+	/* the flow table itself belongs to the comm core */
+	conn_log->demands = en->total_demand;
 }
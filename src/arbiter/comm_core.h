@@ -54,6 +54,7 @@ extern "C" {
  * @comm_core_index: the index of the core among the comm cores
  */
 struct comm_core_cmd {
+	uint16_t comm_core_index;
 	uint64_t start_time;
 	uint64_t end_time;
 
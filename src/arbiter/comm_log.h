@@ -41,6 +41,7 @@ struct comm_log {
 	uint64_t rx_truncated_pkt;
 	uint64_t areq_invalid_src;
 	uint64_t areq_invalid_dst;
+	uint64_t flow_table_full;
 	uint64_t areq_data_count_disagrees;
 	uint64_t demand_increased;
 	uint64_t demand_remained;
@@ -189,6 +190,12 @@ static inline void comm_log_areq_invalid_dst(uint32_t requesting_node,
 			requesting_node, dest);
 }
 
+static inline void comm_log_flow_table_full(uint32_t node, uint16_t dst) {
+	(void)node;(void)dst;
+	CL->flow_table_full++;
+	COMM_DEBUG("flow table of node %u has no space for dst %u\n", node, dst);
+}
+
 static inline void comm_log_areq_data_count_disagrees(uint32_t requesting_node,
 		uint16_t dst, uint8_t areq_count, int32_t demand_diff) {
 	(void)requesting_node; (void) dst; (void) areq_count; (void) demand_diff;
@@ -19,6 +19,11 @@
 #define MAX_Q_ADMITTED	64
 #define MAX_ADMITTED_MEMPOOLS	64
 
+#ifdef STRESS_TEST_SIZE_CDF_FILE
+/* shared by all stress test cores */
+static struct request_size_cdf stress_test_size_cdf;
+#endif
+
 int control_do_queue_allocation(void)
 {
 	int ret, i, j;
@@ -75,10 +80,17 @@ void launch_comm_cores(uint64_t start_time, uint64_t end_time,
 				"comm core supports 1 queue, %d were configured\n",
 				lcore_conf[rte_lcore_id()].n_rx_queue);
 
-	/* TODO: support multiple comm cores */
-	assert(N_COMM_CORES == 1);
+	/* all RX queues go to this core (see conf_alloc_rx_queue above), and the
+	 * state of each endpoint is only touched by the core that receives its
+	 * packets, so there is exactly one comm core. several comm cores are
+	 * only supported by the stress test, which generates its own demands. */
+	if (N_COMM_CORES != 1)
+		rte_exit(EXIT_FAILURE,
+				"comm cores support N_COMM_CORES 1, got %d; use the stress test for more\n",
+				N_COMM_CORES);
 
 	// Set commands
+	comm_cmd.comm_core_index = 0;
 	comm_cmd.start_time = start_time;
 	comm_cmd.end_time = end_time;
 	comm_cmd.q_allocated =
@@ -106,17 +118,33 @@ void launch_stress_test_cores(uint64_t start_time,
 {
 	struct stress_test_core_cmd cmd[N_COMM_CORES];
 	uint64_t hz = rte_get_timer_hz();
+	double mean_t_btwn_requests = STRESS_TEST_MEAN_T_BETWEEN_REQUESTS_SEC * hz;
+	const struct request_size_cdf *size_cdf = NULL;
 	uint16_t i;
 
+#ifdef STRESS_TEST_SIZE_CDF_FILE
+	if (load_request_size_cdf(&stress_test_size_cdf,
+			STRESS_TEST_SIZE_CDF_FILE) != 0)
+		rte_exit(EXIT_FAILURE, "Cannot load request size CDF from %s\n",
+				STRESS_TEST_SIZE_CDF_FILE);
+	size_cdf = &stress_test_size_cdf;
+	/* offer the same load as requests of STRESS_TEST_DEMAND_TSLOTS */
+	mean_t_btwn_requests *= size_cdf->mean / STRESS_TEST_DEMAND_TSLOTS;
+#endif
+
 	/* Prepare commands */
 	uint32_t node_index = 0;
 	uint32_t q_admitted_index = 0;
 	for (i = 0; i < N_COMM_CORES; i++) {
+		cmd[i].comm_core_index = i;
 		cmd[i].start_time = start_time;
 		cmd[i].end_time = start_time + hz * STRESS_TEST_DURATION_SEC;
 		cmd[i].first_time_slot = first_time_slot;
-		cmd[i].mean_t_btwn_requests = STRESS_TEST_MEAN_T_BETWEEN_REQUESTS_SEC * hz;
+		cmd[i].mean_t_btwn_requests = mean_t_btwn_requests;
 		cmd[i].demand_tslots = STRESS_TEST_DEMAND_TSLOTS;
+		cmd[i].size_cdf = size_cdf;
+		cmd[i].dst_pattern = STRESS_TEST_DST_PATTERN;
+		cmd[i].dst_param = STRESS_TEST_DST_PARAM;
 		cmd[i].num_initial_srcs = STRESS_TEST_INITIAL_SOURCES;
 		cmd[i].num_initial_dsts_per_src = STRESS_TEST_INITIAL_DSTS_PER_SRC;
 		cmd[i].initial_flow_size = STRESS_TEST_INITIAL_FLOW_SIZE;
@@ -127,7 +155,10 @@ void launch_stress_test_cores(uint64_t start_time,
 		cmd[i].num_q_allocated = cores_for_comm(i);
 		q_admitted_index += cmd[i].num_q_allocated;
 #else
-		cmd[i].num_nodes = remaining_nodes / (N_COMM_CORES - i);
+		/* split nodes like the sequential allocator's intakes, so each
+		 * core adds to its own */
+		cmd[i].num_nodes = ((i + 1) * STRESS_TEST_NUM_NODES) / N_COMM_CORES -
+				node_index;
 		cmd[i].q_allocated =
 					((N_PATH_SEL_CORES > 0) ? q_path_selected : q_admitted);
 #endif
@@ -231,6 +262,9 @@ void launch_cores(void)
 		topo_config.num_core_rtrs = 0;
 	else
 		topo_config.num_core_rtrs = 1;
+	topo_config.uplink_rate = EMU_UPLINK_RATE;
+	topo_config.host_link_delay = EMU_HOST_LINK_DELAY;
+	topo_config.uplink_delay = EMU_UPLINK_DELAY;
 
 	/* create a q_admitted_out for each algo core */
 	if (ALGO_N_CORES > MAX_Q_ADMITTED)
@@ -270,11 +304,13 @@ void launch_cores(void)
 	/* set commands */
 	path_sel_cmd.q_admitted = q_admitted[0];
 	path_sel_cmd.q_path_selected = q_path_selected;
+	path_sel_init_global();
 
-	/* launch admission core */
-	if (N_PATH_SEL_CORES > 0)
+	/* launch path selection cores, they select paths of different
+	 * timeslots in parallel */
+	for (i = 0; i < N_PATH_SEL_CORES; i++)
 		rte_eal_remote_launch(exec_path_sel_core, &path_sel_cmd,
-				enabled_lcore[FIRST_PATH_SEL_CORE]);
+				enabled_lcore[FIRST_PATH_SEL_CORE + i]);
 
 	/*** ADMISSION CORES ***/
 	/* initialize core structures */
@@ -5,6 +5,7 @@
 #ifndef CONTROL_H_
 #define CONTROL_H_
 
+#include <stdbool.h>
 #include <stdint.h>
 #include "../graph-algo/algo_config.h"
 
@@ -22,6 +23,15 @@ extern "C" {
 #define EMU_NUM_RACKS			1
 #endif
 #define SEPARATE_RACKS			1
+#ifndef EMU_UPLINK_RATE
+#define EMU_UPLINK_RATE			1 /* MTUs per timeslot on router-to-router links */
+#endif
+#ifndef EMU_HOST_LINK_DELAY
+#define EMU_HOST_LINK_DELAY		0 /* extra timeslots of propagation delay */
+#endif
+#ifndef EMU_UPLINK_DELAY
+#define EMU_UPLINK_DELAY		0
+#endif
 
 #define STRESS_TEST_IS_AUTOMATED        1
 #define STRESS_TEST_MEAN_T_BETWEEN_REQUESTS_SEC		.3e-3
@@ -31,6 +41,18 @@ extern "C" {
 #define STRESS_TEST_NUM_NODES					    128
 #endif
 #define STRESS_TEST_DEMAND_TSLOTS					10
+/* destinations of requests, see enum request_dst_pattern */
+#ifndef STRESS_TEST_DST_PATTERN
+#define STRESS_TEST_DST_PATTERN						REQ_DST_UNIFORM
+#endif
+#ifndef STRESS_TEST_DST_PARAM
+#define STRESS_TEST_DST_PARAM						0
+#endif
+/* define to draw request sizes from an empirical CDF, like
+ * "../rpc_tool/CDF_search.txt", instead of exponential sizes with mean
+ * STRESS_TEST_DEMAND_TSLOTS. Load stays the same: the time between requests
+ * is scaled by the mean of the CDF. */
+/* #define STRESS_TEST_SIZE_CDF_FILE	"../rpc_tool/CDF_search.txt" */
 #define STRESS_TEST_DURATION_SEC					120
 #define STRESS_TEST_RATE_INCREASE_FACTOR			2.0
 #define STRESS_TEST_RATE_INCREASE_GAP_SEC			5
@@ -57,8 +79,12 @@ extern "C" {
 #else
 #define N_ADMISSION_CORES		ALGO_N_CORES
 #endif
-#define N_PATH_SEL_CORES		0
-#define N_COMM_CORES			1
+#ifndef N_PATH_SEL_CORES
+#define N_PATH_SEL_CORES		0 /* more than 1 select paths of different timeslots in parallel */
+#endif
+#ifndef N_COMM_CORES
+#define N_COMM_CORES			1 /* the sequential allocator needs SEQ_N_INTAKES to match */
+#endif
 #define N_LOG_CORES				1
 #define N_BENCHMARK_CORES		0
 
@@ -102,10 +128,24 @@ extern "C" {
  */
 #define		Q_LOG_GAP_SECS		0.001
 
+/* how many seconds in between updates of live stats in shared memory */
+#define		LIVE_STATS_GAP_SECS	0.0001
+
 #define RTE_LOGTYPE_CONTROL RTE_LOGTYPE_USER1
 #define CONTROL_DEBUG(a...) RTE_LOG(DEBUG, CONTROL, ##a)
 #define CONTROL_INFO(a...) RTE_LOG(INFO, CONTROL, ##a)
 
+/**
+ * Number of endpoints, set on the command line. At most MAX_NODES, defaults
+ *    to NUM_NODES, or to the number of emulated endpoints if fewer.
+ */
+extern uint16_t arbiter_num_nodes;
+
+/**
+ * Whether arbiter_num_nodes was set on the command line
+ */
+extern bool arbiter_num_nodes_set;
+
 /**
  * Allocate queues to lcores
  */
@@ -0,0 +1,151 @@
+#!/usr/bin/python
+"""
+Converts the binary telemetry written by the log core (see telemetry.h) to
+CSV, or to Parquet with --parquet (needs pandas and pyarrow).
+
+usage: decode_telemetry.py [--parquet] log/telemetry-<time>.bin [out_prefix]
+
+Writes <out_prefix>-queues.csv with one row per router, port and sample:
+time_ns,router,port,enqueues,dequeues,occupancy
+and <out_prefix>-drops.csv with one row per emulation core, port and sample:
+time_ns,core,port,drops,marks
+If the emulation kept queue bank histograms, also writes <out_prefix>-hist.csv
+with one row per router, port and sample:
+time_ns,router,port,max_occupancy,occupancy_0,...,delay_0,...
+where column _b counts values in [2^(b-1), 2^b), and _0 counts zeros.
+"""
+
+import struct
+import sys
+
+TELEMETRY_MAGIC = b'FPTELEM\0'
+TELEMETRY_VERSION = 1
+TELEMETRY_QUEUE_BANK = 1
+TELEMETRY_PORT_DROPS = 2
+TELEMETRY_QUEUE_HIST = 3
+KNOWN_TYPES = (TELEMETRY_QUEUE_BANK, TELEMETRY_PORT_DROPS, TELEMETRY_QUEUE_HIST)
+
+FILE_HEADER = struct.Struct('=8sIHHHH4xQ')
+RECORD_HEADER = struct.Struct('=HHIQ')
+
+QUEUE_COLUMNS = ['time_ns', 'router', 'port', 'enqueues', 'dequeues',
+                 'occupancy']
+DROP_COLUMNS = ['time_ns', 'core', 'port', 'drops', 'marks']
+
+
+def hist_columns(n_buckets):
+    return (['time_ns', 'router', 'port', 'max_occupancy'] +
+            ['occupancy_%d' % b for b in range(n_buckets)] +
+            ['delay_%d' % b for b in range(n_buckets)])
+
+
+def read_records(f):
+    """Yields (type, index, time_ns, counters) for each record, where
+    counters is a tuple of all the counters in the record. Skips record types
+    this decoder does not know. The first item yielded is the header, as
+    (n_ports, n_hist_buckets)."""
+    data = f.read(FILE_HEADER.size)
+    if len(data) < FILE_HEADER.size:
+        raise ValueError('file too short for a telemetry header')
+    magic, version, n_ports, n_routers, n_cores, n_buckets, start_ns = \
+        FILE_HEADER.unpack(data)
+    if magic != TELEMETRY_MAGIC:
+        raise ValueError('not a telemetry file')
+    if version != TELEMETRY_VERSION:
+        raise ValueError('unknown telemetry version %d, expected %d' %
+                         (version, TELEMETRY_VERSION))
+    yield n_ports, n_buckets
+
+    while True:
+        data = f.read(RECORD_HEADER.size)
+        if len(data) < RECORD_HEADER.size:
+            return  # the log core may be in the middle of a write
+        rtype, index, length, time_ns = RECORD_HEADER.unpack(data)
+        payload = f.read(length)
+        if len(payload) < length:
+            return
+        if rtype not in KNOWN_TYPES:
+            continue
+        yield (rtype, index, time_ns,
+               struct.unpack('=%dQ' % (length // 8), payload))
+
+
+def decode(filename):
+    """Returns the number of histogram buckets, and the rows of queue, drop
+    and histogram samples in @filename"""
+    queues = []
+    drops = []
+    hists = []
+    with open(filename, 'rb') as f:
+        records = read_records(f)
+        n_ports, n_buckets = next(records)
+        for rtype, index, time_ns, counters in records:
+            first = counters[:n_ports]
+            if rtype == TELEMETRY_QUEUE_BANK:
+                second = counters[n_ports:]
+                for port in range(n_ports):
+                    queues.append((time_ns, index, port, first[port],
+                                   second[port], first[port] - second[port]))
+            elif rtype == TELEMETRY_PORT_DROPS:
+                second = counters[n_ports:]
+                for port in range(n_ports):
+                    drops.append((time_ns, index, port, first[port],
+                                  second[port]))
+            else:
+                # max occupancy per port, then occupancy and delay
+                # histograms, each n_buckets per port
+                occupancy = n_ports
+                delay = n_ports * (1 + n_buckets)
+                for port in range(n_ports):
+                    row = port * n_buckets
+                    hists.append(
+                        (time_ns, index, port, first[port]) +
+                        counters[occupancy + row:occupancy + row + n_buckets] +
+                        counters[delay + row:delay + row + n_buckets])
+    return n_buckets, queues, drops, hists
+
+
+def write_csv(filename, columns, rows):
+    with open(filename, 'w') as out:
+        out.write(','.join(columns) + '\n')
+        for row in rows:
+            out.write(','.join(str(x) for x in row) + '\n')
+
+
+def write_parquet(filename, columns, rows):
+    import pandas
+    pandas.DataFrame.from_records(rows, columns=columns).to_parquet(filename)
+
+
+def main(argv):
+    args = [a for a in argv[1:] if a != '--parquet']
+    parquet = len(args) != len(argv) - 1
+    if len(args) not in (1, 2):
+        sys.stderr.write(__doc__)
+        return -1
+
+    in_filename = args[0]
+    if len(args) == 2:
+        prefix = args[1]
+    elif in_filename.endswith('.bin'):
+        prefix = in_filename[:-len('.bin')]
+    else:
+        prefix = in_filename
+
+    n_buckets, queues, drops, hists = decode(in_filename)
+    if parquet:
+        write_parquet(prefix + '-queues.parquet', QUEUE_COLUMNS, queues)
+        write_parquet(prefix + '-drops.parquet', DROP_COLUMNS, drops)
+        if hists:
+            write_parquet(prefix + '-hist.parquet', hist_columns(n_buckets),
+                          hists)
+    else:
+        write_csv(prefix + '-queues.csv', QUEUE_COLUMNS, queues)
+        write_csv(prefix + '-drops.csv', DROP_COLUMNS, drops)
+        if hists:
+            write_csv(prefix + '-hist.csv', hist_columns(n_buckets), hists)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
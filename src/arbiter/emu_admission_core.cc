@@ -7,6 +7,7 @@
 
 #include "emu_admission_core.h"
 
+#include <rte_debug.h>
 #include <rte_errno.h>
 #include <rte_string_fns.h>
 #include <pthread.h>
@@ -15,6 +16,8 @@
 
 #include "admission_core_common.h"
 #include "admission_log.h"
+#include "control.h"
+#include "perf_counters.h"
 #include "../emulation/admitted.h"
 #include "../emulation/emulation.h"
 #include "../emulation/emulation_core.h"
@@ -172,6 +175,25 @@ void emu_admission_init_global(struct rte_ring **q_admitted_out,
                 l_args.q_capacity);
     rtype = R_LSTF;
     rtr_args = &l_args;
+#elif defined(DCTCP_PRIO_CORE)
+    struct dctcp_prio_uplink_args tor_args;
+    tor_args.dctcp.q_capacity = 1024;
+    tor_args.dctcp.K_threshold = 65;
+    tor_args.uplink_q_capacity = 256; /* divide 1024 evenly amongst queues */
+    struct drop_tail_args core_args;
+    core_args.q_capacity = 256;
+    struct mixed_router_args mixed_args;
+    mixed_args.tor_type = R_DCTCP_prio_uplinks;
+    mixed_args.tor_args = &tor_args;
+    mixed_args.core_type = R_Prio_by_flow;
+    mixed_args.core_args = &core_args;
+	RTE_LOG(INFO, ADMISSION,
+			"Using DCTCP ToRs with q_capacity %d and K threshold %d, and Priority Queueing by flow uplinks and core with q_capacity %d\n",
+			tor_args.dctcp.q_capacity, tor_args.dctcp.K_threshold,
+			core_args.q_capacity);
+
+    rtype = R_Mixed;
+    rtr_args = &mixed_args;
 #else
 #error "Unrecognized router type"
 #endif
@@ -180,8 +202,18 @@ void emu_admission_init_global(struct rte_ring **q_admitted_out,
     RTE_LOG(INFO, ADMISSION, "running with TSO (TCP Segmentation Offload)\n");
 #endif
 
+    /* A-REQs are validated against arbiter_num_nodes, so every node must be
+     * an endpoint of the emulated topology */
+    if (arbiter_num_nodes > num_endpoints(topo_config)) {
+    	if (arbiter_num_nodes_set)
+    		rte_exit(EXIT_FAILURE,
+    				"-n %u nodes, but the emulated topology has %u endpoints\n",
+    				arbiter_num_nodes, num_endpoints(topo_config));
+    	arbiter_num_nodes = num_endpoints(topo_config);
+    }
+
     RTE_LOG(INFO, ADMISSION, "setup info: %d nodes, flow shift %d, comm cores: %d\n",
-            NUM_NODES, FLOW_SHIFT, N_COMM_CORES);
+            arbiter_num_nodes, FLOW_SHIFT, N_COMM_CORES);
 
 	g_emulation = new Emulation((fp_mempool **) admitted_traffic_mempool,
 			(fp_ring **) q_admitted_out, (1 << PACKET_Q_LOG_SIZE), rtype,
@@ -211,6 +243,8 @@ int exec_emu_admission_core(void *void_cmd_p)
 			rte_lcore_id(), rte_lcore_to_socket_id(rte_lcore_id()), core_ind,
 			cmd->start_timeslot, tslot);
 
+	perf_log_open(&perf_logs[rte_lcore_id()], "emulation step");
+
 	while (1) {
 		/* re-calibrate clock */
 		uint64_t real_time = fp_get_time_ns();
@@ -232,7 +266,9 @@ int exec_emu_admission_core(void *void_cmd_p)
 			admission_log_allocation_begin(logical_timeslot);
 
 			/* perform allocation on this core */
+			perf_phase_begin(&perf_logs[rte_lcore_id()]);
 			core->step();
+			perf_phase_end(&perf_logs[rte_lcore_id()]);
 
 			admission_log_allocation_end(logical_timeslot);
 
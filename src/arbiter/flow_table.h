@@ -0,0 +1,283 @@
+/*
+ * flow_table.h
+ *
+ *  Created on: October 19, 2026
+ */
+
+#ifndef FLOW_TABLE_H_
+#define FLOW_TABLE_H_
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../graph-algo/platform.h"
+#include "../protocol/topology.h"
+
+/* tables are indexed directly by flow if there are at most this many flows */
+#define FLOW_TABLE_DIRECT_MAX	1024
+
+/* a new hashed table has 2^FLOW_TABLE_MIN_SHIFT slots */
+#ifndef FLOW_TABLE_MIN_SHIFT
+#define FLOW_TABLE_MIN_SHIFT	6
+#endif
+
+#if (MAX_FLOWS <= FLOW_TABLE_DIRECT_MAX)
+#define FLOW_TABLE_DIRECT		1
+#else
+#define FLOW_TABLE_DIRECT		0
+#endif
+
+/**
+ * Comm core state of one flow of an endpoint, i.e. a destination and flow as
+ *    encoded in A-REQs and ALLOCs
+ * @flow: the flow
+ * @used: 1 if the slot holds a flow, 0 otherwise
+ * @pending: 1 if the flow has a report waiting to be sent, 0 otherwise
+ * @demand: the total demand of the flow
+ * @alloc: the total allocation to the flow
+ * @acked: the total acked allocation to the flow
+ */
+struct flow_state {
+	uint16_t flow;
+	uint8_t used;
+	uint8_t pending;
+	uint32_t demand;
+	uint32_t alloc;
+	uint32_t acked;
+};
+
+/**
+ * The flows of an endpoint, and the flows with reports pending to it.
+ *
+ * If MAX_FLOWS is small, the table has a slot per flow. Otherwise it is an
+ *    open-addressed hash table with linear probing, that starts small and
+ *    doubles when half of its slots are used, so it takes memory (and cache)
+ *    in the flows the endpoint uses rather than in MAX_FLOWS.
+ *
+ * The endpoint only sends the 16 low bits of its counters, which the comm
+ *    core extends from the totals of the flow, so a flow keeps its slot
+ *    until the connection resets, and flow_table_reset() then recycles all
+ *    slots. Only the comm core of the endpoint touches the table; growing it
+ *    frees the old slots, so other cores must not read them.
+ *
+ *    flows: the slots, a power of two of them
+ *    pending: a ring of flows with pending reports, with as many entries as
+ *        slots, so it cannot overflow
+ *    mask: number of slots minus one
+ *    hash_shift: 32 - log2(number of slots)
+ *    n_flows: number of slots in use
+ *    pending_head: head index for pending
+ *    pending_tail: tail index for pending
+ */
+struct flow_table {
+	struct flow_state *flows;
+	uint16_t *pending;
+	uint32_t mask;
+	uint32_t hash_shift;
+	uint32_t n_flows;
+	uint32_t pending_head;
+	uint32_t pending_tail;
+};
+
+// Internal. Allocates @n_slots empty slots and the pending ring.
+// Returns 0 if successful, -1 on error.
+static inline
+int _flow_table_alloc(struct flow_table *table, uint32_t n_slots)
+{
+	table->flows = (struct flow_state *) fp_calloc("flow_table_flows",
+			n_slots, sizeof(struct flow_state));
+	table->pending = (uint16_t *) fp_malloc("flow_table_pending",
+			n_slots * sizeof(uint16_t));
+	if (table->flows == NULL || table->pending == NULL) {
+		fp_free(table->flows);
+		fp_free(table->pending);
+		return -1;
+	}
+
+	table->mask = n_slots - 1;
+	table->hash_shift = 32 - __builtin_ctz(n_slots);
+	return 0;
+}
+
+/**
+ * Allocates an empty flow table.
+ * Returns 0 if successful, -1 on error.
+ */
+static inline
+int flow_table_init(struct flow_table *table)
+{
+	table->n_flows = 0;
+	table->pending_head = table->pending_tail = 0;
+	return _flow_table_alloc(table,
+			FLOW_TABLE_DIRECT ? MAX_FLOWS : (1 << FLOW_TABLE_MIN_SHIFT));
+}
+
+static inline
+void flow_table_free(struct flow_table *table)
+{
+	fp_free(table->flows);
+	fp_free(table->pending);
+	table->flows = NULL;
+	table->pending = NULL;
+}
+
+/**
+ * Forgets all flows and pending reports. The table keeps its size.
+ */
+static inline
+void flow_table_reset(struct flow_table *table)
+{
+	memset(table->flows, 0, (table->mask + 1) * sizeof(struct flow_state));
+	table->n_flows = 0;
+	table->pending_head = table->pending_tail = 0;
+}
+
+// Internal. Get the first slot to probe for a flow
+static inline __attribute__((always_inline))
+uint32_t _flow_table_slot(struct flow_table *table, uint16_t flow) {
+#if FLOW_TABLE_DIRECT
+	(void) table;
+	return flow;
+#else
+	/* multiplicative hashing, take the high bits */
+	return (uint32_t)((flow + 1) * 2654435761U) >> table->hash_shift;
+#endif
+}
+
+// Internal. Returns the slot of the flow, or the empty slot where it would
+// be added
+static inline __attribute__((always_inline))
+struct flow_state *_flow_table_probe(struct flow_table *table, uint16_t flow)
+{
+	uint32_t i = _flow_table_slot(table, flow);
+	struct flow_state *f;
+
+	while (1) {
+		f = &table->flows[i];
+		if (!f->used || f->flow == flow)
+			return f;
+		i = (i + 1) & table->mask;
+	}
+}
+
+// Internal. Doubles the number of slots. Returns 0 if successful, -1 if
+// memory could not be allocated, in which case the table is unchanged.
+static inline
+int _flow_table_grow(struct flow_table *table)
+{
+	struct flow_table old = *table;
+	uint32_t i, n_pending = 0;
+
+	if (_flow_table_alloc(table, 2 * (old.mask + 1)) != 0) {
+		*table = old;
+		return -1;
+	}
+
+	for (i = 0; i <= old.mask; i++)
+		if (old.flows[i].used)
+			*_flow_table_probe(table, old.flows[i].flow) = old.flows[i];
+
+	/* keep pending reports in order */
+	for (i = old.pending_head; i != old.pending_tail; i++)
+		table->pending[n_pending++] = old.pending[i & old.mask];
+	table->pending_head = 0;
+	table->pending_tail = n_pending;
+
+	flow_table_free(&old);
+	return 0;
+}
+
+/**
+ * Makes room for @n more flows, so that the next @n calls to
+ *    flow_table_find_or_add() find a slot. Growing moves the slots, so
+ *    pointers to flow state from before the call are no longer valid.
+ * Returns 0 if successful, -1 if memory could not be allocated.
+ */
+static inline
+int flow_table_reserve(struct flow_table *table, uint32_t n)
+{
+	if (FLOW_TABLE_DIRECT)
+		return 0; /* every flow has a slot */
+
+	/* keep the load factor at most 1/2 */
+	while (unlikely(2 * (table->n_flows + n) > table->mask + 1))
+		if (_flow_table_grow(table) != 0)
+			return -1;
+	return 0;
+}
+
+/**
+ * Returns the state of @flow, or NULL if the table has no state for it
+ */
+static inline __attribute__((always_inline))
+struct flow_state *flow_table_find(struct flow_table *table, uint16_t flow)
+{
+	struct flow_state *f = _flow_table_probe(table, flow);
+	return f->used ? f : NULL;
+}
+
+/**
+ * Returns the state of @flow, adding zeroed state if the table has none.
+ *    Never moves slots. Returns NULL if the table has no space for another
+ *    flow, which flow_table_reserve() prevents.
+ */
+static inline __attribute__((always_inline))
+struct flow_state *flow_table_find_or_add(struct flow_table *table,
+		uint16_t flow)
+{
+	struct flow_state *f = _flow_table_probe(table, flow);
+
+	if (f->used)
+		return f;
+
+	/* beyond three quarters, probes get long */
+	if (!FLOW_TABLE_DIRECT
+			&& unlikely(4 * table->n_flows >= 3 * (table->mask + 1)))
+		return NULL;
+
+	/* slots are zeroed on reset and when allocated */
+	table->n_flows++;
+	f->flow = flow;
+	f->used = 1;
+	return f;
+}
+
+/**
+ * Queues a report for flow @f, if it does not already have one pending.
+ * Returns true if the report was queued.
+ */
+static inline __attribute__((always_inline))
+bool flow_table_push_pending(struct flow_table *table, struct flow_state *f)
+{
+	if (f->pending)
+		return false;
+	f->pending = 1;
+	table->pending[table->pending_tail++ & table->mask] = f->flow;
+	return true;
+}
+
+static inline __attribute__((always_inline))
+bool flow_table_has_pending(struct flow_table *table)
+{
+	return table->pending_head != table->pending_tail;
+}
+
+/**
+ * Removes the flow with the oldest pending report, and returns its state
+ */
+static inline __attribute__((always_inline))
+struct flow_state *flow_table_pop_pending(struct flow_table *table)
+{
+	struct flow_state *f;
+
+	assert(flow_table_has_pending(table));
+	f = flow_table_find(table,
+			table->pending[table->pending_head++ & table->mask]);
+	assert(f != NULL && f->pending);
+	f->pending = 0;
+	return f;
+}
+
+#endif /* FLOW_TABLE_H_ */
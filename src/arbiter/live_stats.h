@@ -0,0 +1,163 @@
+/*
+ * live_stats.h
+ *
+ *  Created on: October 19, 2026
+ */
+
+#ifndef LIVE_STATS_H_
+#define LIVE_STATS_H_
+
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Live statistics the log core publishes in a read-only POSIX shared memory
+ * segment, /dev/shm/fastpass-stats, for monitors outside the arbiter. The
+ * segment is a live_stats_header followed by sections, each an array of a
+ * struct the arbiter already keeps: comm_log, admission stats, queue bank
+ * stats and so on. The log core copies the structs into their sections every
+ * LIVE_STATS_GAP_SECS, so readers never touch memory of the data path cores.
+ *
+ * Each section has a seqlock: @seq is odd while the log core rewrites the
+ * section. Readers copy what they need and retry if @seq was odd or changed,
+ * see live_stats_read(). live_stats_reader.h and live_stats.py are readers
+ * for C++ and Python.
+ *
+ * Sections are found by type, so new types can be added without changing
+ * the version. The layout of each element is the struct named below, as
+ * compiled into the arbiter; readers check @elem_size.
+ */
+
+#define LIVE_STATS_SHM_NAME			"/fastpass-stats"
+#define LIVE_STATS_MAGIC			"FPSTATS"
+#define LIVE_STATS_VERSION			1
+#define LIVE_STATS_MAX_SECTIONS		16
+
+enum live_stats_section_type {
+	/* struct comm_log of each comm core */
+	LIVE_STATS_COMM_LOG				= 1,
+	/* global allocator stats: struct admission_statistics, or struct
+	 * emu_admission_statistics with the emulation algo */
+	LIVE_STATS_ADMISSION			= 2,
+	/* per admission core allocator stats: struct admission_core_statistics,
+	 * or struct emu_admission_core_statistics with the emulation algo */
+	LIVE_STATS_ADMISSION_CORE		= 3,
+	/* struct queue_bank_stats of each router */
+	LIVE_STATS_QUEUE_BANK			= 4,
+	/* struct port_drop_stats of each emulation core */
+	LIVE_STATS_PORT_DROPS			= 5,
+};
+
+enum live_stats_algo {
+	LIVE_STATS_ALGO_OTHER			= 0,
+	LIVE_STATS_ALGO_PIPELINED		= 1,
+	LIVE_STATS_ALGO_PARALLEL		= 2,
+	LIVE_STATS_ALGO_EMULATION		= 3,
+};
+
+/**
+ * @type: enum live_stats_section_type
+ * @seq: odd while the log core updates the section
+ * @count: number of elements
+ * @elem_size: bytes per element
+ * @offset: of the first element, from the start of the segment
+ * @update_ns: when the section was last updated
+ */
+struct live_stats_section {
+	uint32_t type;
+	uint32_t seq;
+	uint32_t count;
+	uint32_t elem_size;
+	uint64_t offset;
+	uint64_t update_ns;
+};
+
+/**
+ * @magic: LIVE_STATS_MAGIC, with its terminating 0. Written last, so readers
+ * 	that see it also see the section table.
+ * @algo: enum live_stats_algo, which selects the admission struct layouts
+ * @size: bytes in the segment
+ * @start_ns: time the log core started
+ */
+struct live_stats_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t n_sections;
+	uint32_t algo;
+	uint32_t reserved;
+	uint64_t size;
+	uint64_t start_ns;
+	struct live_stats_section sections[LIVE_STATS_MAX_SECTIONS];
+};
+
+/**
+ * Returns the section of type @type, or NULL if there is none
+ */
+static inline
+struct live_stats_section *live_stats_find(struct live_stats_header *hdr,
+		uint32_t type)
+{
+	uint32_t i;
+
+	for (i = 0; i < hdr->n_sections && i < LIVE_STATS_MAX_SECTIONS; i++)
+		if (hdr->sections[i].type == type)
+			return &hdr->sections[i];
+	return NULL;
+}
+
+/**
+ * Returns element @index of section @sec
+ */
+static inline
+void *live_stats_elem(struct live_stats_header *hdr,
+		struct live_stats_section *sec, uint32_t index)
+{
+	return (char *) hdr + sec->offset + (uint64_t) index * sec->elem_size;
+}
+
+/* the log core brackets its updates of a section with these. x86 keeps
+ * stores in order, so only the compiler needs barriers. */
+static inline
+void live_stats_write_begin(struct live_stats_section *sec)
+{
+	*(volatile uint32_t *) &sec->seq = sec->seq + 1;
+	asm volatile("" : : : "memory");
+}
+
+static inline
+void live_stats_write_end(struct live_stats_section *sec, uint64_t now_ns)
+{
+	sec->update_ns = now_ns;
+	asm volatile("" : : : "memory");
+	*(volatile uint32_t *) &sec->seq = sec->seq + 1;
+}
+
+/**
+ * Copies @n_bytes from offset @from of element @index of section @sec to
+ * 	@dst, consistent with one update of the section. Gives up after
+ * 	@max_tries attempts that race with the log core.
+ * Returns 0 on success, -1 if the copy was not consistent
+ */
+static inline
+int live_stats_read(struct live_stats_header *hdr,
+		struct live_stats_section *sec, uint32_t index, uint32_t from,
+		void *dst, uint32_t n_bytes, uint32_t max_tries)
+{
+	const volatile uint32_t *seq = (const volatile uint32_t *) &sec->seq;
+	uint32_t start;
+
+	while (max_tries-- > 0) {
+		start = *seq;
+		if (start & 1)
+			continue;
+		asm volatile("" : : : "memory");
+		memcpy(dst, (char *) live_stats_elem(hdr, sec, index) + from,
+				n_bytes);
+		asm volatile("" : : : "memory");
+		if (*seq == start)
+			return 0;
+	}
+	return -1;
+}
+
+#endif /* LIVE_STATS_H_ */
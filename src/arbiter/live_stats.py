@@ -0,0 +1,173 @@
+#!/usr/bin/python
+"""
+Reads the live stats a running arbiter publishes in shared memory (see
+live_stats.h), without disturbing it.
+
+usage: live_stats.py [interval_secs]
+
+Prints, every interval (default 1 second), the enqueue, dequeue, drop and mark
+rates of each emulated port with traffic. Other monitors can import LiveStats:
+
+    stats = LiveStats()
+    enqueues, dequeues = stats.queue_bank(0)
+    counters = stats.counters(SECTION_COMM_LOG, 0)
+
+counters() returns the raw uint64 fields of a struct, in the order of its
+definition in the arbiter headers.
+"""
+
+import mmap
+import struct
+import sys
+import time
+
+LIVE_STATS_PATH = '/dev/shm/fastpass-stats'
+LIVE_STATS_MAGIC = b'FPSTATS\0'
+LIVE_STATS_VERSION = 1
+LIVE_STATS_MAX_SECTIONS = 16
+
+SECTION_COMM_LOG = 1
+SECTION_ADMISSION = 2
+SECTION_ADMISSION_CORE = 3
+SECTION_QUEUE_BANK = 4
+SECTION_PORT_DROPS = 5
+
+ALGO_NAMES = {0: 'other', 1: 'pipelined', 2: 'parallel', 3: 'emulation'}
+
+HEADER = struct.Struct('=8sIIIIQQ')
+SECTION = struct.Struct('=IIIIQQ')
+SEQ = struct.Struct('=I')
+
+# queue_bank_stats and port_drop_stats: a u32 seq, then two u64 port arrays
+N_PORTS = 64
+PORT_ARRAYS_OFFSET = 8
+
+READ_TRIES = 1000
+
+
+class LiveStats(object):
+    """A read-only mapping of the live stats segment"""
+
+    def __init__(self, path=LIVE_STATS_PATH):
+        with open(path, 'rb') as f:
+            self.mem = mmap.mmap(f.fileno(), 0, mmap.MAP_SHARED,
+                                 mmap.PROT_READ)
+        if len(self.mem) < HEADER.size:
+            raise ValueError('arbiter has not finished creating %s' % path)
+        (magic, version, n_sections, self.algo, _, size,
+         self.start_ns) = HEADER.unpack_from(self.mem, 0)
+        if magic != LIVE_STATS_MAGIC:
+            raise ValueError('arbiter has not finished creating %s' % path)
+        if version != LIVE_STATS_VERSION:
+            raise ValueError('unknown live stats version %d, expected %d' %
+                             (version, LIVE_STATS_VERSION))
+        if size > len(self.mem):
+            raise ValueError('live stats segment is truncated')
+
+        # type -> (offset of section descriptor, count, elem_size, offset)
+        self.sections = {}
+        for i in range(min(n_sections, LIVE_STATS_MAX_SECTIONS)):
+            desc = HEADER.size + i * SECTION.size
+            stype, _, count, elem_size, offset, _ = \
+                SECTION.unpack_from(self.mem, desc)
+            self.sections[stype] = (desc, count, elem_size, offset)
+
+    def close(self):
+        self.mem.close()
+
+    def count(self, stype):
+        """Returns the number of elements in section @stype, 0 if none"""
+        if stype not in self.sections:
+            return 0
+        return self.sections[stype][1]
+
+    def update_ns(self, stype):
+        """Returns the time section @stype was last updated"""
+        desc = self.sections[stype][0]
+        return SECTION.unpack_from(self.mem, desc)[5]
+
+    def read(self, stype, index):
+        """Returns the bytes of element @index of section @stype, consistent
+        with one update by the log core"""
+        desc, count, elem_size, offset = self.sections[stype]
+        if index >= count:
+            raise IndexError('section %d has %d elements' % (stype, count))
+        start = offset + index * elem_size
+        seq_at = desc + 4
+        for _ in range(READ_TRIES):
+            seq = SEQ.unpack_from(self.mem, seq_at)[0]
+            if seq & 1:
+                continue
+            data = self.mem[start:start + elem_size]
+            if SEQ.unpack_from(self.mem, seq_at)[0] == seq:
+                return data
+        raise RuntimeError('log core kept updating section %d' % stype)
+
+    def counters(self, stype, index):
+        """Returns element @index of section @stype as a tuple of uint64"""
+        data = self.read(stype, index)
+        return struct.unpack('=%dQ' % (len(data) // 8),
+                             data[:len(data) // 8 * 8])
+
+    def _port_arrays(self, stype, index):
+        data = self.read(stype, index)
+        values = struct.unpack_from('=%dQ' % (2 * N_PORTS), data,
+                                    PORT_ARRAYS_OFFSET)
+        return list(values[:N_PORTS]), list(values[N_PORTS:])
+
+    def queue_bank(self, index):
+        """Returns the enqueues and dequeues of each port of router @index"""
+        return self._port_arrays(SECTION_QUEUE_BANK, index)
+
+    def port_drops(self, index):
+        """Returns the drops and marks of each port of emulation core
+        @index"""
+        return self._port_arrays(SECTION_PORT_DROPS, index)
+
+    def sample(self):
+        """Returns lists of port counters of all routers and cores"""
+        return ([self.queue_bank(i)
+                 for i in range(self.count(SECTION_QUEUE_BANK))],
+                [self.port_drops(i)
+                 for i in range(self.count(SECTION_PORT_DROPS))])
+
+
+def print_rates(prev, cur, secs):
+    (prev_queues, prev_drops), (queues, drops) = prev, cur
+    for r, ((enq, deq), (penq, pdeq)) in enumerate(zip(queues, prev_queues)):
+        for port in range(N_PORTS):
+            if enq[port] != penq[port] or enq[port] != deq[port]:
+                print('router %d port %d: %.0f enq/s %.0f deq/s, %d queued' %
+                      (r, port, (enq[port] - penq[port]) / secs,
+                       (deq[port] - pdeq[port]) / secs, enq[port] - deq[port]))
+    for c, ((drp, mrk), (pdrp, pmrk)) in enumerate(zip(drops, prev_drops)):
+        for port in range(N_PORTS):
+            if drp[port] != pdrp[port] or mrk[port] != pmrk[port]:
+                print('core %d port %d: %.0f drops/s %.0f marks/s' %
+                      (c, port, (drp[port] - pdrp[port]) / secs,
+                       (mrk[port] - pmrk[port]) / secs))
+
+
+def main():
+    if len(sys.argv) > 2:
+        sys.stderr.write(__doc__)
+        sys.exit(1)
+    interval = float(sys.argv[1]) if len(sys.argv) > 1 else 1.0
+
+    stats = LiveStats()
+    print('%s arbiter, %d routers, %d emulation cores, started at %d ns' %
+          (ALGO_NAMES.get(stats.algo, 'unknown'),
+           stats.count(SECTION_QUEUE_BANK), stats.count(SECTION_PORT_DROPS),
+           stats.start_ns))
+    prev = stats.sample()
+    while True:
+        time.sleep(interval)
+        cur = stats.sample()
+        print('--- %s' % time.strftime('%H:%M:%S'))
+        print_rates(prev, cur, interval)
+        sys.stdout.flush()
+        prev = cur
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,136 @@
+/*
+ * live_stats_reader.h
+ *
+ *  Created on: October 19, 2026
+ */
+
+#ifndef LIVE_STATS_READER_H_
+#define LIVE_STATS_READER_H_
+
+#include "live_stats.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* attempts to read a section before giving up on a busy log core */
+#define LIVE_STATS_READ_TRIES	1000
+
+/**
+ * Reads the live stats an arbiter publishes, for monitors in other
+ * 	processes. Include the arbiter headers of the structs you read, e.g.
+ *
+ * 	LiveStatsReader reader;
+ * 	struct queue_bank_stats st;
+ * 	if (reader.open() == 0 &&
+ * 			reader.read(LIVE_STATS_QUEUE_BANK, 0, &st) == 0)
+ * 		...
+ */
+class LiveStatsReader {
+public:
+	LiveStatsReader() : m_hdr(NULL), m_size(0) {}
+	~LiveStatsReader() { close(); }
+
+	/**
+	 * Maps the segment @name read-only.
+	 * @returns 0 on success, -EAGAIN if the arbiter has not finished creating
+	 * 	the segment, -EPROTO if the segment has a different version, or
+	 * 	another negative errno
+	 */
+	int open(const char *name = LIVE_STATS_SHM_NAME) {
+		struct stat sb;
+		void *seg;
+		int fd;
+
+		close();
+		fd = shm_open(name, O_RDONLY, 0);
+		if (fd < 0)
+			return -errno;
+		if (fstat(fd, &sb) != 0) {
+			::close(fd);
+			return -errno;
+		}
+		if ((size_t) sb.st_size < sizeof(struct live_stats_header)) {
+			::close(fd);
+			return -EAGAIN;
+		}
+		seg = mmap(NULL, sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		::close(fd);
+		if (seg == MAP_FAILED)
+			return -errno;
+		m_hdr = (struct live_stats_header *) seg;
+		m_size = sb.st_size;
+
+		if (memcmp(m_hdr->magic, LIVE_STATS_MAGIC,
+				sizeof(LIVE_STATS_MAGIC)) != 0) {
+			close();
+			return -EAGAIN;
+		}
+		if (m_hdr->version != LIVE_STATS_VERSION || m_hdr->size > m_size) {
+			close();
+			return -EPROTO;
+		}
+		return 0;
+	}
+
+	void close() {
+		if (m_hdr != NULL)
+			munmap(m_hdr, m_size);
+		m_hdr = NULL;
+		m_size = 0;
+	}
+
+	/* enum live_stats_algo of the arbiter */
+	uint32_t algo() const { return m_hdr->algo; }
+
+	/* time the arbiter's log core started */
+	uint64_t start_ns() const { return m_hdr->start_ns; }
+
+	/**
+	 * @returns the number of elements in section @type, 0 if there is none
+	 */
+	uint32_t count(uint32_t type) const {
+		struct live_stats_section *sec = live_stats_find(m_hdr, type);
+		return (sec == NULL) ? 0 : sec->count;
+	}
+
+	/**
+	 * @returns the time section @type was last updated, 0 if never
+	 */
+	uint64_t update_ns(uint32_t type) const {
+		struct live_stats_section *sec = live_stats_find(m_hdr, type);
+		return (sec == NULL) ? 0 : sec->update_ns;
+	}
+
+	/**
+	 * Copies a consistent snapshot of element @index of section @type to
+	 * 	@dst, which must be of the element's type.
+	 * @returns 0 on success, -ENOENT if there is no such element, -EINVAL if
+	 * 	the element is not @n_bytes long, -EAGAIN if the log core kept
+	 * 	updating the section
+	 */
+	int read(uint32_t type, uint32_t index, void *dst, uint32_t n_bytes) const {
+		struct live_stats_section *sec = live_stats_find(m_hdr, type);
+
+		if (sec == NULL || index >= sec->count)
+			return -ENOENT;
+		if (sec->elem_size != n_bytes)
+			return -EINVAL;
+		if (live_stats_read(m_hdr, sec, index, 0, dst, n_bytes,
+				LIVE_STATS_READ_TRIES) != 0)
+			return -EAGAIN;
+		return 0;
+	}
+
+	template <typename T>
+	int read(uint32_t type, uint32_t index, T *dst) const {
+		return read(type, index, dst, sizeof(T));
+	}
+
+private:
+	struct live_stats_header	*m_hdr;
+	size_t						m_size;
+};
+
+#endif /* LIVE_STATS_READER_H_ */
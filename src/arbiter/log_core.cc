@@ -6,10 +6,14 @@
  */
 
 #include <stdio.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 #include <rte_log.h>
 
 #include "log_core.h"
+#include "telemetry.h"
 #include "control.h"
 #include "comm_core.h"
 #include "comm_log.h"
@@ -18,6 +22,8 @@
 #include "admission_log.h"
 #include "benchmark_log.h"
 #include "benchmark_log_impl.h"
+#include "live_stats.h"
+#include "perf_counters.h"
 #include "../emulation/admissible_log.h"
 #include "../emulation/admissible_log_impl.h"
 #include "../emulation/queue_bank_log.h"
@@ -30,11 +36,18 @@
 
 #define MAX_FILENAME_LEN 256
 
+/* room for a few samples of all routers and cores between flushes */
+#define TELEMETRY_BUFFER_SIZE	(4 * 1024 * 1024)
+
 #define RTE_LOGTYPE_LOGGING RTE_LOGTYPE_USER1
 #define LOGGING_ERR(a...) RTE_LOG(CRIT, LOGGING, ##a)
 
 static struct comm_log saved_comm_log[RTE_MAX_LCORE];
 
+/* filled by each core that measures its main loop, see perf_log_open() */
+struct perf_log perf_logs[RTE_MAX_LCORE];
+static struct perf_log saved_perf_logs[RTE_MAX_LCORE];
+
 void print_comm_log(uint16_t lcore_id)
 {
 	struct comm_log *cl = &comm_core_logs[lcore_id];
@@ -118,6 +131,8 @@ void print_comm_log(uint16_t lcore_id)
 		printf("\n  %lu A-REQ payloads from invalid src (check id map?)", cl->areq_invalid_src);
 	if (cl->areq_invalid_dst)
 		printf("\n  %lu A-REQ payloads with invalid dst (check id map?)", cl->areq_invalid_dst);
+	if (cl->flow_table_full)
+		printf("\n  %lu A-REQ payloads or allocs for flows beyond a full flow table", cl->flow_table_full);
 	if (cl->dequeue_admitted_failed)
 		printf("\n  %lu times couldn't dequeue a struct admitted_traffic!",
 				cl->dequeue_admitted_failed);
@@ -157,10 +172,11 @@ void print_global_admission_log_parallel_or_pipelined() {
 	struct admission_statistics *sv = &saved_admission_statistics;
 
 #if defined(PARALLEL_ALGO)
-	printf("\nadmission core (pim with %d ptns, %d nodes per ptn)", N_PARTITIONS, PARTITION_N_NODES);
+	printf("\nadmission core (pim with %d ptns, %d nodes per ptn, %d iterations)",
+               N_PARTITIONS, PARTITION_N_NODES, g_pim_state.n_iterations);
 #else
 	printf("\nadmission core (seq with %d algo cores, %d batch size, %d nodes)",
-               ALGO_N_CORES, BATCH_SIZE, NUM_NODES);
+               ALGO_N_CORES, BATCH_SIZE, arbiter_num_nodes);
 #endif
 
 #define D(X) (st->X - sv->X)
@@ -179,6 +195,12 @@ void print_global_admission_log_parallel_or_pipelined() {
 			st->backlog_flush_forced);
 	printf("\n    %lu spent bins (+%lu), %lu spent demands (+%lu)",
 			st->spent_bins, D(spent_bins), st->spent_demands, D(spent_demands));
+	printf("\n    backlog table: %lu pairs reclaimed (+%lu), %lu demands dropped when full (+%lu)",
+			st->backlog_pairs_reclaimed, D(backlog_pairs_reclaimed),
+			st->backlog_table_full, D(backlog_table_full));
+#if defined(PARALLEL_ALGO)
+	printf("\n    %lu senders reset (+%lu)", st->reset_senders, D(reset_senders));
+#endif
 	printf("\n");
 #undef D
 }
@@ -236,8 +258,16 @@ void print_admission_core_log_parallel_or_pipelined(uint16_t lcore, uint16_t adm
 				st->wrap_up_non_empty_bin, st->wrap_up_non_empty_bin_demands);
 
 #if defined(PARALLEL_ALGO)
-	printf("\n    %lu phases completed, %lu not ready, %lu out of order",
-               st->phase_finished, st->phase_none_ready, st->phase_out_of_order);
+	printf("\n    %lu phases completed, %lu not ready",
+               st->phase_finished, st->phase_none_ready);
+	printf("\n    phase wait cycles: grants avg %lu max %lu, accepts avg %lu max %lu",
+               st->phase_wait_cycles[1] / (st->phase_waits[1] + 1),
+               st->phase_wait_max_cycles[1],
+               st->phase_wait_cycles[0] / (st->phase_waits[0] + 1),
+               st->phase_wait_max_cycles[0]);
+	printf("\n    reset senders: %lu purged with %lu requests, %lu stale grants avoided, %lu stale accepts dropped",
+               st->reset_senders_purged, st->reset_requests_purged,
+               st->stale_grants_avoided, st->stale_accepts_dropped);
 #endif
 
 	printf("\n");
@@ -311,8 +341,83 @@ void print_core_log(uint16_t lcore, uint16_t adm_core_index) {
 
 }
 
+/**
+ * Writes a telemetry record of two arrays of counters, one per port
+ */
+static void write_telemetry_record(FILE *fp, uint16_t type, uint16_t index,
+		u64 time_ns, u64 *first, u64 *second)
+{
+	struct telemetry_record_header hdr;
+	size_t n_bytes = QUEUE_BANK_MAX_PORTS * sizeof(u64);
+
+	hdr.type = type;
+	hdr.index = index;
+	hdr.len = 2 * n_bytes;
+	hdr.time_ns = time_ns;
+
+	if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1
+			|| fwrite(first, n_bytes, 1, fp) != 1
+			|| fwrite(second, n_bytes, 1, fp) != 1)
+		LOGGING_ERR("couldn't write telemetry record of type %d\n", type);
+}
+
+#if MAINTAIN_QUEUE_BANK_HISTOGRAMS
+/**
+ * Writes a telemetry record of the histograms in @hist
+ */
+static void write_telemetry_hist_record(FILE *fp, uint16_t index, u64 time_ns,
+		struct queue_bank_histograms *hist)
+{
+	struct telemetry_record_header hdr;
+	u64 max_occupancy[QUEUE_BANK_MAX_PORTS];
+	uint32_t port;
+
+	for (port = 0; port < QUEUE_BANK_MAX_PORTS; port++)
+		max_occupancy[port] = hist->max_read[port];
+
+	hdr.type = TELEMETRY_QUEUE_HIST;
+	hdr.index = index;
+	hdr.len = sizeof(max_occupancy) + sizeof(hist->occupancy_hist)
+			+ sizeof(hist->delay_hist);
+	hdr.time_ns = time_ns;
+
+	if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1
+			|| fwrite(max_occupancy, sizeof(max_occupancy), 1, fp) != 1
+			|| fwrite(hist->occupancy_hist, sizeof(hist->occupancy_hist), 1,
+					fp) != 1
+			|| fwrite(hist->delay_hist, sizeof(hist->delay_hist), 1, fp) != 1)
+		LOGGING_ERR("couldn't write telemetry histogram record\n");
+}
+#endif
+
+/**
+ * Appends a section of @count elements of @elem_size bytes to @hdr, at
+ * 	offset @offset, which is advanced past the section. Empty sections are
+ * 	left out.
+ */
+static void live_stats_add_section(struct live_stats_header *hdr,
+		uint64_t *offset, uint32_t type, uint32_t count, uint32_t elem_size)
+{
+	struct live_stats_section *sec;
+
+	if (count == 0 || hdr->n_sections == LIVE_STATS_MAX_SECTIONS)
+		return;
+
+	sec = &hdr->sections[hdr->n_sections++];
+	sec->type = type;
+	sec->seq = 0;
+	sec->count = count;
+	sec->elem_size = elem_size;
+	sec->offset = *offset;
+	sec->update_ns = 0;
+
+	/* keep each section on its own cache lines */
+	*offset = (*offset + (uint64_t) count * elem_size + 63) & ~63ULL;
+}
+
 LogCore::LogCore(uint64_t log_gap_ticks, uint64_t q_log_gap_ticks)
-	: m_log_gap_ticks(log_gap_ticks), m_q_log_gap_ticks(q_log_gap_ticks)
+	: m_log_gap_ticks(log_gap_ticks), m_q_log_gap_ticks(q_log_gap_ticks),
+	  m_live_stats(NULL)
 {}
 
 void LogCore::add_comm_lcore(uint8_t lcore)
@@ -335,23 +440,156 @@ void LogCore::add_drop_stats(struct port_drop_stats *port_stats)
 	m_port_stats.push_back(port_stats);
 }
 
+int LogCore::open_live_stats()
+{
+	struct live_stats_header hdr;
+	uint64_t offset = (sizeof(hdr) + 63) & ~63ULL;
+	void *seg;
+	int fd;
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.version = LIVE_STATS_VERSION;
+	hdr.start_ns = fp_get_time_ns();
+
+	live_stats_add_section(&hdr, &offset, LIVE_STATS_COMM_LOG,
+			m_comm_lcores.size(), sizeof(struct comm_log));
+#if (defined(PARALLEL_ALGO) || defined(PIPELINED_ALGO))
+#if defined(PARALLEL_ALGO)
+	hdr.algo = LIVE_STATS_ALGO_PARALLEL;
+#else
+	hdr.algo = LIVE_STATS_ALGO_PIPELINED;
+#endif
+	live_stats_add_section(&hdr, &offset, LIVE_STATS_ADMISSION, 1,
+			sizeof(struct admission_statistics));
+	live_stats_add_section(&hdr, &offset, LIVE_STATS_ADMISSION_CORE,
+			N_ADMISSION_CORES, sizeof(struct admission_core_statistics));
+#elif defined(EMULATION_ALGO)
+	hdr.algo = LIVE_STATS_ALGO_EMULATION;
+	live_stats_add_section(&hdr, &offset, LIVE_STATS_ADMISSION, 1,
+			sizeof(struct emu_admission_statistics));
+	live_stats_add_section(&hdr, &offset, LIVE_STATS_ADMISSION_CORE,
+			N_ADMISSION_CORES, sizeof(struct emu_admission_core_statistics));
+#else
+	hdr.algo = LIVE_STATS_ALGO_OTHER;
+#endif
+	live_stats_add_section(&hdr, &offset, LIVE_STATS_QUEUE_BANK,
+			m_queue_stats.size(), sizeof(struct queue_bank_stats));
+	live_stats_add_section(&hdr, &offset, LIVE_STATS_PORT_DROPS,
+			m_port_stats.size(), sizeof(struct port_drop_stats));
+	hdr.size = offset;
+
+	/* readers may open the segment read-only, only we write it */
+	fd = shm_open(LIVE_STATS_SHM_NAME, O_CREAT | O_TRUNC | O_RDWR, 0644);
+	if (fd < 0) {
+		LOGGING_ERR("could not create live stats segment %s\n",
+				LIVE_STATS_SHM_NAME);
+		return -1;
+	}
+	if (ftruncate(fd, hdr.size) != 0) {
+		LOGGING_ERR("could not size live stats segment to %lu bytes\n",
+				hdr.size);
+		close(fd);
+		return -1;
+	}
+	seg = mmap(NULL, hdr.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (seg == MAP_FAILED) {
+		LOGGING_ERR("could not map live stats segment\n");
+		return -1;
+	}
+
+	/* magic goes in last, after the section table */
+	m_live_stats = (struct live_stats_header *) seg;
+	memcpy(m_live_stats, &hdr, sizeof(hdr));
+	publish_live_stats();
+	asm volatile("" : : : "memory");
+	memcpy(m_live_stats->magic, LIVE_STATS_MAGIC, sizeof(LIVE_STATS_MAGIC));
+
+	return 0;
+}
+
+void LogCore::publish_live_stats()
+{
+	struct live_stats_header *hdr = m_live_stats;
+	struct live_stats_section *sec;
+	u64 now = fp_get_time_ns();
+	uint32_t i, j;
+
+	for (i = 0; i < hdr->n_sections; i++) {
+		sec = &hdr->sections[i];
+		live_stats_write_begin(sec);
+
+		switch (sec->type) {
+		case LIVE_STATS_COMM_LOG:
+			for (j = 0; j < sec->count; j++)
+				memcpy(live_stats_elem(hdr, sec, j),
+						&comm_core_logs[m_comm_lcores[j]], sec->elem_size);
+			break;
+#if (defined(PARALLEL_ALGO) || defined(PIPELINED_ALGO))
+		case LIVE_STATS_ADMISSION:
+			memcpy(live_stats_elem(hdr, sec, 0), g_admission_stats(),
+					sec->elem_size);
+			break;
+		case LIVE_STATS_ADMISSION_CORE:
+			for (j = 0; j < sec->count; j++)
+				memcpy(live_stats_elem(hdr, sec, j), g_admission_core_stats(j),
+						sec->elem_size);
+			break;
+#elif defined(EMULATION_ALGO)
+		case LIVE_STATS_ADMISSION:
+			memcpy(live_stats_elem(hdr, sec, 0), &emu_get_instance()->m_stat,
+					sec->elem_size);
+			break;
+		case LIVE_STATS_ADMISSION_CORE:
+			for (j = 0; j < sec->count; j++)
+				memcpy(live_stats_elem(hdr, sec, j),
+						emu_get_instance()->m_core_stats[j], sec->elem_size);
+			break;
+#endif
+		case LIVE_STATS_QUEUE_BANK:
+			for (j = 0; j < sec->count; j++)
+				queue_bank_stats_snapshot(m_queue_stats[j],
+						(struct queue_bank_stats *)
+						live_stats_elem(hdr, sec, j));
+			break;
+		case LIVE_STATS_PORT_DROPS:
+			for (j = 0; j < sec->count; j++)
+				port_drop_stats_snapshot(m_port_stats[j],
+						(struct port_drop_stats *)
+						live_stats_elem(hdr, sec, j));
+			break;
+		}
+
+		live_stats_write_end(sec, now);
+	}
+}
+
 int LogCore::exec()
 {
 	uint64_t next_ticks = rte_get_timer_cycles();
 	uint64_t q_next_ticks = rte_get_timer_cycles();
+	uint64_t live_next_ticks = rte_get_timer_cycles();
+	uint64_t live_gap_ticks = LIVE_STATS_GAP_SECS * rte_get_timer_hz();
+	uint64_t now_ticks;
 	int i, j;
 	struct conn_log_struct conn_log;
+	struct telemetry_file_header telemetry_hdr;
+	struct queue_bank_stats queue_stats;
+	struct port_drop_stats port_stats;
 	FILE *fp;
-	FILE *fp_queues;
+	FILE *fp_telemetry;
 	char filename[MAX_FILENAME_LEN];
-	char filename_queues[MAX_FILENAME_LEN];
+	char filename_telemetry[MAX_FILENAME_LEN];
 	u64 time = fp_get_time_ns();
 	u64 time_prev;
+#if defined(PIPELINED_ALGO)
+	static uint32_t node_backlog[MAX_NODES];
+#endif
 
 	snprintf(filename, MAX_FILENAME_LEN, "log/conn-%016llX.csv",
 			time);
-	snprintf(filename_queues, MAX_FILENAME_LEN, "log/queues-%016llX.csv",
-			time);
+	snprintf(filename_telemetry, MAX_FILENAME_LEN,
+			"log/telemetry-%016llX.bin", time);
 
 	/* open file for conn log */
 	fp = fopen(filename, "w");
@@ -361,13 +599,26 @@ int LogCore::exec()
 		return -1;
 	}
 
-	/* open file for queues log */
-	fp_queues = fopen(filename_queues, "w");
-	if (fp_queues == NULL) {
-		LOGGING_ERR("lcore %d could not open file for queue logging: %s\n",
-				rte_lcore_id(), filename_queues);
+	/* open file for telemetry, buffered so samples are written in bulk */
+	fp_telemetry = fopen(filename_telemetry, "w");
+	if (fp_telemetry == NULL) {
+		LOGGING_ERR("lcore %d could not open file for telemetry: %s\n",
+				rte_lcore_id(), filename_telemetry);
 		return -1;
 	}
+	setvbuf(fp_telemetry, NULL, _IOFBF, TELEMETRY_BUFFER_SIZE);
+
+	memset(&telemetry_hdr, 0, sizeof(telemetry_hdr));
+	memcpy(telemetry_hdr.magic, TELEMETRY_MAGIC, sizeof(TELEMETRY_MAGIC));
+	telemetry_hdr.version = TELEMETRY_VERSION;
+	telemetry_hdr.n_ports = QUEUE_BANK_MAX_PORTS;
+	telemetry_hdr.n_routers = m_queue_stats.size();
+	telemetry_hdr.n_cores = m_port_stats.size();
+	telemetry_hdr.n_hist_buckets =
+			MAINTAIN_QUEUE_BANK_HISTOGRAMS ? QUEUE_BANK_HIST_BUCKETS : 0;
+	telemetry_hdr.start_ns = time;
+	if (fwrite(&telemetry_hdr, sizeof(telemetry_hdr), 1, fp_telemetry) != 1)
+		LOGGING_ERR("couldn't write telemetry header\n");
 
 	/* copy baseline statistics */
 	for (i = 0; i < m_comm_lcores.size(); i++)
@@ -377,31 +628,48 @@ int LogCore::exec()
 	for (i = 0; i < N_ADMISSION_CORES; i++)
 		save_admission_core_stats(i);
 
+	/* monitors are optional, log on without them */
+	if (open_live_stats() != 0)
+		LOGGING_ERR("live stats disabled\n");
+
 	while (1) {
 		/* wait until proper time for main log */
-		while (next_ticks > rte_get_timer_cycles()) {
+		while (next_ticks > (now_ticks = rte_get_timer_cycles())) {
 #if (defined(EMULATION_ALGO) && MAINTAIN_QUEUE_BANK_LOG_COUNTERS)
 			/* while waiting, sample queues and write to file */
-			while (q_next_ticks > rte_get_timer_cycles())
-				rte_pause();
-
-			/* print time now */
-			time = fp_get_time_ns();
-
-			for (i = 0; i < m_queue_stats.size(); i++) {
-				fprintf(fp_queues, "router number %d\n", i);
-				print_queue_bank_stats_to_file(fp_queues, m_queue_stats[i],
-						time);
+			if (q_next_ticks <= now_ticks) {
+				/* print time now */
+				time = fp_get_time_ns();
+
+				for (i = 0; i < m_queue_stats.size(); i++) {
+					queue_bank_stats_snapshot(m_queue_stats[i], &queue_stats);
+					write_telemetry_record(fp_telemetry, TELEMETRY_QUEUE_BANK,
+							i, time, queue_stats.port_enqueues,
+							queue_stats.port_dequeues);
+#if MAINTAIN_QUEUE_BANK_HISTOGRAMS
+					/* max occupancies answer the request of the last sample */
+					if (queue_bank_stats_max_ready(&queue_stats))
+						write_telemetry_hist_record(fp_telemetry, i, time,
+								&queue_stats.hist);
+					queue_bank_stats_request_max(m_queue_stats[i]);
+#endif
+				}
+				for (i = 0; i < m_port_stats.size(); i++) {
+					port_drop_stats_snapshot(m_port_stats[i], &port_stats);
+					write_telemetry_record(fp_telemetry, TELEMETRY_PORT_DROPS,
+							i, time, port_stats.port_drops,
+							port_stats.port_marks);
+				}
+				q_next_ticks += m_q_log_gap_ticks;
 			}
-			for (i = 0; i < m_port_stats.size(); i++) {
-				fprintf(fp_queues, "core number %d\n", i);
-				print_port_drop_stats_to_file(fp_queues, m_port_stats[i],
-						time);
+#endif
+			/* and keep live stats fresh */
+			if (m_live_stats != NULL && live_next_ticks <= now_ticks) {
+				publish_live_stats();
+				/* skip updates missed while printing the main log */
+				live_next_ticks = now_ticks + live_gap_ticks;
 			}
-			q_next_ticks += m_q_log_gap_ticks;
-#else
 			rte_pause();
-#endif
 		}
 
 		for (i = 0; i < m_comm_lcores.size(); i++)
@@ -410,26 +678,48 @@ int LogCore::exec()
 
 		for (i = 0; i < m_logged_lcores.size(); i++)
 			print_core_log(m_logged_lcores[i], i);
+		if (MAINTAIN_PERF_COUNTERS) {
+			for (i = 0; i < m_comm_lcores.size(); i++)
+				print_perf_log(m_comm_lcores[i], &perf_logs[m_comm_lcores[i]],
+						&saved_perf_logs[m_comm_lcores[i]]);
+			for (i = 0; i < m_logged_lcores.size(); i++)
+				print_perf_log(m_logged_lcores[i],
+						&perf_logs[m_logged_lcores[i]],
+						&saved_perf_logs[m_logged_lcores[i]]);
+		}
 		fflush(stdout);
 
 		/* save admission core stats */
 		for (i = 0; i < N_ADMISSION_CORES; i++)
 			save_admission_core_stats(i);
 
+#if defined(PIPELINED_ALGO)
+		/* sum backlogs by source, visiting only pairs with demand, in one
+		 * pass over each intake. pim keeps backlogs in its allocator, not in
+		 * a backlog table */
+		memset(node_backlog, 0, sizeof(node_backlog));
+		for (i = 0; i < SEQ_N_INTAKES; i++) {
+			struct backlog *backlog = g_admission_backlog(
+					seq_intake_first_src(arbiter_num_nodes, i));
+			uint16_t src, dst;
+			uint32_t n;
+			for (j = backlog_next_active(backlog, 0, &src, &dst, &n);
+					j < (int) backlog_n_slots(backlog);
+					j = backlog_next_active(backlog, j + 1, &src, &dst, &n))
+				node_backlog[src] += n;
+		}
+#endif
+
 		/* write log */
-//		for (i = 0; i < MAX_NODES; i++) {
-		for (i = 49; i < 55; i++) {
+		for (i = 0; i < arbiter_num_nodes; i++) {
 			conn_log.version = CONN_LOG_STRUCT_VERSION;
 			conn_log.node_id = i;
 			conn_log.timestamp = fp_get_time_ns();
 			comm_dump_stat(i, &conn_log);
-
-#if (defined(PIPELINED_ALGO) || defined(PARALLEL_ALGO))
-			/* get backlog */
+#if defined(PIPELINED_ALGO)
+			conn_log.backlog = node_backlog[i];
+#else
 			conn_log.backlog = 0;
-			for (j = 0; j < MAX_NODES; j++)
-				conn_log.backlog +=
-					backlog_get(g_admission_backlog(), i, j);
 #endif
 
 			if (fwrite(&conn_log, sizeof(conn_log), 1, fp) != 1)
@@ -437,7 +727,7 @@ int LogCore::exec()
 		}
 
 		fflush(fp);
-		fflush(fp_queues);
+		fflush(fp_telemetry);
 
 		next_ticks += m_log_gap_ticks;
 	}
@@ -14,6 +14,7 @@
 
 struct queue_bank_stats;
 struct port_drop_stats;
+struct live_stats_header;
 
 class LogCore {
 public:
@@ -36,12 +37,19 @@ public:
 	void remote_launch(unsigned lcore);
 
 private:
+	/* create the shared memory segment for live stats, see live_stats.h */
+	int open_live_stats();
+
+	/* copy all stats into the live stats segment */
+	void publish_live_stats();
+
 	uint64_t m_log_gap_ticks;
 	uint64_t m_q_log_gap_ticks;
 	std::vector<uint8_t> m_comm_lcores;
 	std::vector<uint8_t> m_logged_lcores; /* lcores with logged stats */
 	std::vector<struct queue_bank_stats *> m_queue_stats;
 	std::vector<struct port_drop_stats *> m_port_stats;
+	struct live_stats_header *m_live_stats;
 };
 
 #endif /* LOG_CORE_H_ */
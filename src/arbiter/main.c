@@ -85,6 +85,7 @@
 #include "port_alloc.h"
 
 #include "control.h"
+#include "../protocol/topology.h"
 
 //#define MAIN_C_VERBOSE
 
@@ -186,6 +187,8 @@ static const struct rte_eth_txconf tx_conf = {
 static uint32_t enabled_port_mask = 0;
 static int promiscuous_on = 0; /**< Ports set in promiscuous mode off by default. */
 static int numa_on = 1; /**< NUMA is enabled by default. */
+uint16_t arbiter_num_nodes = NUM_NODES;
+bool arbiter_num_nodes_set = false;
 
 /* mbuf pool for RX packets */
 static struct rte_mempool* rx_pktmbuf_pool[NB_SOCKETS];
@@ -756,11 +759,29 @@ static int lcore_init_power(unsigned lcore_id)
 static void
 print_usage(const char *prgname)
 {
-	printf ("%s [EAL options] -- -p PORTMASK -P"
+	printf ("%s [EAL options] -- -p PORTMASK -P [-n NODES]"
 		"  [--config (port,queue,lcore)[,(port,queue,lcore]]\n"
 		"  -p PORTMASK: hexadecimal bitmask of ports to configure\n"
+		"  -n NODES: optional, number of endpoints (default %d, at most %d)\n"
 		"  --no-numa: optional, disable numa awareness\n",
-		prgname);
+		prgname, NUM_NODES, MAX_NODES);
+}
+
+static int
+parse_num_nodes(const char *num_nodes)
+{
+	char *end = NULL;
+	unsigned long n;
+
+	/* parse decimal string */
+	n = strtoul(num_nodes, &end, 10);
+	if ((num_nodes[0] == '\0') || (end == NULL) || (*end != '\0'))
+		return -1;
+
+	if (n == 0 || n > MAX_NODES)
+		return -1;
+
+	return n;
 }
 
 static int
@@ -795,7 +816,7 @@ parse_args(int argc, char **argv)
 
 	argvopt = argv;
 
-	while ((opt = getopt_long(argc, argvopt, "p:P",
+	while ((opt = getopt_long(argc, argvopt, "p:Pn:",
 				lgopts, &option_index)) != EOF) {
 
 		switch (opt) {
@@ -813,6 +834,18 @@ parse_args(int argc, char **argv)
 			promiscuous_on = 1;
 			break;
 
+		/* number of nodes */
+		case 'n':
+			ret = parse_num_nodes(optarg);
+			if (ret < 0) {
+				printf("invalid number of nodes\n");
+				print_usage(prgname);
+				return -1;
+			}
+			arbiter_num_nodes = ret;
+			arbiter_num_nodes_set = true;
+			break;
+
 		/* long options */
 		case 0:
 			if (!strcmp(lgopts[option_index].name, "no-numa")) {
@@ -2,23 +2,62 @@
 #include "path_sel_core.h"
 
 #include <rte_ip.h>
+#include <rte_cycles.h>
+#include <rte_debug.h>
+#include <rte_spinlock.h>
 #include "../graph-algo/fp_ring.h"
 #include "../graph-algo/path_selection.h"
+#include "../protocol/topology.h"
 #include "control.h"
 
+/**
+ * Path selection cores take admitted traffic in turns, each takes a ticket
+ *    when it dequeues a timeslot. Timeslots are independent so their paths
+ *    are selected in parallel, but a core only passes its timeslot on once
+ *    the timeslot before it was passed on, so comm cores see them in order.
+ */
+struct path_sel_global_state {
+	rte_spinlock_t lock; /* protects dequeueing and taking a ticket */
+	uint64_t next_ticket;
+	volatile uint64_t next_out __rte_cache_aligned;
+} __rte_cache_aligned;
+
+static struct path_sel_global_state path_sel_global;
+
+void path_sel_init_global(void)
+{
+	rte_spinlock_init(&path_sel_global.lock);
+	path_sel_global.next_ticket = 0;
+	path_sel_global.next_out = 0;
+}
 
 int exec_path_sel_core(void *void_cmd_p)
 {
 	struct path_sel_core_cmd *cmd = (struct path_sel_core_cmd *)void_cmd_p;
+	struct path_sel_global_state *g = &path_sel_global;
 	struct admitted_traffic *admitted;
+	struct path_sel_state *state;
+	uint64_t ticket;
+
+	state = create_path_sel_state(NUM_RACKS, TOR_SHIFT);
+	if (state == NULL)
+		rte_exit(EXIT_FAILURE, "Cannot allocate path selection state\n");
 
 	while (1) {
+		rte_spinlock_lock(&g->lock);
 		while (fp_ring_dequeue(cmd->q_admitted, (void **)&admitted) != 0)
 			/* busy wait */;
+		ticket = g->next_ticket++;
+		rte_spinlock_unlock(&g->lock);
+
+		select_paths_with_state(state, admitted);
 
-		select_paths(admitted, NUM_RACKS);
+		/* wait for the previous timeslot to be passed on */
+		while (g->next_out != ticket)
+			rte_pause();
 
 		fp_ring_enqueue(cmd->q_path_selected, (void *)admitted);
+		g->next_out = ticket + 1;
 	}
 	return 0;
 }
@@ -18,6 +18,12 @@ struct path_sel_core_cmd {
 	struct rte_ring *q_path_selected;
 };
 
+/**
+ * Initializes state shared by the path selection cores. Call before
+ *    launching them.
+ */
+void path_sel_init_global(void);
+
 int exec_path_sel_core(void *void_cmd_p);
 
 #ifdef __cplusplus
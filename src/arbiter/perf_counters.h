@@ -0,0 +1,221 @@
+/*
+ * perf_counters.h
+ *
+ * Hardware counters around the main loop of a core, read in user space.
+ *
+ *  Created on: October 19, 2026
+ */
+
+#ifndef PERF_COUNTERS_H_
+#define PERF_COUNTERS_H_
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/perf_event.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * Define to count cycles, instructions, LLC misses and branch misses of each
+ * iteration of the main loop of comm, admission and emulation cores. Counters
+ * are read with rdpmc, which needs kernel.perf_event_paranoid <= 2 and
+ * /sys/bus/event_source/devices/cpu/rdpmc >= 1.
+ */
+#ifndef MAINTAIN_PERF_COUNTERS
+#define MAINTAIN_PERF_COUNTERS		0
+#endif
+
+enum perf_counter {
+	PERF_CYCLES = 0,
+	PERF_INSTRUCTIONS,
+	PERF_LLC_MISSES,
+	PERF_BRANCH_MISSES,
+	PERF_N_COUNTERS
+};
+
+/**
+ * Counters of one core, summed over iterations of its main loop
+ * @phase: name of the loop, NULL if the core has no counters
+ * @fd, @pc: the perf events and their mmapped pages
+ * @n: iterations counted
+ * @total: sum of each counter over the iterations
+ * @start: each counter when the current iteration began
+ */
+struct perf_log {
+	const char *phase;
+	int fd[PERF_N_COUNTERS];
+	struct perf_event_mmap_page *pc[PERF_N_COUNTERS];
+	uint64_t n;
+	uint64_t total[PERF_N_COUNTERS];
+	uint64_t start[PERF_N_COUNTERS];
+} __attribute__((aligned(64))) /* don't want sharing between cores */;
+
+extern struct perf_log perf_logs[];
+
+static inline void perf_log_close(struct perf_log *pl)
+{
+	int i;
+
+	pl->phase = NULL;
+	for (i = 0; i < PERF_N_COUNTERS; i++) {
+		if (pl->pc[i] != NULL)
+			munmap(pl->pc[i], sysconf(_SC_PAGESIZE));
+		if (pl->fd[i] >= 0)
+			close(pl->fd[i]);
+		pl->pc[i] = NULL;
+		pl->fd[i] = -1;
+	}
+}
+
+/**
+ * Opens counters of the calling thread, to be read around iterations of
+ * 	loop @phase. Must be called from the core that runs the loop.
+ * Returns 0 on success, or a negative error code, in which case
+ * 	perf_phase_begin and perf_phase_end do nothing.
+ */
+static inline int perf_log_open(struct perf_log *pl, const char *phase)
+{
+	static const uint64_t configs[PERF_N_COUNTERS] = {
+		PERF_COUNT_HW_CPU_CYCLES,
+		PERF_COUNT_HW_INSTRUCTIONS,
+		PERF_COUNT_HW_CACHE_MISSES,
+		PERF_COUNT_HW_BRANCH_MISSES,
+	};
+	struct perf_event_attr attr;
+	int i, ret;
+
+	memset(pl, 0, sizeof(*pl));
+	for (i = 0; i < PERF_N_COUNTERS; i++)
+		pl->fd[i] = -1;
+	if (!MAINTAIN_PERF_COUNTERS)
+		return 0;
+
+	for (i = 0; i < PERF_N_COUNTERS; i++) {
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = configs[i];
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+
+		pl->fd[i] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+		if (pl->fd[i] < 0) {
+			ret = -errno;
+			goto fail;
+		}
+		pl->pc[i] = (struct perf_event_mmap_page *) mmap(NULL,
+				sysconf(_SC_PAGESIZE), PROT_READ, MAP_SHARED, pl->fd[i], 0);
+		if (pl->pc[i] == MAP_FAILED) {
+			pl->pc[i] = NULL;
+			ret = -errno;
+			goto fail;
+		}
+		if (!pl->pc[i]->cap_user_rdpmc) {
+			ret = -EPERM;
+			goto fail;
+		}
+	}
+
+	pl->phase = phase;
+	return 0;
+
+fail:
+	fprintf(stderr, "could not open perf counter %d for %s: %s\n", i, phase,
+			strerror(-ret));
+	perf_log_close(pl);
+	return ret;
+}
+
+/**
+ * Returns the value of the counter with mmapped page @pc
+ */
+static inline __attribute__((always_inline))
+uint64_t perf_rdpmc(struct perf_event_mmap_page *pc)
+{
+	uint32_t seq, index, lo, hi;
+	uint64_t count;
+	int64_t pmc;
+
+	/* the kernel updates offset and index when it schedules the event */
+	do {
+		seq = pc->lock;
+		asm volatile("" : : : "memory");
+		index = pc->index;
+		count = pc->offset;
+		if (index != 0) {
+			asm volatile("rdpmc" : "=a" (lo), "=d" (hi) : "c" (index - 1));
+			pmc = (int64_t) (((uint64_t) hi << 32) | lo);
+			/* sign-extend the pmc_width bits of the counter */
+			pmc <<= 64 - pc->pmc_width;
+			pmc >>= 64 - pc->pmc_width;
+			count += pmc;
+		}
+		asm volatile("" : : : "memory");
+	} while (pc->lock != seq);
+
+	return count;
+}
+
+static inline __attribute__((always_inline))
+void perf_phase_begin(struct perf_log *pl)
+{
+	int i;
+
+	if (MAINTAIN_PERF_COUNTERS && pl->phase != NULL)
+		for (i = 0; i < PERF_N_COUNTERS; i++)
+			pl->start[i] = perf_rdpmc(pl->pc[i]);
+}
+
+static inline __attribute__((always_inline))
+void perf_phase_end(struct perf_log *pl)
+{
+	int i;
+
+	if (MAINTAIN_PERF_COUNTERS && pl->phase != NULL) {
+		for (i = 0; i < PERF_N_COUNTERS; i++)
+			pl->total[i] += perf_rdpmc(pl->pc[i]) - pl->start[i];
+		pl->n++;
+	}
+}
+
+/**
+ * Prints counters per iteration of @pl since @saved, and saves @pl to @saved.
+ * 	Called by the log core.
+ */
+static inline void print_perf_log(uint16_t lcore, struct perf_log *pl,
+		struct perf_log *saved)
+{
+	uint64_t n = pl->n - saved->n;
+	double d[PERF_N_COUNTERS];
+	int i;
+
+	if (pl->phase == NULL)
+		return;
+
+	for (i = 0; i < PERF_N_COUNTERS; i++)
+		d[i] = (double) (pl->total[i] - saved->total[i]);
+	memcpy(saved, pl, sizeof(*saved));
+
+	if (n == 0)
+		return;
+	printf("\nperf lcore %d %s: %lu iterations, per iteration %0.1f cycles, "
+			"%0.1f instructions (IPC %0.2f), %0.2f LLC misses, "
+			"%0.2f branch misses",
+			lcore, pl->phase, n, d[PERF_CYCLES] / n,
+			d[PERF_INSTRUCTIONS] / n,
+			d[PERF_INSTRUCTIONS] / (d[PERF_CYCLES] + 1),
+			d[PERF_LLC_MISSES] / n, d[PERF_BRANCH_MISSES] / n);
+}
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* PERF_COUNTERS_H_ */
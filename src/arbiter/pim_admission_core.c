@@ -12,17 +12,16 @@
 
 #include "admission_core_common.h"
 #include "admission_log.h"
+#include "perf_counters.h"
 #include "../grant-accept/pim.h"
 #include "../graph-algo/algo_config.h"
 
 #define		Q_NEW_DEMANDS_RING_SIZE      (64 * 1024)
-#define		Q_READY_PARTITIONS_RING_SIZE (2 * N_PARTITIONS)
 
 struct pim_state g_pim_state;
 
 struct admission_log admission_core_logs[RTE_MAX_LCORE];
 struct rte_ring *q_new_demands[N_ADMISSION_CORES];
-struct rte_ring *q_ready_partitions[N_ADMISSION_CORES];
 
 void pim_admission_init_global(struct rte_ring *q_admitted_out,
 		struct rte_mempool *admitted_traffic_mempool)
@@ -64,19 +63,9 @@ void pim_admission_init_global(struct rte_ring *q_admitted_out,
                                  i, rte_strerror(rte_errno));
 	}
 
-	/* init q_ready_partitions */
-	for (i = 0; i < N_ADMISSION_CORES; i++) {
-		snprintf(s, sizeof(s), "q_ready_partitions_%d", i);
-		q_ready_partitions[i] = rte_ring_create(s, Q_READY_PARTITIONS_RING_SIZE,
-							0, RING_F_SC_DEQ);
-		if (q_ready_partitions[i] == NULL)
-			rte_exit(EXIT_FAILURE, "Cannot init q_ready_partitions[%d]: %s\n",
-                                 i, rte_strerror(rte_errno));
-	}
-
 	/* init pim_state */
 	pim_init_state(&g_pim_state, q_new_demands, q_admitted_out,
-                       bin_mempool, admitted_traffic_mempool, q_ready_partitions);
+                       bin_mempool, admitted_traffic_mempool);
 }
 
 void pim_admission_init_core(uint16_t lcore_id)
@@ -98,12 +87,15 @@ int exec_pim_admission_core(void *void_cmd_p)
 	ADMISSION_DEBUG("core %d admission %d starting allocations\n",
 			rte_lcore_id(), core_ind);
 
+	perf_log_open(&perf_logs[rte_lcore_id()], "allocation timeslot");
+
 	/* do allocation loop */
 	while (1) {
 		/* TODO: skip timeslots */
 		
 		/* perform allocation */
 		admission_log_allocation_begin(logical_timeslot);
+		perf_phase_begin(&perf_logs[rte_lcore_id()]);
 
                 /* reset per-timeslot state */
                 pim_prepare(&g_pim_state, core_ind);
@@ -113,7 +105,7 @@ int exec_pim_admission_core(void *void_cmd_p)
                 pim_do_accept(&g_pim_state, core_ind);
                 pim_process_accepts(&g_pim_state, core_ind);
                 uint8_t i;
-                for (i = 1; i < NUM_ITERATIONS; i++) {
+                for (i = 1; i < g_pim_state.n_iterations; i++) {
                         pim_do_grant(&g_pim_state, core_ind);
                         pim_do_accept(&g_pim_state, core_ind);
                         pim_process_accepts(&g_pim_state, core_ind);
@@ -121,6 +113,7 @@ int exec_pim_admission_core(void *void_cmd_p)
 
                 pim_complete_timeslot(&g_pim_state, core_ind);
 
+		perf_phase_end(&perf_logs[rte_lcore_id()]);
 		admission_log_allocation_end(logical_timeslot);
 
 		logical_timeslot += 1;
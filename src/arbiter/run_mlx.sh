@@ -41,6 +41,6 @@ else
 fi
 
 # clear switch logs
-rm -fr ./log/queues-*.csv
+rm -fr ./log/telemetry-*.bin
 
 sudo $FAST -c 7 -n 3 --no-hpet -d ./librte_pmd_mlx4.so -- -p 1 > arbiter_log.txt 2> arbiter_error.txt
@@ -8,8 +8,10 @@
 #include <math.h>
 
 #include "main.h"
+#include "control.h"
 #include "admission_core_common.h"
 #include "admission_log.h"
+#include "perf_counters.h"
 #include "../protocol/platform.h"
 #include "../graph-algo/admissible_structures.h"
 #include "../graph-algo/admissible_traffic.h"
@@ -19,9 +21,13 @@ struct seq_admissible_status g_seq_admissible_status;
 
 struct admission_log admission_core_logs[RTE_MAX_LCORE];
 
-struct rte_ring *q_head;
+struct rte_ring *q_head[SEQ_N_INTAKES];
 struct rte_ring *q_bin[2 * N_ADMISSION_CORES];
 
+#if (SEQ_N_INTAKES != N_COMM_CORES)
+#error "the sequential allocator needs one intake per comm core, set SEQ_N_INTAKES"
+#endif
+
 #ifndef NSEC_PER_SEC
 #define NSEC_PER_SEC (1000*1000*1000)
 #endif
@@ -31,7 +37,6 @@ void seq_admission_init_global(struct rte_ring *q_admitted_out,
 {
 	int i;
 	char s[64];
-	struct rte_ring *q_head;
     struct fp_ring *q_spent;
 	struct rte_mempool *bin_mempool;
 
@@ -41,11 +46,14 @@ void seq_admission_init_global(struct rte_ring *q_admitted_out,
 			 "Invalid number of cores for sequential arbiter: %d\n",
 			 ALGO_N_CORES);
 
-	/* init q_head */
-	q_head = rte_ring_create("q_head", Q_HEAD_RING_SIZE, 0, 0);
-	if (q_head == NULL)
-		rte_exit(EXIT_FAILURE,
-				"Cannot init q_head: %s\n", rte_strerror(rte_errno));
+	/* init q_head, one per intake. each has one comm core enqueuing */
+	for (i = 0; i < SEQ_N_INTAKES; i++) {
+		snprintf(s, sizeof(s), "q_head_%d", i);
+		q_head[i] = rte_ring_create(s, Q_HEAD_RING_SIZE, 0, RING_F_SP_ENQ);
+		if (q_head[i] == NULL)
+			rte_exit(EXIT_FAILURE,
+					"Cannot init q_head[%d]: %s\n", i, rte_strerror(rte_errno));
+	}
 
 	/* init q_spent */
 	q_spent = rte_ring_create("q_spent", Q_SPENT_RING_SIZE, 0, 0);
@@ -89,7 +97,7 @@ void seq_admission_init_global(struct rte_ring *q_admitted_out,
 	/* init admissible_status */
 	seq_init_admissible_status(&g_seq_admissible_status, OVERSUBSCRIBED,
 				   INTER_RACK_CAPACITY, OUT_OF_BOUNDARY_CAPACITY,
-				   NUM_NODES, q_head, q_admitted_out, q_spent, bin_mempool,
+				   arbiter_num_nodes, &q_head[0], q_admitted_out, q_spent, bin_mempool,
 				   admitted_traffic_mempool, &q_bin[0]);
 }
 
@@ -124,6 +132,8 @@ int exec_seq_admission_core(void *void_cmd_p)
 	ADMISSION_DEBUG("core %d admission %d starting allocations\n",
 			rte_lcore_id(), core_ind);
 
+	perf_log_open(&perf_logs[rte_lcore_id()], "allocation batch");
+
 	/* do allocation loop */
 	while (1) {
 		/* re-calibrate clock */
@@ -134,9 +144,11 @@ int exec_seq_admission_core(void *void_cmd_p)
 
 		/* perform allocation */
 		admission_log_allocation_begin(logical_timeslot);
+		perf_phase_begin(&perf_logs[rte_lcore_id()]);
 		seq_get_admissible_traffic(&g_seq_admissible_status, core_ind,
 					   logical_timeslot + (rdtsc_tslot - real_tslot),
 					   rdtsc_mul, rdtsc_shift);
+		perf_phase_end(&perf_logs[rte_lcore_id()]);
 		admission_log_allocation_end(logical_timeslot);
 
 		logical_timeslot += BATCH_SIZE * N_ADMISSION_CORES;
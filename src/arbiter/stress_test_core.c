@@ -108,21 +108,72 @@ static inline uint64_t process_allocated_traffic(struct comm_core_state *core,
 #endif
 }
 
-static inline void get_next_backlog_request(struct request_generator *gen,
-		struct request *next_request, uint32_t percent_out_of_group) {
+/* requests generated ahead of time, handed out one by one */
+struct request_block {
+	struct request reqs[REQ_GEN_BATCH_SIZE];
+	uint32_t next;
+};
+
+/**
+ * Initializes @gen with the sizes and destinations configured in @cmd. Keeps
+ *    emulation traffic within groups (racks) except for @percent_out_of_group,
+ *    unless another pattern is configured.
+ */
+static void init_stress_test_generator(struct request_generator *gen,
+		struct request_block *block, struct stress_test_core_cmd *cmd,
+		double mean_t_btwn_requests, uint64_t now,
+		uint32_t percent_out_of_group) {
+	enum request_dst_pattern dst_pattern = cmd->dst_pattern;
+	uint32_t dst_param = cmd->dst_param;
+
+	init_request_generator(gen, mean_t_btwn_requests, now, cmd->first_node,
+			cmd->num_nodes, STRESS_TEST_NUM_NODES, cmd->demand_tslots);
+	set_request_size_cdf(gen, cmd->size_cdf);
 #if defined(EMULATION_ALGO)
-	get_next_request_biased(gen, next_request, percent_out_of_group);
+	if (dst_pattern == REQ_DST_UNIFORM) {
+		dst_pattern = REQ_DST_GROUPED;
+		dst_param = percent_out_of_group;
+	}
 #else
-	get_next_request(gen, next_request);
+	(void) percent_out_of_group;
 #endif
+	if (set_request_dst_pattern(gen, dst_pattern, dst_param) != 0)
+		rte_exit(EXIT_FAILURE, "Invalid stress test destination pattern %d "
+				"(param %u) for %d nodes\n", dst_pattern, dst_param,
+				STRESS_TEST_NUM_NODES);
+
+	block->next = REQ_GEN_BATCH_SIZE;
+}
+
+/**
+ * Returns the next request of @gen, generating a block of them when the
+ *    previous one runs out. Requests already in the block are dropped when
+ *    the generator is reinitialized, by setting block->next to
+ *    REQ_GEN_BATCH_SIZE.
+ */
+static inline struct request *get_next_backlog_request(
+		struct request_generator *gen, struct request_block *block) {
+	if (block->next == REQ_GEN_BATCH_SIZE) {
+		get_next_requests(gen, block->reqs, REQ_GEN_BATCH_SIZE);
+		block->next = 0;
+	}
+	return &block->reqs[block->next++];
+}
 
+/**
+ * Flushes the demands this core added, and only those: other cores may be
+ *    adding to their own intakes or stages.
+ */
+static inline void flush_stress_test_backlog(struct stress_test_core_cmd *cmd)
+{
+	flush_backlog(g_admissible_status(), cmd->comm_core_index);
 }
 
 /**
  * Adds demands from 'num_srcs' sources, each to 'num_dsts_per_src'.
  *    Demand is for 'flow_size' tslots.
  */
-static void add_initial_requests(struct comm_core_state *core,
+static void add_initial_requests(struct stress_test_core_cmd *cmd,
 		uint32_t num_srcs, uint32_t num_dsts_per_src, uint32_t flow_size)
 {
 	uint32_t src;
@@ -132,7 +183,7 @@ static void add_initial_requests(struct comm_core_state *core,
 			add_backlog(g_admissible_status(), src, (src + 1 + i) % num_srcs,
 					flow_size, 0, NULL);
 
-	flush_backlog(g_admissible_status());
+	flush_stress_test_backlog(cmd);
 }
 
 static inline void print_completion_stats(uint64_t *admitted_tslots,
@@ -231,7 +282,8 @@ int exec_slave_stress_test_core(void *void_cmd_p) {
 	const unsigned lcore_id = rte_lcore_id();
 	uint64_t now;
 	struct request_generator gen;
-	struct request next_request;
+	struct request_block request_block;
+	struct request *next_request;
 	struct comm_core_state *core = &ccore_state[lcore_id];
 	uint64_t min_next_iteration_time;
 	uint64_t loop_minimum_iteration_time =
@@ -267,11 +319,11 @@ int exec_slave_stress_test_core(void *void_cmd_p) {
 
 	mean_t_btwn_requests = cmd->mean_t_btwn_requests;
 	comm_log_mean_t(mean_t_btwn_requests);
-	init_request_generator(&gen, mean_t_btwn_requests, now, cmd->first_node,
-			cmd->num_nodes, STRESS_TEST_NUM_NODES, cmd->demand_tslots);
+	init_stress_test_generator(&gen, &request_block, cmd, mean_t_btwn_requests,
+			now, percent_out_of_group);
 
     /* generate the first request */
-	get_next_backlog_request(&gen, &next_request, percent_out_of_group);
+	next_request = get_next_backlog_request(&gen, &request_block);
 
 	/* MAIN LOOP */
 	while (now < cmd->end_time) {
@@ -284,24 +336,25 @@ int exec_slave_stress_test_core(void *void_cmd_p) {
 			/* reinitialize the request generator */
 			comm_log_mean_t(next_mean_t_btwn_requests);
 			reinit_request_generator(&gen, next_mean_t_btwn_requests, now);
-			get_next_backlog_request(&gen, &next_request, percent_out_of_group);
+			request_block.next = REQ_GEN_BATCH_SIZE;
+			next_request = get_next_backlog_request(&gen, &request_block);
             mean_t_btwn_requests = next_mean_t_btwn_requests;
 		}
 
 		/* if time to enqueue requests, do so now */
 		for (i = 0; i < MAX_ENQUEUES_PER_LOOP; i++) {
-			if (next_request.time > now)
+			if (next_request->time > now)
 				break;
 
 			/* enqueue the request */
-			add_backlog_wrapper(next_request.src, next_request.dst,
-					next_request.backlog);
-			comm_log_demand_increased(next_request.src, next_request.dst, 0,
-					next_request.backlog, next_request.backlog);
+			add_backlog_wrapper(next_request->src, next_request->dst,
+					next_request->backlog);
+			comm_log_demand_increased(next_request->src, next_request->dst, 0,
+					next_request->backlog, next_request->backlog);
 			n_processed_requests++;
 
 			/* generate the next request */
-			get_next_backlog_request(&gen, &next_request, percent_out_of_group);
+			next_request = get_next_backlog_request(&gen, &request_block);
 		}
 		comm_log_processed_batch(n_processed_requests, now);
 
@@ -310,8 +363,7 @@ int exec_slave_stress_test_core(void *void_cmd_p) {
 				cmd->q_allocated, cmd->admitted_traffic_mempool,
 				cmd->num_q_allocated);
 
-		handle_spent_demands(g_admissible_status());
-		flush_backlog(g_admissible_status());
+		flush_stress_test_backlog(cmd);
 
 		/* record the cumulative number of tslots allocated at each second
 		 * throughout the experiment */
@@ -346,7 +398,8 @@ int exec_stress_test_core(void *void_cmd_p)
 	const unsigned lcore_id = rte_lcore_id();
 	uint64_t now;
 	struct request_generator gen;
-	struct request next_request;
+	struct request_block request_block;
+	struct request *next_request;
 	struct comm_core_state *core = &ccore_state[lcore_id];
 	uint64_t min_next_iteration_time;
 	uint64_t loop_minimum_iteration_time =
@@ -387,7 +440,7 @@ int exec_stress_test_core(void *void_cmd_p)
 	/* Add initial demands */
 	assert(cmd->num_initial_srcs <= cmd->num_nodes);
 //	assert(cmd->num_initial_dsts_per_src < cmd->num_initial_srcs);
-	add_initial_requests(core, cmd->num_initial_srcs,
+	add_initial_requests(cmd, cmd->num_initial_srcs,
 			cmd->num_initial_dsts_per_src, cmd->initial_flow_size);
 
 	/* Determine mean t between requests */
@@ -414,12 +467,11 @@ int exec_stress_test_core(void *void_cmd_p)
 	next_record_admitted_time = now;
 	next_rate_check_time = now;
 
-	init_request_generator(&gen, next_mean_t_btwn_requests, now,
-			cmd->first_node, cmd->num_nodes, STRESS_TEST_NUM_NODES,
-			cmd->demand_tslots);
+	init_stress_test_generator(&gen, &request_block, cmd,
+			next_mean_t_btwn_requests, now, percent_out_of_group);
 
 	/* generate the first request */
-	get_next_backlog_request(&gen, &next_request, percent_out_of_group);
+	next_request = get_next_backlog_request(&gen, &request_block);
 
 	/* MAIN LOOP */
 	while (now < cmd->end_time) {
@@ -511,8 +563,8 @@ int exec_stress_test_core(void *void_cmd_p)
 				/* reinitialize the request generator */
 				comm_log_mean_t(next_mean_t_btwn_requests);
 				reinit_request_generator(&gen, next_mean_t_btwn_requests, now);
-				get_next_backlog_request(&gen, &next_request,
-						percent_out_of_group);
+				request_block.next = REQ_GEN_BATCH_SIZE;
+				next_request = get_next_backlog_request(&gen, &request_block);
 
 				next_rate_increase_time = rte_get_timer_cycles() +
 						rte_get_timer_hz() * STRESS_TEST_RATE_INCREASE_GAP_SEC;
@@ -526,21 +578,20 @@ int exec_stress_test_core(void *void_cmd_p)
 
 		/* if time to enqueue request, do so now */
 		for (i = 0; i < MAX_ENQUEUES_PER_LOOP; i++) {
-			if (next_request.time > now)
+			if (next_request->time > now)
 				break;
 
 			/* enqueue the request */
-			add_backlog_wrapper(next_request.src, next_request.dst,
-								next_request.backlog);
-			comm_log_demand_increased(next_request.src, next_request.dst, 0,
-					next_request.backlog, next_request.backlog);
-			total_demand += next_request.backlog;
+			add_backlog_wrapper(next_request->src, next_request->dst,
+								next_request->backlog);
+			comm_log_demand_increased(next_request->src, next_request->dst, 0,
+					next_request->backlog, next_request->backlog);
+			total_demand += next_request->backlog;
 
 			n_processed_requests++;
 
 			/* generate the next request */
-			get_next_backlog_request(&gen, &next_request,
-					percent_out_of_group);
+			next_request = get_next_backlog_request(&gen, &request_block);
 		}
 
 		comm_log_processed_batch(n_processed_requests, now);
@@ -550,12 +601,8 @@ int exec_stress_test_core(void *void_cmd_p)
 				cmd->q_allocated, cmd->admitted_traffic_mempool,
 				cmd->num_q_allocated);
 
-		/* Process the spent demands, launching a new demand for demands where
-		 * backlog increased while the original demand was being allocated */
-		handle_spent_demands(g_admissible_status());
-
 		/* flush q_head's buffer into q_head */
-		flush_backlog(g_admissible_status());
+		flush_stress_test_backlog(cmd);
 
 		/* record the cumulative number of tslots allocated at each second
 		 * throughout the experiment */
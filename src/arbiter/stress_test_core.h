@@ -5,6 +5,7 @@
 #include <stdint.h>
 #include <rte_ip.h>
 #include "../graph-algo/admissible.h"
+#include "../graph-algo/generate_requests.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -20,6 +21,7 @@ extern "C" {
  * Specifications for controller thread
  */
 struct stress_test_core_cmd {
+	uint16_t comm_core_index;
 	uint64_t start_time;
 	uint64_t end_time;
 	uint64_t first_time_slot;
@@ -28,6 +30,9 @@ struct stress_test_core_cmd {
 	uint32_t num_nodes;
 	uint32_t first_node;
 	uint32_t demand_tslots;
+	const struct request_size_cdf *size_cdf; /* exponential sizes if NULL */
+	enum request_dst_pattern dst_pattern;
+	uint32_t dst_param;
 
 	uint32_t num_initial_srcs;
 	uint32_t num_initial_dsts_per_src;
@@ -0,0 +1,67 @@
+/*
+ * telemetry.h
+ *
+ *  Created on: October 19, 2026
+ */
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <stdint.h>
+
+/*
+ * Binary telemetry written by the log core, to log/telemetry-<time>.bin.
+ * The file is a telemetry_file_header, then records, each a
+ * telemetry_record_header followed by @len bytes of payload. All counters
+ * are uint64_t in host byte order. decode_telemetry.py converts a file to
+ * CSV. Readers skip records of types they do not know, so new types can be
+ * added without changing the version.
+ */
+
+#define TELEMETRY_MAGIC				"FPTELEM"
+#define TELEMETRY_VERSION			1
+
+enum telemetry_record_type {
+	/* enqueues[n_ports], dequeues[n_ports] of router @index */
+	TELEMETRY_QUEUE_BANK		= 1,
+	/* drops[n_ports], marks[n_ports] of emulation core @index */
+	TELEMETRY_PORT_DROPS		= 2,
+	/* max_occupancy[n_ports], occupancy_hist[n_ports][n_hist_buckets],
+	 * delay_hist[n_ports][n_hist_buckets] of router @index, see
+	 * struct queue_bank_histograms. max_occupancy is over the period
+	 * between the two previous samples of the router. */
+	TELEMETRY_QUEUE_HIST		= 3,
+};
+
+/**
+ * @magic: TELEMETRY_MAGIC, with its terminating 0
+ * @n_ports: counters per router or core in each array of a record
+ * @n_routers: routers whose queue banks are sampled
+ * @n_cores: emulation cores whose drops are sampled
+ * @n_hist_buckets: buckets per port of histograms, 0 if there are none
+ * @start_ns: time the log core started
+ */
+struct telemetry_file_header {
+	char magic[8];
+	uint32_t version;
+	uint16_t n_ports;
+	uint16_t n_routers;
+	uint16_t n_cores;
+	uint16_t n_hist_buckets;
+	uint16_t reserved[2];
+	uint64_t start_ns;
+};
+
+/**
+ * @index: router or core the record is about
+ * @len: bytes of payload following the header
+ * @time_ns: when the sample was taken
+ */
+struct telemetry_record_header {
+	uint16_t type;
+	uint16_t index;
+	uint32_t len;
+	uint64_t time_ns;
+};
+
+#endif /* TELEMETRY_H_ */
@@ -43,6 +43,25 @@ struct emu_admission_core_statistics {
 	uint64_t endpoint_driver_push_begin;
 	uint64_t endpoint_driver_pull_begin;
 	uint64_t endpoint_driver_new_begin;
+
+	/* counters used by links to other emulator processes */
+	uint64_t partition_link_sent;
+	uint64_t partition_link_received;
+	uint64_t partition_link_wait_for_peer;
+	uint64_t partition_link_ring_full;
+	uint64_t partition_link_held;
+	uint64_t partition_link_alloc_failed;
+
+	/* counters used by links with propagation delay */
+	uint64_t delay_line_full;
+
+	/* packets the emulator dropped on full rings and delay lines, as opposed
+	 * to drops by the emulated network in dropped_packet */
+	uint64_t artificial_drop;
+
+	/* counters used by credit flow control */
+	uint64_t credit_limited;
+	uint64_t credit_held;
 };
 
 /**
@@ -53,6 +72,10 @@ struct emu_admission_statistics {
 	uint64_t packet_alloc_failed;
 	uint64_t enqueue_backlog_failed;
 	uint64_t enqueue_reset_failed;
+	uint64_t non_local_backlog;
+
+	/* backlog the comm cores dropped before it entered the emulated network */
+	uint64_t artificial_drop;
 };
 
 /*
@@ -183,6 +206,77 @@ void adm_log_emu_endpoint_driver_new_begin(
 		st->endpoint_driver_new_begin++;
 }
 
+static inline __attribute__((always_inline))
+void adm_log_emu_partition_link_sent(
+		struct emu_admission_core_statistics *st, uint32_t n_pkts) {
+	if (MAINTAIN_EMU_ADM_LOG_COUNTERS)
+		st->partition_link_sent += n_pkts;
+}
+
+static inline __attribute__((always_inline))
+void adm_log_emu_partition_link_received(
+		struct emu_admission_core_statistics *st, uint32_t n_pkts) {
+	if (MAINTAIN_EMU_ADM_LOG_COUNTERS)
+		st->partition_link_received += n_pkts;
+}
+
+static inline __attribute__((always_inline))
+void adm_log_emu_partition_link_wait_for_peer(
+		struct emu_admission_core_statistics *st) {
+	if (MAINTAIN_EMU_ADM_LOG_COUNTERS)
+		st->partition_link_wait_for_peer++;
+}
+
+static inline __attribute__((always_inline))
+void adm_log_emu_partition_link_ring_full(
+		struct emu_admission_core_statistics *st, uint32_t n_held) {
+	if (MAINTAIN_EMU_ADM_LOG_COUNTERS) {
+		st->partition_link_ring_full++;
+		st->partition_link_held += n_held;
+	}
+}
+
+static inline __attribute__((always_inline))
+void adm_log_emu_partition_link_alloc_failed(
+		struct emu_admission_core_statistics *st) {
+	if (MAINTAIN_EMU_ADM_LOG_COUNTERS)
+		st->partition_link_alloc_failed++;
+}
+
+static inline __attribute__((always_inline))
+void adm_log_emu_delay_line_full(struct emu_admission_core_statistics *st,
+		uint32_t n_pkts) {
+	if (MAINTAIN_EMU_ADM_LOG_COUNTERS)
+		st->delay_line_full += n_pkts;
+}
+
+static inline __attribute__((always_inline))
+void adm_log_emu_artificial_drop(struct emu_admission_core_statistics *st,
+		uint32_t n_pkts) {
+	if (MAINTAIN_EMU_ADM_LOG_COUNTERS)
+		st->artificial_drop += n_pkts;
+}
+
+static inline __attribute__((always_inline))
+void adm_log_emu_artificial_drop(struct emu_admission_statistics *st,
+		uint32_t n_pkts) {
+	if (MAINTAIN_EMU_ADM_LOG_COUNTERS)
+		st->artificial_drop += n_pkts;
+}
+
+static inline __attribute__((always_inline))
+void adm_log_emu_credit_limited(struct emu_admission_core_statistics *st) {
+	if (MAINTAIN_EMU_ADM_LOG_COUNTERS)
+		st->credit_limited++;
+}
+
+static inline __attribute__((always_inline))
+void adm_log_emu_credit_held(struct emu_admission_core_statistics *st,
+		uint32_t n_pkts) {
+	if (MAINTAIN_EMU_ADM_LOG_COUNTERS)
+		st->credit_held += n_pkts;
+}
+
 /* global admission stats */
 
 static inline __attribute__((always_inline))
@@ -206,4 +300,11 @@ void adm_log_emu_enqueue_reset_failed(
 		st->enqueue_reset_failed++;
 }
 
+static inline __attribute__((always_inline))
+void adm_log_emu_non_local_backlog(
+		struct emu_admission_statistics *st) {
+	if (MAINTAIN_EMU_ADM_LOG_COUNTERS)
+		st->non_local_backlog++;
+}
+
 #endif /* EMU_ADMISSIBLE_LOG_H__ */
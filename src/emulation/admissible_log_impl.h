@@ -7,6 +7,7 @@
 
 #include "admissible_log.h"
 #include "emulation.h"
+#include "emulation_core.h"
 #include "../arbiter/emu_admission_core.h"
 #include "../protocol/topology.h"
 
@@ -51,15 +52,31 @@ void print_core_admission_log_emulation(uint16_t core_index) {
 			st->endpoint_driver_processed_new, st->endpoint_driver_push_begin, st->endpoint_driver_pull_begin, st->endpoint_driver_new_begin);
 	printf("\n  router driver pushed %lu, pulled %lu, steps begun %lu, steps ended %lu",
 			st->router_driver_pushed, st->router_driver_pulled, st->router_driver_step_begin, st->router_driver_step_end);
+	if (st->partition_link_sent || st->partition_link_received)
+		printf("\n  partition links sent %lu, received %lu, peer waits %lu, ring full %lu (%lu packets held)",
+				st->partition_link_sent, st->partition_link_received,
+				st->partition_link_wait_for_peer,
+				st->partition_link_ring_full, st->partition_link_held);
 
 	printf("\n warnings:");
 	if (st->send_packet_failed)
 		printf("\n  %lu send packet failed", st->send_packet_failed);
+	if (st->delay_line_full)
+		printf("\n  %lu dropped on full delay line", st->delay_line_full);
+	if (D(artificial_drop))
+		printf("\n  %lu dropped by the emulator, not the emulated network",
+				D(artificial_drop));
+	if (D(credit_limited))
+		printf("\n  %lu pulls limited by credits, %lu packets held",
+				D(credit_limited), D(credit_held));
 	if (D(wait_for_admitted_enqueue))
 		printf("\n  %lu admitted waits", D(wait_for_admitted_enqueue));
 	if (D(admitted_alloc_failed))
 		printf("\n  %lu admitted alloc fails", D(admitted_alloc_failed));
 	printf("\n");
+
+	if (MAINTAIN_EMU_PHASE_HISTOGRAMS)
+		emulation->m_cores[core_index]->print_phase_log();
 #undef D
 }
 
@@ -120,6 +137,12 @@ void print_global_admission_log_emulation() {
 		printf("\n  %lu enqueue backlog failed", st->enqueue_backlog_failed);
 	if (st->enqueue_reset_failed)
 		printf("\n  %lu enqueue reset failed", st->enqueue_reset_failed);
+	if (st->non_local_backlog)
+		printf("\n  %lu backlog requests for senders outside this partition rejected",
+				st->non_local_backlog);
+	if (st->artificial_drop)
+		printf("\n  %lu packets of backlog dropped by the emulator, not the emulated network",
+				st->artificial_drop);
 	printf("\n");
 }
 
@@ -80,6 +80,30 @@ void admitted_insert_edge(struct emu_admitted_traffic *admitted,
 	copy_alloc_data_to_admitted_edge(packet, edge);
 }
 
+/**
+ * The number of edges a packet is admitted or dropped with. Endpoints with TSO
+ * handle whole segments, others expect an edge per MTU, so segments are split
+ * here, as late as possible.
+ */
+static inline __attribute__((always_inline))
+uint8_t admitted_n_edges(struct emu_packet *packet) {
+#if defined(USE_TSO)
+	return 1;
+#else
+	return packet->n_mtus;
+#endif
+}
+
+/**
+ * Add an edge for MTU @mtu of a segment to the admitted struct
+ */
+static inline __attribute__((always_inline))
+void admitted_insert_mtu_edge(struct emu_admitted_traffic *admitted,
+		struct emu_packet *packet, uint16_t flags, uint8_t mtu) {
+	admitted_insert_edge(admitted, packet, flags);
+	admitted->edges[admitted->size - 1].id += mtu;
+}
+
 /**
  * Add an admitted edge to the admitted struct
  */
@@ -10,6 +10,8 @@
 
 #include <stdio.h>
 #include <stdexcept>
+#include <vector>
+#include "config.h"
 #include "packet.h"
 #include "packet_impl.h"
 #include "endpoint_group.h"
@@ -72,7 +74,10 @@ public:
 };
 
 /**
- * Schedulers choose, at each time-slot, what packet should leave the port
+ * Schedulers choose, at each time-slot, what packet should leave the port.
+ *   Packets may be segments of several MTUs (emu_packet.n_mtus); the
+ *   composite keeps the port busy until a segment has been transmitted, so
+ *   schedulers need not track segment sizes.
  */
 class Scheduler {
 public:
@@ -82,6 +87,16 @@ public:
 	struct emu_packet *schedule(uint32_t output_port, uint64_t cur_time,
 			Dropper *dropper) {THROW;}
 
+	/**
+	 * Dequeue up to max_pkts packets from a port that sends several MTUs per
+	 *   timeslot. Schedulers without a faster way can use
+	 *   schedule_burst_by_packet().
+	 * @return the number of packets written to pkts
+	 */
+	uint32_t schedule_burst(uint32_t output_port, uint32_t max_pkts,
+			struct emu_packet **pkts, uint64_t cur_time, Dropper *dropper)
+	{THROW;}
+
 	/**
 	 * @return a pointer to a bit mask with 1 for ports with packets, 0 o/w.
 	 */
@@ -101,6 +116,30 @@ public:
 
 #undef THROW
 
+/**
+ * Implements Scheduler::schedule_burst() by calling schedule() until the port
+ *   is empty, the scheduler declines to send, or max_pkts are dequeued.
+ */
+template < class SCH >
+inline  __attribute__((always_inline))
+uint32_t schedule_burst_by_packet(SCH *sch, uint32_t output_port,
+		uint32_t max_pkts, struct emu_packet **pkts, uint64_t cur_time,
+		Dropper *dropper)
+{
+	uint64_t *non_empty_port_mask = sch->non_empty_port_mask();
+	uint32_t n = 0;
+
+	while (n < max_pkts && (non_empty_port_mask[output_port >> 6] &
+			(1ULL << (output_port & 63)))) {
+		pkts[n] = sch->schedule(output_port, cur_time, dropper);
+		if (pkts[n] == NULL)
+			break;
+		n++;
+	}
+
+	return n;
+}
+
 /**
  * A CompositeRouter is made of a Routing Table, a Classifier, a QueueManager,
  * 		and a Scheduler.
@@ -120,6 +159,7 @@ public:
     		uint64_t cur_time, Dropper *dropper);
     virtual uint32_t pull_batch(struct emu_packet **pkts, uint32_t n_pkts,
     		uint64_t *port_masks, uint64_t cur_time, Dropper *dropper);
+    virtual void set_port_rate(uint16_t port, uint8_t rate);
 
 private:
     RT *m_rt;
@@ -127,6 +167,80 @@ private:
 	QM *m_qm;
 	SCH *m_sch;
 	uint32_t m_n_ports;
+	/* MTUs each port sends per timeslot, NULL if all ports send one */
+	uint8_t *m_port_rates;
+	/* first timeslot each port may send in, after sending a segment */
+	std::vector<uint64_t> m_port_free_time;
+};
+
+/**
+ * The Classifier, QueueManager and Scheduler that handle a group of ports of
+ *   a SplitCompositeRouter.
+ */
+template < class CLA, class QM, class SCH >
+class PortGroup {
+public:
+	PortGroup(CLA *cla, QM *qm, SCH *sch) : cla(cla), qm(qm), sch(sch) {
+		/* static check: make sure template parameters are of the correct
+		 * classes */
+		(void)static_cast<Classifier*>((CLA*)0);
+		(void)static_cast<QueueManager*>((QM*)0);
+		(void)static_cast<Scheduler*>((SCH*)0);
+	}
+
+	CLA *cla;
+	QM *qm;
+	SCH *sch;
+};
+
+/**
+ * A SplitCompositeRouter is made of a Routing Table and two PortGroups: ports
+ *   below first_g1_port are handled by G0, and the rest by G1, e.g. a ToR's
+ *   downward-facing ports and its uplinks. Each group's components are
+ *   statically typed, so the per-packet path has no virtual calls. Both
+ *   groups store packets in one queue bank indexed by router port, so queue
+ *   bank and drop stats cover all ports.
+ *
+ * To run different QMs or schedulers on different ports of a router, derive
+ *   from a SplitCompositeRouter with a PortGroup for each, as
+ *   DCTCPPrioUplinkRouter does.
+ */
+template < class RT, class G0, class G1 >
+class SplitCompositeRouter : public Router {
+public:
+	SplitCompositeRouter(RT *rt, G0 g0, G1 g1, uint32_t n_ports,
+			uint32_t first_g1_port);
+	virtual ~SplitCompositeRouter();
+
+	virtual void push(struct emu_packet *packet, uint64_t cur_time,
+			Dropper *dropper);
+	virtual struct emu_packet *pull(uint16_t port, uint64_t cur_time,
+			Dropper *dropper);
+
+	virtual void push_batch(struct emu_packet **pkts, uint32_t n_pkts,
+			uint64_t cur_time, Dropper *dropper);
+	virtual uint32_t pull_batch(struct emu_packet **pkts, uint32_t n_pkts,
+			uint64_t *port_masks, uint64_t cur_time, Dropper *dropper);
+	virtual void set_port_rate(uint16_t port, uint8_t rate);
+
+private:
+	inline void push_one(struct emu_packet *packet, uint64_t cur_time,
+			Dropper *dropper);
+
+	RT *m_rt;
+	G0 m_g0;
+	G1 m_g1;
+	uint32_t m_n_ports;
+	uint32_t m_first_g1_port;
+	/* MTUs each port sends per timeslot, NULL if all ports send one */
+	uint8_t *m_port_rates;
+	/* first timeslot each port may send in, after sending a segment */
+	std::vector<uint64_t> m_port_free_time;
+	/* ports of each group, and the requested ports of each group */
+	std::vector<uint64_t> m_g0_ports;
+	std::vector<uint64_t> m_g1_ports;
+	std::vector<uint64_t> m_g0_masks;
+	std::vector<uint64_t> m_g1_masks;
 };
 
 /**
@@ -153,17 +267,27 @@ private:
 	SINK *m_sink;
 	uint32_t m_first_endpoint_id;
 	uint32_t m_n_endpoints;
+	/* first timeslot each endpoint may send in, after sending a segment */
+	std::vector<uint64_t> m_port_free_time;
 };
 
-/** shared functionality between CompositeEndpointGroup and CompositeRouter */
+/**
+ * shared functionality between CompositeEndpointGroup and CompositeRouter.
+ * port_free_time holds the first timeslot each port may send in, and is
+ * updated when a port sends a segment of several MTUs. port_rates gives the
+ * MTUs each port may send this timeslot, or is NULL if every port sends at
+ * most one.
+ */
 template < class SCH >
 inline  __attribute__((always_inline))
 uint32_t composite_pull_batch(SCH *sch, uint32_t n_elems,
 		struct emu_packet **pkts, uint32_t n_pkts, uint64_t *port_masks,
-		uint64_t cur_time, Dropper *dropper)
+		uint64_t cur_time, Dropper *dropper, uint64_t *port_free_time,
+		const uint8_t *port_rates = NULL)
 {
 	uint64_t *non_empty_port_mask = sch->non_empty_port_mask();
 	uint32_t res = 0;
+	uint32_t first, rate, mtus, j;
 
 /*	if (unlikely(n_pkts < n_elems))
 		throw std::runtime_error("pull_batch should be passed space for at least n_elems packets");*/
@@ -173,15 +297,43 @@ uint32_t composite_pull_batch(SCH *sch, uint32_t n_elems,
 		uint64_t mask = non_empty_port_mask[i] & port_masks[i];
 		uint64_t port;
 		while (mask) {
+			/* no room for more packets, e.g. when the driver is out of
+			 * credits. the remaining ports keep their packets. */
+			if (unlikely(res == n_pkts))
+				return res;
+
 			/* get the index of the lsb that is set */
 			asm("bsfq %1,%0" : "=r"(port) : "r"(mask));
 			/* turn off the set bit in the mask */
 			mask &= (mask - 1);
 			port += 64 * i;
 
-			pkts[res] = sch->schedule(port, cur_time, dropper);
-			if (pkts[res] != NULL)
-				res++;
+			/* the port is still transmitting an earlier segment */
+			if (port_free_time[port] > cur_time)
+				continue;
+
+			first = res;
+			if (port_rates != NULL && port_rates[port] > 1) {
+				uint32_t max_pkts = port_rates[port];
+				if (max_pkts > n_pkts - res)
+					max_pkts = n_pkts - res;
+				rate = port_rates[port];
+				res += sch->schedule_burst(port, max_pkts, &pkts[res],
+						cur_time, dropper);
+			} else {
+				rate = 1;
+				pkts[res] = sch->schedule(port, cur_time, dropper);
+				if (pkts[res] != NULL)
+					res++;
+			}
+
+			/* segments of more MTUs than the port sends per timeslot keep it
+			 * busy in the following timeslots */
+			mtus = 0;
+			for (j = first; j < res; j++)
+				mtus += pkts[j]->n_mtus;
+			if (unlikely(mtus > rate))
+				port_free_time[port] = cur_time + (mtus + rate - 1) / rate;
 		}
 	}
 
@@ -196,7 +348,8 @@ template < class RT, class CLA, class QM, class SCH >
 CompositeRouter<RT,CLA,QM,SCH>::CompositeRouter(
 		RT *rt, CLA *cla, QM *qm, SCH *sch, uint32_t n_ports)
 	: m_rt(rt), m_cla(cla), m_qm(qm), m_sch(sch),
-	  m_n_ports(n_ports)
+	  m_n_ports(n_ports), m_port_rates(NULL),
+	  m_port_free_time(n_ports, 0)
 {
 	/* static check: make sure template parameters are of the correct classes */
 	(void)static_cast<RoutingTable*>((RT*)0);
@@ -206,7 +359,10 @@ CompositeRouter<RT,CLA,QM,SCH>::CompositeRouter(
 }
 
 template < class RT, class CLA, class QM, class SCH >
-CompositeRouter<RT,CLA,QM,SCH>::~CompositeRouter() {}
+CompositeRouter<RT,CLA,QM,SCH>::~CompositeRouter() {
+	if (m_port_rates != NULL)
+		fp_free(m_port_rates);
+}
 
 /** helper for common functionality in push and push_batch */
 template <class RT, class CLA, class QM>
@@ -262,7 +418,156 @@ uint32_t CompositeRouter<RT,CLA,QM,SCH>::pull_batch(struct emu_packet **pkts,
 		Dropper *dropper)
 {
 	return composite_pull_batch<SCH>(m_sch, m_n_ports, pkts, n_pkts,
-			port_masks, cur_time, dropper);
+			port_masks, cur_time, dropper, &m_port_free_time[0],
+			m_port_rates);
+}
+
+/**
+ * shared functionality of composite routers' set_port_rate. port_rates is
+ * allocated on first use, so single-rate routers pay nothing.
+ */
+inline void composite_set_port_rate(uint8_t **port_rates, uint32_t n_ports,
+		uint16_t port, uint8_t rate)
+{
+	uint32_t i;
+
+	if (port >= n_ports || rate == 0 || rate > EMU_MAX_PORT_RATE)
+		throw std::runtime_error("invalid port rate");
+
+	if (*port_rates == NULL) {
+		*port_rates = (uint8_t *) fp_malloc("port_rates", n_ports);
+		if (*port_rates == NULL)
+			throw std::runtime_error("could not allocate port rates");
+		for (i = 0; i < n_ports; i++)
+			(*port_rates)[i] = 1;
+	}
+	(*port_rates)[port] = rate;
+}
+
+template < class RT, class CLA, class QM, class SCH >
+void CompositeRouter<RT,CLA,QM,SCH>::set_port_rate(uint16_t port, uint8_t rate)
+{
+	composite_set_port_rate(&m_port_rates, m_n_ports, port, rate);
+}
+
+
+/***
+ * SplitCompositeRouter
+ */
+
+template < class RT, class G0, class G1 >
+SplitCompositeRouter<RT,G0,G1>::SplitCompositeRouter(RT *rt, G0 g0, G1 g1,
+		uint32_t n_ports, uint32_t first_g1_port)
+	: m_rt(rt), m_g0(g0), m_g1(g1),
+	  m_n_ports(n_ports), m_first_g1_port(first_g1_port),
+	  m_port_rates(NULL),
+	  m_port_free_time(n_ports, 0),
+	  m_g0_ports((n_ports + 63) / 64, 0), m_g1_ports((n_ports + 63) / 64, 0),
+	  m_g0_masks((n_ports + 63) / 64, 0), m_g1_masks((n_ports + 63) / 64, 0)
+{
+	uint32_t port;
+
+	/* static check: make sure template parameters are of the correct classes */
+	(void)static_cast<RoutingTable*>((RT*)0);
+
+	if (first_g1_port > n_ports)
+		throw std::runtime_error("port group starts after the last port");
+
+	for (port = 0; port < n_ports; port++) {
+		if (port < first_g1_port)
+			m_g0_ports[port >> 6] |= (1ULL << (port & 63));
+		else
+			m_g1_ports[port >> 6] |= (1ULL << (port & 63));
+	}
+}
+
+template < class RT, class G0, class G1 >
+SplitCompositeRouter<RT,G0,G1>::~SplitCompositeRouter() {
+	if (m_port_rates != NULL)
+		fp_free(m_port_rates);
+}
+
+template < class RT, class G0, class G1 >
+inline  __attribute__((always_inline))
+void SplitCompositeRouter<RT,G0,G1>::push_one(struct emu_packet *packet,
+		uint64_t cur_time, Dropper *dropper)
+{
+	uint32_t port = m_rt->route(packet);
+	uint32_t queue;
+
+	if (port < m_first_g1_port) {
+		queue = m_g0.cla->classify(packet, port);
+		m_g0.qm->enqueue(packet, port, queue, cur_time, dropper);
+	} else {
+		queue = m_g1.cla->classify(packet, port);
+		m_g1.qm->enqueue(packet, port, queue, cur_time, dropper);
+	}
+}
+
+template < class RT, class G0, class G1 >
+void SplitCompositeRouter<RT,G0,G1>::push(struct emu_packet *packet,
+		uint64_t cur_time, Dropper *dropper)
+{
+	push_one(packet, cur_time, dropper);
+}
+
+template < class RT, class G0, class G1 >
+struct emu_packet *SplitCompositeRouter<RT,G0,G1>::pull(uint16_t port,
+		uint64_t cur_time, Dropper *dropper)
+{
+	if (port < m_first_g1_port)
+		return m_g0.sch->schedule(port, cur_time, dropper);
+	else
+		return m_g1.sch->schedule(port, cur_time, dropper);
+}
+
+template < class RT, class G0, class G1 >
+void SplitCompositeRouter<RT,G0,G1>::push_batch(struct emu_packet **pkts,
+		uint32_t n_pkts, uint64_t cur_time, Dropper *dropper)
+{
+	uint32_t i;
+
+	/* prefetch first group of packets */
+	for (i = 0; i < COMP_PREFETCH_OFFSET && i < n_pkts; i++)
+		fp_prefetch0(pkts[i]);
+
+	/* prefetch next and handle already prefetched */
+	for (i = 0; i + COMP_PREFETCH_OFFSET < n_pkts; i++) {
+		fp_prefetch0(pkts[i + COMP_PREFETCH_OFFSET]);
+		push_one(pkts[i], cur_time, dropper);
+	}
+
+	/* handle last group of prefetched packets */
+	for (; i < n_pkts; i++)
+		push_one(pkts[i], cur_time, dropper);
+}
+
+template < class RT, class G0, class G1 >
+uint32_t SplitCompositeRouter<RT,G0,G1>::pull_batch(struct emu_packet **pkts,
+		uint32_t n_pkts, uint64_t *port_masks, uint64_t cur_time,
+		Dropper *dropper)
+{
+	uint32_t i, res;
+
+	/* each group's scheduler only sees requested ports of its group */
+	for (i = 0; i < m_g0_masks.size(); i++) {
+		m_g0_masks[i] = port_masks[i] & m_g0_ports[i];
+		m_g1_masks[i] = port_masks[i] & m_g1_ports[i];
+	}
+
+	res = composite_pull_batch(m_g0.sch, m_n_ports, pkts, n_pkts,
+			&m_g0_masks[0], cur_time, dropper, &m_port_free_time[0],
+			m_port_rates);
+	res += composite_pull_batch(m_g1.sch, m_n_ports, &pkts[res], n_pkts - res,
+			&m_g1_masks[0], cur_time, dropper, &m_port_free_time[0],
+			m_port_rates);
+	return res;
+}
+
+template < class RT, class G0, class G1 >
+void SplitCompositeRouter<RT,G0,G1>::set_port_rate(uint16_t port, uint8_t rate)
+{
+	composite_set_port_rate(&m_port_rates, m_n_ports, port, rate);
 }
 
 
@@ -275,7 +580,8 @@ inline CompositeEndpointGroup<CLA, QM, SCH, SINK>::CompositeEndpointGroup(
 		CLA* cla, QM* qm, SCH* sch, SINK* sink, uint32_t first_endpoint_id,
 		uint32_t n_endpoints)
 	: m_cla(cla), m_qm(qm), m_sch(sch), m_sink(sink),
-	  m_first_endpoint_id(first_endpoint_id), m_n_endpoints(n_endpoints)
+	  m_first_endpoint_id(first_endpoint_id), m_n_endpoints(n_endpoints),
+	  m_port_free_time(n_endpoints, 0)
 {
 	/* static check: make sure template parameters are of the correct classes */
 	(void)static_cast<Classifier*>((CLA*)0);
@@ -342,7 +648,7 @@ inline uint32_t CompositeEndpointGroup<CLA, QM, SCH, SINK>::pull_batch(
 {
 	uint64_t mask = 0xFFFFFFFFFFFFFFFF;
 	return composite_pull_batch<SCH>(m_sch, m_n_endpoints, pkts, n_pkts, &mask,
-			cur_time, dropper);
+			cur_time, dropper, &m_port_free_time[0]);
 }
 
 #endif /* COMPOSITE_H_ */
@@ -8,7 +8,18 @@
 #ifndef CONFIG_H_
 #define CONFIG_H_
 
-#define DROP_ON_FAILED_ENQUEUE
+/* what drivers do when the ring to the next component is full.
+ * EMU_CREDIT_FLOW_CONTROL: pull only as many packets as the ring has room
+ * 	for, so packets wait in the emulated queues, see util/credit_link.h.
+ * DROP_ON_FAILED_ENQUEUE: drop whole bursts that do not fit, and count them
+ * 	as artificial drops.
+ * neither: spin until the ring has room. */
+#define EMU_CREDIT_FLOW_CONTROL
+//#define DROP_ON_FAILED_ENQUEUE
+
+#if defined(EMU_CREDIT_FLOW_CONTROL) && defined(DROP_ON_FAILED_ENQUEUE)
+#error "define at most one of EMU_CREDIT_FLOW_CONTROL and DROP_ON_FAILED_ENQUEUE"
+#endif
 
 #ifndef ALGO_N_CORES
 #define ALGO_N_CORES			1
@@ -25,5 +36,14 @@
 #define EMU_MAX_EPGS_PER_COMM	EMU_MAX_ENDPOINT_GROUPS
 #define EMU_MAX_PACKET_QS		(3 * EMU_MAX_ENDPOINT_GROUPS + EMU_MAX_ROUTERS)
 #define EMU_MAX_ALGO_CORES		16
+#define EMU_MAX_PORT_RATE		8 /* MTUs per timeslot */
+#define EMU_MAX_SEGMENT_MTUS	64
+
+/* MTUs in each packet created for backlog. Above 1, bulk flows are carried as
+ * segments and split into MTUs only when admitted. With TSO, endpoints choose
+ * segment sizes instead. */
+#ifndef EMU_SEGMENT_MTUS
+#define EMU_SEGMENT_MTUS		1
+#endif
 
 #endif /* CONFIG_H_ */
@@ -13,6 +13,9 @@
 #include "../endpoint_group.h"
 #include "../emulation.h"
 #include "../packet_impl.h"
+#include "../phase_log.h"
+#include "../util/credit_link.h"
+#include "../util/delay_line.h"
 #include "../graph-algo/fp_ring.h"
 #include "../graph-algo/platform.h"
 
@@ -21,7 +24,8 @@
 EndpointDriver::EndpointDriver(struct fp_ring* q_new_packets,
 		struct fp_ring* q_to_router, struct fp_ring* q_from_router,
 		struct fp_ring *q_resets, EndpointGroup* epg,
-		struct fp_mempool *packet_mempool, uint32_t burst_size)
+		struct fp_mempool *packet_mempool, uint32_t burst_size,
+		uint16_t delay)
 	: m_q_new_packets(q_new_packets),
 	  m_q_to_router(q_to_router),
 	  m_q_from_router(q_from_router),
@@ -29,25 +33,40 @@ EndpointDriver::EndpointDriver(struct fp_ring* q_new_packets,
 	  m_epg(epg),
 	  m_cur_time(0),
 	  m_packet_mempool(packet_mempool),
-	  m_burst_size(burst_size)
-{}
+	  m_burst_size(burst_size),
+	  m_delay_line(NULL)
+{
+	if (delay > 0)
+		m_delay_line = delay_line_create(delay, burst_size);
+#ifdef EMU_CREDIT_FLOW_CONTROL
+	m_credit_link = credit_link_create(q_to_router, burst_size);
+#endif
+}
 
 void EndpointDriver::assign_to_core(EmulationOutput *out, Dropper *dropper,
-		struct emu_admission_core_statistics *stat, uint16_t core_index) {
+		struct emu_admission_core_statistics *stat, uint16_t core_index,
+		struct emu_phase_log *phase_logs) {
 	m_epg->assign_to_core(out);
 	m_dropper = dropper;
 	m_stat = stat;
+	m_phase_logs = phase_logs;
 	m_core_index = core_index;
 }
 
 void EndpointDriver::cleanup() {
 	free_packet_ring(m_q_from_router, m_packet_mempool);
+	if (m_delay_line != NULL)
+		delay_line_free(m_delay_line, m_packet_mempool);
+#ifdef EMU_CREDIT_FLOW_CONTROL
+	credit_link_free(m_credit_link, m_packet_mempool);
+#endif
 
 	delete m_epg;
 }
 
 void EndpointDriver::step() {
 	uint64_t endpoint_id;
+	uint64_t phase_start;
 
 	/* handle any resets */
 	while (fp_ring_dequeue(m_q_resets, (void **) &endpoint_id) != -ENOENT) {
@@ -55,9 +74,13 @@ void EndpointDriver::step() {
 		m_epg->reset((uint16_t) endpoint_id);
 	}
 
+	phase_start = emu_phase_now();
 	push();
+	emu_phase_end(m_phase_logs, EMU_PHASE_ENDPOINT_PUSH, &phase_start);
 	pull();
+	emu_phase_end(m_phase_logs, EMU_PHASE_ENDPOINT_PULL, &phase_start);
 	process_new();
+	emu_phase_end(m_phase_logs, EMU_PHASE_ENDPOINT_NEW, &phase_start);
 
 	m_cur_time++;
 }
@@ -89,19 +112,42 @@ inline void EndpointDriver::push() {
  * Emulate pull at a single endpoint group with index @index
  */
 inline void EndpointDriver::pull() {
-	uint32_t n_pkts;
+	uint32_t n_pkts, max_pull, max_send;
 	struct emu_packet *pkts[EPG_MAX_BURST];
 
 	adm_log_emu_endpoint_driver_pull_begin(m_stat);
 
+#ifdef EMU_CREDIT_FLOW_CONTROL
+	/* pull only what the link to the router has credits for, see
+	 * RouterDriver::step() */
+	max_send = credit_link_credits(m_credit_link, m_burst_size, m_stat);
+	if (m_delay_line != NULL)
+		max_pull = MIN(m_burst_size, delay_line_space(m_delay_line));
+	else
+		max_pull = max_send;
+#else
+	max_pull = max_send = m_burst_size;
+#endif
+
 	/* pull a batch of packets from the epg, enqueue to router */
-	n_pkts = m_epg->pull_batch(&pkts[0], m_burst_size, m_cur_time, m_dropper);
-	assert(n_pkts <= m_burst_size);
-#ifdef DROP_ON_FAILED_ENQUEUE
+	n_pkts = m_epg->pull_batch(&pkts[0], max_pull, m_cur_time, m_dropper);
+	assert(n_pkts <= max_pull);
+
+	/* packets on links with propagation delay are sent once they reach the
+	 * router */
+	if (m_delay_line != NULL)
+		n_pkts = delay_line_transfer(m_delay_line, pkts, n_pkts, max_send,
+				m_cur_time, m_packet_mempool, m_stat);
+
+#if defined(EMU_CREDIT_FLOW_CONTROL)
+	credit_link_send(m_credit_link, &pkts[0], n_pkts, m_stat);
+	adm_log_emu_endpoint_driver_pulled(m_stat, n_pkts);
+#elif defined(DROP_ON_FAILED_ENQUEUE)
 	if (n_pkts > 0 && fp_ring_enqueue_bulk(m_q_to_router,
 			(void **) &pkts[0], n_pkts) == -ENOBUFS) {
 		/* no space in ring. log but don't retry. */
 		adm_log_emu_send_packets_failed(m_stat, n_pkts);
+		adm_log_emu_artificial_drop(m_stat, n_pkts);
 		free_packet_bulk(&pkts[0], m_packet_mempool, n_pkts);
 	} else {
 		adm_log_emu_endpoint_driver_pulled(m_stat, n_pkts);
@@ -112,7 +158,6 @@ inline void EndpointDriver::pull() {
 		/* no space in ring. log and retry. */
 		adm_log_emu_send_packets_failed(m_stat, n_pkts);
 	}
-	adm_log_emu_endpoint_sent_packets(m_stat, n_pkts);
 	adm_log_emu_endpoint_driver_pulled(m_stat, n_pkts);
 #endif
 
@@ -8,6 +8,7 @@
 #ifndef DRIVERS_ENDPOINTDRIVER_H_
 #define DRIVERS_ENDPOINTDRIVER_H_
 
+#include "config.h"
 #include "../graph-algo/fp_ring.h"
 #include "../graph-algo/platform.h"
 
@@ -15,19 +16,28 @@ class EndpointGroup;
 class EmulationOutput;
 class Dropper;
 struct emu_admission_statistics;
+struct emu_delay_line;
+struct emu_credit_link;
+struct emu_phase_log;
 
 class EndpointDriver {
 public:
+	/**
+	 * @delay: timeslots of propagation delay on the links to the router, on
+	 * 	top of the one timeslot every hop takes
+	 */
 	EndpointDriver(struct fp_ring *q_new_packets, struct fp_ring *q_to_router,
 			struct fp_ring *q_from_router, struct fp_ring *q_resets,
 			EndpointGroup *epg, struct fp_mempool *packet_mempool,
-			uint32_t burst_size);
+			uint32_t burst_size, uint16_t delay = 0);
 
 	/**
 	 * Prepares this driver to run on a specific core.
+	 * @phase_logs: EMU_N_ENDPOINT_PHASES cycle histograms, or NULL
 	 */
 	void assign_to_core(EmulationOutput *out, Dropper *dropper,
-			struct emu_admission_core_statistics *stat, uint16_t core_index);
+			struct emu_admission_core_statistics *stat, uint16_t core_index,
+			struct emu_phase_log *phase_logs);
 
 	/**
 	 * Emulate a single timeslot
@@ -51,10 +61,15 @@ private:
 	EndpointGroup		*m_epg;
 	Dropper				*m_dropper;
 	struct emu_admission_core_statistics	*m_stat;
+	struct emu_phase_log	*m_phase_logs;
 	uint16_t			m_core_index;
 	uint64_t			m_cur_time;
 	struct fp_mempool	*m_packet_mempool;
 	uint32_t			m_burst_size;
+	struct emu_delay_line	*m_delay_line; /* NULL for no delay */
+#ifdef EMU_CREDIT_FLOW_CONTROL
+	struct emu_credit_link	*m_credit_link;
+#endif
 };
 
 #endif /* DRIVERS_ENDPOINTDRIVER_H_ */
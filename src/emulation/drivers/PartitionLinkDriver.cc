@@ -0,0 +1,138 @@
+/*
+ * PartitionLinkDriver.cc
+ *
+ *  Created on: October 19, 2026
+ */
+
+#include "PartitionLinkDriver.h"
+#include <assert.h>
+#include "../config.h"
+#include "../admissible_log.h"
+#include "../packet_impl.h"
+#include "../util/credit_link.h"
+#include "../util/shm_ring.h"
+#include "../graph-algo/fp_ring.h"
+#include "../graph-algo/platform.h"
+
+PartitionLinkDriver::PartitionLinkDriver(struct fp_ring *q_outbound,
+		const char *tx_name, const char *rx_name, uint32_t ring_size,
+		struct fp_ring *q_inbound, struct fp_mempool *packet_mempool)
+	: m_q_outbound(q_outbound),
+	  m_q_inbound(q_inbound),
+	  m_rx(NULL),
+	  m_n_held(0),
+	  m_tx_name(tx_name),
+	  m_rx_name(rx_name),
+	  m_packet_mempool(packet_mempool),
+	  m_cur_time(0)
+{
+	/* we create the ring we produce into. the ring we consume from is
+	 * attached on first use, so processes can be started in any order. */
+	m_tx = shm_ring_create(tx_name, ring_size);
+#ifdef EMU_CREDIT_FLOW_CONTROL
+	m_credit_link = credit_link_create(q_inbound, PARTITION_LINK_MAX_BURST);
+#endif
+}
+
+void PartitionLinkDriver::assign_to_core(
+		struct emu_admission_core_statistics *stat, uint16_t core_index) {
+	m_stat = stat;
+	m_core_index = core_index;
+}
+
+void PartitionLinkDriver::cleanup() {
+	free_packet_bulk(&m_held[0], m_packet_mempool, m_n_held);
+	free_packet_ring(m_q_outbound, m_packet_mempool);
+#ifdef EMU_CREDIT_FLOW_CONTROL
+	credit_link_free(m_credit_link, m_packet_mempool);
+#endif
+
+	shm_ring_free(m_tx, m_tx_name.c_str(), true);
+	if (m_rx != NULL)
+		shm_ring_free(m_rx, m_rx_name.c_str(), false);
+}
+
+void PartitionLinkDriver::receive() {
+	uint32_t n_pkts, max_pkts;
+	struct emu_packet *pkts[PARTITION_LINK_MAX_BURST];
+
+	if (unlikely(m_rx == NULL))
+		m_rx = shm_ring_attach(m_rx_name.c_str(), m_tx->mask + 1);
+
+	/* wait for the peer to finish the previous timeslot */
+	while (shm_ring_published(m_rx) < m_cur_time) {
+		adm_log_emu_partition_link_wait_for_peer(m_stat);
+		fp_pause();
+	}
+
+#ifdef EMU_CREDIT_FLOW_CONTROL
+	/* send packets held in the previous timeslot. packets the inbound ring
+	 * has no credits for stay in the shared ring until the next timeslot. */
+	credit_link_send(m_credit_link, NULL, 0, m_stat);
+	max_pkts = credit_link_credits(m_credit_link, PARTITION_LINK_MAX_BURST,
+			m_stat);
+#else
+	max_pkts = PARTITION_LINK_MAX_BURST;
+#endif
+
+	/* copy everything sent before this timeslot into local packets */
+	while ((n_pkts = shm_ring_ready(m_rx, m_cur_time, max_pkts)) > 0) {
+		while (fp_mempool_get_bulk(m_packet_mempool, (void **) &pkts[0],
+				n_pkts) == -ENOENT)
+			adm_log_emu_partition_link_alloc_failed(m_stat);
+		shm_ring_dequeue_bulk(m_rx, &pkts[0], n_pkts);
+
+#if defined(EMU_CREDIT_FLOW_CONTROL)
+		credit_link_send(m_credit_link, &pkts[0], n_pkts, m_stat);
+		max_pkts = credit_link_credits(m_credit_link,
+				PARTITION_LINK_MAX_BURST, m_stat);
+#elif defined(DROP_ON_FAILED_ENQUEUE)
+		if (fp_ring_enqueue_bulk(m_q_inbound, (void **) &pkts[0], n_pkts)
+				== -ENOBUFS) {
+			/* no space in ring. log but don't retry. */
+			adm_log_emu_send_packets_failed(m_stat, n_pkts);
+			adm_log_emu_artificial_drop(m_stat, n_pkts);
+			free_packet_bulk(&pkts[0], m_packet_mempool, n_pkts);
+			continue;
+		}
+#else
+		while (fp_ring_enqueue_bulk(m_q_inbound, (void **) &pkts[0], n_pkts)
+				== -ENOBUFS) {
+			/* no space in ring. log and retry. */
+			adm_log_emu_send_packets_failed(m_stat, n_pkts);
+		}
+#endif
+		adm_log_emu_partition_link_received(m_stat, n_pkts);
+	}
+}
+
+void PartitionLinkDriver::send() {
+	uint32_t n_sent;
+
+	/* copy packets held from earlier timeslots, then packets from this
+	 * timeslot, to the peer. don't wait for space: the peer only drains the
+	 * ring in receive(), after we publish this timeslot. */
+	while (m_n_held > 0 || (m_n_held = fp_ring_dequeue_burst(m_q_outbound,
+			(void **) &m_held[0], PARTITION_LINK_MAX_BURST)) > 0) {
+		n_sent = 0;
+		while (n_sent < m_n_held &&
+				shm_ring_enqueue(m_tx, m_held[n_sent], m_cur_time) == 0)
+			n_sent++;
+		free_packet_bulk(&m_held[0], m_packet_mempool, n_sent);
+		adm_log_emu_partition_link_sent(m_stat, n_sent);
+
+		if (unlikely(n_sent < m_n_held)) {
+			/* ring full. hold the rest, the rest of q_outbound waits too */
+			m_n_held -= n_sent;
+			memmove(&m_held[0], &m_held[n_sent],
+					m_n_held * sizeof(struct emu_packet *));
+			adm_log_emu_partition_link_ring_full(m_stat, m_n_held);
+			break;
+		}
+		m_n_held = 0;
+	}
+
+	/* timeslot complete */
+	m_cur_time++;
+	shm_ring_publish(m_tx, m_cur_time);
+}
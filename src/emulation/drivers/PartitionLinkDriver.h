@@ -0,0 +1,84 @@
+/*
+ * PartitionLinkDriver.h
+ *
+ *  Created on: October 19, 2026
+ */
+
+#ifndef DRIVERS_PARTITIONLINKDRIVER_H_
+#define DRIVERS_PARTITIONLINKDRIVER_H_
+
+#include "config.h"
+#include "../graph-algo/fp_ring.h"
+#include "../graph-algo/platform.h"
+#include <inttypes.h>
+#include <string>
+
+#define PARTITION_LINK_MAX_BURST	64
+
+struct emu_packet;
+struct emu_shm_ring;
+struct emu_credit_link;
+struct emu_admission_core_statistics;
+
+/**
+ * Carries packets across the boundary between two emulator processes. Packets
+ * 	that local components enqueue on @q_outbound are copied to the peer over
+ * 	shared memory, and packets from the peer are copied into new local packets
+ * 	and enqueued on @q_inbound.
+ *
+ * The two processes advance in lockstep: packets sent by the peer in timeslot
+ * 	t are delivered at the start of timeslot t+1, and receive() waits until
+ * 	the peer has finished timeslot t. So send() never waits for the peer: if
+ * 	the shared ring is full, the rest of the packets are sent in a later
+ * 	timeslot.
+ */
+class PartitionLinkDriver {
+public:
+	PartitionLinkDriver(struct fp_ring *q_outbound, const char *tx_name,
+			const char *rx_name, uint32_t ring_size, struct fp_ring *q_inbound,
+			struct fp_mempool *packet_mempool);
+
+	/**
+	 * Prepares this driver to run on a specific core.
+	 */
+	void assign_to_core(struct emu_admission_core_statistics *stat,
+			uint16_t core_index);
+
+	/**
+	 * Deliver packets the peer sent in previous timeslots. Call before the
+	 * 	components of this timeslot run.
+	 */
+	void receive();
+
+	/**
+	 * Send packets enqueued on q_outbound during this timeslot to the peer,
+	 * 	and mark the timeslot complete. Call after the components of this
+	 * 	timeslot run. Packets that do not fit in the shared ring stay in
+	 * 	m_held and q_outbound, and go first in the next timeslot.
+	 */
+	void send();
+
+	/**
+	 * Cleanup internal state
+	 */
+	void cleanup();
+
+private:
+	struct fp_ring			*m_q_outbound;
+	struct fp_ring			*m_q_inbound;
+#ifdef EMU_CREDIT_FLOW_CONTROL
+	struct emu_credit_link	*m_credit_link;
+#endif
+	struct emu_shm_ring		*m_tx;
+	struct emu_shm_ring		*m_rx;
+	struct emu_packet		*m_held[PARTITION_LINK_MAX_BURST];
+	uint32_t				m_n_held;
+	std::string				m_tx_name;
+	std::string				m_rx_name;
+	struct fp_mempool		*m_packet_mempool;
+	struct emu_admission_core_statistics	*m_stat;
+	uint16_t				m_core_index;
+	uint64_t				m_cur_time;
+};
+
+#endif /* DRIVERS_PARTITIONLINKDRIVER_H_ */
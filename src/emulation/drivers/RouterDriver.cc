@@ -8,21 +8,29 @@
 #include "RouterDriver.h"
 #include <assert.h>
 #include <stdint.h>
+#include <stdexcept>
 #include <time.h> /* for seeding the random number generator */
 #include "../config.h"
 #include "../emulation.h"
 #include "../router.h"
 #include "../packet_impl.h"
+#include "../phase_log.h"
+#include "../queue_bank_log.h"
+#include "../util/credit_link.h"
+#include "../util/delay_line.h"
+#include "../protocol/probes.h"
 #include "../graph-algo/fp_ring.h"
 #include "../graph-algo/platform.h"
 #include "../graph-algo/random.h"
 
-#define ROUTER_MAX_BURST	64
+/* enough for 64 ports that each send at the highest port rate */
+#define ROUTER_MAX_BURST	(64 * EMU_MAX_PORT_RATE)
 
 
 RouterDriver::RouterDriver(Router *router, struct fp_ring *q_to_router,
 		struct fp_ring **q_from_router, uint64_t *masks, uint16_t n_neighbors,
-		struct fp_mempool *packet_mempool, uint32_t burst_size)
+		struct fp_mempool *packet_mempool, uint32_t burst_size,
+		uint16_t *delays)
 	: m_router(router),
 	  m_q_to_router(q_to_router),
 	  m_neighbors(n_neighbors),
@@ -32,22 +40,44 @@ RouterDriver::RouterDriver(Router *router, struct fp_ring *q_to_router,
 {
 	uint16_t i;
 
+	if (burst_size > ROUTER_MAX_BURST)
+		throw std::runtime_error("router burst size exceeds ROUTER_MAX_BURST");
+
 	seed_random(&m_random, time(NULL));
 	for (i = 0; i < n_neighbors; i++) {
 		m_q_from_router[i] = q_from_router[i];
 		m_port_masks[i] = masks[i];
+		if (delays != NULL && delays[i] > 0)
+			m_delay_lines[i] = delay_line_create(delays[i], burst_size);
+		else
+			m_delay_lines[i] = NULL;
+#ifdef EMU_CREDIT_FLOW_CONTROL
+		m_credit_links[i] = credit_link_create(q_from_router[i], burst_size);
+#endif
 	}
 }
 
 void RouterDriver::assign_to_core(Dropper *dropper,
-		struct emu_admission_core_statistics *stat, uint16_t core_index) {
+		struct emu_admission_core_statistics *stat, uint16_t core_index,
+		struct emu_phase_log *phase_logs) {
 	m_dropper = dropper;
 	m_stat = stat;
+	m_queue_stats = m_router->get_queue_bank_stats();
+	m_phase_logs = phase_logs;
 	m_core_index = core_index;
 }
 
 void RouterDriver::cleanup() {
+	uint16_t i;
+
 	free_packet_ring(m_q_to_router, m_packet_mempool);
+	for (i = 0; i < m_neighbors; i++) {
+		if (m_delay_lines[i] != NULL)
+			delay_line_free(m_delay_lines[i], m_packet_mempool);
+#ifdef EMU_CREDIT_FLOW_CONTROL
+		credit_link_free(m_credit_links[i], m_packet_mempool);
+#endif
+	}
 
 	delete m_router;
 }
@@ -56,16 +86,30 @@ void RouterDriver::cleanup() {
  * Emulate a timeslot at a single router
  */
 void RouterDriver::step() {
-	uint32_t i, j, n_pkts;
+	uint32_t i, j, n_pkts, max_pull, max_send;
 	struct emu_packet *pkt_ptrs[ROUTER_MAX_BURST];
+	uint64_t phase_start = emu_phase_now();
 	assert(ROUTER_MAX_BURST >= m_burst_size);
 	(void) i;
 
 	adm_log_emu_router_driver_step_begin(m_stat);
+	queue_bank_stats_write_begin(m_queue_stats);
 
 	/* fetch packets to send from router to other routers */
 	for (j = 0; j < m_neighbors; j++) {
-		n_pkts = m_router->pull_batch(pkt_ptrs, m_burst_size, &m_port_masks[j],
+#ifdef EMU_CREDIT_FLOW_CONTROL
+		/* send only what the link has credits for. with a delay line, the
+		 * router may keep sending while the line has room, and packets that
+		 * reach the end of the line wait there for credits. */
+		max_send = credit_link_credits(m_credit_links[j], m_burst_size, m_stat);
+		if (m_delay_lines[j] != NULL)
+			max_pull = MIN(m_burst_size, delay_line_space(m_delay_lines[j]));
+		else
+			max_pull = max_send;
+#else
+		max_pull = max_send = m_burst_size;
+#endif
+		n_pkts = m_router->pull_batch(pkt_ptrs, max_pull, &m_port_masks[j],
 				m_cur_time, m_dropper);
 
 #ifdef CONFIG_IP_FASTPASS_DEBUG
@@ -73,13 +117,25 @@ void RouterDriver::step() {
 			assert(pkt_ptrs[i] != NULL);
 		}
 #endif
-		assert(n_pkts <= m_burst_size);
+		assert(n_pkts <= max_pull);
+
+		/* packets on a link with propagation delay are sent once they
+		 * reach the other end */
+		if (m_delay_lines[j] != NULL)
+			n_pkts = delay_line_transfer(m_delay_lines[j], pkt_ptrs, n_pkts,
+					max_send, m_cur_time, m_packet_mempool, m_stat);
+
 		/* send packets to endpoint groups */
-#ifdef DROP_ON_FAILED_ENQUEUE
+#if defined(EMU_CREDIT_FLOW_CONTROL)
+		credit_link_send(m_credit_links[j], &pkt_ptrs[0], n_pkts, m_stat);
+		adm_log_emu_router_driver_pulled(m_stat, n_pkts);
+#elif defined(DROP_ON_FAILED_ENQUEUE)
 		if (n_pkts > 0 && fp_ring_enqueue_bulk(m_q_from_router[j],
 				(void **) &pkt_ptrs[0], n_pkts) == -ENOBUFS) {
 			/* no space in ring. log but don't retry. */
 			adm_log_emu_send_packets_failed(m_stat, n_pkts);
+			adm_log_emu_artificial_drop(m_stat, n_pkts);
+			FP_PROBE2(router_ring_full, j, n_pkts);
 			free_packet_bulk(&pkt_ptrs[0], m_packet_mempool, n_pkts);
 		} else {
 			adm_log_emu_router_driver_pulled(m_stat, n_pkts);
@@ -89,8 +145,8 @@ void RouterDriver::step() {
 				(void **) &pkt_ptrs[0], n_pkts) == -ENOBUFS) {
 			/* no space in ring. log and retry. */
 			adm_log_emu_send_packets_failed(m_stat, n_pkts);
+			FP_PROBE2(router_ring_full, j, n_pkts);
 		}
-		adm_log_emu_router_sent_packets(m_stat, n_pkts);
 		adm_log_emu_router_driver_pulled(m_stat, n_pkts);
 #endif
 
@@ -100,6 +156,8 @@ void RouterDriver::step() {
 #endif
 	}
 
+	emu_phase_end(m_phase_logs, EMU_PHASE_ROUTER_PULL, &phase_start);
+
 	/* increase time before pushing so that queue managers always see at least
 	 * one timeslot since last_empty_time */
 	m_cur_time++;
@@ -127,6 +185,9 @@ void RouterDriver::step() {
 	printf("RouterDriver on core %d pushed %d packets\n", m_core_index,
 			n_pkts);
 #endif
+
+	emu_phase_end(m_phase_logs, EMU_PHASE_ROUTER_PUSH, &phase_start);
+	queue_bank_stats_write_end(m_queue_stats);
 }
 
 
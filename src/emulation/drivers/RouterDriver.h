@@ -15,18 +15,30 @@
 class Router;
 class Dropper;
 struct emu_admission_statistics;
+struct queue_bank_stats;
+struct emu_delay_line;
+struct emu_credit_link;
+struct emu_phase_log;
 
 class RouterDriver {
 public:
+	/**
+	 * @burst_size: the most packets moved to the router, or from the router
+	 * 	to one neighbor, in a timeslot
+	 * @delays: timeslots of propagation delay on the link to each neighbor, on
+	 * 	top of the one timeslot every hop takes. NULL for no extra delay.
+	 */
 	RouterDriver(Router *router, struct fp_ring *q_to_router,
 			struct fp_ring **q_from_router, uint64_t *masks,
 			uint16_t n_neighbors, struct fp_mempool *packet_mempool,
-			uint32_t burst_size);
+			uint32_t burst_size, uint16_t *delays = NULL);
 	/**
 	 * Prepares this driver to run on a specific core.
+	 * @phase_logs: EMU_N_ROUTER_PHASES cycle histograms, or NULL
 	 */
 	void assign_to_core(Dropper *dropper,
-			struct emu_admission_core_statistics *stat, uint16_t core_index);
+			struct emu_admission_core_statistics *stat, uint16_t core_index,
+			struct emu_phase_log *phase_logs);
 
 	void step();
 	void cleanup();
@@ -36,9 +48,15 @@ private:
 	struct fp_ring		*m_q_to_router;
 	struct fp_ring		*m_q_from_router[EMU_MAX_OUTPUTS_PER_RTR];
 	uint64_t			m_port_masks[EMU_MAX_OUTPUTS_PER_RTR]; /* mask for each outgoing queue */
+	struct emu_delay_line	*m_delay_lines[EMU_MAX_OUTPUTS_PER_RTR]; /* NULL for no delay */
+#ifdef EMU_CREDIT_FLOW_CONTROL
+	struct emu_credit_link	*m_credit_links[EMU_MAX_OUTPUTS_PER_RTR];
+#endif
 	uint16_t			m_neighbors;
 	Dropper				*m_dropper;
 	struct emu_admission_core_statistics	*m_stat;
+	struct queue_bank_stats	*m_queue_stats;
+	struct emu_phase_log	*m_phase_logs;
 	uint32_t			m_random;
 	uint16_t			m_core_index;
 	uint64_t			m_cur_time;
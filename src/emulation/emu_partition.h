@@ -0,0 +1,81 @@
+/*
+ * emu_partition.h
+ *
+ *  Created on: October 19, 2026
+ */
+
+#ifndef EMU_PARTITION_H_
+#define EMU_PARTITION_H_
+
+#include "emu_topology.h"
+#include <inttypes.h>
+#include <stdexcept>
+
+#define EMU_PARTITION_LINK_RING_SIZE	(1 << 12)
+
+/**
+ * Configuration for splitting one emulated topology across several emulator
+ * 	processes. Racks are split into contiguous blocks, one per partition. The
+ * 	core router runs in partition 0. Packets that cross between a ToR and the
+ * 	core router in different partitions travel on shared-memory rings.
+ * @num_partitions: number of emulator processes
+ * @partition_id: the partition run by this process
+ * @shm_prefix: prefix for the names of the shared-memory rings, must be the
+ * 	same in all processes
+ * @link_ring_size: number of packets in each shared-memory ring
+ */
+struct emu_partition_config {
+	uint16_t	num_partitions;
+	uint16_t	partition_id;
+	const char	*shm_prefix;
+	uint32_t	link_ring_size;
+};
+
+/* The number of racks in each partition (the last one may have fewer). */
+static inline uint16_t racks_per_partition(struct emu_topo_config *topo_config,
+		struct emu_partition_config *part_config) {
+	return (topo_config->num_racks + part_config->num_partitions - 1) /
+			part_config->num_partitions;
+}
+
+/* Check that the topology can be split as requested. */
+static inline void check_partition_config(struct emu_topo_config *topo_config,
+		struct emu_partition_config *part_config) {
+	if (part_config->num_partitions == 0 ||
+			part_config->partition_id >= part_config->num_partitions)
+		throw std::runtime_error("invalid partition id");
+	if (part_config->num_partitions > topo_config->num_racks)
+		throw std::runtime_error("more partitions than racks");
+	if (part_config->num_partitions > 1 && num_core_routers(topo_config) != 1)
+		throw std::runtime_error("partitioning requires a core router");
+	if ((topo_config->num_racks - 1) / racks_per_partition(topo_config,
+			part_config) != part_config->num_partitions - 1)
+		throw std::runtime_error("racks do not split into this many partitions");
+}
+
+/* The partition that runs a rack's endpoint group and ToR. */
+static inline uint16_t partition_of_rack(struct emu_topo_config *topo_config,
+		struct emu_partition_config *part_config, uint16_t rack) {
+	return rack / racks_per_partition(topo_config, part_config);
+}
+
+/* The partition that runs the core router. */
+static inline uint16_t core_router_partition(
+		struct emu_partition_config *part_config) {
+	return 0;
+}
+
+/* Whether a rack runs in this process. */
+static inline bool is_local_rack(struct emu_topo_config *topo_config,
+		struct emu_partition_config *part_config, uint16_t rack) {
+	return partition_of_rack(topo_config, part_config, rack) ==
+			part_config->partition_id;
+}
+
+/* Whether the core router runs in this process. */
+static inline bool is_local_core_router(struct emu_partition_config *part_config)
+{
+	return core_router_partition(part_config) == part_config->partition_id;
+}
+
+#endif /* EMU_PARTITION_H_ */
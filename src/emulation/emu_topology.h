@@ -8,6 +8,7 @@
 #ifndef EMU_TOPOLOGY_H_
 #define EMU_TOPOLOGY_H_
 
+#include "config.h"
 #include <inttypes.h>
 #include <stdexcept>
 
@@ -18,6 +19,9 @@ struct emu_topo_config {
 	uint16_t	num_racks;
 	uint16_t	rack_shift;
 	uint16_t	num_core_rtrs; /* 0 or 1 for now */
+	uint16_t	uplink_rate; /* MTUs per timeslot on ToR uplinks and core ports */
+	uint16_t	host_link_delay; /* extra timeslots between endpoints and ToRs */
+	uint16_t	uplink_delay; /* extra timeslots between ToRs and core routers */
 };
 
 /* The number of endpoints per rack, from the rack shift. */
@@ -77,6 +81,16 @@ static inline uint32_t tor_uplink_mask(struct emu_topo_config *topo_config) {
 		return (1 << topo_config->rack_shift) - 1;
 }
 
+/* The number of MTUs each ToR uplink and core router port sends per timeslot.
+ * Links to endpoints always send one. */
+static inline uint16_t uplink_rate(struct emu_topo_config *topo_config) {
+	if (topo_config->uplink_rate == 0 ||
+			topo_config->uplink_rate > EMU_MAX_PORT_RATE)
+		throw std::runtime_error("unsupported uplink rate");
+	else
+		return topo_config->uplink_rate;
+}
+
 /* The number of ports on each Core router. */
 static inline uint16_t core_router_ports(struct emu_topo_config *topo_config) {
 	if (topo_config->num_racks == 1)
@@ -13,6 +13,7 @@
 #include "router.h"
 #include "drivers/EndpointDriver.h"
 #include "drivers/RouterDriver.h"
+#include "drivers/PartitionLinkDriver.h"
 #include "output.h"
 #include "packet_impl.h"
 #include "util/make_mempool.h"
@@ -27,14 +28,25 @@
 Emulation::Emulation(struct fp_mempool **admitted_traffic_mempool,
 		struct fp_ring **q_admitted_out, uint32_t packet_ring_size,
 		RouterType r_type, void *r_args, EndpointType e_type, void *e_args,
-		struct emu_topo_config *m_topo_config)
-	: m_topo_config(m_topo_config) {
+		struct emu_topo_config *m_topo_config,
+		struct emu_partition_config *m_part_config)
+	: m_topo_config(m_topo_config), m_part_config(m_part_config) {
 	uint32_t i, pq;
 	EndpointGroup	*epgs[EMU_MAX_ENDPOINT_GROUPS];
 	Router			*rtrs[EMU_MAX_ROUTERS];
 	char s[64];
 	struct fp_ring *packet_queues[EMU_MAX_PACKET_QS];
 
+	if (m_part_config != NULL)
+		check_partition_config(m_topo_config, m_part_config);
+	set_segment_mtus(EMU_SEGMENT_MTUS);
+
+	/* a ToR's ingress ring receives a timeslot of packets from its endpoints
+	 * and from its uplinks */
+	if (packet_ring_size < (uint32_t) (endpoints_per_rack(m_topo_config) *
+			(1 + uplink_rate(m_topo_config))))
+		throw std::runtime_error("packet rings too small for uplink rate");
+
 	/* create packet mempool */
 	m_packet_mempool = make_mempool("packet_mempool", PACKET_MEMPOOL_SIZE,
 			EMU_ALIGN(sizeof(struct emu_packet)), PACKET_MEMPOOL_CACHE_SIZE, 0,
@@ -70,6 +82,7 @@ Emulation::Emulation(struct fp_mempool **admitted_traffic_mempool,
 		m_comm_state.q_epg_new_pkts[i] = packet_queues[pq++];
 		m_comm_state.q_resets[i] = packet_queues[pq++];
 	}
+	assign_epgs_to_comm_cores();
 
 	/* initialize the topology */
 	construct_topology(&epgs[0], &rtrs[0], r_type, r_args, e_type, e_args);
@@ -77,9 +90,10 @@ Emulation::Emulation(struct fp_mempool **admitted_traffic_mempool,
 	/* assign endpoints and routers to cores */
 	assign_components_to_cores(&epgs[0], &rtrs[0], &packet_queues[pq]);
 
-	/* get queue bank stat pointers from routers */
+	/* get queue bank stat pointers from routers in this process */
 	for (i = 0; i < num_routers(m_topo_config); i++) {
-		m_queue_bank_stats.push_back(rtrs[i]->get_queue_bank_stats());
+		if (rtrs[i] != NULL)
+			m_queue_bank_stats.push_back(rtrs[i]->get_queue_bank_stats());
 	}
 
 	/* get port drop stat pointers from cores */
@@ -98,6 +112,7 @@ void Emulation::step() {
 void Emulation::cleanup() {
 	uint32_t i;
 	struct emu_admitted_traffic *admitted;
+	struct emu_backlog_stage *stage;
 
 	/* cleanup cores */
 	for (i = 0; i < ALGO_N_CORES; i++) {
@@ -107,6 +122,12 @@ void Emulation::cleanup() {
 
 	/* free queues to comm core */
 	for (i = 0; i < num_endpoint_groups(m_topo_config); i++) {
+		/* return staged packets to mempool */
+		stage = &m_comm_state.stages[m_comm_state.comm_of_epg[i]];
+		free_packet_bulk(&stage->staged_pkts[i][0], m_packet_mempool,
+				stage->n_staged[i]);
+		stage->n_staged[i] = 0;
+
 		/* free packet queues, return packets to mempool */
 		free_packet_ring(m_comm_state.q_epg_new_pkts[i], m_packet_mempool);
 		free_packet_ring(m_comm_state.q_resets[i], m_packet_mempool);
@@ -124,6 +145,41 @@ void Emulation::cleanup() {
 	fp_free(m_packet_mempool);
 }
 
+void Emulation::set_segment_mtus(uint8_t mtus) {
+	if (mtus == 0 || mtus > EMU_MAX_SEGMENT_MTUS)
+		throw std::runtime_error("unsupported segment size");
+#if defined(USE_TSO)
+	if (mtus > 1)
+		throw std::runtime_error("with TSO, endpoints choose segment sizes");
+#elif defined(PFABRIC) || defined(LSTF)
+	/* a segment would carry the request data of its first MTU only */
+	if (mtus > 1)
+		throw std::runtime_error(
+				"pFabric and LSTF prioritize each MTU by its request data");
+#endif
+
+	m_segment_mtus = mtus;
+}
+
+/* map each endpoint group to the comm core that receives for its endpoints */
+void Emulation::assign_epgs_to_comm_cores() {
+	uint16_t comm_index, epg_id = 0;
+	uint16_t n_epgs;
+
+	/* comm cores take the endpoints of consecutive endpoint groups, as in
+	 * endpoints_for_comm(). any groups left over go to the last comm core. */
+	for (comm_index = 0; comm_index < N_COMM_CORES; comm_index++) {
+		n_epgs = endpoints_for_comm(comm_index, m_topo_config) /
+				endpoints_per_epg(m_topo_config);
+		while (n_epgs-- > 0 && epg_id < num_endpoint_groups(m_topo_config))
+			m_comm_state.comm_of_epg[epg_id++] = comm_index;
+	}
+	while (epg_id < num_endpoint_groups(m_topo_config))
+		m_comm_state.comm_of_epg[epg_id++] = N_COMM_CORES - 1;
+
+	memset(&m_comm_state.stages, 0, sizeof(m_comm_state.stages));
+}
+
 /* configure the topology of endpoints and routers */
 void Emulation::construct_topology(EndpointGroup **epgs, Router **rtrs,
 		RouterType r_type, void *r_args, EndpointType e_type, void *e_args) {
@@ -134,6 +190,10 @@ void Emulation::construct_topology(EndpointGroup **epgs, Router **rtrs,
 
 	/* initialize endpoints */
 	for (i = 0; i < num_endpoint_groups(m_topo_config); i++) {
+		if (!is_local_rack(i)) {
+			epgs[i] = NULL; /* runs in another process */
+			continue;
+		}
 		epgs[i] = EndpointGroupFactory::NewEndpointGroup(e_type,
 				i * endpoints_per_rack(m_topo_config), e_args, m_topo_config);
 		assert(epgs[i] != NULL);
@@ -141,17 +201,50 @@ void Emulation::construct_topology(EndpointGroup **epgs, Router **rtrs,
 
 	/* initialize Tors */
 	for (rtr_index = 0; rtr_index < num_tors(m_topo_config); rtr_index++) {
+		if (!is_local_rack(rtr_index)) {
+			rtrs[rtr_index] = NULL; /* runs in another process */
+			continue;
+		}
 		rtrs[rtr_index] = RouterFactory::NewRouter(r_type, r_args, TOR_ROUTER,
 				rtr_index, m_topo_config);
 		assert(rtrs[rtr_index] != NULL);
 	}
 
 	/* initialize the Core */
-	if (num_core_routers(m_topo_config) > 0) {
+	if (num_core_routers(m_topo_config) > 0 && !is_local_core_router()) {
+		rtrs[rtr_index] = NULL; /* runs in another process */
+	} else if (num_core_routers(m_topo_config) > 0) {
 		rtrs[rtr_index] = RouterFactory::NewRouter(r_type, r_args, CORE_ROUTER,
 				num_tors(m_topo_config), m_topo_config);
 		assert(rtrs[rtr_index] != NULL);
 	}
+
+	set_uplink_rates(rtrs);
+}
+
+/* Let ToR uplinks and core router ports send uplink_rate MTUs per timeslot.
+ * Links to endpoints always send one. */
+void Emulation::set_uplink_rates(Router **rtrs) {
+	uint16_t i, port;
+	uint8_t rate = uplink_rate(m_topo_config);
+
+	if (rate == 1 || num_core_routers(m_topo_config) == 0)
+		return; /* every port sends one MTU per timeslot */
+
+	/* ToRs: downward-facing ports first, then uplinks */
+	for (i = 0; i < num_tors(m_topo_config); i++) {
+		if (rtrs[i] == NULL)
+			continue; /* runs in another process */
+		for (port = endpoints_per_rack(m_topo_config);
+				port < tor_ports(m_topo_config); port++)
+			rtrs[i]->set_port_rate(port, rate);
+	}
+
+	/* core router: every port faces a ToR */
+	if (rtrs[num_tors(m_topo_config)] != NULL) {
+		for (port = 0; port < core_router_ports(m_topo_config); port++)
+			rtrs[num_tors(m_topo_config)]->set_port_rate(port, rate);
+	}
 }
 
 /* Populate rtr_masks with a mask for each set of ports that faces a different
@@ -206,9 +299,13 @@ void Emulation::assign_components_to_cores(EndpointGroup **epgs, Router **rtrs,
 	struct fp_ring *q_epg_ingress[EMU_MAX_ENDPOINT_GROUPS];
 	struct fp_ring *q_router_ingress[EMU_MAX_ROUTERS];
 	struct fp_ring *q_router_egress[EMU_MAX_OUTPUTS_PER_RTR];
+	struct fp_ring *q_core_egress[EMU_MAX_OUTPUTS_PER_RTR];
 	uint64_t rtr_masks[EMU_MAX_OUTPUTS_PER_RTR];
+	uint16_t rtr_delays[EMU_MAX_OUTPUTS_PER_RTR];
 	EndpointDriver	*epg_drivers[EMU_MAX_ENDPOINT_GROUPS];
 	RouterDriver	*router_drivers[EMU_MAX_ROUTERS];
+	PartitionLinkDriver	*tor_links[EMU_MAX_ROUTERS];
+	PartitionLinkDriver	*core_links[EMU_MAX_ROUTERS];
 	void *p_aligned; /* all memory must be aligned to 64-byte cache lines */
 
 	/* First, construct drivers */
@@ -222,43 +319,80 @@ void Emulation::assign_components_to_cores(EndpointGroup **epgs, Router **rtrs,
 
 	/* initialize all the endpoint drivers */
 	for (i = 0; i < num_endpoint_groups(m_topo_config); i++) {
+		if (epgs[i] == NULL) {
+			epg_drivers[i] = NULL; /* runs in another process */
+			continue;
+		}
 		p_aligned = fp_malloc("EndpointDriver", sizeof(class EndpointDriver));
 		epg_drivers[i] =
 				new (p_aligned) EndpointDriver(m_comm_state.q_epg_new_pkts[i],
 						q_router_ingress[i], q_epg_ingress[i],
 						m_comm_state.q_resets[i], epgs[i], m_packet_mempool,
-						endpoints_per_rack(m_topo_config));
+						endpoints_per_rack(m_topo_config),
+						m_topo_config->host_link_delay);
 	}
 
 	/* initialize the drivers for the ToRs */
 	set_tor_port_masks(&rtr_masks[0]);
-	if (tor_neighbors(m_topo_config) == 2)
-		q_router_egress[1] = q_router_ingress[num_tors(m_topo_config)];
-
+	rtr_delays[0] = m_topo_config->host_link_delay;
+	rtr_delays[1] = m_topo_config->uplink_delay;
 	for (rtr_index = 0; rtr_index < num_tors(m_topo_config); rtr_index++) {
+		tor_links[rtr_index] = NULL;
+		if (rtrs[rtr_index] == NULL) {
+			router_drivers[rtr_index] = NULL; /* runs in another process */
+			continue;
+		}
+
 		q_router_egress[0] = q_epg_ingress[rtr_index];
+		if (tor_neighbors(m_topo_config) == 2 && is_local_core_router()) {
+			q_router_egress[1] = q_router_ingress[num_tors(m_topo_config)];
+		} else if (tor_neighbors(m_topo_config) == 2) {
+			/* the core router runs in another process */
+			tor_links[rtr_index] = make_partition_link("up", "down",
+					rtr_index, q_router_ingress[rtr_index],
+					&q_router_egress[1]);
+		}
+
 		p_aligned = fp_malloc("RouterDriver", sizeof(class RouterDriver));
 		router_drivers[rtr_index] =
 				new (p_aligned) RouterDriver(rtrs[rtr_index],
 						q_router_ingress[rtr_index], &q_router_egress[0],
 						&rtr_masks[0], tor_neighbors(m_topo_config),
-						m_packet_mempool, endpoints_per_rack(m_topo_config));
+						m_packet_mempool, router_burst_size(), &rtr_delays[0]);
 	}
 
 	/* initialize the Core's driver */
-	if (num_core_routers(m_topo_config) > 0) {
+	if (num_core_routers(m_topo_config) > 0 && is_local_core_router()) {
+		for (i = 0; i < num_tors(m_topo_config); i++) {
+			core_links[i] = NULL;
+			if (rtrs[i] != NULL) {
+				q_core_egress[i] = q_router_ingress[i];
+				continue;
+			}
+
+			/* this ToR runs in another process */
+			core_links[i] = make_partition_link("down", "up", i,
+					q_router_ingress[rtr_index], &q_core_egress[i]);
+		}
+
 		set_core_port_masks(&rtr_masks[0]);
+		for (i = 0; i < core_neighbors(m_topo_config); i++)
+			rtr_delays[i] = m_topo_config->uplink_delay;
 		p_aligned = fp_malloc("RouterDriver", sizeof(class RouterDriver));
 		router_drivers[rtr_index] =
 				new (p_aligned) RouterDriver(rtrs[rtr_index],
-						q_router_ingress[rtr_index], &q_router_ingress[0],
+						q_router_ingress[rtr_index], &q_core_egress[0],
 						&rtr_masks[0], core_neighbors(m_topo_config),
-						m_packet_mempool, endpoints_per_rack(m_topo_config));
+						m_packet_mempool, router_burst_size(), &rtr_delays[0]);
+	} else if (num_core_routers(m_topo_config) > 0) {
+		router_drivers[rtr_index] = NULL; /* runs in another process */
 	}
 
-
 	/* Now assign drivers to cores */
-	if (ALGO_N_CORES == (num_routers(m_topo_config) +
+	if (m_part_config != NULL) {
+		assign_partition_to_cores(epg_drivers, router_drivers, tor_links,
+				core_links);
+	} else if (ALGO_N_CORES == (num_routers(m_topo_config) +
 			num_endpoint_groups(m_topo_config))) {
 		/* put 1 router or endpoint group on each core */
 		for (i = 0; i < num_endpoint_groups(m_topo_config); i++) {
@@ -316,3 +450,108 @@ void Emulation::assign_components_to_cores(EndpointGroup **epgs, Router **rtrs,
 	for (i = 0; i < ALGO_N_CORES; i++)
 		m_core_stats[i] = m_cores[i]->stats();
 }
+
+PartitionLinkDriver *Emulation::make_partition_link(const char *tx_dir,
+		const char *rx_dir, uint16_t tor_index, struct fp_ring *q_inbound,
+		struct fp_ring **q_outbound) {
+	char s[64], tx_name[64], rx_name[64];
+	const char *prefix = m_part_config->shm_prefix;
+	void *p_aligned;
+
+	if (prefix == NULL)
+		prefix = "fp_emu";
+
+	/* a timeslot's worth of outbound packets should fit in the shared ring,
+	 * which is also a power of two */
+	if (m_part_config->link_ring_size < (1 << PACKET_Q_LOG_SIZE) ||
+			(m_part_config->link_ring_size &
+					(m_part_config->link_ring_size - 1)) != 0)
+		throw std::runtime_error("invalid partition link ring size");
+
+	/* local ring for packets bound for the other process */
+	snprintf(s, sizeof(s), "partition_q_%s_%d", tx_dir, tor_index);
+	*q_outbound = make_ring(s, (1 << PACKET_Q_LOG_SIZE), 0, RING_F_SC_DEQ);
+
+	snprintf(tx_name, sizeof(tx_name), "/%s_%s_%d", prefix, tx_dir, tor_index);
+	snprintf(rx_name, sizeof(rx_name), "/%s_%s_%d", prefix, rx_dir, tor_index);
+
+	p_aligned = fp_malloc("PartitionLinkDriver",
+			sizeof(class PartitionLinkDriver));
+	return new (p_aligned) PartitionLinkDriver(*q_outbound, tx_name, rx_name,
+			m_part_config->link_ring_size, q_inbound, m_packet_mempool);
+}
+
+/* Map the drivers of this process's partition to cores. Each ToR's link to a
+ * remote core router runs on the ToR's core, and each of the core router's
+ * links runs on the core router's core. */
+void Emulation::assign_partition_to_cores(EndpointDriver **epg_drivers,
+		RouterDriver **router_drivers, PartitionLinkDriver **tor_links,
+		PartitionLinkDriver **core_links) {
+	uint16_t i, n_local_racks, core_index;
+	uint16_t local_racks[EMU_MAX_ROUTERS];
+	EndpointDriver	*local_epg_drivers[EMU_MAX_ENDPOINT_GROUPS];
+	RouterDriver	*local_router_drivers[EMU_MAX_ROUTERS];
+	PartitionLinkDriver *links[EMU_MAX_ROUTERS];
+	uint16_t n_links;
+	uint16_t core_rtr = num_tors(m_topo_config);
+	bool has_core = (num_core_routers(m_topo_config) > 0 &&
+			is_local_core_router());
+	void *p_aligned;
+
+	/* gather the local components and links */
+	n_local_racks = 0;
+	n_links = 0;
+	for (i = 0; i < num_tors(m_topo_config); i++) {
+		if (is_local_rack(i)) {
+			local_racks[n_local_racks] = i;
+			local_epg_drivers[n_local_racks] = epg_drivers[i];
+			local_router_drivers[n_local_racks] = router_drivers[i];
+			n_local_racks++;
+		}
+		if (tor_links[i] != NULL)
+			links[n_links++] = tor_links[i];
+		if (has_core && core_links[i] != NULL)
+			links[n_links++] = core_links[i];
+	}
+	if (has_core)
+		local_router_drivers[n_local_racks] = router_drivers[core_rtr];
+
+	if (ALGO_N_CORES == 1) {
+		/* assign everything in this partition to one core */
+		p_aligned = fp_malloc("EmulationCore", sizeof(class EmulationCore));
+		m_cores[0] = new (p_aligned) EmulationCore(local_epg_drivers,
+				local_router_drivers, n_local_racks,
+				n_local_racks + (has_core ? 1 : 0), 0, m_q_admitted_out[0],
+				m_admitted_traffic_mempool[comm_for_emu(0)], m_packet_mempool);
+		for (i = 0; i < n_links; i++)
+			m_cores[0]->add_partition_link(links[i]);
+	} else if (ALGO_N_CORES == n_local_racks + (has_core ? 1 : 0)) {
+		/* 1 epg + 1 rtr per core, core router and its links on last core */
+		for (core_index = 0; core_index < n_local_racks; core_index++) {
+			p_aligned = fp_malloc("EmulationCore", sizeof(class EmulationCore));
+			m_cores[core_index] = new (p_aligned) EmulationCore(
+					&local_epg_drivers[core_index],
+					&local_router_drivers[core_index], 1, 1, core_index,
+					m_q_admitted_out[core_index],
+					m_admitted_traffic_mempool[comm_for_emu(core_index)],
+					m_packet_mempool);
+			if (tor_links[local_racks[core_index]] != NULL)
+				m_cores[core_index]->add_partition_link(
+						tor_links[local_racks[core_index]]);
+		}
+		if (has_core) {
+			p_aligned = fp_malloc("EmulationCore", sizeof(class EmulationCore));
+			m_cores[core_index] = new (p_aligned) EmulationCore(NULL,
+					&local_router_drivers[n_local_racks], 0, 1, core_index,
+					m_q_admitted_out[core_index],
+					m_admitted_traffic_mempool[comm_for_emu(core_index)],
+					m_packet_mempool);
+			for (i = 0; i < num_tors(m_topo_config); i++) {
+				if (core_links[i] != NULL)
+					m_cores[core_index]->add_partition_link(core_links[i]);
+			}
+		}
+	} else {
+		throw std::runtime_error("no specified way to assign this partition to cores");
+	}
+}
@@ -10,7 +10,9 @@
 
 #include "admissible_log.h"
 #include "config.h"
+#include "emu_comm_core_map.h"
 #include "endpoint.h"
+#include "emu_partition.h"
 #include "emu_topology.h"
 #include "packet.h"
 #include "packet_impl.h"
@@ -18,6 +20,7 @@
 #include "queue_bank_log.h"
 #include "../graph-algo/fp_ring.h"
 #include "../graph-algo/platform.h"
+#include "../protocol/probes.h"
 #include "../protocol/topology.h"
 #include <assert.h>
 #include <inttypes.h>
@@ -30,6 +33,7 @@
 #define PACKET_Q_LOG_SIZE				10
 #define MIN(X, Y)						(X <= Y ? X : Y)
 #define EMU_ADD_BACKLOG_BATCH_SIZE		64
+#define EMU_BACKLOG_STAGE_SIZE			128
 #define BACKLOG_PREFETCH_OFFSET			3
 
 class EmulationCore;
@@ -38,15 +42,33 @@ class Router;
 class EmulationOutput;
 class EndpointDriver;
 class RouterDriver;
+class PartitionLinkDriver;
 
 /**
- * Emu state allocated for each comm core
+ * Packets a comm core has created but not yet enqueued to its endpoint
+ * 	groups. Only the comm core that owns the stage touches it.
+ * @staged_mask: bitmask of endpoint groups that have staged packets
+ * @n_staged: number of packets staged for each endpoint group
+ * @staged_pkts: packets created but not yet enqueued to q_epg_new_pkts
+ */
+struct emu_backlog_stage {
+	uint64_t			staged_mask;
+	uint32_t			n_staged[EMU_MAX_EPGS_PER_COMM];
+	struct emu_packet	*staged_pkts[EMU_MAX_EPGS_PER_COMM][EMU_BACKLOG_STAGE_SIZE];
+};
+
+/**
+ * Emu state used to communicate with the comm cores
  * @q_epg_new_pkts: queues of packets from comm core to each endpoint group
  * @q_resets: a queue of pending resets, for each endpoint group
+ * @comm_of_epg: the comm core that adds the backlog of each endpoint group
+ * @stages: the staged packets of each comm core
  */
 struct emu_comm_state {
-	struct fp_ring	*q_epg_new_pkts[EMU_MAX_EPGS_PER_COMM];
-	struct fp_ring	*q_resets[EMU_MAX_EPGS_PER_COMM];
+	struct fp_ring				*q_epg_new_pkts[EMU_MAX_EPGS_PER_COMM];
+	struct fp_ring				*q_resets[EMU_MAX_EPGS_PER_COMM];
+	uint8_t						comm_of_epg[EMU_MAX_EPGS_PER_COMM];
+	struct emu_backlog_stage	stages[N_COMM_CORES];
 };
 
 /**
@@ -57,7 +79,8 @@ public:
 	Emulation(struct fp_mempool **admitted_traffic_mempool,
 			struct fp_ring **q_admitted_out, uint32_t packet_ring_size,
 			enum RouterType r_type, void *r_args, enum EndpointType e_type,
-			void *e_args, struct emu_topo_config *topo_config);
+			void *e_args, struct emu_topo_config *topo_config,
+			struct emu_partition_config *part_config = NULL);
 
 	/**
 	 * Run the emulation for one step.
@@ -67,22 +90,49 @@ public:
 	/**
 	 * Add backlog from @src to @dst for @flow. Add @amount MTUs, with the
 	 * 	first id of @start_id. @areq_data provides additional information about
-	 * 	each MTU.
+	 * 	each MTU. Packets are staged per endpoint group by the comm core that
+	 * 	owns @src, and only enqueued to the emulation when a stage fills up or
+	 * 	when that comm core calls flush_backlog().
+	 *
+	 * 	With EMU_CREDIT_FLOW_CONTROL, if the endpoint group stops taking
+	 * 	packets and the stage is full, the rest of the backlog is dropped
+	 * 	rather than stalling the comm core. The endpoint is not told, so these
+	 * 	packets are never sent; they are counted as artificial drops.
+	 *
+	 * 	Backlog for a sender outside this partition is rejected and counted.
 	 */
 	inline void add_backlog(uint16_t src, uint16_t dst, uint16_t flow,
 			uint32_t amount, uint16_t start_id, u8* areq_data);
 
+	/**
+	 * Enqueue the packets staged by comm core @comm_index to their endpoint
+	 * 	groups, one bulk enqueue per endpoint group.
+	 */
+	inline void flush_backlog(uint16_t comm_index);
+
 	/**
 	 * Reset the emulation state for a single sender @src.
 	 */
 	inline void reset_sender(uint16_t src);
 
+	/**
+	 * Carry backlog added from now on in segments of up to @mtus MTUs.
+	 */
+	void set_segment_mtus(uint8_t mtus);
+
 	/**
 	 * Cleanup before destroying this Emulation.
 	 */
 	void cleanup();
 
 private:
+	/**
+	 * Enqueue the packets staged in @stage for endpoint group @epg_id. With
+	 * 	DROP_ON_FAILED_ENQUEUE, packets that do not fit in the ring are
+	 * 	dropped and counted as artificial drops.
+	 */
+	inline void flush_staged(struct emu_backlog_stage *stage, uint16_t epg_id);
+
 	/**
 	 * Creates a packet, returns a pointer to the packet.
 	 */
@@ -90,7 +140,9 @@ private:
 			uint16_t flow, uint16_t id, uint8_t *areq_data);
 
 	/**
-	 * Creates a batch of packets, putting pointers to them in pkt_ptrs.
+	 * Creates a batch of packets covering @amount MTUs, in segments of up to
+	 * 	m_segment_mtus MTUs, putting pointers to them in pkt_ptrs.
+	 * @returns the number of packets created
 	 */
 	inline uint32_t create_packet_batch(struct emu_packet **pkt_ptrs,
 			uint16_t src, uint16_t dst, uint16_t flow, uint16_t start_id,
@@ -103,12 +155,63 @@ private:
 			RouterType r_type, void *r_args, EndpointType e_type,
 			void *e_args);
 
+	/**
+	 * Records which comm core adds the backlog of each endpoint group, and
+	 * 	empties the stages.
+	 */
+	void assign_epgs_to_comm_cores();
+
+	/**
+	 * Sets the rates of router ports that face other routers.
+	 */
+	void set_uplink_rates(Router **rtrs);
+
+	/**
+	 * The most packets a router driver moves to or from one neighbor in a
+	 * 	timeslot.
+	 */
+	inline uint32_t router_burst_size() {
+		return endpoints_per_rack(m_topo_config) * uplink_rate(m_topo_config);
+	}
+
 	/**
 	 * Assign the emulated components to the hardware cores.
 	 */
 	void assign_components_to_cores(EndpointGroup **epgs, Router **rtrs,
 			struct fp_ring **packet_queues);
 
+	/**
+	 * Assign the components of this process's partition of the topology, and
+	 * 	the links to other partitions, to the hardware cores.
+	 */
+	void assign_partition_to_cores(EndpointDriver **epg_drivers,
+			RouterDriver **router_drivers, PartitionLinkDriver **tor_links,
+			PartitionLinkDriver **core_links);
+
+	/**
+	 * Create a link carrying packets between a local ring and a router in
+	 * 	another process. @q_inbound receives packets from the other process.
+	 */
+	PartitionLinkDriver *make_partition_link(const char *tx_dir,
+			const char *rx_dir, uint16_t tor_index,
+			struct fp_ring *q_inbound, struct fp_ring **q_outbound);
+
+	/**
+	 * Whether rack @rack runs in this process.
+	 */
+	inline bool is_local_rack(uint16_t rack) {
+		return (m_part_config == NULL ||
+				::is_local_rack(m_topo_config, m_part_config, rack));
+	}
+
+	/**
+	 * Whether the core router runs in this process.
+	 */
+	inline bool is_local_core_router() {
+		return (m_part_config == NULL ||
+				::is_local_core_router(m_part_config));
+	}
+
 	void set_tor_port_masks(uint64_t *rtr_masks);
 	void set_core_port_masks(uint64_t *rtr_masks);
 
@@ -126,62 +229,133 @@ private:
 	std::vector<struct fp_ring *>			m_q_admitted_out;
 	struct emu_comm_state					m_comm_state;
 	struct emu_topo_config					*m_topo_config;
+	struct emu_partition_config				*m_part_config;
+	uint8_t									m_segment_mtus;
 };
 
 
 inline void Emulation::add_backlog(uint16_t src, uint16_t dst, uint16_t flow,
 		uint32_t amount, uint16_t start_id, u8* areq_data) {
 	uint32_t amount_this_iter, amount_created;
-	struct fp_ring *q_epg_new_pkts;
+	uint16_t epg_id;
+	struct emu_backlog_stage *stage;
+	uint32_t *n_staged;
 	assert(src < num_endpoints(m_topo_config));
 	assert(dst < num_endpoints(m_topo_config));
 	assert(flow < FLOWS_PER_NODE);
 
-	q_epg_new_pkts =
-			m_comm_state.q_epg_new_pkts[src / endpoints_per_epg(m_topo_config)];
+	epg_id = src / endpoints_per_epg(m_topo_config);
+	if (unlikely(!is_local_rack(epg_id))) {
+		/* this partition has no endpoint group for src */
+		adm_log_emu_non_local_backlog(&m_stat);
+		return;
+	}
+	stage = &m_comm_state.stages[m_comm_state.comm_of_epg[epg_id]];
+	n_staged = &stage->n_staged[epg_id];
+
+	FP_PROBE5(add_backlog, src, dst, flow, amount, start_id);
 
 #ifdef CONFIG_IP_FASTPASS_DEBUG
 	printf("adding backlog from %d to %d, amount %d\n", src, dst, amount);
 #endif
 
-	/* create and enqueue a packet for each MTU, do this in batches */
-	struct emu_packet *pkt_ptrs[EMU_ADD_BACKLOG_BATCH_SIZE];
+	/* create a packet for each MTU (or segment) directly in the stage for this
+	 * endpoint group, do this in batches */
 	while (amount > 0) {
-		amount_this_iter = MIN(amount, EMU_ADD_BACKLOG_BATCH_SIZE);
+#ifdef EMU_CREDIT_FLOW_CONTROL
+		if (unlikely(*n_staged == EMU_BACKLOG_STAGE_SIZE)) {
+			/* the endpoint group is not taking new packets. rather than stall
+			 * the comm core, drop the rest. */
+			uint32_t n_dropped = (amount + m_segment_mtus - 1) / m_segment_mtus;
+			adm_log_emu_enqueue_backlog_failed(&m_stat, n_dropped);
+			adm_log_emu_artificial_drop(&m_stat, n_dropped);
+			break;
+		}
+#endif
+		amount_this_iter = MIN(amount,
+				EMU_ADD_BACKLOG_BATCH_SIZE * m_segment_mtus);
+		amount_this_iter = MIN(amount_this_iter,
+				(EMU_BACKLOG_STAGE_SIZE - *n_staged) * m_segment_mtus);
 
-		/* this might return 0 if using DROP_ON_FAILED_ENQUEUE and the packet
+		/* this might return 0 if not spinning on full rings and the packet
 		 * pool has been exhausted */
-		amount_created = create_packet_batch(&pkt_ptrs[0], src, dst, flow,
+		amount_created = create_packet_batch(
+				&stage->staged_pkts[epg_id][*n_staged], src, dst, flow,
 				start_id, amount_this_iter, areq_data);
+		*n_staged += amount_created;
+		if (amount_created != 0)
+			stage->staged_mask |= (1ULL << epg_id);
 
-		/* enqueue the packets to the correct endpoint group packet queue */
-#ifdef DROP_ON_FAILED_ENQUEUE
-		if ((amount_created != 0) &&
-				fp_ring_enqueue_bulk(q_epg_new_pkts, (void **) &pkt_ptrs[0],
-				amount_this_iter) == -ENOBUFS) {
-			/* no space in ring. log but don't retry. */
-			adm_log_emu_enqueue_backlog_failed(&m_stat, amount_this_iter);
-			free_packet_bulk(&pkt_ptrs[0], m_packet_mempool, amount_this_iter);
-		}
-#else
-		while (fp_ring_enqueue_bulk(q_epg_new_pkts, (void **) &pkt_ptrs[0],
-				amount_this_iter) == -ENOBUFS) {
-			/* no space in ring. log and retry. */
-			adm_log_emu_enqueue_backlog_failed(&m_stat, amount_this_iter);
-		}
-#endif
+		/* enqueue the stage once it is full */
+		if (*n_staged == EMU_BACKLOG_STAGE_SIZE)
+			flush_staged(stage, epg_id);
 
 		amount -= amount_this_iter;
 		start_id += amount_this_iter;
+		if (areq_data != NULL)
+			areq_data += emu_req_data_bytes() * amount_this_iter;
 	}
 }
 
+inline void Emulation::flush_backlog(uint16_t comm_index) {
+	struct emu_backlog_stage *stage = &m_comm_state.stages[comm_index];
+	uint64_t mask = stage->staged_mask;
+	uint16_t epg_id;
+
+	while (mask) {
+		epg_id = __builtin_ctzll(mask);
+		mask &= (mask - 1);
+		flush_staged(stage, epg_id);
+	}
+}
+
+inline void Emulation::flush_staged(struct emu_backlog_stage *stage,
+		uint16_t epg_id) {
+	struct fp_ring *q_epg_new_pkts = m_comm_state.q_epg_new_pkts[epg_id];
+	struct emu_packet **pkt_ptrs = &stage->staged_pkts[epg_id][0];
+	uint32_t n = stage->n_staged[epg_id];
+
+	/* enqueue the packets to the correct endpoint group packet queue */
+#if defined(EMU_CREDIT_FLOW_CONTROL)
+	uint32_t n_sent = fp_ring_enqueue_burst(q_epg_new_pkts, (void **) pkt_ptrs,
+			n);
+	if (unlikely(n_sent < n)) {
+		/* no space in ring. keep the rest staged for the next flush. */
+		memmove(pkt_ptrs, &pkt_ptrs[n_sent],
+				(n - n_sent) * sizeof(struct emu_packet *));
+		stage->n_staged[epg_id] = n - n_sent;
+		return;
+	}
+#elif defined(DROP_ON_FAILED_ENQUEUE)
+	if (fp_ring_enqueue_bulk(q_epg_new_pkts, (void **) pkt_ptrs, n)
+			== -ENOBUFS) {
+		/* no space in ring. log but don't retry. */
+		adm_log_emu_enqueue_backlog_failed(&m_stat, n);
+		adm_log_emu_artificial_drop(&m_stat, n);
+		free_packet_bulk(pkt_ptrs, m_packet_mempool, n);
+	}
+#else
+	while (fp_ring_enqueue_bulk(q_epg_new_pkts, (void **) pkt_ptrs, n)
+			== -ENOBUFS) {
+		/* no space in ring. log and retry. */
+		adm_log_emu_enqueue_backlog_failed(&m_stat, n);
+	}
+#endif
+
+	stage->n_staged[epg_id] = 0;
+	stage->staged_mask &= ~(1ULL << epg_id);
+}
+
 inline void Emulation::reset_sender(uint16_t src) {
 	struct fp_ring *q_resets;
+	uint16_t epg_id = src / endpoints_per_epg(m_topo_config);
 	uint64_t endpoint_id = src % endpoints_per_epg(m_topo_config);
 
-	q_resets =
-			m_comm_state.q_resets[src / endpoints_per_epg(m_topo_config)];
+	q_resets = m_comm_state.q_resets[epg_id];
+
+	/* packets staged before the reset must reach the endpoint first. the
+	 * comm core of @src is the one resetting it. */
+	flush_backlog(m_comm_state.comm_of_epg[epg_id]);
 
 	/* enqueue a notification to the endpoint driver's reset queue */
 	/* cast src id to a pointer */
@@ -209,41 +383,56 @@ inline uint32_t Emulation::create_packet_batch(struct emu_packet **pkt_ptrs,
 		uint16_t src, uint16_t dst, uint16_t flow, uint16_t start_id,
 		uint32_t amount, uint8_t *areq_data)
 {
-	uint32_t i;
+	uint32_t i, n_mtus, n_pkts;
+
+	/* one packet per segment, the last may be shorter */
+	n_pkts = (amount + m_segment_mtus - 1) / m_segment_mtus;
 
 	/* fetch a batch of packets */
-#ifdef DROP_ON_FAILED_ENQUEUE
-	if (fp_mempool_get_bulk(m_packet_mempool, (void **) pkt_ptrs, amount)
+#if defined(DROP_ON_FAILED_ENQUEUE) || defined(EMU_CREDIT_FLOW_CONTROL)
+	if (fp_mempool_get_bulk(m_packet_mempool, (void **) pkt_ptrs, n_pkts)
 			== -ENOENT) {
 		adm_log_emu_packet_alloc_failed(&m_stat);
 
 		/* failed to alloc packets */
-		areq_data += emu_req_data_bytes() * amount;
 		return 0;
 	}
 #else
-	while (fp_mempool_get_bulk(m_packet_mempool, (void **) pkt_ptrs, amount)
+	while (fp_mempool_get_bulk(m_packet_mempool, (void **) pkt_ptrs, n_pkts)
 			== -ENOENT) {
 		adm_log_emu_packet_alloc_failed(&m_stat);
 	}
 #endif
 
+	if (m_segment_mtus > 1) {
+		/* each segment keeps the areq data of its first MTU */
+		for (i = 0; i < n_pkts; i++) {
+			n_mtus = MIN(amount, m_segment_mtus);
+			packet_init(pkt_ptrs[i], src, dst, flow, start_id, areq_data);
+			pkt_ptrs[i]->n_mtus = n_mtus;
+			start_id += n_mtus;
+			areq_data += emu_req_data_bytes() * n_mtus;
+			amount -= n_mtus;
+		}
+		return n_pkts;
+	}
+
 	/* initialize all packets, using prefetching */
-	for (i = 0; i < BACKLOG_PREFETCH_OFFSET && i < amount; i++)
+	for (i = 0; i < BACKLOG_PREFETCH_OFFSET && i < n_pkts; i++)
 		fp_prefetch0(pkt_ptrs[i]);
 
-	for (i = 0; i + BACKLOG_PREFETCH_OFFSET < amount; i++) {
+	for (i = 0; i + BACKLOG_PREFETCH_OFFSET < n_pkts; i++) {
 		fp_prefetch0(pkt_ptrs[i + BACKLOG_PREFETCH_OFFSET]);
 		packet_init(pkt_ptrs[i], src, dst, flow, start_id++, areq_data);
 		areq_data += emu_req_data_bytes();
 	}
 
-	for (; i < amount; i++) {
+	for (; i < n_pkts; i++) {
 		packet_init(pkt_ptrs[i], src, dst, flow, start_id++, areq_data);
 		areq_data += emu_req_data_bytes();
 	}
 
-	return amount;
+	return n_pkts;
 }
 
 #endif /* EMULATION_H_ */
@@ -15,6 +15,11 @@ void emu_add_backlog(void* emu, uint16_t src, uint16_t dst, uint16_t flow,
 	((Emulation *)emu)->add_backlog(src, dst, flow, amt, start_id, areq_data);
 }
 
+void emu_flush_backlog(void* emu, uint16_t comm_index)
+{
+	((Emulation *)emu)->flush_backlog(comm_index);
+}
+
 void emu_reset_sender(void* emu, uint16_t src)
 {
 	((Emulation *)emu)->reset_sender(src);
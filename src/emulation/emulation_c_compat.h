@@ -17,6 +17,8 @@ extern "C" {
 void emu_add_backlog(void *emu, uint16_t src, uint16_t dst, uint16_t flow,
 		uint32_t amt, uint16_t start_id, uint8_t *areq_data);
 
+void emu_flush_backlog(void *emu, uint16_t comm_index);
+
 void emu_reset_sender(void *emu, uint16_t src);
 
 #ifdef __cplusplus
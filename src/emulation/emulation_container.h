@@ -28,13 +28,15 @@ public:
 			uint32_t admitted_ring_size, uint32_t packet_mempool_size,
 			uint32_t packet_ring_size, enum RouterType r_type, void *r_args,
 			enum EndpointType e_type, void *e_args,
-			struct emu_topo_config *topo_config);
+			struct emu_topo_config *topo_config,
+			struct emu_partition_config *part_config = NULL);
 	inline ~EmulationContainer();
 
 	inline void add_backlog(uint16_t src, uint16_t dst, uint16_t flow,
 			uint32_t amount, uint16_t start_id, u8* areq_data);
 	inline void step();
 	inline void print_admitted();
+	inline void set_segment_mtus(uint8_t mtus);
 
 	/* Return the first struct of admitted packets. */
 	inline struct emu_admitted_traffic *get_admitted();
@@ -52,7 +54,8 @@ inline EmulationContainer::EmulationContainer(uint32_t admitted_mempool_size,
 		uint32_t admitted_ring_size, uint32_t packet_mempool_size,
 		uint32_t packet_ring_size, enum RouterType r_type, void *r_args,
 		enum EndpointType e_type, void *e_args,
-		struct emu_topo_config *topo_config) {
+		struct emu_topo_config *topo_config,
+		struct emu_partition_config *part_config) {
 	uint16_t i;
 	char s[64];
 
@@ -73,7 +76,8 @@ inline EmulationContainer::EmulationContainer(uint32_t admitted_mempool_size,
 		throw std::runtime_error("couldn't allocate packet_mempool");
 
 	m_emulation = new Emulation(&m_admitted_mempool, &m_q_admitted_out[0],
-			packet_ring_size, r_type, r_args, e_type, e_args, topo_config);
+			packet_ring_size, r_type, r_args, e_type, e_args, topo_config,
+			part_config);
 }
 
 inline EmulationContainer::~EmulationContainer() {
@@ -86,6 +90,10 @@ inline void EmulationContainer::add_backlog(uint16_t src, uint16_t dst,
 	m_emulation->add_backlog(src, dst, flow, amount, start_id, areq_data);
 }
 
+inline void EmulationContainer::set_segment_mtus(uint8_t mtus) {
+	m_emulation->set_segment_mtus(mtus);
+}
+
 inline void EmulationContainer::step() {
 	struct emu_admitted_traffic *admitted;
 	uint32_t i;
@@ -97,6 +105,11 @@ inline void EmulationContainer::step() {
 			fp_mempool_put(m_admitted_mempool, admitted);
 	}
 
+	/* hand staged backlog to the emulation, as the comm cores do after each
+	 * rx burst */
+	for (i = 0; i < N_COMM_CORES; i++)
+		m_emulation->flush_backlog(i);
+
 	/* step emulation by one timeslot */
 	m_emulation->step();
 }
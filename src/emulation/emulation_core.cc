@@ -8,6 +8,8 @@
 #include "emulation_core.h"
 #include "drivers/EndpointDriver.h"
 #include "drivers/RouterDriver.h"
+#include "drivers/PartitionLinkDriver.h"
+#include <stdexcept>
 
 EmulationCore::EmulationCore(EndpointDriver **epg_drivers,
 		RouterDriver **router_drivers, uint16_t n_epgs, uint16_t n_rtrs,
@@ -18,29 +20,61 @@ EmulationCore::EmulationCore(EndpointDriver **epg_drivers,
 	  m_n_epgs(n_epgs),
 	  m_n_rtrs(n_rtrs),
 	  m_core_index(core_index),
-	  m_dropper(m_out, &m_stat)
+	  m_dropper(m_out, &m_stat),
+	  m_phase_logs(NULL)
 {
 	uint32_t i;
+	struct emu_phase_log *epg_phase_logs = NULL;
+	struct emu_phase_log *rtr_phase_logs = NULL;
+
+	if (MAINTAIN_EMU_PHASE_HISTOGRAMS) {
+		m_phase_logs = (struct emu_phase_log *) fp_calloc("EmuPhaseLogs",
+				EMU_N_CORE_PHASES + n_epgs * EMU_N_ENDPOINT_PHASES
+				+ n_rtrs * EMU_N_ROUTER_PHASES, sizeof(struct emu_phase_log));
+		if (m_phase_logs == NULL)
+			throw std::runtime_error("could not allocate phase logs");
+		epg_phase_logs = &m_phase_logs[EMU_N_CORE_PHASES];
+		rtr_phase_logs = &epg_phase_logs[n_epgs * EMU_N_ENDPOINT_PHASES];
+	}
 
 	m_endpoint_drivers.reserve(m_n_epgs);
 	for (i = 0; i < n_epgs; i++) {
 		m_endpoint_drivers.push_back(epg_drivers[i]);
 		m_endpoint_drivers[i]->assign_to_core(&m_out, &m_dropper, &m_stat,
-				core_index);
+				core_index, epg_phase_logs == NULL ? NULL :
+						&epg_phase_logs[i * EMU_N_ENDPOINT_PHASES]);
 	}
 
 	m_router_drivers.reserve(m_n_rtrs);
 	for (i = 0; i < n_rtrs; i++) {
 		m_router_drivers.push_back(router_drivers[i]);
-		m_router_drivers[i]->assign_to_core(&m_dropper, &m_stat, core_index);
+		m_router_drivers[i]->assign_to_core(&m_dropper, &m_stat, core_index,
+				rtr_phase_logs == NULL ? NULL :
+						&rtr_phase_logs[i * EMU_N_ROUTER_PHASES]);
 	}
 
 	/* initialize log to zeroes */
 	memset(&m_stat, 0, sizeof(struct emu_admission_core_statistics));
 }
 
+void EmulationCore::add_partition_link(PartitionLinkDriver *link) {
+	m_links.push_back(link);
+	link->assign_to_core(&m_stat, m_core_index);
+}
+
 void EmulationCore::step() {
 	uint32_t i;
+	uint64_t step_start = emu_phase_now();
+	uint64_t phase_start = step_start;
+
+	/* endpoints and routers drop packets anywhere in the timeslot */
+	port_drop_stats_write_begin(m_dropper.get_port_drop_stats());
+
+	/* deliver packets sent by other emulator processes in the last timeslot */
+	for (i = 0; i < m_links.size(); i++)
+		m_links[i]->receive();
+	if (!m_links.empty())
+		emu_phase_end(m_phase_logs, EMU_PHASE_CORE_RECEIVE, &phase_start);
 
 	/* push/pull at endpoints and routers must be done in a specific order to
 	 * ensure that packets pushed in one timeslot cannot be pulled until the
@@ -54,7 +88,50 @@ void EmulationCore::step() {
 	for (i = 0; i < m_n_rtrs; i++)
 		m_router_drivers[i]->step();
 
+	/* hand packets for other emulator processes to them */
+	phase_start = emu_phase_now();
+	for (i = 0; i < m_links.size(); i++)
+		m_links[i]->send();
+	if (!m_links.empty())
+		emu_phase_end(m_phase_logs, EMU_PHASE_CORE_SEND, &phase_start);
+
 	m_out.flush();
+	emu_phase_end(m_phase_logs, EMU_PHASE_CORE_FLUSH, &phase_start);
+	emu_phase_end(m_phase_logs, EMU_PHASE_CORE_STEP, &step_start);
+
+	port_drop_stats_write_end(m_dropper.get_port_drop_stats());
+}
+
+void EmulationCore::print_phase_log() {
+	uint32_t i;
+	struct emu_phase_log *log = m_phase_logs;
+	static const char *endpoint_phases[EMU_N_ENDPOINT_PHASES] =
+			{"push", "pull", "new"};
+	static const char *router_phases[EMU_N_ROUTER_PHASES] = {"pull", "push"};
+
+	if (!MAINTAIN_EMU_PHASE_HISTOGRAMS)
+		return;
+
+	printf("\n  phase cycles:");
+	emu_phase_print_and_save(&log[EMU_PHASE_CORE_STEP], "core", m_core_index,
+			"step");
+	emu_phase_print_and_save(&log[EMU_PHASE_CORE_RECEIVE], "core",
+			m_core_index, "receive");
+	emu_phase_print_and_save(&log[EMU_PHASE_CORE_SEND], "core", m_core_index,
+			"send");
+	emu_phase_print_and_save(&log[EMU_PHASE_CORE_FLUSH], "core", m_core_index,
+			"flush");
+	log += EMU_N_CORE_PHASES;
+
+	for (i = 0; i < m_n_epgs; i++)
+		for (uint32_t phase = 0; phase < EMU_N_ENDPOINT_PHASES; phase++)
+			emu_phase_print_and_save(log++, "endpoint group", i,
+					endpoint_phases[phase]);
+
+	for (i = 0; i < m_n_rtrs; i++)
+		for (uint32_t phase = 0; phase < EMU_N_ROUTER_PHASES; phase++)
+			emu_phase_print_and_save(log++, "router", i, router_phases[phase]);
+	printf("\n");
 }
 
 void EmulationCore::cleanup() {
@@ -71,4 +148,12 @@ void EmulationCore::cleanup() {
 		m_router_drivers[i]->cleanup();
 		delete m_router_drivers[i];
 	}
+
+	/* free all links to other processes */
+	for (i = 0; i < m_links.size(); i++) {
+		m_links[i]->cleanup();
+		delete m_links[i];
+	}
+
+	fp_free(m_phase_logs);
 }
@@ -11,6 +11,7 @@
 #include "admissible_log.h"
 #include "config.h"
 #include "output.h"
+#include "phase_log.h"
 #include "../graph-algo/fp_ring.h"
 #include "../graph-algo/platform.h"
 #include <inttypes.h>
@@ -19,6 +20,7 @@
 class EmulationOutput;
 class EndpointDriver;
 class RouterDriver;
+class PartitionLinkDriver;
 
 /**
  * A class to encapsulate the state used by one core in the emulation.
@@ -27,8 +29,11 @@ class RouterDriver;
  * @m_n_epgs: number of endpoint groups this core controls
  * @m_router_drivers: one driver for each router in the network
  * @m_n_rtrs: number of routers this core controls
+ * @m_links: links to other emulator processes that this core drives
  * @m_stats: stats for this core
  * @m_core_index: index of this core
+ * @m_phase_logs: cycle histograms of the phases of the core, then of each
+ * 	endpoint group and each router. NULL unless MAINTAIN_EMU_PHASE_HISTOGRAMS.
  */
 class EmulationCore {
 public:
@@ -38,6 +43,12 @@ public:
 			struct fp_mempool *admitted_traffic_mempool,
 			struct fp_mempool *packet_mempool);
 
+	/**
+	 * Drive @link from this core, for a topology partitioned across
+	 * 	processes.
+	 */
+	void add_partition_link(PartitionLinkDriver *link);
+
 	void step();
 	void cleanup();
 
@@ -47,15 +58,23 @@ public:
 	inline struct port_drop_stats *get_port_drop_stats() {
 		return m_dropper.get_port_drop_stats();
 	}
+
+	/**
+	 * Prints percentiles of the duration of each phase of each component
+	 * 	since the last call. Called by the log core.
+	 */
+	void print_phase_log();
 private:
 	EmulationOutput	m_out;
 	std::vector<EndpointDriver *> m_endpoint_drivers;
 	uint16_t		m_n_epgs;
 	std::vector<RouterDriver *> m_router_drivers;
 	uint16_t		m_n_rtrs;
+	std::vector<PartitionLinkDriver *> m_links;
 	struct emu_admission_core_statistics m_stat;
 	uint16_t		m_core_index;
 	Dropper			m_dropper;
+	struct emu_phase_log	*m_phase_logs;
 }  __attribute__((aligned(64))) /* don't want sharing between cores */;
 
 #endif /* EMULATION_CORE_H_ */
@@ -89,6 +89,9 @@ int main() {
 	topo_config.num_racks = 1;
 	topo_config.rack_shift = 5; /* 32 machines per rack */
 	topo_config.num_core_rtrs = 0;
+	topo_config.uplink_rate = 1;
+	topo_config.host_link_delay = 0;
+	topo_config.uplink_delay = 0;
 
     /* run a basic test of emulation framework */
     container = create_container(R_DropTail, &topo_config);
@@ -199,6 +199,7 @@ inline void LSTFQueueBank::enqueue(uint32_t port, struct emu_packet *p, uint64_t
         m_occupancies[port]++;
 
         queue_bank_log_enqueue(&m_stats, port);
+        queue_bank_hist_enqueue(&m_stats, port);
 
 }
 
@@ -230,6 +231,7 @@ inline struct emu_packet *LSTFQueueBank::dequeue_least_slack(
         tdiff = cur_time - arrival;
         /* to prevent underflow */
         p->slack = tdiff <= p->slack ? p->slack - tdiff : 0;
+        queue_bank_hist_dequeue(&m_stats, port, arrival, cur_time);
 
         m_occupancies[port]--;
 
@@ -281,6 +283,7 @@ inline struct emu_packet *LSTFQueueBank::dequeue_most_slack(
         m_non_empty_ports[port >> 6] ^= (port_empty << (port & 0x3F));
 
         queue_bank_log_dequeue(&m_stats, port);
+        queue_bank_hist_drop(&m_stats, port);
 
         return p;
 }
@@ -11,6 +11,7 @@
 #include "admitted.h"
 #include "packet.h"
 #include "queue_bank_log.h"
+#include "../protocol/probes.h"
 
 /**
  * A class used to admit and drop packets
@@ -96,6 +97,8 @@ public:
 	inline void  __attribute__((always_inline))	drop(struct emu_packet *packet,
 			uint32_t port)
 	{
+		FP_PROBE5(queue_drop, packet->src, packet->dst, packet->flow,
+				packet->id, port);
 		m_emu_output.drop(packet);
 		queue_bank_log_drop(&m_stats, port);
 		adm_log_emu_dropped_packet(m_core_stats);
@@ -103,6 +106,8 @@ public:
 
 	inline void __attribute__((always_inline)) mark_ecn(
 			struct emu_packet *packet, uint32_t port) {
+		FP_PROBE5(queue_mark_ecn, packet->src, packet->dst, packet->flow,
+				packet->id, port);
 		packet->flags = EMU_FLAGS_ECN_MARK;
 		adm_log_emu_marked_packet(m_core_stats);
 		queue_bank_log_mark(&m_stats, port);
@@ -143,6 +148,11 @@ inline EmulationOutput::~EmulationOutput() {
 inline void __attribute__((always_inline))
 EmulationOutput::drop(struct emu_packet* packet)
 {
+	uint8_t mtu;
+
+	FP_PROBE5(emu_drop, packet->src, packet->dst, packet->flow, packet->id,
+			packet->n_mtus);
+
 	/* add dropped packet to admitted struct */
 	admitted_insert_dropped_edge(admitted, packet);
 
@@ -150,12 +160,25 @@ EmulationOutput::drop(struct emu_packet* packet)
 	if (unlikely(admitted->size == EMU_ADMITS_PER_ADMITTED))
 		flush();
 
+	/* remaining MTUs of a segment */
+	for (mtu = 1; mtu < admitted_n_edges(packet); mtu++) {
+		admitted_insert_mtu_edge(admitted, packet, EMU_FLAGS_DROP, mtu);
+		admitted->dropped++;
+		if (unlikely(admitted->size == EMU_ADMITS_PER_ADMITTED))
+			flush();
+	}
+
 	free_packet(packet);
 }
 
 inline void __attribute__((always_inline))
 EmulationOutput::admit(struct emu_packet* packet)
 {
+	uint8_t mtu;
+
+	FP_PROBE5(emu_admit, packet->src, packet->dst, packet->flow, packet->id,
+			packet->n_mtus);
+
 	admitted_insert_admitted_edge(admitted, packet);
 	adm_log_emu_admitted_packet(m_stat);
 	adm_log_emu_admitted_mtus(m_stat, packet->n_mtus);
@@ -164,6 +187,14 @@ EmulationOutput::admit(struct emu_packet* packet)
 	if (unlikely(admitted->size == EMU_ADMITS_PER_ADMITTED))
 		flush();
 
+	/* remaining MTUs of a segment */
+	for (mtu = 1; mtu < admitted_n_edges(packet); mtu++) {
+		admitted_insert_mtu_edge(admitted, packet, packet->flags, mtu);
+		admitted->admitted++;
+		if (unlikely(admitted->size == EMU_ADMITS_PER_ADMITTED))
+			flush();
+	}
+
 	free_packet(packet);
 }
 
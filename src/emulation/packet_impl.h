@@ -24,6 +24,7 @@ void packet_init(struct emu_packet *packet, uint16_t src, uint16_t dst,
 	packet->flow = flow;
 	packet->id = id;
 	packet->flags = EMU_FLAGS_NONE; /* start with no flags */
+	packet->n_mtus = 1; /* a single MTU unless created as a segment */
 
 	/* copy algo-specific fields to emu_packet */
 #if defined(PFABRIC)
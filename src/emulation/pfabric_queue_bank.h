@@ -46,6 +46,9 @@ struct pfabric_pkt_metadata {
 	struct pfabric_pkt_metadata *prev;
 	struct pfabric_pkt_metadata *next;
 	struct pfabric_flow_metadata *flow;
+#if MAINTAIN_QUEUE_BANK_HISTOGRAMS
+	uint64_t enqueue_time;
+#endif
 };
 
 /**
@@ -74,17 +77,21 @@ public:
 	 * Enqueues the packet
 	 * @param port: the port number to enqueue to
 	 * @param p: the packet to enqueue
+	 * @param cur_time: the current time, for queueing delay histograms
 	 * @assumes there is enough space in q
 	 */
-	inline void enqueue(uint32_t port, struct emu_packet *p);
+	inline void enqueue(uint32_t port, struct emu_packet *p,
+			uint64_t cur_time = 0);
 
 	/**
 	 * Dequeues the first packet from the flow of the highest priority packet,
 	 * for this port.
 	 * @param port: the port number to dequeue from
+	 * @param cur_time: the current time, for queueing delay histograms
 	 * @assumes the queue is non-empty
 	 */
-	inline struct emu_packet *dequeue_highest_priority(uint32_t port);
+	inline struct emu_packet *dequeue_highest_priority(uint32_t port,
+			uint64_t cur_time = 0);
 
 	/**
 	 * Dequeues the lowest priority packet for this port.
@@ -227,7 +234,8 @@ inline PFabricQueueBank::~PFabricQueueBank()
 	free(m_non_empty_ports);
 }
 
-inline void PFabricQueueBank::enqueue(uint32_t port, struct emu_packet *p) {
+inline void PFabricQueueBank::enqueue(uint32_t port, struct emu_packet *p,
+		uint64_t cur_time) {
 	uint16_t p_index;
 	struct pfabric_flow_metadata *flow_metadata;
 
@@ -240,6 +248,9 @@ inline void PFabricQueueBank::enqueue(uint32_t port, struct emu_packet *p) {
 	pkt_metadata->pkt = p;
 	pkt_metadata->priority = p->priority;
 	pkt_metadata->next = NULL;
+#if MAINTAIN_QUEUE_BANK_HISTOGRAMS
+	pkt_metadata->enqueue_time = cur_time;
+#endif
 
 	/* find entry in flow queue */
 	flow_metadata = m_flow_metadata[port];
@@ -273,10 +284,11 @@ found_flow_metadata:
 	m_occupancies[port]++;
 
 	queue_bank_log_enqueue(&m_stats, port);
+	queue_bank_hist_enqueue(&m_stats, port);
 }
 
 inline struct emu_packet *PFabricQueueBank::dequeue_highest_priority(
-		uint32_t port) {
+		uint32_t port, uint64_t cur_time) {
 	struct pfabric_flow_metadata *flow_metadata, *highest_pri_flow_metadata;
 	uint32_t highest_priority = PFABRIC_MAX_PRIORITY;
 
@@ -291,6 +303,10 @@ inline struct emu_packet *PFabricQueueBank::dequeue_highest_priority(
 		flow_metadata++;
 	}
 
+#if MAINTAIN_QUEUE_BANK_HISTOGRAMS
+	queue_bank_hist_dequeue(&m_stats, port,
+			highest_pri_flow_metadata->head->enqueue_time, cur_time);
+#endif
 	return dequeue_packet_from_flow(port, highest_pri_flow_metadata);
 }
 
@@ -310,6 +326,7 @@ inline struct emu_packet *PFabricQueueBank::dequeue_lowest_priority(
 		flow_metadata++;
 	}
 
+	queue_bank_hist_drop(&m_stats, port);
 	return dequeue_packet_from_flow(port, lowest_pri_flow_metadata);
 }
 
@@ -0,0 +1,172 @@
+/*
+ * phase_log.h
+ *
+ * Cycle histograms of the phases of a timeslot on an emulation core.
+ *
+ *  Created on: October 19, 2026
+ */
+
+#ifndef EMU_PHASE_LOG_H__
+#define EMU_PHASE_LOG_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "../graph-algo/rdtsc.h"
+
+#ifndef MAINTAIN_EMU_PHASE_HISTOGRAMS
+#define MAINTAIN_EMU_PHASE_HISTOGRAMS	0
+#endif
+
+/* durations below EMU_PHASE_HIST_EXACT cycles get a bin each. above that,
+ * each power of two is split into EMU_PHASE_HIST_SUB bins, so percentiles
+ * are within 1/EMU_PHASE_HIST_SUB of the true value. durations of 2^32
+ * cycles or more go to the last bin. */
+#define EMU_PHASE_HIST_EXACT		16
+#define EMU_PHASE_HIST_EXACT_SHIFT	4
+#define EMU_PHASE_HIST_SUB			8
+#define EMU_PHASE_HIST_SUB_SHIFT	3
+#define EMU_PHASE_HIST_NUM_BINS		(EMU_PHASE_HIST_EXACT + \
+		(32 - EMU_PHASE_HIST_EXACT_SHIFT) * EMU_PHASE_HIST_SUB)
+
+/* phases of an endpoint group, a router, and the core itself */
+enum emu_endpoint_phase {
+	EMU_PHASE_ENDPOINT_PUSH = 0,
+	EMU_PHASE_ENDPOINT_PULL,
+	EMU_PHASE_ENDPOINT_NEW,
+	EMU_N_ENDPOINT_PHASES
+};
+
+enum emu_router_phase {
+	EMU_PHASE_ROUTER_PULL = 0,
+	EMU_PHASE_ROUTER_PUSH,
+	EMU_N_ROUTER_PHASES
+};
+
+enum emu_core_phase {
+	EMU_PHASE_CORE_RECEIVE = 0, /* from partition links */
+	EMU_PHASE_CORE_SEND, /* to partition links */
+	EMU_PHASE_CORE_FLUSH,
+	EMU_PHASE_CORE_STEP, /* the whole timeslot */
+	EMU_N_CORE_PHASES
+};
+
+/**
+ * Durations of one phase of one component
+ * @bins: counts of durations, in cycles, see emu_phase_hist_bin()
+ * @saved: @bins at the last report, so reports cover the last interval
+ */
+struct emu_phase_log {
+	uint64_t bins[EMU_PHASE_HIST_NUM_BINS];
+	uint64_t saved[EMU_PHASE_HIST_NUM_BINS];
+};
+
+/**
+ * Returns the timestamp a phase starts at, or 0 if phases are not logged
+ */
+static inline __attribute__((always_inline))
+uint64_t emu_phase_now(void) {
+	if (MAINTAIN_EMU_PHASE_HISTOGRAMS)
+		return current_time();
+	return 0;
+}
+
+static inline __attribute__((always_inline))
+uint32_t emu_phase_hist_bin(uint64_t cycles) {
+	uint32_t log;
+
+	if (cycles < EMU_PHASE_HIST_EXACT)
+		return cycles;
+	if (cycles >> 32)
+		return EMU_PHASE_HIST_NUM_BINS - 1;
+
+	log = 63 - __builtin_clzll(cycles);
+	return EMU_PHASE_HIST_EXACT
+			+ ((log - EMU_PHASE_HIST_EXACT_SHIFT) << EMU_PHASE_HIST_SUB_SHIFT)
+			+ ((cycles >> (log - EMU_PHASE_HIST_SUB_SHIFT))
+					& (EMU_PHASE_HIST_SUB - 1));
+}
+
+/**
+ * Returns the largest duration that falls in @bin
+ */
+static inline
+uint64_t emu_phase_hist_bin_max(uint32_t bin) {
+	uint32_t log, sub;
+
+	if (bin < EMU_PHASE_HIST_EXACT)
+		return bin;
+
+	log = EMU_PHASE_HIST_EXACT_SHIFT
+			+ ((bin - EMU_PHASE_HIST_EXACT) >> EMU_PHASE_HIST_SUB_SHIFT);
+	sub = (bin - EMU_PHASE_HIST_EXACT) & (EMU_PHASE_HIST_SUB - 1);
+	return ((uint64_t) (EMU_PHASE_HIST_SUB + sub + 1)
+			<< (log - EMU_PHASE_HIST_SUB_SHIFT)) - 1;
+}
+
+/**
+ * Ends @phase of a component with logs @logs, that started at *@start, and
+ * 	starts the next one. @logs is NULL when phases are not logged.
+ */
+static inline __attribute__((always_inline))
+void emu_phase_end(struct emu_phase_log *logs, uint32_t phase,
+		uint64_t *start) {
+	if (MAINTAIN_EMU_PHASE_HISTOGRAMS) {
+		uint64_t now = current_time();
+
+		logs[phase].bins[emu_phase_hist_bin(now - *start)]++;
+		*start = now;
+	}
+}
+
+/**
+ * Returns the duration, in cycles, that a fraction @p of the @n durations
+ * 	in @diff took at most
+ */
+static inline
+uint64_t emu_phase_percentile(uint64_t *diff, uint64_t n, double p) {
+	uint64_t rank = (uint64_t) (p * n);
+	uint64_t seen = 0;
+	uint32_t bin;
+
+	for (bin = 0; bin < EMU_PHASE_HIST_NUM_BINS; bin++) {
+		seen += diff[bin];
+		if (seen > rank)
+			return emu_phase_hist_bin_max(bin);
+	}
+	return emu_phase_hist_bin_max(EMU_PHASE_HIST_NUM_BINS - 1);
+}
+
+/**
+ * Prints the number of durations of the phase since the last report, their
+ * 	p50, p99, p99.9 and max, and saves the histogram for the next report.
+ * 	Called by the log core; counts of a phase in progress may be off by one.
+ */
+static inline
+void emu_phase_print_and_save(struct emu_phase_log *log, const char *component,
+		uint16_t index, const char *phase) {
+	uint64_t diff[EMU_PHASE_HIST_NUM_BINS];
+	uint64_t bins[EMU_PHASE_HIST_NUM_BINS];
+	uint64_t n = 0;
+	uint32_t bin, max_bin = 0;
+
+	memcpy(bins, log->bins, sizeof(bins));
+	for (bin = 0; bin < EMU_PHASE_HIST_NUM_BINS; bin++) {
+		diff[bin] = bins[bin] - log->saved[bin];
+		n += diff[bin];
+		if (diff[bin] != 0)
+			max_bin = bin;
+	}
+	memcpy(log->saved, bins, sizeof(bins));
+
+	if (n == 0)
+		return;
+	printf("\n    %s %d %s: %lu, p50 %lu, p99 %lu, p99.9 %lu, max %lu",
+			component, index, phase, n,
+			emu_phase_percentile(diff, n, 0.5),
+			emu_phase_percentile(diff, n, 0.99),
+			emu_phase_percentile(diff, n, 0.999),
+			emu_phase_hist_bin_max(max_bin));
+}
+
+#endif /* EMU_PHASE_LOG_H__ */
@@ -0,0 +1,310 @@
+/*
+ * py_batch_router.h
+ *
+ *  Created on: October 19, 2026
+ */
+
+#ifndef PY_BATCH_ROUTER_H_
+#define PY_BATCH_ROUTER_H_
+
+#include "output.h"
+#include "packet.h"
+#include "queue_bank.h"
+#include "router.h"
+#include "../graph-algo/platform.h"
+#include <stdexcept>
+#include <string.h>
+#include <vector>
+
+/* flags in emu_batch_verdict.action */
+#define EMU_BATCH_DROP		0x1	/* drop the packet */
+#define EMU_BATCH_MARK		0x2	/* mark the packet with ECN and enqueue it */
+
+/**
+ * The fields of a packet, gathered into a contiguous array for a batch
+ * 	callback. Matches PACKET_DTYPE in python/batch.py. Changes to @priority
+ * 	and @slack are copied back to the packet.
+ */
+struct emu_batch_packet {
+	uint16_t	src;
+	uint16_t	dst;
+	uint16_t	flow;
+	uint16_t	id;
+	uint16_t	flags;
+	uint8_t		n_mtus;
+	uint8_t		pad;
+	uint32_t	priority;
+	uint64_t	slack;
+};
+
+/**
+ * The decision of a batch callback for one packet. Matches VERDICT_DTYPE in
+ * 	python/batch.py.
+ * @port: output port
+ * @queue: queue in @port
+ * @action: EMU_BATCH_* flags, 0 to enqueue
+ */
+struct emu_batch_verdict {
+	uint16_t	port;
+	uint16_t	queue;
+	uint8_t		action;
+	uint8_t		pad[3];
+};
+
+/**
+ * A router whose routing, classification, queue management and scheduling
+ *   are decided a burst at a time, by overriding classify_batch() and
+ *   schedule_batch(), e.g. in Python via a SWIG director. Each callback sees
+ *   the whole burst in flat arrays it can wrap without copying (e.g. as NumPy
+ *   structured arrays, see python/batch.py), so a scheme crosses into Python
+ *   once per burst rather than several times per packet.
+ *
+ * classify_batch(n) reads the first n packets at packets_addr() and fills
+ *   the first n verdicts at verdicts_addr(). The router then drops, marks and
+ *   enqueues packets in order. Packets that do not fit in their queue are
+ *   dropped.
+ *
+ * schedule_batch() is called when some requested ports have packets, and
+ *   eligible_addr()[port] is set for them. It writes to sched_queue_addr()
+ *   [port] the queue to send from, or -1 to send nothing.
+ *   occupancy_addr()[port * n_queues + queue] holds the MTUs in each queue.
+ *   The default sends from the lowest non-empty queue, without calling out.
+ *
+ * Buffer addresses are returned as integers so scripting languages can map
+ *   them.
+ */
+class PyBatchRouter : public Router {
+public:
+	/**
+	 * c'tor
+	 * @param n_ports: number of output ports
+	 * @param n_queues: number of queues per port, at most 64
+	 * @param queue_max_size: capacity of each queue, a power of two
+	 * @param max_burst: most packets passed to a single classify_batch()
+	 */
+	PyBatchRouter(uint32_t n_ports, uint32_t n_queues, uint32_t queue_max_size,
+			uint32_t max_burst);
+	virtual ~PyBatchRouter();
+
+	/**
+	 * Decides the port, queue and action of the first @n_pkts packets.
+	 */
+	virtual void classify_batch(uint32_t n_pkts, uint64_t cur_time)
+	{
+		throw std::runtime_error("not implemented");
+	}
+
+	/**
+	 * Chooses the queue each eligible port sends from.
+	 */
+	virtual void schedule_batch(uint64_t cur_time);
+
+	inline uint32_t n_ports() { return m_n_ports; }
+	inline uint32_t n_queues() { return m_n_queues; }
+	inline uint32_t max_burst() { return m_max_burst; }
+
+	inline uintptr_t packets_addr() { return (uintptr_t) m_packets; }
+	inline uintptr_t verdicts_addr() { return (uintptr_t) m_verdicts; }
+	inline uintptr_t occupancy_addr() { return (uintptr_t) m_occupancy; }
+	inline uintptr_t eligible_addr() { return (uintptr_t) m_eligible; }
+	inline uintptr_t sched_queue_addr() { return (uintptr_t) m_sched_queue; }
+
+	virtual struct queue_bank_stats *get_queue_bank_stats();
+	virtual void push(struct emu_packet *packet, uint64_t cur_time,
+			Dropper *dropper);
+	virtual struct emu_packet *pull(uint16_t port, uint64_t cur_time,
+			Dropper *dropper);
+	virtual void push_batch(struct emu_packet **pkts, uint32_t n_pkts,
+			uint64_t cur_time, Dropper *dropper);
+	virtual uint32_t pull_batch(struct emu_packet **pkts, uint32_t n_pkts,
+			uint64_t *port_masks, uint64_t cur_time, Dropper *dropper);
+
+protected:
+	PacketQueueBank				m_bank;
+	uint32_t					m_n_ports;
+	uint32_t					m_n_queues;
+	uint32_t					m_max_burst;
+	struct emu_batch_packet		*m_packets;
+	struct emu_batch_verdict	*m_verdicts;
+	uint32_t					*m_occupancy;
+	uint8_t						*m_eligible;
+	int16_t						*m_sched_queue;
+
+private:
+	/* one call to classify_batch() for at most m_max_burst packets */
+	void push_burst(struct emu_packet **pkts, uint32_t n_pkts,
+			uint64_t cur_time, Dropper *dropper);
+};
+
+/** implementation */
+
+inline PyBatchRouter::PyBatchRouter(uint32_t n_ports, uint32_t n_queues,
+		uint32_t queue_max_size, uint32_t max_burst)
+	: m_bank(n_ports, n_queues, queue_max_size), m_n_ports(n_ports),
+	  m_n_queues(n_queues), m_max_burst(max_burst)
+{
+	if (max_burst == 0)
+		throw std::runtime_error("max_burst must be positive");
+
+	m_packets = (struct emu_batch_packet *) fp_calloc("batch_packets",
+			max_burst, sizeof(struct emu_batch_packet));
+	m_verdicts = (struct emu_batch_verdict *) fp_calloc("batch_verdicts",
+			max_burst, sizeof(struct emu_batch_verdict));
+	m_occupancy = (uint32_t *) fp_calloc("batch_occupancy",
+			n_ports * n_queues, sizeof(uint32_t));
+	m_eligible = (uint8_t *) fp_calloc("batch_eligible", n_ports,
+			sizeof(uint8_t));
+	m_sched_queue = (int16_t *) fp_calloc("batch_sched_queue", n_ports,
+			sizeof(int16_t));
+	if (m_packets == NULL || m_verdicts == NULL || m_occupancy == NULL ||
+			m_eligible == NULL || m_sched_queue == NULL)
+		throw std::runtime_error("could not allocate batch buffers");
+}
+
+inline PyBatchRouter::~PyBatchRouter()
+{
+	fp_free(m_packets);
+	fp_free(m_verdicts);
+	fp_free(m_occupancy);
+	fp_free(m_eligible);
+	fp_free(m_sched_queue);
+}
+
+inline void PyBatchRouter::schedule_batch(uint64_t cur_time)
+{
+	uint64_t queue;
+	uint32_t port;
+
+	for (port = 0; port < m_n_ports; port++) {
+		if (!m_eligible[port])
+			continue;
+		/* get the index of the lsb that is set */
+		asm("bsfq %1,%0" : "=r"(queue)
+				: "r"(m_bank.non_empty_queue_mask(port)));
+		m_sched_queue[port] = queue;
+	}
+}
+
+inline struct queue_bank_stats *PyBatchRouter::get_queue_bank_stats()
+{
+	return m_bank.get_queue_bank_stats();
+}
+
+inline void PyBatchRouter::push(struct emu_packet *packet, uint64_t cur_time,
+		Dropper *dropper)
+{
+	push_burst(&packet, 1, cur_time, dropper);
+}
+
+inline struct emu_packet *PyBatchRouter::pull(uint16_t port,
+		uint64_t cur_time, Dropper *dropper)
+{
+	std::vector<uint64_t> port_masks((m_n_ports + 63) >> 6, 0);
+	struct emu_packet *packet;
+
+	port_masks[port >> 6] = 1ULL << (port & 63);
+	if (pull_batch(&packet, 1, &port_masks[0], cur_time, dropper) == 0)
+		return NULL;
+	return packet;
+}
+
+inline void PyBatchRouter::push_batch(struct emu_packet **pkts,
+		uint32_t n_pkts, uint64_t cur_time, Dropper *dropper)
+{
+	uint32_t i, n;
+
+	for (i = 0; i < n_pkts; i += n) {
+		n = (n_pkts - i < m_max_burst) ? n_pkts - i : m_max_burst;
+		push_burst(&pkts[i], n, cur_time, dropper);
+	}
+}
+
+inline void PyBatchRouter::push_burst(struct emu_packet **pkts,
+		uint32_t n_pkts, uint64_t cur_time, Dropper *dropper)
+{
+	struct emu_batch_verdict *v;
+	struct emu_packet *pkt;
+	uint32_t i, flat;
+
+	/* gather fields, so the callback sees them in one array */
+	for (i = 0; i < n_pkts; i++) {
+		pkt = pkts[i];
+		m_packets[i].src = pkt->src;
+		m_packets[i].dst = pkt->dst;
+		m_packets[i].flow = pkt->flow;
+		m_packets[i].id = pkt->id;
+		m_packets[i].flags = pkt->flags;
+		m_packets[i].n_mtus = pkt->n_mtus;
+		m_packets[i].priority = pkt->priority;
+		m_packets[i].slack = pkt->slack;
+	}
+	memset(m_verdicts, 0, n_pkts * sizeof(struct emu_batch_verdict));
+
+	classify_batch(n_pkts, cur_time);
+
+	/* apply verdicts in order, so packets of a queue keep their order */
+	for (i = 0; i < n_pkts; i++) {
+		pkt = pkts[i];
+		v = &m_verdicts[i];
+		if (v->port >= m_n_ports || v->queue >= m_n_queues)
+			throw std::runtime_error("batch verdict out of range");
+
+		pkt->priority = m_packets[i].priority;
+		pkt->slack = m_packets[i].slack;
+
+		flat = m_bank.flat_index(v->port, v->queue);
+		if ((v->action & EMU_BATCH_DROP) || m_bank.full(v->port, v->queue)) {
+			dropper->drop(pkt, v->port);
+			continue;
+		}
+		if (v->action & EMU_BATCH_MARK)
+			dropper->mark_ecn(pkt, v->port);
+		m_occupancy[flat] += pkt->n_mtus;
+		m_bank.enqueue(v->port, v->queue, pkt, cur_time);
+	}
+}
+
+inline uint32_t PyBatchRouter::pull_batch(struct emu_packet **pkts,
+		uint32_t n_pkts, uint64_t *port_masks, uint64_t cur_time,
+		Dropper *dropper)
+{
+	uint64_t *non_empty_port_mask = m_bank.non_empty_port_mask();
+	uint64_t mask, port;
+	uint32_t res = 0;
+	bool any = false;
+	int16_t queue;
+	uint32_t i;
+
+	memset(m_eligible, 0, m_n_ports);
+	for (i = 0; i < ((m_n_ports + 63) >> 6); i++) {
+		/* only non-empty ports that are requested right now */
+		mask = non_empty_port_mask[i] & port_masks[i];
+		any |= (mask != 0);
+		while (mask) {
+			asm("bsfq %1,%0" : "=r"(port) : "r"(mask));
+			mask &= (mask - 1);
+			m_eligible[port + 64 * i] = 1;
+			m_sched_queue[port + 64 * i] = -1;
+		}
+	}
+	if (!any)
+		return 0;
+
+	schedule_batch(cur_time);
+
+	for (port = 0; port < m_n_ports && res < n_pkts; port++) {
+		queue = m_sched_queue[port];
+		if (!m_eligible[port] || queue < 0)
+			continue;
+		if (queue >= (int16_t) m_n_queues || m_bank.empty(port, queue))
+			throw std::runtime_error("batch scheduler chose an empty queue");
+
+		pkts[res] = m_bank.dequeue(port, queue, cur_time);
+		m_occupancy[m_bank.flat_index(port, queue)] -= pkts[res]->n_mtus;
+		res++;
+	}
+
+	return res;
+}
+
+#endif /* PY_BATCH_ROUTER_H_ */
@@ -0,0 +1,92 @@
+#!/usr/bin/python
+"""
+Batch prototyping of router schemes in Python, on top of PyBatchRouter (see
+py_batch_router.h). A scheme sees each burst of packets as a NumPy structured
+array and returns its decisions in another, so it crosses from C++ into
+Python once per burst instead of several times per packet.
+
+Subclass BatchScheme and implement decide():
+
+    class MyScheme(BatchScheme):
+        def decide(self, pkts, verdicts, cur_time):
+            verdicts['port'] = pkts['dst']
+            verdicts['queue'] = pkts['flow'] % self.n_queues()
+            verdicts['action'][pkts['priority'] > 10] |= DROP
+
+To also schedule in Python, override schedule_batch(cur_time). It sets
+self.sched_queue[port] to the queue each port in np.flatnonzero(self.eligible)
+sends from, or leaves it -1 to send nothing; self.occupancy[port, queue]
+holds the MTUs in each queue. By default each port sends from its lowest
+non-empty queue.
+
+decide() must not keep the arrays it is given: they are views onto buffers
+that the router reuses for the next burst.
+"""
+
+import ctypes
+import numpy as np
+from fastemu import *
+
+# struct emu_batch_packet
+PACKET_DTYPE = np.dtype([('src', np.uint16), ('dst', np.uint16),
+                         ('flow', np.uint16), ('id', np.uint16),
+                         ('flags', np.uint16), ('n_mtus', np.uint8),
+                         ('pad', np.uint8), ('priority', np.uint32),
+                         ('slack', np.uint64)])
+
+# struct emu_batch_verdict
+VERDICT_DTYPE = np.dtype([('port', np.uint16), ('queue', np.uint16),
+                          ('action', np.uint8), ('pad', np.uint8, (3,))])
+
+# flags in a verdict's action
+DROP = EMU_BATCH_DROP
+MARK = EMU_BATCH_MARK
+
+assert PACKET_DTYPE.itemsize == 24
+assert VERDICT_DTYPE.itemsize == 8
+
+
+def _view(addr, dtype, count):
+    """Returns an array of @count @dtype elements at address @addr, without
+    copying"""
+    dtype = np.dtype(dtype)
+    buf = (ctypes.c_char * (count * dtype.itemsize)).from_address(addr)
+    return np.frombuffer(buf, dtype=dtype)
+
+
+def rank_within(keys):
+    """Returns, for each element of @keys, how many earlier elements have the
+    same key, e.g. the position of each packet among the packets of the burst
+    that go to its queue"""
+    n = len(keys)
+    order = np.argsort(keys, kind='mergesort')  # stable, keeps arrival order
+    sorted_keys = keys[order]
+    starts = np.flatnonzero(np.r_[True, sorted_keys[1:] != sorted_keys[:-1]])
+    sizes = np.diff(np.r_[starts, n])
+    ranks = np.empty(n, dtype=np.int64)
+    ranks[order] = np.arange(n) - np.repeat(starts, sizes)
+    return ranks
+
+
+class BatchScheme(PyBatchRouter):
+    """A router scheme that decides a burst at a time with NumPy"""
+
+    def __init__(self, n_ports, n_queues, queue_max_size, max_burst):
+        super(BatchScheme, self).__init__(n_ports, n_queues, queue_max_size,
+                                          max_burst)
+        self.packets = _view(self.packets_addr(), PACKET_DTYPE, max_burst)
+        self.verdicts = _view(self.verdicts_addr(), VERDICT_DTYPE, max_burst)
+        # MTUs in each queue, as occupancy[port, queue]
+        self.occupancy = _view(self.occupancy_addr(), np.uint32,
+                               n_ports * n_queues).reshape(n_ports, n_queues)
+        self.eligible = _view(self.eligible_addr(), np.uint8, n_ports)
+        self.sched_queue = _view(self.sched_queue_addr(), np.int16, n_ports)
+
+    def classify_batch(self, n_pkts, cur_time):
+        self.decide(self.packets[:n_pkts], self.verdicts[:n_pkts], cur_time)
+
+    def decide(self, pkts, verdicts, cur_time):
+        """Fills the port, queue and action of each packet in @verdicts.
+        Verdicts start as zeros, i.e. enqueue to queue 0 of port 0. Changes to
+        the priority and slack of @pkts are copied back to the packets."""
+        raise NotImplementedError()
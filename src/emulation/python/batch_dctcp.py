@@ -0,0 +1,59 @@
+#!/usr/bin/python
+"""
+DCTCP in a top-of-rack router, prototyped with the batch API (see batch.py):
+each port has a single queue that marks packets when it holds at least
+mark_threshold MTUs, and drops them when it holds q_capacity. Assumes packets
+of one MTU.
+"""
+
+import numpy as np
+from batch import *
+
+
+class BatchDCTCPRouter(BatchScheme):
+    def __init__(self, n_ports, q_capacity, mark_threshold, max_burst=256):
+        super(BatchDCTCPRouter, self).__init__(n_ports, 1, 4096, max_burst)
+        self.q_capacity = q_capacity
+        self.mark_threshold = mark_threshold
+
+    def decide(self, pkts, verdicts, cur_time):
+        # route to the destination's port, in the only queue
+        ports = pkts['dst'] % self.n_ports()
+        verdicts['port'] = ports
+
+        # each packet waits behind the queue and earlier packets of the burst
+        ahead = self.occupancy[ports, 0] + rank_within(ports)
+        dropped = ahead >= self.q_capacity
+        verdicts['action'][dropped] = DROP
+
+        # once a packet is dropped so are later packets to its port, so the
+        # packets counted ahead of an enqueued packet were all enqueued
+        verdicts['action'][~dropped & (ahead >= self.mark_threshold)] = MARK
+
+
+class BatchLongestQueueRouter(BatchScheme):
+    """Like BatchDCTCPRouter, with a queue per priority level. Each port sends
+    from its longest queue."""
+
+    def __init__(self, n_ports, n_prios, q_capacity, mark_threshold,
+                 max_burst=256):
+        super(BatchLongestQueueRouter, self).__init__(n_ports, n_prios, 4096,
+                                                      max_burst)
+        self.q_capacity = q_capacity
+        self.mark_threshold = mark_threshold
+
+    def decide(self, pkts, verdicts, cur_time):
+        ports = pkts['dst'] % self.n_ports()
+        queues = np.minimum(pkts['priority'], self.n_queues() - 1)
+        verdicts['port'] = ports
+        verdicts['queue'] = queues
+
+        flat = ports.astype(np.int64) * self.n_queues() + queues
+        ahead = self.occupancy[ports, queues] + rank_within(flat)
+        dropped = ahead >= self.q_capacity
+        verdicts['action'][dropped] = DROP
+        verdicts['action'][~dropped & (ahead >= self.mark_threshold)] = MARK
+
+    def schedule_batch(self, cur_time):
+        ports = np.flatnonzero(self.eligible)
+        self.sched_queue[ports] = np.argmax(self.occupancy[ports], axis=1)
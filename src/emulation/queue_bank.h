@@ -13,7 +13,9 @@
 #include <stdexcept>
 #include "circular_queue.h"
 #include "queue_bank_log.h"
+#include "packet.h"
 #include "../graph-algo/platform.h"
+#include "../protocol/probes.h"
 
 /**
  * A collection of queues. The queue bank keeps M queues for each of N input
@@ -50,9 +52,11 @@ public:
 	 * Enqueues the element
 	 * @param queue_index: the flat index of the queue
 	 * @param e: the element to enqueue
+	 * @param cur_time: the current time, for queueing delay histograms
 	 * @assumes there is enough space in q
 	 */
-	inline void enqueue(uint32_t port, uint32_t queue, ELEM *e);
+	inline void enqueue(uint32_t port, uint32_t queue, ELEM *e,
+			uint64_t cur_time);
 
 	/**
 	 * Dequeues an element
@@ -100,21 +104,9 @@ public:
 	inline struct queue_bank_stats *get_queue_bank_stats();
 
 	/**
-	 * Get TSO occupancy count
+	 * @returns the number of MTUs in queue, counting each segment by its size
 	 */
-	inline uint16_t get_tso_occupancy(uint32_t port, uint32_t queue);
-
-	/**
-	 * Increment TSO occupancy count
-	 */
-	inline void increment_tso_occupancy(uint32_t port, uint32_t queue,
-			uint16_t amount);
-
-	/**
-	 * Decrement TSO occupancy count
-	 */
-	inline void decrement_tso_occupancy(uint32_t port, uint32_t queue,
-			uint16_t amount);
+	inline uint32_t mtu_occupancy(uint32_t port, uint32_t queue);
 
 private:
 	uint32_t m_n_ports;
@@ -136,10 +128,48 @@ private:
 	/** logging stats */
 	struct queue_bank_stats m_stats;
 
-	/** special occupancy counts used for TSO */
-	std::vector<uint32_t> m_tso_occupancies;
+	/** number of MTUs in each queue */
+	std::vector<uint32_t> m_mtu_occupancies;
+
+#if MAINTAIN_QUEUE_BANK_HISTOGRAMS
+	/** enqueue time of each element, in the same slots as m_queues */
+	std::vector<uint64_t *> m_enqueue_times;
+#endif
 };
 
+/**
+ * The number of MTUs an element of a QueueBank takes on the wire. Packets may
+ * 	be segments of several MTUs.
+ */
+template <typename ELEM >
+inline uint32_t elem_mtus(ELEM *e) {
+	return 1;
+}
+
+template <>
+inline uint32_t elem_mtus<struct emu_packet>(struct emu_packet *e) {
+	return e->n_mtus;
+}
+
+/**
+ * Fires the queue_enqueue or queue_dequeue probe for element @e. Only packets
+ *    carry the fields the probes report.
+ */
+template <typename ELEM >
+inline void elem_probe(ELEM *e, bool enqueue, uint32_t port,
+		uint32_t occupancy) {}
+
+template <>
+inline void elem_probe<struct emu_packet>(struct emu_packet *e, bool enqueue,
+		uint32_t port, uint32_t occupancy) {
+	if (enqueue)
+		FP_PROBE6(queue_enqueue, e->src, e->dst, e->flow, e->id, port,
+				occupancy);
+	else
+		FP_PROBE6(queue_dequeue, e->src, e->dst, e->flow, e->id, port,
+				occupancy);
+}
+
 
 typedef QueueBank<struct emu_packet> PacketQueueBank;
 
@@ -194,8 +224,19 @@ QueueBank<ELEM>::QueueBank(uint32_t n_ports, uint32_t n_queues,
 	memset(&m_stats, 0, sizeof(m_stats));
 
 	for (i = 0; i < (n_ports * n_queues); i++) {
-		m_tso_occupancies.push_back(0);
+		m_mtu_occupancies.push_back(0);
+	}
+
+#if MAINTAIN_QUEUE_BANK_HISTOGRAMS
+	m_enqueue_times.reserve(n_ports * n_queues);
+	for (i = 0; i < (n_ports * n_queues); i++) {
+		uint64_t *times = (uint64_t *) fp_malloc("QueueBankEnqueueTimes",
+				sizeof(uint64_t) * queue_max_size);
+		if (times == NULL)
+			throw std::runtime_error("could not allocate enqueue times");
+		m_enqueue_times.push_back(times);
 	}
+#endif
 }
 
 template <typename ELEM >
@@ -203,6 +244,10 @@ QueueBank<ELEM>::~QueueBank()
 {
 	for (uint32_t i = 0; i < (m_n_ports * m_n_queues); i++)
 		free(m_queues[i]);
+#if MAINTAIN_QUEUE_BANK_HISTOGRAMS
+	for (uint32_t i = 0; i < (m_n_ports * m_n_queues); i++)
+		free(m_enqueue_times[i]);
+#endif
 
 	free(m_non_empty_ports);
 	free(m_non_empty_queues);
@@ -214,7 +259,8 @@ inline uint32_t QueueBank<ELEM>::flat_index(uint32_t port, uint32_t queue) {
 }
 
 template <typename ELEM >
-inline void QueueBank<ELEM>::enqueue(uint32_t port, uint32_t queue, ELEM *e) {
+inline void QueueBank<ELEM>::enqueue(uint32_t port, uint32_t queue, ELEM *e,
+		uint64_t cur_time) {
 	uint32_t flat = flat_index(port, queue);
 
 	/* mark port as non-empty */
@@ -224,9 +270,17 @@ inline void QueueBank<ELEM>::enqueue(uint32_t port, uint32_t queue, ELEM *e) {
 	asm("bts %1,%0" : "+m" (m_non_empty_queues[port]) : "r" (queue));
 
 	/* enqueue */
+#if MAINTAIN_QUEUE_BANK_HISTOGRAMS
+	m_enqueue_times[flat][m_queues[flat]->tail & m_queues[flat]->mask] =
+			cur_time;
+#endif
 	cq_enqueue(m_queues[flat], (void *)e);
+	m_mtu_occupancies[flat] += elem_mtus(e);
 
 	queue_bank_log_enqueue(&m_stats, port);
+	queue_bank_hist_enqueue(&m_stats, port);
+	if (FASTPASS_PROBES)
+		elem_probe(e, true, port, cq_occupancy(m_queues[flat]));
 }
 
 template <typename ELEM >
@@ -236,7 +290,12 @@ inline ELEM *QueueBank<ELEM>::dequeue(uint32_t port, uint32_t queue,
 	uint32_t flat = flat_index(port, queue);
 	ELEM *res;
 
+#if MAINTAIN_QUEUE_BANK_HISTOGRAMS
+	queue_bank_hist_dequeue(&m_stats, port, m_enqueue_times[flat][
+			m_queues[flat]->head & m_queues[flat]->mask], cur_time);
+#endif
 	res = (ELEM *)cq_dequeue(m_queues[flat]);
+	m_mtu_occupancies[flat] -= elem_mtus(res);
 
 	uint64_t queue_empty = cq_empty(m_queues[flat]) & 0x1;
 	m_non_empty_queues[port] ^= (queue_empty << queue);
@@ -245,6 +304,8 @@ inline ELEM *QueueBank<ELEM>::dequeue(uint32_t port, uint32_t queue,
 	m_non_empty_ports[port >> 6] ^= (port_empty << (port & 0x3F));
 
 	queue_bank_log_dequeue(&m_stats, port);
+	if (FASTPASS_PROBES)
+		elem_probe(res, false, port, cq_occupancy(m_queues[flat]));
 
 	/* update last queue empty time if the queue has just become empty. note
 	 * that if dequeue was called, the queue must have been non-empty before */
@@ -297,21 +358,9 @@ inline struct queue_bank_stats *QueueBank<ELEM>::get_queue_bank_stats() {
 }
 
 template <typename ELEM >
-inline uint16_t QueueBank<ELEM>::get_tso_occupancy(uint32_t port,
+inline uint32_t QueueBank<ELEM>::mtu_occupancy(uint32_t port,
 		uint32_t queue) {
-	return m_tso_occupancies[flat_index(port, queue)];
-}
-
-template <typename ELEM >
-inline void QueueBank<ELEM>::increment_tso_occupancy(uint32_t port,
-		uint32_t queue, uint16_t amount) {
-	m_tso_occupancies[flat_index(port, queue)] += amount;
-}
-
-template <typename ELEM >
-inline void QueueBank<ELEM>::decrement_tso_occupancy(uint32_t port,
-		uint32_t queue, uint16_t amount) {
-	m_tso_occupancies[flat_index(port, queue)] -= amount;
+	return m_mtu_occupancies[flat_index(port, queue)];
 }
 
 #endif /* QUEUE_BANK_H_ */
@@ -10,29 +10,158 @@
 
 #include "../protocol/platform/generic.h"
 
+#ifndef MAINTAIN_QUEUE_BANK_LOG_COUNTERS
 #define MAINTAIN_QUEUE_BANK_LOG_COUNTERS	0
+#endif
+#ifndef MAINTAIN_QUEUE_BANK_HISTOGRAMS
+#define MAINTAIN_QUEUE_BANK_HISTOGRAMS		0
+#endif
 #define QUEUE_BANK_MAX_PORTS				64
+#define QUEUE_BANK_HIST_BUCKETS				16
+
+#if MAINTAIN_QUEUE_BANK_HISTOGRAMS && !MAINTAIN_QUEUE_BANK_LOG_COUNTERS
+#error "queue bank histograms are kept with the queue bank log counters"
+#endif
+
+/**
+ * Per-port histograms of a queue bank. Bucket 0 counts zeros, and bucket b
+ * 	counts values in [2^(b-1), 2^b). The last bucket also counts larger values.
+ * @ occupancy_hist: packets already in the port when a packet is enqueued
+ * @ delay_hist: timeslots between enqueue and dequeue of transmitted packets.
+ * 	Packets dropped from the queue are not counted.
+ * @ occupancy: packets currently in the port
+ * @ max_occupancy: max occupancy since the log core last read it
+ * @ max_read: max_occupancy as of the last read
+ * @ max_epoch: the last read the owning core has seen
+ * @ max_epoch_req: written by the log core to read max_occupancy, see
+ * 	queue_bank_stats_request_max()
+ */
+struct queue_bank_histograms {
+	u64		occupancy_hist[QUEUE_BANK_MAX_PORTS][QUEUE_BANK_HIST_BUCKETS];
+	u64		delay_hist[QUEUE_BANK_MAX_PORTS][QUEUE_BANK_HIST_BUCKETS];
+	u32		occupancy[QUEUE_BANK_MAX_PORTS];
+	u32		max_occupancy[QUEUE_BANK_MAX_PORTS];
+	u32		max_read[QUEUE_BANK_MAX_PORTS];
+	u32		max_epoch;
+	u32		max_epoch_req __attribute__((aligned(64)));
+};
 
 /**
  * Queue bank stats at one time - enqueues, dequeues, and drops
+ * @ seq: odd while the owning core updates the counters, see
+ * 	queue_bank_stats_snapshot()
  * @ port_enqueues: number of enqueues that have occurred at each port
  * @ port_dequeues: number of dequeues that have occurred at each port
+ * @ hist: occupancy and delay histograms, if MAINTAIN_QUEUE_BANK_HISTOGRAMS
  */
 struct queue_bank_stats {
+	u32		seq;
 	u64		port_enqueues[QUEUE_BANK_MAX_PORTS];
 	u64		port_dequeues[QUEUE_BANK_MAX_PORTS];
+#if MAINTAIN_QUEUE_BANK_HISTOGRAMS
+	struct queue_bank_histograms hist;
+#endif
 };
 
 /**
  * Port drop stats at one time - drops and marks
+ * @ seq: odd while the owning core updates the counters
  * @ port_drops: number of drops that have occurred at each port
  * @ port_marks: number of marks that have occurred at each port
  */
 struct port_drop_stats {
+	u32		seq;
 	u64		port_drops[QUEUE_BANK_MAX_PORTS];
 	u64		port_marks[QUEUE_BANK_MAX_PORTS];
 };
 
+/*
+ * The core that owns the stats brackets its updates in a timeslot with
+ * write_begin/write_end, so the log core reads counters consistent at a
+ * timeslot boundary without locking. x86 keeps stores in order and loads in
+ * order, so only the compiler needs barriers.
+ */
+static inline __attribute__((always_inline))
+void _stats_seq_write_begin(u32 *seq) {
+	*(volatile u32 *)seq = *seq + 1;
+	asm volatile("" : : : "memory");
+}
+
+static inline __attribute__((always_inline))
+void _stats_seq_write_end(u32 *seq) {
+	asm volatile("" : : : "memory");
+	*(volatile u32 *)seq = *seq + 1;
+}
+
+/* copies @n_bytes of stats at @src that start with a seq, retrying while
+ * the owning core is updating them */
+static inline
+void _stats_seq_snapshot(void *dst, const void *src, size_t n_bytes) {
+	const volatile u32 *seq = (const volatile u32 *) src;
+	u32 start;
+
+	do {
+		while ((start = *seq) & 1)
+			asm volatile("pause");
+		asm volatile("" : : : "memory");
+		memcpy(dst, src, n_bytes);
+		asm volatile("" : : : "memory");
+	} while (*seq != start);
+}
+
+static inline __attribute__((always_inline))
+void queue_bank_stats_write_begin(struct queue_bank_stats *st) {
+	if (MAINTAIN_QUEUE_BANK_LOG_COUNTERS && st != NULL)
+		_stats_seq_write_begin(&st->seq);
+#if MAINTAIN_QUEUE_BANK_HISTOGRAMS
+	/* the log core asked for the max, start a new interval */
+	if (st != NULL && st->hist.max_epoch !=
+			*(volatile u32 *)&st->hist.max_epoch_req) {
+		for (uint32_t i = 0; i < QUEUE_BANK_MAX_PORTS; i++) {
+			st->hist.max_read[i] = st->hist.max_occupancy[i];
+			st->hist.max_occupancy[i] = st->hist.occupancy[i];
+		}
+		st->hist.max_epoch = st->hist.max_epoch_req;
+	}
+#endif
+}
+
+static inline __attribute__((always_inline))
+void queue_bank_stats_write_end(struct queue_bank_stats *st) {
+	if (MAINTAIN_QUEUE_BANK_LOG_COUNTERS && st != NULL)
+		_stats_seq_write_end(&st->seq);
+}
+
+static inline __attribute__((always_inline))
+void port_drop_stats_write_begin(struct port_drop_stats *st) {
+	if (MAINTAIN_QUEUE_BANK_LOG_COUNTERS)
+		_stats_seq_write_begin(&st->seq);
+}
+
+static inline __attribute__((always_inline))
+void port_drop_stats_write_end(struct port_drop_stats *st) {
+	if (MAINTAIN_QUEUE_BANK_LOG_COUNTERS)
+		_stats_seq_write_end(&st->seq);
+}
+
+/**
+ * Copies @st to @copy, consistent at a timeslot boundary of its core
+ */
+static inline
+void queue_bank_stats_snapshot(struct queue_bank_stats *st,
+		struct queue_bank_stats *copy) {
+	_stats_seq_snapshot(copy, st, sizeof(*copy));
+}
+
+/**
+ * Copies @st to @copy, consistent at a timeslot boundary of its core
+ */
+static inline
+void port_drop_stats_snapshot(struct port_drop_stats *st,
+		struct port_drop_stats *copy) {
+	_stats_seq_snapshot(copy, st, sizeof(*copy));
+}
+
 static inline __attribute__((always_inline))
 void queue_bank_log_enqueue(struct queue_bank_stats *st, uint32_t port) {
 	if (MAINTAIN_QUEUE_BANK_LOG_COUNTERS && st != NULL)
@@ -45,68 +174,98 @@ void queue_bank_log_dequeue(struct queue_bank_stats *st, uint32_t port) {
 		st->port_dequeues[port]++;
 }
 
+/**
+ * Returns the histogram bucket of @value
+ */
 static inline __attribute__((always_inline))
-void queue_bank_log_drop(struct port_drop_stats *st, uint32_t port) {
-	if (MAINTAIN_QUEUE_BANK_LOG_COUNTERS)
-		st->port_drops[port]++;
+uint32_t queue_bank_hist_bucket(u64 value) {
+	uint32_t bucket;
+
+	if (value == 0)
+		return 0;
+	bucket = 64 - __builtin_clzll(value);
+	return (bucket < QUEUE_BANK_HIST_BUCKETS) ?
+			bucket : QUEUE_BANK_HIST_BUCKETS - 1;
 }
 
+/**
+ * Records that a packet was enqueued to @port
+ */
 static inline __attribute__((always_inline))
-void queue_bank_log_mark(struct port_drop_stats *st, uint32_t port) {
-	if (MAINTAIN_QUEUE_BANK_LOG_COUNTERS)
-		st->port_marks[port]++;
+void queue_bank_hist_enqueue(struct queue_bank_stats *st, uint32_t port) {
+#if MAINTAIN_QUEUE_BANK_HISTOGRAMS
+	uint32_t occupancy = st->hist.occupancy[port];
+
+	st->hist.occupancy_hist[port][queue_bank_hist_bucket(occupancy)]++;
+	st->hist.occupancy[port] = ++occupancy;
+	if (occupancy > st->hist.max_occupancy[port])
+		st->hist.max_occupancy[port] = occupancy;
+#endif
+}
+
+/**
+ * Records that a packet enqueued at @enqueue_time was dequeued from @port
+ * 	for transmission at @cur_time
+ */
+static inline __attribute__((always_inline))
+void queue_bank_hist_dequeue(struct queue_bank_stats *st, uint32_t port,
+		u64 enqueue_time, u64 cur_time) {
+#if MAINTAIN_QUEUE_BANK_HISTOGRAMS
+	/* endpoints flush their queues with cur_time 0 */
+	u64 delay = (cur_time > enqueue_time) ? cur_time - enqueue_time : 0;
+
+	st->hist.delay_hist[port][queue_bank_hist_bucket(delay)]++;
+	st->hist.occupancy[port]--;
+#endif
+}
+
+/**
+ * Records that a packet was dequeued from @port to be dropped
+ */
+static inline __attribute__((always_inline))
+void queue_bank_hist_drop(struct queue_bank_stats *st, uint32_t port) {
+#if MAINTAIN_QUEUE_BANK_HISTOGRAMS
+	st->hist.occupancy[port]--;
+#endif
 }
 
 /**
- * Print the current contents of the queue bank stats to a specific file.
+ * Asks the owning core for the max occupancy of each port since the previous
+ * 	request. The core answers at its next timeslot boundary; a later
+ * 	snapshot for which queue_bank_stats_max_ready() holds has the maxima in
+ * 	hist.max_read. Sampling this way never stalls the log core.
  */
 static inline
-void print_queue_bank_stats_to_file(FILE *fp, struct queue_bank_stats *st,
-		u64 time_ns)
-{
-	uint32_t port;
-
-	/* Take snapshot so we can print without values changing underneath us */
-	struct queue_bank_stats lst;
-	memcpy(&lst, st, sizeof(lst));
-
-	fprintf(fp, "%llu,enqueues", time_ns);
-	for (port = 0; port < QUEUE_BANK_MAX_PORTS; port++) {
-		fprintf(fp, ",%llu", lst.port_enqueues[port]);
-	}
-	fprintf(fp, "\n%llu,dequeues", time_ns);
-	for (port = 0; port < QUEUE_BANK_MAX_PORTS; port++) {
-		fprintf(fp, ",%llu", lst.port_dequeues[port]);
-	}
-	fprintf(fp, "\n%llu,occupancies", time_ns);
-	for (port = 0; port < QUEUE_BANK_MAX_PORTS; port++) {
-		fprintf(fp, ",%lld", lst.port_enqueues[port] - lst.port_dequeues[port]);
-	}
-	fprintf(fp, "\n");
+void queue_bank_stats_request_max(struct queue_bank_stats *st) {
+#if MAINTAIN_QUEUE_BANK_HISTOGRAMS
+	*(volatile u32 *)&st->hist.max_epoch_req = st->hist.max_epoch_req + 1;
+#endif
 }
 
 /**
- * Print the current contents of the port drop stats to a specific file.
+ * Returns 1 if hist.max_read of snapshot @copy holds the answer to the last
+ * 	request, 0 otherwise
  */
 static inline
-void print_port_drop_stats_to_file(FILE *fp, struct port_drop_stats *pdst,
-		u64 time_ns)
-{
-	uint32_t port;
-
-	/* Take snapshot so we can print without values changing underneath us */
-	struct port_drop_stats lpdst;
-	memcpy(&lpdst, pdst, sizeof(lpdst));
-
-	fprintf(fp, "%llu,drops", time_ns);
-	for (port = 0; port < QUEUE_BANK_MAX_PORTS; port++) {
-		fprintf(fp, ",%llu", lpdst.port_drops[port]);
-	}
-	fprintf(fp, "\n%llu,marks", time_ns);
-	for (port = 0; port < QUEUE_BANK_MAX_PORTS; port++) {
-		fprintf(fp, ",%llu", lpdst.port_marks[port]);
-	}
-	fprintf(fp, "\n");
+int queue_bank_stats_max_ready(struct queue_bank_stats *copy) {
+#if MAINTAIN_QUEUE_BANK_HISTOGRAMS
+	return (copy->hist.max_epoch != 0 &&
+			copy->hist.max_epoch == copy->hist.max_epoch_req);
+#else
+	return 0;
+#endif
+}
+
+static inline __attribute__((always_inline))
+void queue_bank_log_drop(struct port_drop_stats *st, uint32_t port) {
+	if (MAINTAIN_QUEUE_BANK_LOG_COUNTERS)
+		st->port_drops[port]++;
+}
+
+static inline __attribute__((always_inline))
+void queue_bank_log_mark(struct port_drop_stats *st, uint32_t port) {
+	if (MAINTAIN_QUEUE_BANK_LOG_COUNTERS)
+		st->port_marks[port]++;
 }
 
 #endif /* QUEUE_BANK_LOG_H_ */
@@ -19,8 +19,8 @@ DCTCPQueueManager::DCTCPQueueManager(PacketQueueBank *bank,
 void DCTCPQueueManager::enqueue(struct emu_packet *pkt, uint32_t port,
 		uint32_t queue, uint64_t cur_time, Dropper *dropper)
 {
-    uint32_t qlen = m_bank->occupancy(port, queue);
-    if (qlen >= m_dctcp_params.q_capacity) {
+    uint32_t qlen = m_bank->mtu_occupancy(port, queue);
+    if (qlen + pkt->n_mtus > m_dctcp_params.q_capacity) {
         /* no space to enqueue, drop this packet */
         dropper->drop(pkt, port);
         return;
@@ -32,12 +32,12 @@ void DCTCPQueueManager::enqueue(struct emu_packet *pkt, uint32_t port,
         dropper->mark_ecn(pkt, port);
     }
 
-    m_bank->enqueue(port, queue, pkt);
+    m_bank->enqueue(port, queue, pkt, cur_time);
 }
 
 /**
- * All ports of a DCTCPRouter run DCTCP. We don't currently support routers with 
- * different ports running different QMs or schedulers.
+ * All ports of a DCTCPRouter run DCTCP. See DCTCPPrioUplinkRouter for a ToR
+ * whose uplinks run a different QM and scheduler.
  */
 DCTCPRouter::DCTCPRouter(struct dctcp_args *dctcp_params, uint32_t rack_index,
 		struct emu_topo_config *topo_config)
@@ -55,3 +55,32 @@ DCTCPRouter::~DCTCPRouter() {}
 struct queue_bank_stats *DCTCPRouter::get_queue_bank_stats() {
 	return m_bank.get_queue_bank_stats();
 }
+
+/**
+ * Ports to endpoints come first, so they form the DCTCP group and the uplinks
+ * the priority group. Both groups share one bank, with 3 queues per port, of
+ * which DCTCP ports only use the first.
+ */
+DCTCPPrioUplinkRouter::DCTCPPrioUplinkRouter(
+		struct dctcp_prio_uplink_args *args, uint32_t rack_index,
+		struct emu_topo_config *topo_config)
+    : DCTCPPrioUplinkRouterBase(&m_rt,
+    		DCTCPPortGroup(&m_down_cla, &m_down_qm, &m_down_sch),
+    		PriorityByFlowPortGroup(&m_up_cla, &m_up_qm, &m_up_sch),
+    		tor_ports(topo_config), endpoints_per_rack(topo_config)),
+      m_bank(tor_ports(topo_config), 3, DCTCP_QUEUE_CAPACITY),
+      m_rt(topo_config->rack_shift, rack_index,
+    		  endpoints_per_rack(topo_config), tor_uplink_mask(topo_config)),
+      m_down_cla(),
+      m_down_qm(&m_bank, &args->dctcp),
+      m_down_sch(&m_bank),
+      m_up_cla(),
+      m_up_qm(&m_bank, args->uplink_q_capacity),
+      m_up_sch(&m_bank)
+{}
+
+DCTCPPrioUplinkRouter::~DCTCPPrioUplinkRouter() {}
+
+struct queue_bank_stats *DCTCPPrioUplinkRouter::get_queue_bank_stats() {
+	return m_bank.get_queue_bank_stats();
+}
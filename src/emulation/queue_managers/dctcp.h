@@ -16,7 +16,10 @@
 #include "../graph-algo/fp_ring.h"
 #include "routing_tables/TorRoutingTable.h"
 #include "classifiers/SingleQueueClassifier.h"
+#include "classifiers/FlowIDClassifier.h"
 #include "schedulers/SingleQueueScheduler.h"
+#include "schedulers/PriorityScheduler.h"
+#include "queue_managers/drop_tail.h"
 
 #define DCTCP_QUEUE_CAPACITY 4096
 
@@ -25,6 +28,16 @@ struct dctcp_args {
     uint32_t K_threshold;
 };
 
+/**
+ * Arguments of a DCTCPPrioUplinkRouter.
+ * @dctcp: parameters of DCTCP on the downward-facing ports
+ * @uplink_q_capacity: capacity of each priority queue on the uplinks
+ */
+struct dctcp_prio_uplink_args {
+    struct dctcp_args dctcp;
+    uint16_t uplink_q_capacity;
+};
+
 class DCTCPQueueManager : public QueueManager {
 public:
     DCTCPQueueManager(PacketQueueBank *bank, struct dctcp_args *dctcp_params);
@@ -60,4 +73,34 @@ private:
     SingleQueueScheduler m_sch;
 };
 
+typedef PortGroup<SingleQueueClassifier, DCTCPQueueManager, SingleQueueScheduler>
+	DCTCPPortGroup;
+typedef PortGroup<FlowIDClassifier, DropTailQueueManager, PriorityScheduler>
+	PriorityByFlowPortGroup;
+typedef SplitCompositeRouter<TorRoutingTable, DCTCPPortGroup, PriorityByFlowPortGroup>
+	DCTCPPrioUplinkRouterBase;
+
+/**
+ * A ToR that runs DCTCP on its ports to endpoints, and drop tail with
+ * 	priority by flow on its uplinks, so it can be paired with priority core
+ * 	routers.
+ */
+class DCTCPPrioUplinkRouter : public DCTCPPrioUplinkRouterBase {
+public:
+    DCTCPPrioUplinkRouter(struct dctcp_prio_uplink_args *args,
+    		uint32_t rack_index, struct emu_topo_config *topo_config);
+	virtual struct queue_bank_stats *get_queue_bank_stats();
+    virtual ~DCTCPPrioUplinkRouter();
+
+private:
+    PacketQueueBank m_bank;
+    TorRoutingTable m_rt;
+    SingleQueueClassifier m_down_cla;
+    DCTCPQueueManager m_down_qm;
+    SingleQueueScheduler m_down_sch;
+    FlowIDClassifier m_up_cla;
+    DropTailQueueManager m_up_qm;
+    PriorityScheduler m_up_sch;
+};
+
 #endif /* DCTCP_H_ */
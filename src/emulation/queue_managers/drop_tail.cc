@@ -67,6 +67,23 @@ struct queue_bank_stats *PriorityByFlowRouter::get_queue_bank_stats() {
 
 PriorityByFlowRouter::~PriorityByFlowRouter() {}
 
+PriorityByFlowCoreRouter::PriorityByFlowCoreRouter(uint16_t q_capacity,
+		struct emu_topo_config *topo_config)
+	: PriorityByFlowCoreRouterBase(&m_rt, &m_cla, &m_qm, &m_sch,
+			core_router_ports(topo_config)),
+	  m_bank(core_router_ports(topo_config), 3, DROP_TAIL_QUEUE_CAPACITY),
+	  m_rt((1 << topo_config->rack_shift) - 1, num_tors(topo_config)),
+	  m_cla(),
+	  m_qm(&m_bank, q_capacity),
+	  m_sch(&m_bank)
+{}
+
+struct queue_bank_stats *PriorityByFlowCoreRouter::get_queue_bank_stats() {
+	return m_bank.get_queue_bank_stats();
+}
+
+PriorityByFlowCoreRouter::~PriorityByFlowCoreRouter() {}
+
 PriorityBySourceRouter::PriorityBySourceRouter(struct prio_by_src_args *args,
 		uint32_t rack_index, struct emu_topo_config *topo_config)
 	: PriorityBySourceRouterBase(&m_rt, &m_cla, &m_qm, &m_sch,
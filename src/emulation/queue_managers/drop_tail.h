@@ -48,11 +48,11 @@ private:
 inline void DropTailQueueManager::enqueue(struct emu_packet *pkt,
 		uint32_t port, uint32_t queue, uint64_t cur_time, Dropper *dropper)
 {
-	if (m_bank->occupancy(port, queue) >= m_q_capacity) {
+	if (m_bank->mtu_occupancy(port, queue) + pkt->n_mtus > m_q_capacity) {
 		/* no space to enqueue, drop this packet */
 		dropper->drop(pkt, port);
 	} else {
-		m_bank->enqueue(port, queue, pkt);
+		m_bank->enqueue(port, queue, pkt, cur_time);
 	}
 }
 
@@ -118,6 +118,24 @@ private:
     PriorityScheduler m_sch;
 };
 
+typedef CompositeRouter<CoreRoutingTable, FlowIDClassifier, DropTailQueueManager, PriorityScheduler>
+	PriorityByFlowCoreRouterBase;
+
+class PriorityByFlowCoreRouter : public PriorityByFlowCoreRouterBase {
+public:
+    PriorityByFlowCoreRouter(uint16_t q_capacity,
+    		struct emu_topo_config *topo_config);
+	virtual struct queue_bank_stats *get_queue_bank_stats();
+    virtual ~PriorityByFlowCoreRouter();
+
+private:
+    PacketQueueBank m_bank;
+    CoreRoutingTable m_rt;
+    FlowIDClassifier m_cla;
+    DropTailQueueManager m_qm;
+    PriorityScheduler m_sch;
+};
+
 typedef CompositeRouter<TorRoutingTable, BySourceClassifier, DropTailQueueManager, PriorityScheduler>
 	PriorityBySourceRouterBase;
 
@@ -7,7 +7,7 @@
 
 #include "queue_managers/drop_tail_tso.h"
 #include "queue_managers/drop_tail.h"
-#include "schedulers/SingleQueueTSOScheduler.h"
+#include "schedulers/SingleQueueScheduler.h"
 
 DropTailTSOQueueManager::DropTailTSOQueueManager(PacketQueueBank *bank,
 		uint32_t queue_capacity)
@@ -25,7 +25,7 @@ DropTailTSORouter::DropTailTSORouter(uint16_t q_capacity, uint32_t rack_index,
 			  endpoints_per_rack(topo_config), tor_uplink_mask(topo_config)),
 	  m_cla(),
 	  m_qm(&m_bank, q_capacity),
-	  m_sch(&m_bank, tor_ports(topo_config) * 1)
+	  m_sch(&m_bank)
 {}
 
 DropTailTSORouter::~DropTailTSORouter() {}
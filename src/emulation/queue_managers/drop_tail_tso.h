@@ -16,7 +16,7 @@
 #include "drop_tail.h"
 #include "routing_tables/TorRoutingTable.h"
 #include "classifiers/SingleQueueClassifier.h"
-#include "schedulers/SingleQueueTSOScheduler.h"
+#include "schedulers/SingleQueueScheduler.h"
 #include "output.h"
 
 #include <stdexcept>
@@ -38,16 +38,14 @@ private:
 inline void DropTailTSOQueueManager::enqueue(struct emu_packet *pkt,
 		uint32_t port, uint32_t queue, uint64_t cur_time, Dropper *dropper)
 {
-	if (m_bank->get_tso_occupancy(port, queue) + pkt->n_mtus >= m_q_capacity)
+	if (m_bank->mtu_occupancy(port, queue) + pkt->n_mtus > m_q_capacity)
 		dropper->drop(pkt, port);
-	else {
-		m_bank->enqueue(port, queue, pkt);
-		m_bank->increment_tso_occupancy(port, queue, pkt->n_mtus);
-	}
+	else
+		m_bank->enqueue(port, queue, pkt, cur_time);
 }
 
 typedef CompositeRouter<TorRoutingTable, SingleQueueClassifier,
-		DropTailTSOQueueManager, SingleQueueTSOScheduler>
+		DropTailTSOQueueManager, SingleQueueScheduler>
 	DropTailTSORouterBase;
 
 /**
@@ -66,7 +64,7 @@ private:
     TorRoutingTable m_rt;
     SingleQueueClassifier m_cla;
     DropTailTSOQueueManager m_qm;
-    SingleQueueTSOScheduler m_sch;
+    SingleQueueScheduler m_sch;
 };
 
 #endif /* DROP_TAIL_TSO_H_ */
@@ -31,12 +31,11 @@ void PFabricQueueManager::enqueue(struct emu_packet *pkt, uint32_t port,
 		}
 	}
 
-    m_bank->enqueue(port, pkt);
+    m_bank->enqueue(port, pkt, cur_time);
 }
 
 /**
- * All ports of a PFabricRouter run PFabric. We don't currently support routers with
- * different ports running different QMs or schedulers.
+ * All ports of a PFabricRouter run PFabric.
  */
 PFabricRouter::PFabricRouter(struct pfabric_args *pfabric_params,
 		uint32_t rack_index, struct emu_topo_config *topo_config)
@@ -23,8 +23,8 @@ ProbDropQueueManager::ProbDropQueueManager(PacketQueueBank *bank,
 void ProbDropQueueManager::enqueue(struct emu_packet *pkt, uint32_t port,
 		uint32_t queue, uint64_t cur_time, Dropper *dropper)
 {
-    uint32_t qlen = m_bank->occupancy(port, queue);
-    if (qlen >= m_probdrop_params.q_capacity) {
+    uint32_t qlen = m_bank->mtu_occupancy(port, queue);
+    if (qlen + pkt->n_mtus > m_probdrop_params.q_capacity) {
         /* no space to enqueue, drop this packet */
         dropper->drop(pkt, port);
 	return;
@@ -34,13 +34,12 @@ void ProbDropQueueManager::enqueue(struct emu_packet *pkt, uint32_t port,
         // drop this packet
         dropper->drop(pkt, port);
     } else {
-        m_bank->enqueue(port, queue, pkt);
+        m_bank->enqueue(port, queue, pkt, cur_time);
     }
 }
 
 /**
- * All ports of a ProbDropRouter run ProbDrop. We don't currently support routers with 
- * different ports running different QMs or schedulers.
+ * All ports of a ProbDropRouter run ProbDrop.
  */
 ProbDropRouter::ProbDropRouter(struct probdrop_args *probdrop_params,
 		uint32_t rack_index, struct emu_topo_config *topo_config)
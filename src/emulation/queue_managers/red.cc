@@ -38,9 +38,9 @@ REDQueueManager::REDQueueManager(PacketQueueBank *bank,
 
 void REDQueueManager::enqueue(struct emu_packet *pkt, uint32_t port,
 		uint32_t queue, uint64_t cur_time, Dropper *dropper) {
-	uint32_t qlen = m_bank->occupancy(port, queue);
+	uint32_t qlen = m_bank->mtu_occupancy(port, queue);
 	//    printf("RED qlen %d q_avg %d count_since_last %d\n", qlen, q_avg, count_since_last);
-	if (qlen >= m_red_params.q_capacity) {
+	if (qlen + pkt->n_mtus > m_red_params.q_capacity) {
 		/* no space to enqueue, drop this packet */
 		//        printf("REDenq: force drop qlen %d capacity%d\n", qlen, m_red_params.q_capacity);
 		mark_or_drop(pkt, RED_FORCEDROP, port, queue, dropper);
@@ -48,7 +48,7 @@ void REDQueueManager::enqueue(struct emu_packet *pkt, uint32_t port,
 	} else {
 		if (red_rules(pkt, qlen, port, queue, cur_time, dropper) !=
 				RED_DROPPKT) {
-			m_bank->enqueue(port, queue, pkt);
+			m_bank->enqueue(port, queue, pkt, cur_time);
 		}
 	}
 }
@@ -130,8 +130,7 @@ uint8_t REDQueueManager::mark_or_drop(struct emu_packet *pkt, bool force_drop,
 }
 
 /**
- * All ports of a REDRouter run RED. We don't currently support routers with 
- * different ports running different QMs or schedulers.
+ * All ports of a REDRouter run RED.
  */
 REDRouter::REDRouter(struct red_args *red_params, uint32_t rack_index,
 		struct emu_topo_config *topo_config)
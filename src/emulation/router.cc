@@ -22,6 +22,7 @@ Router *RouterFactory::NewRouter(enum RouterType type, void *args,
 {
 	struct drop_tail_args *dt_args;
 	struct prio_by_src_args *prio_args;
+	struct mixed_router_args *mixed_args;
 	void *p_aligned; /* all memory must be aligned to 64-byte cache lines */
 
 	switch (type) {
@@ -62,10 +63,17 @@ Router *RouterFactory::NewRouter(enum RouterType type, void *args,
 	case (R_Prio_by_flow):
 		assert(args != NULL);
 		dt_args = (struct drop_tail_args *) args;
-		p_aligned = fp_malloc("PriorityByFlowRouter",
-				sizeof(class PriorityByFlowRouter));
-		return new (p_aligned) PriorityByFlowRouter(dt_args->q_capacity,
-				router_index, topo_config);
+		if (func == TOR_ROUTER) {
+			p_aligned = fp_malloc("PriorityByFlowRouter",
+					sizeof(class PriorityByFlowRouter));
+			return new (p_aligned) PriorityByFlowRouter(dt_args->q_capacity,
+					router_index, topo_config);
+		} else {
+			p_aligned = fp_malloc("PriorityByFlowCoreRouter",
+					sizeof(class PriorityByFlowCoreRouter));
+			return new (p_aligned) PriorityByFlowCoreRouter(
+					dt_args->q_capacity, topo_config);
+		}
 
 	case (R_RR):
 		assert(args != NULL);
@@ -100,6 +108,26 @@ Router *RouterFactory::NewRouter(enum RouterType type, void *args,
                 p_aligned = fp_malloc("LSTFRouter", sizeof(class LSTFRouter));
                 return new (p_aligned) LSTFRouter((struct lstf_args *) args,
                                 router_index, topo_config);
+
+	case (R_DCTCP_prio_uplinks):
+		assert(args != NULL);
+		p_aligned = fp_malloc("DCTCPPrioUplinkRouter",
+				sizeof(class DCTCPPrioUplinkRouter));
+		return new (p_aligned) DCTCPPrioUplinkRouter(
+				(struct dctcp_prio_uplink_args *) args, router_index,
+				topo_config);
+
+	case (R_Mixed):
+		assert(args != NULL);
+		mixed_args = (struct mixed_router_args *) args;
+		if (mixed_args->tor_type == R_Mixed || mixed_args->core_type == R_Mixed)
+			throw std::runtime_error("mixed routers cannot be nested\n");
+		if (func == TOR_ROUTER)
+			return NewRouter(mixed_args->tor_type, mixed_args->tor_args, func,
+					router_index, topo_config);
+		else
+			return NewRouter(mixed_args->core_type, mixed_args->core_args,
+					func, router_index, topo_config);
 	}
 
 
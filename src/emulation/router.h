@@ -9,13 +9,16 @@
 #define ROUTER_H_
 
 #include <inttypes.h>
+#ifdef __cplusplus
+#include <stdexcept>
+#endif
 
 struct emu_packet;
 struct emu_topo_config;
 
 enum RouterType {
     R_DropTail, R_RED, R_DCTCP, R_Prio, R_RR, R_Prio_by_flow, R_HULL_sched,
-    R_PFabric, R_DropTailTSO, R_LSTF
+    R_PFabric, R_DropTailTSO, R_LSTF, R_DCTCP_prio_uplinks, R_Mixed
 };
 
 enum RouterFunction {
@@ -23,6 +26,18 @@ enum RouterFunction {
 	CORE_ROUTER
 };
 
+/**
+ * Arguments of an R_Mixed router, which is constructed as tor_type with
+ * 	tor_args if it is a ToR, and as core_type with core_args if it is a core
+ * 	router. Neither type may be R_Mixed.
+ */
+struct mixed_router_args {
+	enum RouterType	tor_type;
+	void			*tor_args;
+	enum RouterType	core_type;
+	void			*core_args;
+};
+
 #ifdef __cplusplus
 class Dropper;
 /**
@@ -31,6 +46,7 @@ class Dropper;
  * @pull: dequeue a single packet from port output at this router
  * @push_batch: enqueue a batch of several packets to this router
  * @pull_batch: dequeue a batch of several packets from this router
+ * @set_port_rate: let a port send up to rate packets per timeslot
  */
 class Router {
 public:
@@ -45,6 +61,9 @@ public:
     		uint64_t cur_time, Dropper *dropper) = 0;
     virtual uint32_t pull_batch(struct emu_packet **pkts, uint32_t n_pkts,
     		uint64_t *port_masks, uint64_t cur_time, Dropper *dropper) = 0;
+    virtual void set_port_rate(uint16_t port, uint8_t rate) {
+    	throw std::runtime_error("router does not support port rates");
+    }
 };
 
 /**
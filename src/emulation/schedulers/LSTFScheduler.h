@@ -29,6 +29,14 @@ public:
                         return m_bank->dequeue_least_slack(output_port, cur_time);
         }
 
+        inline uint32_t schedule_burst(uint32_t output_port, uint32_t max_pkts,
+                        struct emu_packet **pkts, uint64_t cur_time,
+                        Dropper *dropper)
+        {
+                return schedule_burst_by_packet(this, output_port, max_pkts,
+                                pkts, cur_time, dropper);
+        }
+
         inline uint64_t *non_empty_port_mask(){
                 return m_bank->non_empty_port_mask();
         }
@@ -26,7 +26,13 @@ public:
 		if (unlikely(m_bank->empty(output_port)))
 			throw std::runtime_error("called schedule on an empty port");
 		else
-			return m_bank->dequeue_highest_priority(output_port);
+			return m_bank->dequeue_highest_priority(output_port, cur_time);
+	}
+
+	inline uint32_t schedule_burst(uint32_t output_port, uint32_t max_pkts,
+			struct emu_packet **pkts, uint64_t cur_time, Dropper *dropper) {
+		return schedule_burst_by_packet(this, output_port, max_pkts, pkts,
+				cur_time, dropper);
 	}
 
 	inline uint64_t *non_empty_port_mask() {
@@ -18,6 +18,8 @@ public:
 	PriorityScheduler(PacketQueueBank *bank);
 	inline struct emu_packet *schedule(uint32_t port, uint64_t cur_time,
 			Dropper *dropper);
+	inline uint32_t schedule_burst(uint32_t port, uint32_t max_pkts,
+			struct emu_packet **pkts, uint64_t cur_time, Dropper *dropper);
 	inline uint64_t *non_empty_port_mask();
 private:
 	PacketQueueBank *m_bank;
@@ -39,6 +41,13 @@ PriorityScheduler::schedule(uint32_t port, uint64_t cur_time, Dropper *dropper)
 	return m_bank->dequeue(port, q_index, cur_time);
 }
 
+inline uint32_t PriorityScheduler::schedule_burst(uint32_t port, uint32_t max_pkts,
+		struct emu_packet **pkts, uint64_t cur_time, Dropper *dropper)
+{
+	return schedule_burst_by_packet(this, port, max_pkts, pkts, cur_time,
+			dropper);
+}
+
 inline uint64_t* PriorityScheduler::non_empty_port_mask() {
 	return m_bank->non_empty_port_mask();
 }
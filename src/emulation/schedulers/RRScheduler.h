@@ -18,6 +18,8 @@ public:
 	RRScheduler(PacketQueueBank *bank, uint32_t n_queues_total);
 	inline struct emu_packet *schedule(uint32_t port, uint64_t cur_time,
 			Dropper *dropper);
+	inline uint32_t schedule_burst(uint32_t port, uint32_t max_pkts,
+			struct emu_packet **pkts, uint64_t cur_time, Dropper *dropper);
 	inline uint64_t *non_empty_port_mask();
 private:
 	PacketQueueBank *m_bank;
@@ -49,6 +51,13 @@ RRScheduler::schedule(uint32_t port, uint64_t cur_time, Dropper *dropper)
 	return m_bank->dequeue(port, m_last_sched_index[port], cur_time);
 }
 
+inline uint32_t RRScheduler::schedule_burst(uint32_t port, uint32_t max_pkts,
+		struct emu_packet **pkts, uint64_t cur_time, Dropper *dropper)
+{
+	return schedule_burst_by_packet(this, port, max_pkts, pkts, cur_time,
+			dropper);
+}
+
 inline uint64_t* RRScheduler::non_empty_port_mask() {
 	return m_bank->non_empty_port_mask();
 }
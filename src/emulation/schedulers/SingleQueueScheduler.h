@@ -30,6 +30,21 @@ public:
 			return m_bank->dequeue(output_port, 0, cur_time);
 	}
 
+	inline uint32_t schedule_burst(uint32_t output_port, uint32_t max_pkts,
+			struct emu_packet **pkts, uint64_t cur_time, Dropper *dropper)
+	{
+		uint32_t n = 0;
+
+		if (unlikely(m_bank->empty(output_port, 0)))
+			throw std::runtime_error("called schedule on an empty port");
+
+		do {
+			pkts[n++] = m_bank->dequeue(output_port, 0, cur_time);
+		} while (n < max_pkts && !m_bank->empty(output_port, 0));
+
+		return n;
+	}
+
 	inline uint64_t *non_empty_port_mask() {
 		return m_bank->non_empty_port_mask();
 	}
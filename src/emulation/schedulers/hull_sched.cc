@@ -44,8 +44,8 @@ struct emu_packet *HULLScheduler::schedule(uint32_t output_port,
 	}
 	m_last_phantom_update_time[output_port] = cur_time;
 
-    /* add to phantom length */
-	m_phantom_len[output_port] += HULL_MTU_SIZE;
+    /* add to phantom length, a segment counts once for each of its MTUs */
+	m_phantom_len[output_port] += HULL_MTU_SIZE * pkt->n_mtus;
 
     if ((uint32_t) m_phantom_len[output_port] > m_hull_params.mark_threshold) {
     	/* Set ECN mark on packet, then enqueue */
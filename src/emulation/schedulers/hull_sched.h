@@ -36,6 +36,12 @@ public:
 	struct emu_packet *schedule(uint32_t output_port, uint64_t cur_time,
 			Dropper *dropper);
 
+	inline uint32_t schedule_burst(uint32_t output_port, uint32_t max_pkts,
+			struct emu_packet **pkts, uint64_t cur_time, Dropper *dropper) {
+		return schedule_burst_by_packet(this, output_port, max_pkts, pkts,
+				cur_time, dropper);
+	}
+
 private:
     struct hull_args m_hull_params;
 
@@ -74,7 +74,7 @@ SimpleTSOEndpointGroup::SimpleTSOEndpointGroup(uint16_t start_id,
   m_bank(endpoints_per_epg(topo_config), 1, q_capacity),
   m_cla(),
   m_qm(&m_bank, q_capacity),
-  m_sch(&m_bank, endpoints_per_epg(topo_config)),
+  m_sch(&m_bank),
   m_sink(start_id >> topo_config->rack_shift, topo_config->rack_shift)
 {}
 
@@ -19,7 +19,6 @@
 #include "queue_managers/drop_tail.h"
 #include "queue_managers/drop_tail_tso.h"
 #include "schedulers/SingleQueueScheduler.h"
-#include "schedulers/SingleQueueTSOScheduler.h"
 #include "schedulers/RateLimitingScheduler.h"
 
 #define SIMPLE_ENDPOINT_QUEUE_CAPACITY 1024
@@ -100,7 +99,7 @@ private:
 
 
 typedef CompositeEndpointGroup<SingleQueueClassifier, DropTailTSOQueueManager,
-		SingleQueueTSOScheduler, SimpleSink>
+		SingleQueueScheduler, SimpleSink>
 	SimpleTSOEndpointGroupBase;
 
 /**
@@ -118,7 +117,7 @@ private:
     EmulationOutput *m_emu_output;
     SingleQueueClassifier m_cla;
     DropTailTSOQueueManager m_qm;
-    SingleQueueTSOScheduler m_sch;
+    SingleQueueScheduler m_sch;
     SimpleSink m_sink;
 };
 
@@ -0,0 +1,110 @@
+/*
+ * credit_link_unittest.cc
+ *
+ *  Created on: October 19, 2026
+ */
+
+#include "emulation.h"
+#include "emulation_container.h"
+#include "emu_topology.h"
+#include "queue_managers/drop_tail.h"
+#include "util/credit_link.h"
+#include "gtest/gtest.h"
+
+/*
+ * Test that a credit link grants as many credits as the ring has room for,
+ * and holds packets, in order, when another producer takes the room first.
+ */
+TEST(CreditLinkTest, credits_and_held_packets) {
+	struct emu_admission_core_statistics stat;
+	struct fp_ring *ring;
+	struct emu_credit_link *cl;
+	struct emu_packet pkts[8];
+	struct emu_packet *in[8];
+	void *out;
+	uint16_t i;
+
+	memset(&stat, 0, sizeof(stat));
+	for (i = 0; i < 8; i++)
+		in[i] = &pkts[i];
+
+	/* a ring of 8 holds 7 packets */
+	ring = fp_ring_create("credit_ring", 8, 0, 0);
+	cl = credit_link_create(ring, 4);
+	EXPECT_EQ(4, credit_link_credits(cl, 4, &stat));
+
+	/* another producer fills 5 slots */
+	for (i = 0; i < 5; i++)
+		ASSERT_EQ(0, fp_ring_enqueue(ring, NULL));
+	ASSERT_EQ(2, credit_link_credits(cl, 4, &stat));
+
+	/* and takes one more before the link sends its 2 packets */
+	ASSERT_EQ(0, fp_ring_enqueue(ring, NULL));
+	EXPECT_EQ(1, credit_link_send(cl, &in[0], 2, &stat));
+	EXPECT_EQ(1, cl->n_held);
+	EXPECT_EQ(0, credit_link_credits(cl, 4, &stat));
+
+	/* the consumer frees 3 slots: the held packet needs one */
+	for (i = 0; i < 3; i++)
+		ASSERT_EQ(0, fp_ring_dequeue(ring, &out));
+	ASSERT_EQ(2, credit_link_credits(cl, 4, &stat));
+	EXPECT_EQ(3, credit_link_send(cl, &in[2], 2, &stat));
+	EXPECT_EQ(0, cl->n_held);
+
+	/* packets arrive in the order they were sent */
+	for (i = 0; i < 3; i++)
+		ASSERT_EQ(0, fp_ring_dequeue(ring, &out));
+	for (i = 0; i < 4; i++) {
+		ASSERT_EQ(0, fp_ring_dequeue(ring, &out));
+		EXPECT_EQ(in[i], out);
+	}
+	EXPECT_TRUE(fp_ring_empty(ring));
+
+	credit_link_free(cl, NULL);
+	free(ring);
+}
+
+/*
+ * Test that backlog that does not fit in the ring to its endpoint group waits
+ * for room and is all admitted, rather than dropped by the emulator.
+ */
+TEST(CreditLinkTest, backlog_larger_than_ring) {
+	struct emu_topo_config topo_config;
+	struct drop_tail_args rtr_args;
+	EmulationContainer *container;
+	struct emu_admitted_traffic *admitted;
+	uint16_t i, j, n_admitted = 0;
+
+	/* initialize emulated topology */
+	topo_config.num_racks = 1;
+	topo_config.rack_shift = 5; /* 32 machines per rack */
+	topo_config.num_core_rtrs = 0;
+	topo_config.uplink_rate = 1;
+	topo_config.host_link_delay = 0;
+	topo_config.uplink_delay = 0;
+
+	/* initialize router arguments */
+	rtr_args.q_capacity = 32;
+
+	/* rings of 64, the smallest a rack of 32 allows */
+	container = new EmulationContainer(ADMITTED_MEMPOOL_SIZE,
+			(1 << ADMITTED_Q_LOG_SIZE), PACKET_MEMPOOL_SIZE, 64, R_DropTail,
+			&rtr_args, E_Simple, NULL, &topo_config);
+
+	/* src, dst, flow, amount, start_id, pointer to additional data */
+	container->add_backlog(1, 2, 0, 100, 0, NULL);
+
+	for (i = 0; i < 120; i++) {
+		container->step();
+		admitted = container->get_admitted();
+		for (j = 0; j < admitted->size; j++) {
+			EXPECT_EQ(0, admitted->edges[j].flags & EMU_FLAGS_DROP);
+			EXPECT_EQ(n_admitted, admitted->edges[j].id);
+			n_admitted++;
+		}
+		container->free_admitted(admitted);
+	}
+	EXPECT_EQ(100, n_admitted);
+
+	delete container;
+}
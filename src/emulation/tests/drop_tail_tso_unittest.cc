@@ -28,6 +28,9 @@ TEST(DropTailTSOTest, one_flow_backlogged) {
 	topo_config.num_racks = 1;
 	topo_config.rack_shift = 5; /* 32 machines per rack */
 	topo_config.num_core_rtrs = 0;
+	topo_config.uplink_rate = 1;
+	topo_config.host_link_delay = 0;
+	topo_config.uplink_delay = 0;
 
 	/* initialize router arguments */
 	rtr_args.q_capacity = 32;
@@ -86,6 +89,9 @@ TEST(DropTailTSOTest, one_flow_on_off) {
 	topo_config.num_racks = 1;
 	topo_config.rack_shift = 5; /* 32 machines per rack */
 	topo_config.num_core_rtrs = 0;
+	topo_config.uplink_rate = 1;
+	topo_config.host_link_delay = 0;
+	topo_config.uplink_delay = 0;
 
 	/* initialize router arguments */
 	rtr_args.q_capacity = 32;
@@ -0,0 +1,99 @@
+/*
+ * link_delay_unittest.cc
+ *
+ *  Created on: October 19, 2026
+ */
+
+#include "emulation.h"
+#include "emulation_container.h"
+#include "emu_topology.h"
+#include "queue_managers/drop_tail.h"
+#include "util/delay_line.h"
+#include "gtest/gtest.h"
+
+/*
+ * Test that a delay line releases packets exactly delay timeslots after they
+ * were sent, and refuses packets when full.
+ */
+TEST(LinkDelayTest, delay_line) {
+	struct emu_delay_line *dl;
+	struct emu_packet pkts[4];
+	struct emu_packet *in[4] = {&pkts[0], &pkts[1], &pkts[2], &pkts[3]};
+	struct emu_packet *out[4];
+
+	/* 2 timeslots of delay, 1 packet per timeslot: room for 4 */
+	dl = delay_line_create(2, 1);
+
+	EXPECT_EQ(1, delay_line_enqueue_burst(dl, &in[0], 1, 10));
+	EXPECT_EQ(0, delay_line_dequeue_due(dl, &out[0], 4, 10));
+	EXPECT_EQ(0, delay_line_dequeue_due(dl, &out[0], 4, 11));
+	EXPECT_EQ(2, delay_line_enqueue_burst(dl, &in[1], 2, 11));
+	ASSERT_EQ(1, delay_line_dequeue_due(dl, &out[0], 4, 12));
+	EXPECT_EQ(&pkts[0], out[0]);
+
+	/* 2 slots are taken, only two more fit */
+	EXPECT_EQ(2, delay_line_enqueue_burst(dl, &in[2], 2, 12));
+	EXPECT_EQ(0, delay_line_enqueue_burst(dl, &in[0], 1, 12));
+
+	ASSERT_EQ(2, delay_line_dequeue_due(dl, &out[0], 4, 13));
+	EXPECT_EQ(&pkts[1], out[0]);
+	EXPECT_EQ(&pkts[2], out[1]);
+	ASSERT_EQ(2, delay_line_dequeue_due(dl, &out[0], 4, 14));
+	EXPECT_EQ(&pkts[2], out[0]);
+	EXPECT_EQ(&pkts[3], out[1]);
+
+	fp_free(dl);
+}
+
+/*
+ * Test that delay on the links between endpoints and the ToR postpones when
+ * packets are admitted, by the delay of both hops.
+ */
+TEST(LinkDelayTest, host_link_delay) {
+	struct emu_topo_config topo_config;
+	struct drop_tail_args rtr_args;
+	EmulationContainer *container;
+	struct emu_admitted_traffic *admitted;
+	uint16_t i, delay, n_empty;
+
+	for (delay = 0; delay <= 3; delay += 3) {
+		/* initialize emulated topology */
+		topo_config.num_racks = 1;
+		topo_config.rack_shift = 5; /* 32 machines per rack */
+		topo_config.num_core_rtrs = 0;
+		topo_config.uplink_rate = 1;
+		topo_config.host_link_delay = delay;
+		topo_config.uplink_delay = 0;
+
+		/* initialize router arguments */
+		rtr_args.q_capacity = 32;
+
+		/* initialize emulation container */
+		container = new EmulationContainer(ADMITTED_MEMPOOL_SIZE,
+				(1 << ADMITTED_Q_LOG_SIZE), PACKET_MEMPOOL_SIZE,
+				(1 << PACKET_Q_LOG_SIZE), R_DropTail, &rtr_args, E_Simple,
+				NULL, &topo_config);
+
+		/* src, dst, flow, amount, start_id, pointer to additional data */
+		container->add_backlog(1, 2, 0, 3, 0, NULL);
+
+		/* three timeslots of hops, plus the delay up and back down */
+		n_empty = 3 + 2 * delay;
+		for (i = 0; i < n_empty; i++) {
+			container->step();
+			admitted = container->get_admitted();
+			EXPECT_EQ(0, admitted->size);
+			container->free_admitted(admitted);
+		}
+
+		for (i = 0; i < 3; i++) {
+			container->step();
+			admitted = container->get_admitted();
+			ASSERT_EQ(1, admitted->size);
+			EXPECT_EQ(i, admitted->edges[0].id);
+			container->free_admitted(admitted);
+		}
+
+		delete container;
+	}
+}
@@ -32,6 +32,9 @@ TEST(LSTFTest, drop_on_full_queue){
         topo_config.num_racks = 1;
         topo_config.rack_shift = 5;
         topo_config.num_core_rtrs = 0;
+        topo_config.uplink_rate = 1;
+        topo_config.host_link_delay = 0;
+        topo_config.uplink_delay = 0;
 
         rtr_args.q_capacity = 2;
 
@@ -0,0 +1,165 @@
+/*
+ * partition_unittest.cc
+ *
+ *  Created on: October 19, 2026
+ */
+
+#include "emulation.h"
+#include "emulation_container.h"
+#include "emu_partition.h"
+#include "emu_topology.h"
+#include "queue_managers/drop_tail.h"
+#include "util/shm_ring.h"
+#include "gtest/gtest.h"
+#include <stdio.h>
+#include <unistd.h>
+
+/*
+ * Send packets over a shared-memory ring and check that they are only visible
+ * to the consumer after the timeslot they were sent in.
+ */
+TEST(PartitionTest, shm_ring_lockstep) {
+	struct emu_shm_ring *tx, *rx;
+	struct emu_packet p_send, p_recv;
+	struct emu_packet *p_recv_ptr = &p_recv;
+	char name[64];
+
+	snprintf(name, sizeof(name), "/fp_emu_test_%d_ring", getpid());
+	tx = shm_ring_create(name, 4);
+	rx = shm_ring_attach(name, 4);
+
+	p_send.src = 3;
+	p_send.dst = 40;
+	p_send.id = 17;
+
+	/* sent in timeslot 0, not ready before timeslot 1 */
+	EXPECT_EQ(0, shm_ring_enqueue(tx, &p_send, 0));
+	EXPECT_EQ(0, shm_ring_ready(rx, 0, 8));
+	shm_ring_publish(tx, 1);
+	EXPECT_EQ(1, shm_ring_published(rx));
+	ASSERT_EQ(1, shm_ring_ready(rx, 1, 8));
+
+	shm_ring_dequeue_bulk(rx, &p_recv_ptr, 1);
+	EXPECT_EQ(3, p_recv.src);
+	EXPECT_EQ(40, p_recv.dst);
+	EXPECT_EQ(17, p_recv.id);
+	EXPECT_EQ(0, shm_ring_ready(rx, 1, 8));
+
+	/* ring holds 4 packets */
+	EXPECT_EQ(0, shm_ring_enqueue(tx, &p_send, 1));
+	EXPECT_EQ(0, shm_ring_enqueue(tx, &p_send, 1));
+	EXPECT_EQ(0, shm_ring_enqueue(tx, &p_send, 1));
+	EXPECT_EQ(0, shm_ring_enqueue(tx, &p_send, 1));
+	EXPECT_EQ(-ENOBUFS, shm_ring_enqueue(tx, &p_send, 1));
+
+	shm_ring_free(rx, name, false);
+	shm_ring_free(tx, name, true);
+}
+
+/*
+ * Split a two-rack topology across two emulations, and check that packets
+ * from a rack in one partition reach an endpoint in the other, in order.
+ */
+TEST(PartitionTest, cross_partition_flow) {
+	struct emu_topo_config topo_config;
+	struct emu_partition_config part_config[2];
+	struct drop_tail_args rtr_args;
+	EmulationContainer *container[2];
+	struct emu_admitted_traffic *admitted;
+	char prefix[64];
+	uint16_t i, j, n_admitted;
+	uint16_t admitted_ids[3];
+
+	/* initialize emulated topology */
+	topo_config.num_racks = 2;
+	topo_config.rack_shift = 5; /* 32 machines per rack */
+	topo_config.num_core_rtrs = 1;
+	topo_config.uplink_rate = 1;
+	topo_config.host_link_delay = 0;
+	topo_config.uplink_delay = 0;
+
+	/* partition 0 runs rack 0 and the core, partition 1 runs rack 1 */
+	snprintf(prefix, sizeof(prefix), "fp_emu_test_%d", getpid());
+	for (i = 0; i < 2; i++) {
+		part_config[i].num_partitions = 2;
+		part_config[i].partition_id = i;
+		part_config[i].shm_prefix = prefix;
+		part_config[i].link_ring_size = EMU_PARTITION_LINK_RING_SIZE;
+	}
+
+	/* initialize router arguments */
+	rtr_args.q_capacity = 32;
+
+	/* initialize emulation containers */
+	for (i = 0; i < 2; i++)
+		container[i] = new EmulationContainer(ADMITTED_MEMPOOL_SIZE,
+				(1 << ADMITTED_Q_LOG_SIZE), PACKET_MEMPOOL_SIZE,
+				(1 << PACKET_Q_LOG_SIZE), R_DropTail, &rtr_args, E_Simple,
+				NULL, &topo_config, &part_config[i]);
+
+	/* src, dst, flow, amount, start_id, pointer to additional data */
+	container[1]->add_backlog(33, 2, 0, 3, 0, NULL);
+
+	/* step the partitions in lockstep */
+	n_admitted = 0;
+	for (i = 0; i < 20; i++) {
+		container[0]->step();
+		admitted = container[0]->get_admitted();
+		ASSERT_TRUE(admitted != NULL);
+		for (j = 0; j < admitted->size; j++) {
+			EXPECT_EQ(33, admitted->edges[j].src);
+			EXPECT_EQ(2, admitted->edges[j].dst);
+			ASSERT_LT(n_admitted, 3);
+			admitted_ids[n_admitted++] = admitted->edges[j].id;
+		}
+		container[0]->free_admitted(admitted);
+
+		container[1]->step();
+		admitted = container[1]->get_admitted();
+		ASSERT_TRUE(admitted != NULL);
+		EXPECT_EQ(0, admitted->size);
+		container[1]->free_admitted(admitted);
+	}
+
+	/* all packets arrived in order */
+	ASSERT_EQ(3, n_admitted);
+	EXPECT_EQ(0, admitted_ids[0]);
+	EXPECT_EQ(1, admitted_ids[1]);
+	EXPECT_EQ(2, admitted_ids[2]);
+
+	delete container[0];
+	delete container[1];
+}
+
+/*
+ * Check that a shared-memory ring smaller than the outbound packet queue is
+ * rejected, since a timeslot's packets might not fit in it.
+ */
+TEST(PartitionTest, small_link_ring) {
+	struct emu_topo_config topo_config;
+	struct emu_partition_config part_config;
+	struct drop_tail_args rtr_args;
+	char prefix[64];
+
+	/* initialize emulated topology */
+	topo_config.num_racks = 2;
+	topo_config.rack_shift = 5; /* 32 machines per rack */
+	topo_config.num_core_rtrs = 1;
+	topo_config.uplink_rate = 1;
+	topo_config.host_link_delay = 0;
+	topo_config.uplink_delay = 0;
+
+	snprintf(prefix, sizeof(prefix), "fp_emu_test_%d_small", getpid());
+	part_config.num_partitions = 2;
+	part_config.partition_id = 1;
+	part_config.shm_prefix = prefix;
+	part_config.link_ring_size = (1 << PACKET_Q_LOG_SIZE) / 2;
+
+	/* initialize router arguments */
+	rtr_args.q_capacity = 32;
+
+	EXPECT_THROW(new EmulationContainer(ADMITTED_MEMPOOL_SIZE,
+			(1 << ADMITTED_Q_LOG_SIZE), PACKET_MEMPOOL_SIZE,
+			(1 << PACKET_Q_LOG_SIZE), R_DropTail, &rtr_args, E_Simple,
+			NULL, &topo_config, &part_config), std::runtime_error);
+}
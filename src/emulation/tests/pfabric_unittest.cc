@@ -30,6 +30,9 @@ TEST(PFabricTest, two_flows) {
 	topo_config.num_racks = 1;
 	topo_config.rack_shift = 5; /* 32 machines per rack */
 	topo_config.num_core_rtrs = 0;
+	topo_config.uplink_rate = 1;
+	topo_config.host_link_delay = 0;
+	topo_config.uplink_delay = 0;
 
 	/* initialize router arguments */
 	rtr_args.q_capacity = PFABRIC_QUEUE_CAPACITY;
@@ -89,6 +92,9 @@ TEST(PFabricTest, drop_on_full_queue) {
 	topo_config.num_racks = 1;
 	topo_config.rack_shift = 5; /* 32 machines per rack */
 	topo_config.num_core_rtrs = 0;
+	topo_config.uplink_rate = 1;
+	topo_config.host_link_delay = 0;
+	topo_config.uplink_delay = 0;
 
 	/* initialize router arguments */
 	rtr_args.q_capacity = 2;
@@ -134,3 +140,37 @@ TEST(PFabricTest, drop_on_full_queue) {
 
 	delete container;
 }
+
+#if defined(PFABRIC)
+/*
+ * Test that backlog cannot be carried in segments of several MTUs, since
+ * pFabric prioritizes each MTU by its own request data.
+ */
+TEST(PFabricTest, no_multi_mtu_segments) {
+	struct emu_topo_config topo_config;
+	struct pfabric_args rtr_args;
+	EmulationContainer *container;
+
+	/* initialize emulated topology */
+	topo_config.num_racks = 1;
+	topo_config.rack_shift = 5; /* 32 machines per rack */
+	topo_config.num_core_rtrs = 0;
+	topo_config.uplink_rate = 1;
+	topo_config.host_link_delay = 0;
+	topo_config.uplink_delay = 0;
+
+	/* initialize router arguments */
+	rtr_args.q_capacity = PFABRIC_QUEUE_CAPACITY;
+
+	/* initialize emulation container */
+	container = new EmulationContainer(ADMITTED_MEMPOOL_SIZE,
+			(1 << ADMITTED_Q_LOG_SIZE), PACKET_MEMPOOL_SIZE,
+			(1 << PACKET_Q_LOG_SIZE), R_PFabric, &rtr_args, E_Simple, NULL,
+			&topo_config);
+
+	EXPECT_THROW(container->set_segment_mtus(2), std::runtime_error);
+	container->set_segment_mtus(1);
+
+	delete container;
+}
+#endif
@@ -0,0 +1,71 @@
+/*
+ * port_rate_unittest.cc
+ *
+ *  Created on: October 19, 2026
+ */
+
+#include "emu_topology.h"
+#include "packet.h"
+#include "queue_managers/drop_tail.h"
+#include "gtest/gtest.h"
+
+/*
+ * Test that an uplink with rate 4 sends up to 4 packets per pull, while a
+ * downlink with the default rate sends one.
+ */
+TEST(PortRateTest, uplink_burst) {
+	struct emu_topo_config topo_config;
+	struct emu_packet pkts[8];
+	struct emu_packet *pulled[16];
+	uint64_t down_mask = 0xFFFFFFFF;
+	uint64_t up_mask = 0xFFFFFFFF00000000;
+	DropTailRouter *rtr;
+	uint16_t i;
+
+	/* initialize emulated topology */
+	topo_config.num_racks = 2;
+	topo_config.rack_shift = 5; /* 32 machines per rack */
+	topo_config.num_core_rtrs = 1;
+	topo_config.uplink_rate = 4;
+	topo_config.host_link_delay = 0;
+	topo_config.uplink_delay = 0;
+
+	rtr = new DropTailRouter(32, 0, &topo_config);
+	for (i = 32; i < 64; i++)
+		rtr->set_port_rate(i, uplink_rate(&topo_config));
+
+	/* 6 packets of one flow to the other rack share an uplink, 2 packets go
+	 * to an endpoint in this rack */
+	for (i = 0; i < 8; i++) {
+		pkts[i].src = 1;
+		pkts[i].dst = (i < 6) ? 40 : 2;
+		pkts[i].flow = 0;
+		pkts[i].id = i;
+		pkts[i].flags = 0;
+		pkts[i].n_mtus = 1;
+		rtr->push(&pkts[i], 0, NULL);
+	}
+
+	/* uplink drains 4, then the remaining 2, in order */
+	ASSERT_EQ(4, rtr->pull_batch(&pulled[0], 16, &up_mask, 1, NULL));
+	for (i = 0; i < 4; i++)
+		EXPECT_EQ(i, pulled[i]->id);
+	ASSERT_EQ(2, rtr->pull_batch(&pulled[0], 16, &up_mask, 2, NULL));
+	EXPECT_EQ(4, pulled[0]->id);
+	EXPECT_EQ(5, pulled[1]->id);
+	EXPECT_EQ(0, rtr->pull_batch(&pulled[0], 16, &up_mask, 3, NULL));
+
+	/* downlink still sends one packet per timeslot */
+	ASSERT_EQ(1, rtr->pull_batch(&pulled[0], 16, &down_mask, 1, NULL));
+	EXPECT_EQ(6, pulled[0]->id);
+	ASSERT_EQ(1, rtr->pull_batch(&pulled[0], 16, &down_mask, 2, NULL));
+	EXPECT_EQ(7, pulled[0]->id);
+
+	/* a burst never exceeds the space the caller provides */
+	for (i = 0; i < 6; i++)
+		rtr->push(&pkts[i], 3, NULL);
+	EXPECT_EQ(3, rtr->pull_batch(&pulled[0], 3, &up_mask, 4, NULL));
+	EXPECT_EQ(3, rtr->pull_batch(&pulled[0], 16, &up_mask, 5, NULL));
+
+	delete rtr;
+}
@@ -0,0 +1,191 @@
+/*
+ * py_batch_router_unittest.cc
+ *
+ *  Created on: October 19, 2026
+ */
+
+#include "output.h"
+#include "packet.h"
+#include "packet_impl.h"
+#include "py_batch_router.h"
+#include "gtest/gtest.h"
+
+#define TEST_N_PORTS	4
+#define TEST_N_QUEUES	2
+
+/**
+ * Stands in for a scheme written in Python: routes by destination, queues by
+ * 	flow, drops flow 7, marks priority 1, and sends from the highest queue.
+ */
+class TestBatchScheme : public PyBatchRouter {
+public:
+	TestBatchScheme(uint32_t queue_max_size, uint32_t max_burst)
+		: PyBatchRouter(TEST_N_PORTS, TEST_N_QUEUES, queue_max_size, max_burst),
+		  n_classify_calls(0), n_schedule_calls(0) {}
+
+	virtual void classify_batch(uint32_t n_pkts, uint64_t cur_time) {
+		struct emu_batch_packet *pkts =
+				(struct emu_batch_packet *) packets_addr();
+		struct emu_batch_verdict *verdicts =
+				(struct emu_batch_verdict *) verdicts_addr();
+		uint32_t i;
+
+		n_classify_calls++;
+		for (i = 0; i < n_pkts; i++) {
+			verdicts[i].port = pkts[i].dst % TEST_N_PORTS;
+			verdicts[i].queue = pkts[i].flow % TEST_N_QUEUES;
+			if (pkts[i].flow == 7)
+				verdicts[i].action |= EMU_BATCH_DROP;
+			if (pkts[i].priority == 1)
+				verdicts[i].action |= EMU_BATCH_MARK;
+			pkts[i].slack = 42;
+		}
+	}
+
+	virtual void schedule_batch(uint64_t cur_time) {
+		uint8_t *eligible = (uint8_t *) eligible_addr();
+		int16_t *sched_queue = (int16_t *) sched_queue_addr();
+		uint32_t *occupancy = (uint32_t *) occupancy_addr();
+		uint32_t port;
+
+		n_schedule_calls++;
+		for (port = 0; port < TEST_N_PORTS; port++) {
+			if (!eligible[port])
+				continue;
+			sched_queue[port] = occupancy[port * TEST_N_QUEUES + 1] > 0 ? 1 : 0;
+		}
+	}
+
+	uint32_t n_classify_calls;
+	uint32_t n_schedule_calls;
+};
+
+class PyBatchRouterTest : public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		memset(&stat, 0, sizeof(stat));
+		admitted_mempool = fp_mempool_create("admitted_mempool", 16,
+				sizeof(struct emu_admitted_traffic), 0, 0, 0);
+		packet_mempool = fp_mempool_create("packet_mempool", 64,
+				EMU_ALIGN(sizeof(struct emu_packet)), 0, 0, 0);
+		q_admitted = fp_ring_create("q_admitted", 16, 0, 0);
+		output = new EmulationOutput(q_admitted, admitted_mempool,
+				packet_mempool, &stat);
+		dropper = new Dropper(*output, &stat);
+	}
+
+	virtual void TearDown() {
+		delete dropper;
+		delete output;
+		free(q_admitted);
+	}
+
+	struct emu_packet *new_packet(uint16_t dst, uint16_t flow, uint16_t id,
+			uint32_t priority) {
+		struct emu_packet *pkt;
+
+		EXPECT_EQ(0, fp_mempool_get(packet_mempool, (void **) &pkt));
+		packet_init(pkt, 0, dst, flow, id, NULL);
+		pkt->priority = priority;
+		return pkt;
+	}
+
+	/* returns the number of packets dropped since the last call */
+	uint32_t count_drops() {
+		struct emu_admitted_traffic *admitted;
+		uint32_t drops = 0;
+
+		output->flush();
+		while (fp_ring_dequeue(q_admitted, (void **) &admitted) == 0) {
+			drops += admitted->dropped;
+			fp_mempool_put(admitted_mempool, admitted);
+		}
+		return drops;
+	}
+
+	struct emu_admission_core_statistics stat;
+	struct fp_mempool *admitted_mempool;
+	struct fp_mempool *packet_mempool;
+	struct fp_ring *q_admitted;
+	EmulationOutput *output;
+	Dropper *dropper;
+};
+
+/*
+ * Test that verdicts of a batch callback are applied: packets are routed,
+ * classified, dropped and marked as decided, and the scheduler's choices are
+ * dequeued.
+ */
+TEST_F(PyBatchRouterTest, applies_verdicts) {
+	TestBatchScheme rtr(16, 4);
+	struct emu_packet *pkts[6];
+	struct emu_packet *pulled[8];
+	uint32_t *occupancy = (uint32_t *) rtr.occupancy_addr();
+	uint64_t all_ports = 0xF;
+	uint64_t port_1 = 0x2;
+
+	pkts[0] = new_packet(1, 0, 0, 0);
+	pkts[1] = new_packet(1, 1, 1, 1);	/* marked */
+	pkts[2] = new_packet(1, 7, 2, 0);	/* dropped */
+	pkts[3] = new_packet(2, 0, 3, 0);
+	pkts[4] = new_packet(6, 1, 4, 0);	/* port 2 */
+	pkts[5] = new_packet(1, 0, 5, 0);
+
+	/* 6 packets are classified in bursts of at most 4 */
+	rtr.push_batch(pkts, 6, 0, dropper);
+	EXPECT_EQ(2, rtr.n_classify_calls);
+	EXPECT_EQ(1, count_drops());
+	EXPECT_EQ(2, occupancy[1 * TEST_N_QUEUES + 0]);
+	EXPECT_EQ(1, occupancy[1 * TEST_N_QUEUES + 1]);
+	EXPECT_EQ(1, occupancy[2 * TEST_N_QUEUES + 0]);
+	EXPECT_EQ(1, occupancy[2 * TEST_N_QUEUES + 1]);
+
+	/* only requested ports send, from the queue the scheduler chose */
+	ASSERT_EQ(1, rtr.pull_batch(pulled, 8, &port_1, 1, dropper));
+	EXPECT_EQ(1, pulled[0]->id);
+	EXPECT_EQ(EMU_FLAGS_ECN_MARK, pulled[0]->flags);
+	EXPECT_EQ(42, pulled[0]->slack);
+	EXPECT_EQ(0, occupancy[1 * TEST_N_QUEUES + 1]);
+	free_packet(pulled[0], packet_mempool);
+
+	ASSERT_EQ(2, rtr.pull_batch(pulled, 8, &all_ports, 2, dropper));
+	EXPECT_EQ(0, pulled[0]->id);
+	EXPECT_EQ(4, pulled[1]->id);
+	free_packet_bulk(pulled, packet_mempool, 2);
+
+	/* the scheduler is not called when no requested port has packets */
+	rtr.n_schedule_calls = 0;
+	ASSERT_EQ(2, rtr.pull_batch(pulled, 8, &all_ports, 3, dropper));
+	EXPECT_EQ(5, pulled[0]->id);
+	EXPECT_EQ(3, pulled[1]->id);
+	free_packet_bulk(pulled, packet_mempool, 2);
+	EXPECT_EQ(0, rtr.pull_batch(pulled, 8, &all_ports, 4, dropper));
+	EXPECT_EQ(1, rtr.n_schedule_calls);
+	EXPECT_EQ(0, count_drops());
+}
+
+/*
+ * Test that packets a callback enqueues to a full queue are dropped rather
+ * than lost.
+ */
+TEST_F(PyBatchRouterTest, drops_when_queue_full) {
+	TestBatchScheme rtr(8, 32);
+	struct emu_packet *pkts[20];
+	struct emu_packet *pulled[1];
+	uint64_t all_ports = 0xF;
+	uint32_t i, n_pulled = 0, drops;
+
+	for (i = 0; i < 20; i++)
+		pkts[i] = new_packet(0, 0, i, 0);
+	rtr.push_batch(pkts, 20, 0, dropper);
+	drops = count_drops();
+	EXPECT_GT(drops, 0);
+
+	/* the packets that fit leave in order */
+	while (rtr.pull_batch(pulled, 1, &all_ports, n_pulled + 1, dropper) == 1) {
+		EXPECT_EQ(n_pulled, pulled[0]->id);
+		free_packet(pulled[0], packet_mempool);
+		n_pulled++;
+	}
+	EXPECT_EQ(20, n_pulled + drops);
+}
@@ -0,0 +1,66 @@
+/*
+ * segment_unittest.cc
+ *
+ *  Created on: October 19, 2026
+ */
+
+#include "emulation.h"
+#include "emulation_container.h"
+#include "emu_topology.h"
+#include "queue_managers/drop_tail.h"
+#include "gtest/gtest.h"
+
+/*
+ * Test that backlog carried in segments is admitted with one edge per MTU,
+ * and that each segment holds its ports for as many timeslots as it has MTUs.
+ */
+TEST(SegmentTest, one_flow_in_segments) {
+	struct emu_topo_config topo_config;
+	struct drop_tail_args rtr_args;
+	EmulationContainer *container;
+	struct emu_admitted_traffic *admitted;
+	uint16_t i, j, n_admitted;
+
+	/* initialize emulated topology */
+	topo_config.num_racks = 1;
+	topo_config.rack_shift = 5; /* 32 machines per rack */
+	topo_config.num_core_rtrs = 0;
+	topo_config.uplink_rate = 1;
+	topo_config.host_link_delay = 0;
+	topo_config.uplink_delay = 0;
+
+	/* initialize router arguments */
+	rtr_args.q_capacity = 32;
+
+	/* initialize emulation container */
+	container = new EmulationContainer(ADMITTED_MEMPOOL_SIZE,
+			(1 << ADMITTED_Q_LOG_SIZE), PACKET_MEMPOOL_SIZE,
+			(1 << PACKET_Q_LOG_SIZE), R_DropTail, &rtr_args, E_Simple, NULL,
+			&topo_config);
+	container->set_segment_mtus(4);
+
+	/* src, dst, flow, amount, start_id, pointer to additional data */
+	container->add_backlog(1, 2, 0, 10, 0, NULL);
+
+	/* segments of 4, 4, and 2 MTUs arrive 4 timeslots apart */
+	n_admitted = 0;
+	for (i = 0; i < 12; i++) {
+		container->step();
+		admitted = container->get_admitted();
+
+		if (i == 3 || i == 7 || i == 11) {
+			ASSERT_EQ((i == 11) ? 2 : 4, admitted->size);
+			for (j = 0; j < admitted->size; j++) {
+				EXPECT_EQ(1, admitted->edges[j].src);
+				EXPECT_EQ(n_admitted++, admitted->edges[j].id);
+			}
+		} else {
+			EXPECT_EQ(0, admitted->size);
+		}
+
+		container->free_admitted(admitted);
+	}
+	EXPECT_EQ(10, n_admitted);
+
+	delete container;
+}
@@ -0,0 +1,178 @@
+/*
+ * split_router_unittest.cc
+ *
+ *  Created on: October 19, 2026
+ */
+
+#include "output.h"
+#include "packet.h"
+#include "packet_impl.h"
+#include "emu_topology.h"
+#include "queue_managers/drop_tail.h"
+#include "queue_managers/dctcp.h"
+#include "gtest/gtest.h"
+
+#define DOWNLINKS_MASK	0x00000000FFFFFFFFULL
+#define UPLINKS_MASK	0xFFFFFFFF00000000ULL
+
+class SplitRouterTest : public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		/* 2 racks of 32 endpoints, so ToRs have uplinks on ports 32..63 */
+		topo_config.num_racks = 2;
+		topo_config.rack_shift = 5;
+		topo_config.num_core_rtrs = 1;
+		topo_config.uplink_rate = 1;
+		topo_config.host_link_delay = 0;
+		topo_config.uplink_delay = 0;
+
+		args.dctcp.q_capacity = 4;
+		args.dctcp.K_threshold = 2;
+		args.uplink_q_capacity = 2;
+
+		memset(&stat, 0, sizeof(stat));
+		admitted_mempool = fp_mempool_create("admitted_mempool", 16,
+				sizeof(struct emu_admitted_traffic), 0, 0, 0);
+		packet_mempool = fp_mempool_create("packet_mempool", 64,
+				EMU_ALIGN(sizeof(struct emu_packet)), 0, 0, 0);
+		q_admitted = fp_ring_create("q_admitted", 16, 0, 0);
+		output = new EmulationOutput(q_admitted, admitted_mempool,
+				packet_mempool, &stat);
+		dropper = new Dropper(*output, &stat);
+	}
+
+	virtual void TearDown() {
+		delete dropper;
+		delete output;
+		free(q_admitted);
+	}
+
+	struct emu_packet *new_packet(uint16_t src, uint16_t dst, uint16_t flow,
+			uint16_t id) {
+		struct emu_packet *pkt;
+
+		EXPECT_EQ(0, fp_mempool_get(packet_mempool, (void **) &pkt));
+		packet_init(pkt, src, dst, flow, id, NULL);
+		return pkt;
+	}
+
+	/* returns the number of packets dropped since the last call */
+	uint32_t count_drops() {
+		struct emu_admitted_traffic *admitted;
+		uint32_t drops = 0;
+
+		output->flush();
+		while (fp_ring_dequeue(q_admitted, (void **) &admitted) == 0) {
+			drops += admitted->dropped;
+			fp_mempool_put(admitted_mempool, admitted);
+		}
+		return drops;
+	}
+
+	struct emu_topo_config topo_config;
+	struct dctcp_prio_uplink_args args;
+	struct emu_admission_core_statistics stat;
+	struct fp_mempool *admitted_mempool;
+	struct fp_mempool *packet_mempool;
+	struct fp_ring *q_admitted;
+	EmulationOutput *output;
+	Dropper *dropper;
+};
+
+/*
+ * Test that ports to endpoints run DCTCP: they mark above the threshold and
+ * drop at capacity.
+ */
+TEST_F(SplitRouterTest, dctcp_on_downlinks) {
+	DCTCPPrioUplinkRouter rtr(&args, 0, &topo_config);
+	struct emu_packet *pkts[6];
+	struct emu_packet *pulled[2];
+	uint64_t masks[1] = { UPLINKS_MASK };
+	uint16_t i;
+
+	for (i = 0; i < 6; i++)
+		pkts[i] = new_packet(40, 3, i % 3, i);
+	rtr.push_batch(pkts, 6, 0, dropper);
+	EXPECT_EQ(2, count_drops());
+
+	/* uplinks have nothing to send */
+	EXPECT_EQ(0, rtr.pull_batch(pulled, 2, masks, 1, dropper));
+
+	/* downlinks send in arrival order, regardless of flow */
+	masks[0] = DOWNLINKS_MASK;
+	for (i = 0; i < 4; i++) {
+		ASSERT_EQ(1, rtr.pull_batch(pulled, 2, masks, i + 1, dropper));
+		EXPECT_EQ(i, pulled[0]->id);
+		EXPECT_EQ(i == 3 ? EMU_FLAGS_ECN_MARK : 0, pulled[0]->flags);
+		free_packet(pulled[0], packet_mempool);
+	}
+	EXPECT_EQ(0, rtr.pull_batch(pulled, 2, masks, 5, dropper));
+}
+
+/*
+ * Test that uplinks run drop tail with priority by flow, and that requests
+ * for one group's ports do not pull from the other group.
+ */
+TEST_F(SplitRouterTest, priority_on_uplinks) {
+	DCTCPPrioUplinkRouter rtr(&args, 0, &topo_config);
+	struct emu_packet *pkts[6];
+	struct emu_packet *pulled[2];
+	uint64_t masks[1] = { DOWNLINKS_MASK };
+	uint16_t expected_ids[4] = {2, 1, 0, 3};
+	uint16_t i;
+
+	/* to rack 1; the sources are chosen so all packets take uplink 40 */
+	pkts[0] = new_packet(18, 40, 2, 0);
+	pkts[1] = new_packet(9, 40, 1, 1);
+	pkts[2] = new_packet(0, 40, 0, 2);
+	pkts[3] = new_packet(18, 40, 2, 3);
+	pkts[4] = new_packet(18, 40, 2, 4);	/* dropped, queue 2 is full */
+	pkts[5] = new_packet(40, 5, 0, 5);	/* to a downlink */
+	rtr.push_batch(pkts, 6, 0, dropper);
+	EXPECT_EQ(1, count_drops());
+
+	ASSERT_EQ(1, rtr.pull_batch(pulled, 2, masks, 1, dropper));
+	EXPECT_EQ(5, pulled[0]->id);
+	free_packet(pulled[0], packet_mempool);
+
+	/* uplinks send the lowest flow first and never mark */
+	masks[0] = UPLINKS_MASK;
+	for (i = 0; i < 4; i++) {
+		ASSERT_EQ(1, rtr.pull_batch(pulled, 2, masks, i + 2, dropper));
+		EXPECT_EQ(expected_ids[i], pulled[0]->id);
+		EXPECT_EQ(0, pulled[0]->flags);
+		free_packet(pulled[0], packet_mempool);
+	}
+	EXPECT_EQ(0, rtr.pull_batch(pulled, 2, masks, 6, dropper));
+}
+
+/*
+ * Test that a mixed router type constructs ToRs and core routers of their
+ * own types.
+ */
+TEST_F(SplitRouterTest, mixed_router_factory) {
+	struct drop_tail_args core_args;
+	struct mixed_router_args mixed_args;
+	Router *tor, *core;
+
+	core_args.q_capacity = 32;
+	mixed_args.tor_type = R_DCTCP_prio_uplinks;
+	mixed_args.tor_args = &args;
+	mixed_args.core_type = R_Prio_by_flow;
+	mixed_args.core_args = &core_args;
+
+	tor = RouterFactory::NewRouter(R_Mixed, &mixed_args, TOR_ROUTER, 1,
+			&topo_config);
+	core = RouterFactory::NewRouter(R_Mixed, &mixed_args, CORE_ROUTER, 0,
+			&topo_config);
+	EXPECT_TRUE(dynamic_cast<DCTCPPrioUplinkRouter *>(tor) != NULL);
+	EXPECT_TRUE(dynamic_cast<PriorityByFlowCoreRouter *>(core) != NULL);
+	tor->~Router();
+	fp_free(tor);
+	core->~Router();
+	fp_free(core);
+
+	mixed_args.core_type = R_Mixed;
+	EXPECT_THROW(RouterFactory::NewRouter(R_Mixed, &mixed_args, CORE_ROUTER,
+			0, &topo_config), std::runtime_error);
+}
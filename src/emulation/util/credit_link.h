@@ -0,0 +1,141 @@
+/*
+ * credit_link.h
+ *
+ *  Created on: October 19, 2026
+ */
+
+#ifndef UTIL_CREDIT_LINK_H_
+#define UTIL_CREDIT_LINK_H_
+
+#include "../admissible_log.h"
+#include "../packet.h"
+#include "../packet_impl.h"
+#include "../graph-algo/fp_ring.h"
+#include "../graph-algo/platform.h"
+#include <assert.h>
+#include <stdexcept>
+#include <string.h>
+
+/**
+ * Credit-based flow control on the link from a driver into a ring, used with
+ * 	EMU_CREDIT_FLOW_CONTROL. Each timeslot the driver has as many credits as
+ * 	the ring has free space, and pulls at most that many packets from its
+ * 	router or endpoint group, so packets wait in the emulated queues instead
+ * 	of being dropped or spun on by the emulator.
+ *
+ * 	On rings with several producers another driver can take the space between
+ * 	counting credits and enqueueing. Packets that do not fit are then held by
+ * 	the link and sent ahead of new packets in the next timeslot. Credits
+ * 	account for held packets, so at most @max_burst packets are ever held.
+ * @ring: the ring the link sends into
+ * @max_burst: the most packets sent on the link in one timeslot
+ * @n_held: packets that did not fit in the ring
+ * @held: the held packets, in the order they were sent
+ */
+struct emu_credit_link {
+	struct fp_ring		*ring;
+	uint32_t			max_burst;
+	uint32_t			n_held;
+	struct emu_packet	*held[0];
+};
+
+/**
+ * Creates a link into @ring for bursts of up to @max_burst packets.
+ */
+static inline
+struct emu_credit_link *credit_link_create(struct fp_ring *ring,
+		uint32_t max_burst)
+{
+	struct emu_credit_link *cl;
+
+	cl = (struct emu_credit_link *) fp_malloc("emu_credit_link",
+			sizeof(struct emu_credit_link) +
+			max_burst * sizeof(struct emu_packet *));
+	if (cl == NULL)
+		throw std::runtime_error("could not allocate credit link");
+
+	cl->ring = ring;
+	cl->max_burst = max_burst;
+	cl->n_held = 0;
+
+	return cl;
+}
+
+/**
+ * Frees a link and returns held packets to the mempool.
+ */
+static inline
+void credit_link_free(struct emu_credit_link *cl,
+		struct fp_mempool *packet_mempool)
+{
+	if (cl->n_held > 0)
+		free_packet_bulk(&cl->held[0], packet_mempool, cl->n_held);
+	fp_free(cl);
+}
+
+/**
+ * Returns the number of packets, at most @max, that may be sent on the link
+ * 	this timeslot.
+ */
+static inline __attribute__((always_inline))
+uint32_t credit_link_credits(struct emu_credit_link *cl, uint32_t max,
+		struct emu_admission_core_statistics *stat)
+{
+	uint32_t space = fp_ring_free_count(cl->ring);
+	uint32_t credits = (space > cl->n_held) ? space - cl->n_held : 0;
+
+	if (max > cl->max_burst - cl->n_held)
+		max = cl->max_burst - cl->n_held;
+	if (credits >= max)
+		return max;
+
+	adm_log_emu_credit_limited(stat);
+	return credits;
+}
+
+/**
+ * Enqueues held packets, then @n @packets, which must not exceed the credits
+ * 	returned by credit_link_credits() in this timeslot. Packets that do not
+ * 	fit are held.
+ * @returns the number of packets enqueued
+ */
+static inline __attribute__((always_inline))
+uint32_t credit_link_send(struct emu_credit_link *cl,
+		struct emu_packet **packets, uint32_t n,
+		struct emu_admission_core_statistics *stat)
+{
+	uint32_t sent = 0;
+	uint32_t n_new;
+
+	assert(cl->n_held + n <= cl->max_burst);
+
+	if (unlikely(cl->n_held > 0)) {
+		sent = fp_ring_enqueue_burst(cl->ring, (void **) &cl->held[0],
+				cl->n_held);
+		cl->n_held -= sent;
+		memmove(&cl->held[0], &cl->held[sent],
+				cl->n_held * sizeof(struct emu_packet *));
+		if (cl->n_held > 0) {
+			/* new packets go behind the ones still held */
+			if (n > 0)
+				memcpy(&cl->held[cl->n_held], packets,
+						n * sizeof(struct emu_packet *));
+			cl->n_held += n;
+			adm_log_emu_credit_held(stat, n);
+			return sent;
+		}
+	}
+
+	n_new = (n > 0) ? fp_ring_enqueue_burst(cl->ring, (void **) packets, n) : 0;
+	if (unlikely(n_new < n)) {
+		/* another producer took the space. hold the rest. */
+		memcpy(&cl->held[0], &packets[n_new],
+				(n - n_new) * sizeof(struct emu_packet *));
+		cl->n_held = n - n_new;
+		adm_log_emu_credit_held(stat, n - n_new);
+	}
+
+	return sent + n_new;
+}
+
+#endif /* UTIL_CREDIT_LINK_H_ */
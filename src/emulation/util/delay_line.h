@@ -0,0 +1,161 @@
+/*
+ * delay_line.h
+ *
+ *  Created on: October 19, 2026
+ */
+
+#ifndef UTIL_DELAY_LINE_H_
+#define UTIL_DELAY_LINE_H_
+
+#include "../packet.h"
+#include "../packet_impl.h"
+#include "../graph-algo/platform.h"
+#include <stdexcept>
+
+/**
+ * A packet in flight on a link.
+ * @due: the timeslot when the packet reaches the end of the link
+ * @packet: the packet
+ */
+struct emu_delay_slot {
+	uint64_t			due;
+	struct emu_packet	*packet;
+};
+
+/**
+ * Holds packets for a fixed number of timeslots, emulating the propagation
+ * 	delay of a link. All packets on a link have the same delay, so they
+ * 	become due in the order they were sent and a FIFO of timestamped
+ * 	pointers is enough. Used by a single driver, so there is no locking.
+ * @delay: timeslots each packet is held
+ * @mask: number of slots minus one
+ * @head: index of the next slot to release
+ * @tail: index of the next slot to fill
+ * @slot: the packets in flight
+ */
+struct emu_delay_line {
+	uint32_t				delay;
+	uint32_t				mask;
+	uint32_t				head;
+	uint32_t				tail;
+	struct emu_delay_slot	slot[0];
+};
+
+/**
+ * Creates a delay line that holds packets for @delay timeslots, with space
+ * 	for @max_per_timeslot packets sent in each of those timeslots.
+ */
+static inline
+struct emu_delay_line *delay_line_create(uint32_t delay,
+		uint32_t max_per_timeslot)
+{
+	struct emu_delay_line *dl;
+	uint32_t count = 1;
+
+	/* round up to a power of two */
+	while (count < max_per_timeslot * (delay + 1))
+		count <<= 1;
+
+	dl = (struct emu_delay_line *) fp_malloc("emu_delay_line",
+			sizeof(struct emu_delay_line) +
+			count * sizeof(struct emu_delay_slot));
+	if (dl == NULL)
+		throw std::runtime_error("could not allocate delay line");
+
+	dl->delay = delay;
+	dl->mask = count - 1;
+	dl->head = 0;
+	dl->tail = 0;
+
+	return dl;
+}
+
+/**
+ * Frees a delay line and returns the packets still in flight to the mempool.
+ */
+static inline
+void delay_line_free(struct emu_delay_line *dl,
+		struct fp_mempool *packet_mempool)
+{
+	for (; dl->head != dl->tail; dl->head++)
+		free_packet(dl->slot[dl->head & dl->mask].packet, packet_mempool);
+	fp_free(dl);
+}
+
+/**
+ * Returns the number of packets that can be put on the link
+ */
+static inline __attribute__((always_inline))
+uint32_t delay_line_space(struct emu_delay_line *dl)
+{
+	return dl->mask + 1 - (dl->tail - dl->head);
+}
+
+/**
+ * Puts @n packets sent in timeslot @cur_time on the link.
+ * @returns the number of packets accepted, the rest did not fit
+ */
+static inline __attribute__((always_inline))
+uint32_t delay_line_enqueue_burst(struct emu_delay_line *dl,
+		struct emu_packet **packets, uint32_t n, uint64_t cur_time)
+{
+	uint32_t i;
+	uint32_t space = delay_line_space(dl);
+
+	if (n > space)
+		n = space;
+
+	for (i = 0; i < n; i++) {
+		dl->slot[(dl->tail + i) & dl->mask].due = cur_time + dl->delay;
+		dl->slot[(dl->tail + i) & dl->mask].packet = packets[i];
+	}
+	dl->tail += n;
+
+	return n;
+}
+
+/**
+ * Takes up to @max packets that are due by timeslot @cur_time off the link.
+ * @returns the number of packets written to @packets
+ */
+static inline __attribute__((always_inline))
+uint32_t delay_line_dequeue_due(struct emu_delay_line *dl,
+		struct emu_packet **packets, uint32_t max, uint64_t cur_time)
+{
+	uint32_t n = 0;
+
+	while (n < max && dl->head != dl->tail &&
+			dl->slot[dl->head & dl->mask].due <= cur_time) {
+		packets[n++] = dl->slot[dl->head & dl->mask].packet;
+		dl->head++;
+	}
+
+	return n;
+}
+
+/**
+ * Sends @n packets onto the link in timeslot @cur_time, then replaces them in
+ * 	@packets with up to @max packets that reach the end of the link now.
+ * 	Packets that do not fit on the link are dropped.
+ * @returns the number of packets written to @packets
+ */
+static inline __attribute__((always_inline))
+uint32_t delay_line_transfer(struct emu_delay_line *dl,
+		struct emu_packet **packets, uint32_t n, uint32_t max,
+		uint64_t cur_time, struct fp_mempool *packet_mempool,
+		struct emu_admission_core_statistics *stat)
+{
+	uint32_t n_accepted;
+
+	n_accepted = delay_line_enqueue_burst(dl, packets, n, cur_time);
+	if (unlikely(n_accepted < n)) {
+		/* no space on the link. log and drop. */
+		adm_log_emu_delay_line_full(stat, n - n_accepted);
+		adm_log_emu_artificial_drop(stat, n - n_accepted);
+		free_packet_bulk(&packets[n_accepted], packet_mempool, n - n_accepted);
+	}
+
+	return delay_line_dequeue_due(dl, packets, max, cur_time);
+}
+
+#endif /* UTIL_DELAY_LINE_H_ */
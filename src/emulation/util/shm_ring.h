@@ -0,0 +1,220 @@
+/*
+ * shm_ring.h
+ *
+ *  Created on: October 19, 2026
+ */
+
+#ifndef UTIL_SHM_RING_H_
+#define UTIL_SHM_RING_H_
+
+#include "../packet.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define EMU_SHM_RING_MAGIC		0x46505348524e4731ULL /* "FPSHRNG1" */
+
+/**
+ * A packet copied into shared memory.
+ * @timeslot: the sender's timeslot when the packet was sent
+ * @packet: the packet contents
+ */
+struct emu_shm_slot {
+	uint64_t			timeslot;
+	struct emu_packet	packet;
+} __attribute__((aligned(64)));
+
+/**
+ * A single-producer single-consumer ring of packets in shared memory, used to
+ * 	carry packets between emulator processes. Packets are copied by value
+ * 	since packet pointers are only valid within one process.
+ * @magic: set by the producer once the ring is initialized
+ * @mask: number of slots minus one
+ * @published: number of timeslots the producer has completed
+ * @tail: index of the next slot to write, written only by the producer
+ * @head: index of the next slot to read, written only by the consumer
+ * @slot: the packet slots
+ */
+struct emu_shm_ring {
+	uint64_t	magic;
+	uint32_t	mask;
+	uint64_t	published __attribute__((aligned(64)));
+	uint32_t	tail __attribute__((aligned(64)));
+	uint32_t	head __attribute__((aligned(64)));
+	struct emu_shm_slot slot[0] __attribute__((aligned(64)));
+};
+
+static inline size_t shm_ring_mem_size(unsigned count)
+{
+	return sizeof(struct emu_shm_ring) + count * sizeof(struct emu_shm_slot);
+}
+
+static inline
+struct emu_shm_ring *shm_ring_map(const char *name, unsigned count, int oflag)
+{
+	int fd;
+	void *mem;
+	size_t size = shm_ring_mem_size(count);
+
+	fd = shm_open(name, oflag, S_IRUSR | S_IWUSR);
+	if (fd < 0)
+		return NULL;
+
+	if ((oflag & O_CREAT) && ftruncate(fd, size) != 0) {
+		close(fd);
+		throw std::runtime_error(std::string("Could not size shm ring name='")
+				+ name + "'");
+	}
+
+	mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (mem == MAP_FAILED)
+		throw std::runtime_error(std::string("Could not map shm ring name='")
+				+ name + "'");
+
+	return (struct emu_shm_ring *) mem;
+}
+
+/**
+ * Creates a shared-memory ring with @count slots (a power of two). Called by
+ * 	the producer. Any stale ring with the same name is reset.
+ */
+static inline
+struct emu_shm_ring *shm_ring_create(const char *name, unsigned count)
+{
+	struct emu_shm_ring *ring;
+
+	if (count == 0 || (count & (count - 1)) != 0)
+		throw std::runtime_error("shm ring size must be a power of two");
+
+	ring = shm_ring_map(name, count, O_CREAT | O_RDWR);
+	if (ring == NULL)
+		throw std::runtime_error(std::string("Could not create shm ring name='")
+				+ name + "'");
+
+	__atomic_store_n(&ring->magic, 0, __ATOMIC_RELEASE);
+	ring->mask = count - 1;
+	ring->published = 0;
+	ring->tail = 0;
+	ring->head = 0;
+	__atomic_store_n(&ring->magic, EMU_SHM_RING_MAGIC, __ATOMIC_RELEASE);
+
+	return ring;
+}
+
+/**
+ * Attaches to a shared-memory ring created by another process. Called by the
+ * 	consumer. Blocks until the producer has created and initialized the ring.
+ */
+static inline
+struct emu_shm_ring *shm_ring_attach(const char *name, unsigned count)
+{
+	struct emu_shm_ring *ring;
+
+	while ((ring = shm_ring_map(name, count, O_RDWR)) == NULL)
+		usleep(1000);
+
+	while (__atomic_load_n(&ring->magic, __ATOMIC_ACQUIRE) != EMU_SHM_RING_MAGIC)
+		usleep(1000);
+
+	if (ring->mask != count - 1)
+		throw std::runtime_error(std::string("shm ring size mismatch name='")
+				+ name + "'");
+
+	return ring;
+}
+
+/**
+ * Unmaps a ring. The producer also removes its name.
+ */
+static inline
+void shm_ring_free(struct emu_shm_ring *ring, const char *name, bool unlink)
+{
+	munmap(ring, shm_ring_mem_size(ring->mask + 1));
+	if (unlink)
+		shm_unlink(name);
+}
+
+/**
+ * Copies @packet into the ring, tagged with @timeslot.
+ * @returns 0 on success, -ENOBUFS if the ring is full
+ */
+static inline
+int shm_ring_enqueue(struct emu_shm_ring *ring, struct emu_packet *packet,
+		uint64_t timeslot)
+{
+	uint32_t tail = ring->tail;
+	struct emu_shm_slot *slot;
+
+	if (tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) > ring->mask)
+		return -ENOBUFS;
+
+	slot = &ring->slot[tail & ring->mask];
+	slot->timeslot = timeslot;
+	memcpy(&slot->packet, packet, sizeof(struct emu_packet));
+	__atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+/**
+ * Returns the number of packets (at most @max) at the head of the ring that
+ * 	were sent before timeslot @before.
+ */
+static inline
+uint32_t shm_ring_ready(struct emu_shm_ring *ring, uint64_t before,
+		uint32_t max)
+{
+	uint32_t head = ring->head;
+	uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+	uint32_t n = 0;
+
+	while (n < max && head + n != tail &&
+			ring->slot[(head + n) & ring->mask].timeslot < before)
+		n++;
+
+	return n;
+}
+
+/**
+ * Copies @n packets from the head of the ring into @packets. The caller must
+ * 	have checked that they are available with shm_ring_ready().
+ */
+static inline
+void shm_ring_dequeue_bulk(struct emu_shm_ring *ring,
+		struct emu_packet **packets, uint32_t n)
+{
+	uint32_t head = ring->head;
+	uint32_t i;
+
+	for (i = 0; i < n; i++)
+		memcpy(packets[i], &ring->slot[(head + i) & ring->mask].packet,
+				sizeof(struct emu_packet));
+
+	__atomic_store_n(&ring->head, head + n, __ATOMIC_RELEASE);
+}
+
+/**
+ * Marks all timeslots before @timeslot as complete at the producer.
+ */
+static inline
+void shm_ring_publish(struct emu_shm_ring *ring, uint64_t timeslot)
+{
+	__atomic_store_n(&ring->published, timeslot, __ATOMIC_RELEASE);
+}
+
+/**
+ * Returns the number of timeslots the producer has completed.
+ */
+static inline
+uint64_t shm_ring_published(struct emu_shm_ring *ring)
+{
+	return __atomic_load_n(&ring->published, __ATOMIC_ACQUIRE);
+}
+
+#endif /* UTIL_SHM_RING_H_ */
@@ -9,11 +9,20 @@
 #define GRANT_ACCEPT_H_
 
 #include <stdint.h>
+#include <string.h>
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
 #include "../protocol/topology.h"
+#include "../graph-algo/random.h"
 #include "partitioning.h"
 
 #define GA_MAX_DEGREE			256
 
+/* bitmaps with a bit for every node, in 64 bit words */
+#define GA_BITMAP_WORDS			((MAX_NODES + 63) / 64)
+#define GA_NO_NEIGH				0xFFFF
+
 struct ga_edge {
 	uint16_t src;
 	uint16_t dst;
@@ -74,6 +83,102 @@ void ga_adj_delete_neigh(struct ga_adj *adj, uint16_t node_index,
 	adj->neigh[node_index][neigh_index] = adj->neigh[node_index][last_ind];
 }
 
+/**
+ * A bit matrix for one partition of the graph: for each node in the partition,
+ *   a bitmap of its neighbors.
+ */
+struct ga_bitmatrix {
+	uint64_t	row[PARTITION_N_NODES][GA_BITMAP_WORDS];
+} __attribute__((aligned(64))) /* don't want sharing between cores */;
+
+/**
+ * Erases all edges from the bit matrix
+ */
+static inline
+void ga_reset_bitmatrix(struct ga_bitmatrix *m) {
+	memset(&m->row[0][0], 0, sizeof(m->row));
+}
+
+/**
+ * Adds neighbor 'neigh' to the node at node_index
+ */
+static inline __attribute__((always_inline))
+void ga_bitmatrix_set(struct ga_bitmatrix *m, uint16_t node_index,
+		uint16_t neigh)
+{
+	m->row[node_index][neigh >> 6] |= (1ULL << (neigh & 63));
+}
+
+/**
+ * Removes neighbor 'neigh' from the node at node_index
+ */
+static inline __attribute__((always_inline))
+void ga_bitmatrix_clear(struct ga_bitmatrix *m, uint16_t node_index,
+		uint16_t neigh)
+{
+	m->row[node_index][neigh >> 6] &= ~(1ULL << (neigh & 63));
+}
+
+/**
+ * Returns true if the node at node_index has no neighbors
+ */
+static inline __attribute__((always_inline))
+bool ga_bitmatrix_row_empty(struct ga_bitmatrix *m, uint16_t node_index)
+{
+	uint64_t any = 0;
+	uint16_t w;
+	for (w = 0; w < GA_BITMAP_WORDS; w++)
+		any |= m->row[node_index][w];
+	return (any == 0);
+}
+
+/**
+ * Returns the index of the 'rank'th set bit of 'word' (rank 0 is the lsb).
+ *   'word' must have more than 'rank' bits set.
+ */
+static inline __attribute__((always_inline))
+uint16_t ga_select_bit(uint64_t word, uint32_t rank)
+{
+#ifdef __BMI2__
+	return __builtin_ctzll(_pdep_u64(1ULL << rank, word));
+#else
+	while (rank--)
+		word &= word - 1;
+	return __builtin_ctzll(word);
+#endif
+}
+
+/**
+ * Picks a bit that is set in 'bitmap' but not in 'exclude', uniformly at
+ *    random. A word at a time: for MAX_NODES of 256 the bitmaps are 4 words,
+ *    which stay in registers.
+ * Returns the index of the bit, or GA_NO_NEIGH if there is no such bit.
+ */
+static inline __attribute__((always_inline))
+uint16_t ga_bitmap_random_bit(const uint64_t *bitmap, const uint64_t *exclude,
+		u32 *rand_state)
+{
+	uint64_t cand[GA_BITMAP_WORDS];
+	uint16_t count[GA_BITMAP_WORDS];
+	uint32_t total = 0;
+	uint32_t rank;
+	uint16_t w;
+
+	for (w = 0; w < GA_BITMAP_WORDS; w++) {
+		cand[w] = bitmap[w] & ~exclude[w];
+		count[w] = __builtin_popcountll(cand[w]);
+		total += count[w];
+	}
+	if (total == 0)
+		return GA_NO_NEIGH;
+
+	rank = random_int(rand_state, total);
+	for (w = 0; rank >= count[w]; w++)
+		rank -= count[w];
+
+	return (w << 6) + ga_select_bit(cand[w], rank);
+}
+
 /**
  * Prints an adjacency list to stdout for debugging
  */
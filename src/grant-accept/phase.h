@@ -10,51 +10,51 @@
 
 #include "partitioning.h"
 #include "../graph-algo/admissible_algo_log.h"
-#include "../graph-algo/fp_ring.h"
+#include "../graph-algo/rdtsc.h"
 
 #define NONE_READY     N_PARTITIONS
 
+#if (N_PARTITIONS > 64)
+#error "phase state keeps a 64 bit mask of partitions"
+#endif
+
+/**
+ *  The number of phases a partition has finished. Written only by the
+ *  partition's core and polled by the others, so it is alone on its cache
+ *  line.
+ */
+struct partition_epoch {
+        volatile uint32_t epoch;
+} __attribute__((aligned(64)));
+
 /**
- *  Tracks what phase a partition is in and which
- *  partitions are ready to be processed by it
+ *  Per partition state that only the partition's core touches: the
+ *  partitions whose output of the current phase it has not processed yet,
+ *  and when it started waiting for them.
  */
 struct partition_phase_state {
-        struct fp_ring *q_ready;
-        uint16_t phase;
+        uint64_t pending;
+        uint64_t wait_start;
 } __attribute__((aligned(64)));
 
 /**
  *  Tracks phase state for each partition
  */
 struct phase_state {
+        struct partition_epoch epochs[N_PARTITIONS];
         struct partition_phase_state partitions[N_PARTITIONS];
 };
 
-static inline
-uint64_t create_queue_entry(uint16_t phase, uint16_t partition_index) {
-        return (((uint64_t) phase) << 16) | partition_index;
-}
-
-static inline
-uint16_t get_phase_from_queue_entry(uint64_t queue_entry) {
-        return queue_entry >> 16;
-}
-
-static inline
-uint16_t get_partition_from_queue_entry(uint64_t queue_entry) {
-        return queue_entry & 0xFFFF;
-}
-
 /**
  * Initialize a phase_state structure
  */
 static inline
-void phase_state_init(struct phase_state *phase,
-                     struct fp_ring **q_ready) {
+void phase_state_init(struct phase_state *phase) {
         uint16_t i;
         for (i = 0; i < N_PARTITIONS; i++) {
-                phase->partitions[i].q_ready = q_ready[i];
-                phase->partitions[i].phase = 0;
+                phase->epochs[i].epoch = 0;
+                phase->partitions[i].pending = 0;
+                phase->partitions[i].wait_start = 0;
         }
 }
 
@@ -65,49 +65,54 @@ static inline
 void phase_finished(struct phase_state *phase_state,
                     uint16_t partition_index,
                     struct admission_core_statistics *stat) {
+        struct partition_phase_state *mine = &phase_state->partitions[partition_index];
         adm_log_phase_finished(stat);
 
-        uint16_t phase = ++phase_state->partitions[partition_index].phase;
-        uint64_t queue_entry = create_queue_entry(phase, partition_index);
+        /* wait for all other partitions to finish this phase */
+        mine->pending = ((N_PARTITIONS == 64) ? ~0ULL : ((1ULL << N_PARTITIONS) - 1))
+                        & ~(1ULL << partition_index);
+        if (MAINTAIN_ADM_LOG_COUNTERS)
+                mine->wait_start = current_time();
 
-        /* for each other partition, enqueue an entry */
-        uint16_t i, partition;
-        for (i = 1; i < N_PARTITIONS; i++) {
-                partition = (partition_index + i) % N_PARTITIONS;
-                fp_ring_enqueue(phase_state->partitions[partition].q_ready,
-                                (void *) queue_entry);
-        }
+        /* output of this phase must be visible before the new epoch. x86
+         * does not reorder stores, so only the compiler needs a barrier */
+        asm volatile("" : : : "memory");
+        phase_state->epochs[partition_index].epoch++;
 }
 
 /**
- * Returns another partition that has finished the previous phase
- * or NONE_READY if none are done
+ * Returns another partition that has finished the current phase, and whose
+ * output this partition has not processed yet, or NONE_READY if none are
+ * done. Epochs of partitions are at most one phase apart, since every
+ * partition waits for all others before finishing its next phase.
  */
 static inline
 uint16_t phase_get_finished_partition(struct phase_state *phase_state,
                                       uint16_t partition_index,
                                       struct admission_core_statistics *stat) {
-        uint64_t queue_entry;
-        int ret = fp_ring_dequeue(phase_state->partitions[partition_index].q_ready,
-                                  (void *) &queue_entry);
-
-        if (ret == -ENOENT) {
-                adm_log_phase_none_ready(stat);
-                return NONE_READY;
-        }
-
-        uint16_t entry_phase = get_phase_from_queue_entry(queue_entry);
-        uint16_t my_phase = phase_state->partitions[partition_index].phase;
-        if (entry_phase != my_phase) {
-                /* this phase is out of order.
-                   re-enqueue the entry and return NONE_READY */
-                fp_ring_enqueue(phase_state->partitions[partition_index].q_ready,
-                                (void *) queue_entry);
-                adm_log_phase_out_of_order(stat);
-                return NONE_READY;
+        struct partition_phase_state *mine = &phase_state->partitions[partition_index];
+        uint32_t my_epoch = phase_state->epochs[partition_index].epoch;
+        uint64_t pending = mine->pending;
+        uint16_t partition;
+
+        while (pending) {
+                partition = __builtin_ctzll(pending);
+                pending &= pending - 1;
+
+                if ((int32_t) (phase_state->epochs[partition].epoch - my_epoch) < 0)
+                        continue; /* not done with this phase yet */
+
+                /* read the partition's output only after seeing its epoch */
+                asm volatile("" : : : "memory");
+                mine->pending &= ~(1ULL << partition);
+                if (mine->pending == 0)
+                        adm_log_phase_wait(stat, my_epoch,
+                                           current_time() - mine->wait_start);
+                return partition;
         }
 
-        return get_partition_from_queue_entry(queue_entry);
+        adm_log_phase_none_ready(stat);
+        return NONE_READY;
 }
 
 #endif /* PHASE_H_ */
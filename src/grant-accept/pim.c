@@ -8,55 +8,200 @@
 #include "pim.h"
 
 #include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "phase.h"
 #include "../graph-algo/random.h"
 
-#define MAX_TRIES 10
 #define RING_DEQUEUE_BURST_SIZE		8
+#define MAX_BIN_BACKLOG			0xFFFF /* backlog_edge holds 16 bits */
+
+/* an empty bitmap, to exclude no nodes */
+static const uint64_t no_nodes[GA_BITMAP_WORDS];
 
 /**
- * Return true if the src is already allocated, false otherwise.
+ * Mark the src as allocated.
  */
 static inline __attribute__((always_inline))
-bool src_is_allocated(struct pim_core_state *core, uint16_t src) {
+void mark_src_allocated(struct pim_core_state *core, uint16_t src) {
         uint16_t src_index = PARTITION_IDX(src);
-        return ((core->src_endnodes[PIM_BITMASK_WORD(src_index)] >>
-                 PIM_BITMASK_SHIFT(src_index)) & 0x1);
+        core->src_endnodes[PIM_BITMASK_WORD(src_index)] |=
+                (1ULL << PIM_BITMASK_SHIFT(src_index));
 }
 
 /**
- * Return true if the dst is already allocated, false otherwise.
+ * Mark the dst as allocated.
  */
 static inline __attribute__((always_inline))
-bool dst_is_allocated(struct pim_state *state, uint16_t dst) {
-        /* this function may be called by a different core than
-         * the core of dst */
-        struct pim_core_state *core = &state->cores[PARTITION_OF(dst)];
-
+void mark_dst_allocated(struct pim_core_state *core, uint16_t dst) {
         uint16_t dst_index = PARTITION_IDX(dst);
-        return ((core->dst_endnodes[PIM_BITMASK_WORD(dst_index)] >>
-                 PIM_BITMASK_SHIFT(dst_index)) & 0x1);
+        core->dst_endnodes[PIM_BITMASK_WORD(dst_index)]
+                |= (1ULL << PIM_BITMASK_SHIFT(dst_index));
 }
 
 /**
- * Mark the src as allocated.
+ * Fills 'dst_alloc' with a bitmap of the dsts allocated so far in this
+ *    timeslot, over all partitions. Reads the bitmasks of other cores.
  */
 static inline __attribute__((always_inline))
-void mark_src_allocated(struct pim_core_state *core, uint16_t src) {
+void get_allocated_dsts(struct pim_state *state, uint64_t *dst_alloc) {
+        uint16_t partition, w;
+        for (partition = 0; partition < N_PARTITIONS; partition++)
+                for (w = 0; w < PIM_PARTITION_WORDS; w++)
+                        dst_alloc[partition * PIM_PARTITION_WORDS + w] =
+                                state->cores[partition].dst_endnodes[w];
+}
+
+/**
+ * Returns the number of requests in 'row' to destinations below dst, which is
+ *    where the backlog to dst is kept.
+ */
+static inline __attribute__((always_inline))
+uint16_t request_rank(const uint64_t *row, uint16_t dst) {
+        uint16_t w, rank = 0;
+        for (w = 0; w < (dst >> 6); w++)
+                rank += __builtin_popcountll(row[w]);
+        return rank + __builtin_popcountll(row[w] & ((1ULL << (dst & 63)) - 1));
+}
+
+/**
+ * Returns true if src_index has a request to dst
+ */
+static inline __attribute__((always_inline))
+bool has_request(struct pim_requests *requests, uint16_t src_index,
+                 uint16_t dst) {
+        return (requests->bits.row[src_index][dst >> 6] >> (dst & 63)) & 0x1;
+}
+
+/**
+ * Doubles the room for backlogs of a src, which has as many requests as fit
+ */
+static void grow_src_backlog(struct pim_src_backlog *backlog) {
+        uint32_t *count = fp_malloc("pim_src_backlog",
+                                    2 * backlog->capacity * sizeof(uint32_t));
+        if (count == NULL) {
+                printf("ERROR: could not allocate backlogs for %u requests\n",
+                       2 * backlog->capacity);
+                exit(-1);
+        }
+
+        memcpy(count, backlog->count, backlog->n * sizeof(uint32_t));
+        if (backlog->count != backlog->inline_count)
+                fp_free(backlog->count);
+        backlog->count = count;
+        backlog->capacity *= 2;
+}
+
+/**
+ * Add 'amount' to the request from src to dst. Called by the src's core.
+ */
+static inline __attribute__((always_inline))
+void add_request(struct pim_state *state, uint16_t partition_index,
+                 uint16_t src, uint16_t dst, uint32_t amount) {
+        struct pim_requests *requests = &state->requests_by_src[partition_index];
+        struct pim_core_state *core = &state->cores[partition_index];
         uint16_t src_index = PARTITION_IDX(src);
-        core->src_endnodes[PIM_BITMASK_WORD(src_index)] |=
-                (0x1 << PIM_BITMASK_SHIFT(src_index));
+        struct pim_src_backlog *backlog = &requests->backlog[src_index];
+        uint16_t rank = request_rank(requests->bits.row[src_index], dst);
+
+        if (!has_request(requests, src_index, dst)) {
+                /* make room for the new backlog at its rank */
+                if (unlikely(backlog->n == backlog->capacity))
+                        grow_src_backlog(backlog);
+                memmove(&backlog->count[rank + 1], &backlog->count[rank],
+                        (backlog->n - rank) * sizeof(uint32_t));
+                backlog->count[rank] = 0;
+                backlog->n++;
+
+                ga_bitmatrix_set(&requests->bits, src_index, dst);
+                core->src_has_requests[PIM_BITMASK_WORD(src_index)] |=
+                        (1ULL << PIM_BITMASK_SHIFT(src_index));
+        }
+        backlog->count[rank] += amount;
 }
 
 /**
- * Mark the dst as allocated.
+ * Take one timeslot off the request from src to dst, which was just allocated.
+ * Returns the remaining backlog.
  */
 static inline __attribute__((always_inline))
-void mark_dst_allocated(struct pim_core_state *core, uint16_t dst) {
-        uint16_t dst_index = PARTITION_IDX(dst);
-        core->dst_endnodes[PIM_BITMASK_WORD(dst_index)]
-                |= (0x1 << PIM_BITMASK_SHIFT(dst_index));
+uint32_t decrease_request(struct pim_state *state, uint16_t partition_index,
+                          uint16_t src, uint16_t dst) {
+        struct pim_requests *requests = &state->requests_by_src[partition_index];
+        struct pim_core_state *core = &state->cores[partition_index];
+        uint16_t src_index = PARTITION_IDX(src);
+        struct pim_src_backlog *src_backlog = &requests->backlog[src_index];
+        uint16_t rank = request_rank(requests->bits.row[src_index], dst);
+
+        assert(has_request(requests, src_index, dst));
+        assert(src_backlog->count[rank] != 0);
+        uint32_t backlog = --src_backlog->count[rank];
+        if (backlog != 0)
+                return backlog;
+
+        /* no more backlog, delete the edge from requests */
+        memmove(&src_backlog->count[rank], &src_backlog->count[rank + 1],
+                (src_backlog->n - rank - 1) * sizeof(uint32_t));
+        src_backlog->n--;
+        ga_bitmatrix_clear(&requests->bits, src_index, dst);
+        if (src_backlog->n == 0)
+                core->src_has_requests[PIM_BITMASK_WORD(src_index)] &=
+                        ~(1ULL << PIM_BITMASK_SHIFT(src_index));
+        return 0;
+}
+
+/**
+ * Return true if src was reset and its requests were not purged yet
+ */
+static inline __attribute__((always_inline))
+bool src_reset_pending(struct pim_core_state *core, uint16_t src_index) {
+        return (core->src_reset_pending[PIM_BITMASK_WORD(src_index)] >>
+                PIM_BITMASK_SHIFT(src_index)) & 0x1;
+}
+
+/**
+ * Delete all requests of a src that was reset. Work is in the size of the
+ *    src's row of requests.
+ */
+static inline __attribute__((always_inline))
+void purge_sender(struct pim_state *state, uint16_t partition_index,
+                  uint16_t src_index) {
+        struct pim_requests *requests = &state->requests_by_src[partition_index];
+        struct pim_core_state *core = &state->cores[partition_index];
+        uint32_t n_requests = requests->backlog[src_index].n;
+
+        /* the backlogs are only read at the ranks of set bits */
+        memset(requests->bits.row[src_index], 0,
+               GA_BITMAP_WORDS * sizeof(uint64_t));
+        requests->backlog[src_index].n = 0;
+
+        core->src_has_requests[PIM_BITMASK_WORD(src_index)] &=
+                ~(1ULL << PIM_BITMASK_SHIFT(src_index));
+        core->src_reset_pending[PIM_BITMASK_WORD(src_index)] &=
+                ~(1ULL << PIM_BITMASK_SHIFT(src_index));
+        adm_log_reset_sender_purged(&core->stat, n_requests);
+}
+
+/**
+ * Purge up to 'max_senders' srcs that were reset, to bound the work done in
+ *    one timeslot when many senders reset at once.
+ */
+static inline __attribute__((always_inline))
+void purge_reset_senders(struct pim_state *state, uint16_t partition_index,
+                         uint16_t max_senders) {
+        struct pim_core_state *core = &state->cores[partition_index];
+        uint16_t w;
+
+        for (w = 0; w < PIM_PARTITION_WORDS; w++) {
+                while (core->src_reset_pending[w]) {
+                        if (max_senders-- == 0)
+                                return;
+                        purge_sender(state, partition_index,
+                                     (w << 6) + __builtin_ctzll(core->src_reset_pending[w]));
+                }
+        }
 }
 
 /**
@@ -97,18 +242,25 @@ void pim_flush_backlog(struct pim_state *state) {
  */
 void pim_add_backlog(struct pim_state *state, uint16_t src, uint16_t dst,
                      uint32_t amount) {
-        if (backlog_increase(&state->backlog, src, dst, amount,
-                             &state->stat) == false)
-                return; /* no need to enqueue */
-
-        /* add to state->new_demands for the src partition
-         * leave the 'metric' unused */
         uint16_t partition_index = PARTITION_OF(src);
-        enqueue_bin(state->new_demands[partition_index], src, dst, 0);
-
-        if (bin_size(state->new_demands[partition_index]) == SMALL_BIN_SIZE) {
-                adm_log_backlog_flush_bin_full(&state->stat);
-                _flush_backlog_now(state, partition_index);
+        uint32_t part;
+
+        /* the allocator keeps the backlog of each request, so every increase
+         * is passed on to it */
+        adm_log_increased_backlog_to_queue(&state->stat, amount, amount);
+
+        while (amount > 0) {
+                /* add to state->new_demands for the src partition
+                 * leave the 'metric' unused */
+                part = (amount > MAX_BIN_BACKLOG) ? MAX_BIN_BACKLOG : amount;
+                enqueue_bin(state->new_demands[partition_index], src, dst,
+                            part, 0);
+                amount -= part;
+
+                if (bin_size(state->new_demands[partition_index]) == SMALL_BIN_SIZE) {
+                        adm_log_backlog_flush_bin_full(&state->stat);
+                        _flush_backlog_now(state, partition_index);
+                }
         }
 }
 
@@ -116,7 +268,18 @@ void pim_add_backlog(struct pim_state *state, uint16_t src, uint16_t dst,
  * Reset state of all flows for which src is the sender
  */
 void pim_reset_sender(struct pim_state *state, uint16_t src) {
-	/* TODO: implement this */
+        uint16_t partition_index = PARTITION_OF(src);
+
+        /* demands are never empty, so an empty demand marks the reset. it
+         * follows the src's earlier demands to the src's core, which then
+         * knows to purge those */
+        adm_log_reset_sender(&state->stat);
+        enqueue_bin(state->new_demands[partition_index], src, 0, 0, 0);
+
+        if (bin_size(state->new_demands[partition_index]) == SMALL_BIN_SIZE) {
+                adm_log_backlog_flush_bin_full(&state->stat);
+                _flush_backlog_now(state, partition_index);
+        }
 }
 
 /**
@@ -125,12 +288,26 @@ void pim_reset_sender(struct pim_state *state, uint16_t src) {
 static inline __attribute__((always_inline))
 void process_incoming_bin(struct pim_state *state, uint16_t partition_index,
                           struct bin *bin) {
+        struct pim_core_state *core = &state->cores[partition_index];
         uint32_t i;
         for (i = 0; i < bin_size(bin); i++) {
-                /* add the edge to requests for this partition */
                 struct backlog_edge *edge = bin_get(bin, i);
-                ga_adj_add_edge_by_src(&state->requests_by_src[partition_index],
-                                       PARTITION_IDX(edge->src), edge->dst);
+                uint16_t src_index = PARTITION_IDX(edge->src);
+
+                if (edge->backlog == 0) {
+                        /* the src was reset, purge its requests later */
+                        core->src_reset_pending[PIM_BITMASK_WORD(src_index)] |=
+                                (1ULL << PIM_BITMASK_SHIFT(src_index));
+                        continue;
+                }
+
+                /* demands after a reset must not mix with those before it */
+                if (unlikely(src_reset_pending(core, src_index)))
+                        purge_sender(state, partition_index, src_index);
+
+                /* add the edge to requests for this partition */
+                add_request(state, partition_index, edge->src, edge->dst,
+                            edge->backlog);
         }
 }
 
@@ -168,9 +345,12 @@ void pim_prepare(struct pim_state *state, uint16_t partition_index) {
         /* add new backlogs to requests */
         process_new_requests(state, partition_index);
 
+        /* clean up after senders that were reset */
+        purge_reset_senders(state, partition_index, PIM_RESET_PURGE_PER_TSLOT);
+
         /* reset src and dst endnodes */
-        memset(&core->src_endnodes, 0, PIM_BITMASK_WORD(PARTITION_N_NODES));
-        memset(&core->dst_endnodes, 0, PIM_BITMASK_WORD(PARTITION_N_NODES));
+        memset(&core->src_endnodes, 0, sizeof(core->src_endnodes));
+        memset(&core->dst_endnodes, 0, sizeof(core->dst_endnodes));
 
         /* get memory for admitted traffic, init it */
         while (fp_mempool_get(state->admitted_traffic_mempool, (void**) &core->admitted) != 0)
@@ -180,83 +360,81 @@ void pim_prepare(struct pim_state *state, uint16_t partition_index) {
 }
 
 /**
- * For all source (left-hand) nodes in partition 'partition_index',
- *    selects edges to grant. These are added to 'grants'. For the
- *    first iteration only.
+ * For each src in the partition that is not allocated yet, grants one of its
+ *    requests to a dst that is not in 'dst_alloc', chosen uniformly at random.
  */
-void pim_do_grant_first_it(struct pim_state *state, uint16_t partition_index) {
-        uint16_t count, src_partition, dst_adj_index, dst;
+static inline __attribute__((always_inline))
+void grant_requests(struct pim_state *state, uint16_t partition_index,
+                    const uint64_t *dst_alloc) {
         struct pim_core_state *core = &state->cores[partition_index];
-        struct admission_core_statistics *core_stat = &core->stat;
+        struct pim_requests *requests = &state->requests_by_src[partition_index];
+        uint16_t w, src_index, dst;
 
         /* reset grant edgelist */
         ga_partd_edgelist_src_reset(&state->grants, partition_index);
 
-        /* for each src in the partition, randomly choose a dst to grant to */
-        uint16_t src;
-        for (src = first_in_partition(partition_index);
-             src <= last_in_partition(partition_index);
-             src++) {
-                uint16_t src_index = PARTITION_IDX(src);
-                uint16_t degree = state->requests_by_src[partition_index].degree[src_index];
-                if (degree == 0)
-                        continue; /* no requests for this src */
-
-                /* pick a random destination to grant to */
-                dst_adj_index = random_int(&core->rand_state, degree);
-                dst = state->requests_by_src[partition_index].neigh[src_index][dst_adj_index];
-
-                /* add the granted edge */
-                ga_partd_edgelist_add(&state->grants, src, dst);
-
-                /* record the index of the destination we granted to */
-                core->grant_adj_index[PARTITION_IDX(src)] = dst_adj_index;
+        /* only visit srcs that have requests and are not allocated. srcs
+         * that were reset have stale requests, don't grant those */
+        for (w = 0; w < PIM_PARTITION_WORDS; w++) {
+                uint64_t srcs = core->src_has_requests[w] & ~core->src_endnodes[w];
+                if (unlikely(srcs & core->src_reset_pending[w])) {
+                        adm_log_stale_grants_avoided(&core->stat,
+                                __builtin_popcountll(srcs & core->src_reset_pending[w]));
+                        srcs &= ~core->src_reset_pending[w];
+                }
+                while (srcs) {
+                        src_index = (w << 6) + __builtin_ctzll(srcs);
+                        srcs &= srcs - 1;
+
+                        /* pick a random un-allocated destination to grant to */
+                        dst = ga_bitmap_random_bit(requests->bits.row[src_index],
+                                                   dst_alloc, &core->rand_state);
+                        if (dst == GA_NO_NEIGH)
+                                continue; /* couldn't find a free dst */
+
+                        /* add the granted edge */
+                        ga_partd_edgelist_add(&state->grants,
+                                first_in_partition(partition_index) + src_index, dst);
+                }
         }
 }
 
+/**
+ * For all source (left-hand) nodes in partition 'partition_index',
+ *    selects edges to grant. These are added to 'grants'. For the
+ *    first iteration only.
+ */
+void pim_do_grant_first_it(struct pim_state *state, uint16_t partition_index) {
+        /* no dst is allocated in the first iteration */
+        grant_requests(state, partition_index, no_nodes);
+}
+
 /**
  * For all source (left-hand) nodes in partition 'partition_index',
  *    selects edges to grant. These are added to 'grants'.
  */
 void pim_do_grant(struct pim_state *state, uint16_t partition_index) {
-        uint16_t count, src_partition;
-        struct pim_core_state *core = &state->cores[partition_index];
-        struct admission_core_statistics *core_stat = &core->stat;
+        uint64_t dst_alloc[GA_BITMAP_WORDS];
 
-        /* reset grant edgelist */
-        ga_partd_edgelist_src_reset(&state->grants, partition_index);
+        get_allocated_dsts(state, dst_alloc);
+        grant_requests(state, partition_index, dst_alloc);
+}
+
+/**
+ * Adds grants in 'edgelist' to grants_by_dst for this partition
+ */
+static inline __attribute__((always_inline))
+void add_grants_by_dst(struct pim_state *state, uint16_t partition_index,
+                       struct ga_edgelist *edgelist) {
+        struct pim_core_state *core = &state->cores[partition_index];
+        uint32_t i;
 
-        /* for each src in the partition, randomly choose a dst to grant to */
-        uint16_t src;
-        for (src = first_in_partition(partition_index);
-             src <= last_in_partition(partition_index);
-             src++) {
-                if (src_is_allocated(core, src))
-                        continue; /* this src has been allocated in this timeslot */
-
-                uint16_t src_index = PARTITION_IDX(src);
-                uint16_t degree = state->requests_by_src[partition_index].degree[src_index];
-                if (degree == 0)
-                        continue; /* no requests for this src */
-
-                /* find an un-allocated destination to grant to */
-                uint8_t tries = MAX_TRIES;
-                uint16_t dst_adj_index, dst;
-                bool dst_is_alloc;
-                do {
-                        dst_adj_index = random_int(&core->rand_state, degree);
-                        dst = state->requests_by_src[partition_index].neigh[src_index][dst_adj_index];
-                        dst_is_alloc = dst_is_allocated(state, dst);
-                } while (dst_is_alloc && (--tries > 0));
-
-                if (dst_is_alloc)
-                        continue; /* couldn't find a free dst*/
-
-                /* add the granted edge */
-                ga_partd_edgelist_add(&state->grants, src, dst);
-
-                /* record the index of the destination we granted to */
-                core->grant_adj_index[PARTITION_IDX(src)] = dst_adj_index;
+        for (i = 0; i < edgelist->n; i++) {
+                uint16_t dst_index = PARTITION_IDX(edgelist->edge[i].dst);
+                ga_bitmatrix_set(&state->grants_by_dst[partition_index],
+                                 dst_index, edgelist->edge[i].src);
+                core->dst_has_grants[PIM_BITMASK_WORD(dst_index)] |=
+                        (1ULL << PIM_BITMASK_SHIFT(dst_index));
         }
 }
 
@@ -276,16 +454,12 @@ void pim_do_accept(struct pim_state *state, uint16_t partition_index) {
         phase_finished(&state->phase, partition_index, core_stat);
 #endif
 
-        /* reset grant adjacency list */
-        ga_reset_adj(&state->grants_by_dst[partition_index]);
-
-        /* sort grants from all src partitions by destination node */
-        struct ga_adj *dest_adj = &state->grants_by_dst[partition_index];
-
+        /* sort grants from all src partitions by destination node. the
+         * bit matrix was left empty by the previous accept */
 #ifndef PIM_SINGLE_ADMISSION_CORE
         /* sort grants from this partition first */
         edgelist = &state->grants.dst[partition_index].src[partition_index];
-        ga_edges_to_adj_by_dst(&edgelist->edge[0], edgelist->n, dest_adj);
+        add_grants_by_dst(state, partition_index, edgelist);
 
         /* sort grants from other partitions, as they are ready */
         count = 0;
@@ -295,34 +469,38 @@ void pim_do_accept(struct pim_state *state, uint16_t partition_index) {
                 if (src_partition != NONE_READY) {
                         count++;
                         edgelist = &state->grants.dst[partition_index].src[src_partition];
-                        ga_edges_to_adj_by_dst(&edgelist->edge[0], edgelist->n, dest_adj);
+                        add_grants_by_dst(state, partition_index, edgelist);
                 } else
                         process_new_requests(state, partition_index);
         }
 #else
         for (src_partition = 0; src_partition < N_PARTITIONS; src_partition++) {
                 edgelist = &state->grants.dst[partition_index].src[src_partition];
-                ga_edges_to_adj_by_dst(&edgelist->edge[0], edgelist->n, dest_adj);
+                add_grants_by_dst(state, partition_index, edgelist);
         }
 #endif
 
-        /* for each dst in the partition, randomly choose a src to accept */
-        uint16_t dst;
-        for (dst = first_in_partition(partition_index);
-             dst <= last_in_partition(partition_index);
-             dst++) {
-                uint16_t dst_index = PARTITION_IDX(dst);
-                uint16_t degree = state->grants_by_dst[partition_index].degree[dst_index];
-                if (degree == 0)
-                        continue; /* no grants for this dst */
-
-                /* choose an edge and accept it */
-                uint16_t src_adj_index = random_int(&core->rand_state, degree);
-                uint16_t src = state->grants_by_dst[partition_index].neigh[dst_index][src_adj_index];
-                ga_partd_edgelist_add(&state->accepts, src, dst);
-
-                /* mark the dst as allocated for this timeslot */
-                mark_dst_allocated(core, dst);
+        /* for each dst in the partition with grants, randomly choose a src to
+         * accept */
+        uint16_t w, dst_index;
+        for (w = 0; w < PIM_PARTITION_WORDS; w++) {
+                uint64_t dsts = core->dst_has_grants[w];
+                core->dst_has_grants[w] = 0;
+                while (dsts) {
+                        dst_index = (w << 6) + __builtin_ctzll(dsts);
+                        dsts &= dsts - 1;
+
+                        /* choose an edge and accept it */
+                        uint64_t *granted = state->grants_by_dst[partition_index].row[dst_index];
+                        uint16_t src = ga_bitmap_random_bit(granted, no_nodes,
+                                                            &core->rand_state);
+                        uint16_t dst = first_in_partition(partition_index) + dst_index;
+                        ga_partd_edgelist_add(&state->accepts, src, dst);
+                        memset(granted, 0, GA_BITMAP_WORDS * sizeof(uint64_t));
+
+                        /* mark the dst as allocated for this timeslot */
+                        mark_dst_allocated(core, dst);
+                }
         }
 }
 
@@ -342,6 +520,14 @@ void process_accepts_from_partition(struct pim_state *state, uint16_t src_partit
         for (i = 0; i < edgelist->n; i++) {
                 struct ga_edge *edge = &edgelist->edge[i];
 
+                /* the src could have been reset and purged while waiting for
+                 * other partitions in this timeslot */
+                if (unlikely(!has_request(&state->requests_by_src[src_partition],
+                                          PARTITION_IDX(edge->src), edge->dst))) {
+                        adm_log_stale_accept_dropped(core_stat);
+                        continue;
+                }
+
                 /* add edge to admitted traffic */
                 insert_admitted_edge(admitted, edge->src, edge->dst);
 
@@ -349,8 +535,8 @@ void process_accepts_from_partition(struct pim_state *state, uint16_t src_partit
                 mark_src_allocated(core, edge->src);
 
                 /* decrease the backlog */
-                assert(backlog_get(&state->backlog, edge->src, edge->dst) != 0);
-                backlog = backlog_decrease(&state->backlog, edge->src, edge->dst);
+                backlog = decrease_request(state, src_partition, edge->src,
+                                           edge->dst);
                 if (backlog != 0) {
                         /* there is remaining backlog */
                         adm_log_allocated_backlog_remaining(core_stat, edge->src,
@@ -358,11 +544,7 @@ void process_accepts_from_partition(struct pim_state *state, uint16_t src_partit
                         continue;
                 }
 
-                 /* no more backlog, delete the edge from requests */
-                 adm_log_allocator_no_backlog(core_stat, edge->src, edge->dst);
-                 uint16_t grant_adj_index = core->grant_adj_index[PARTITION_IDX(edge->src)];
-                 ga_adj_delete_neigh(&state->requests_by_src[PARTITION_OF(edge->src)],
-                                     PARTITION_IDX(edge->src), grant_adj_index);
+                adm_log_allocator_no_backlog(core_stat, edge->src, edge->dst);
         }
 }
 
@@ -13,41 +13,74 @@
 #include "phase.h"
 #include "../graph-algo/random.h"
 #include "../graph-algo/admitted.h"
-#include "../graph-algo/backlog.h"
+#include "../graph-algo/admissible_algo_log.h"
 #include "../graph-algo/bin.h"
 #include "../graph-algo/fp_ring.h"
 #include "../graph-algo/platform.h"
 
-#define NUM_ITERATIONS 3
+#define NUM_ITERATIONS 3 /* default, see pim_set_iterations() */
+#define PIM_RESET_PURGE_PER_TSLOT 8 /* reset senders purged per timeslot */
 #define SMALL_BIN_SIZE (MAX_NODES / N_PARTITIONS)
+#define PIM_SRC_INLINE_REQUESTS 4 /* backlogs a src keeps without allocating */
 
-/* packing of bitmasks into 8 bit words */
-#define PIM_BITMASKS_PER_8_BIT      8
-#define PIM_BITMASK_WORD(node)      (node >> 3)
-#define PIM_BITMASK_SHIFT(node)     (node & (PIM_BITMASKS_PER_8_BIT - 1))
+/* packing of bitmasks into 64 bit words, so the bitmasks of the partitions
+ * concatenate into one bitmap over all nodes */
+#define PIM_BITMASKS_PER_64_BIT     64
+#define PIM_BITMASK_WORD(node)      ((node) >> 6)
+#define PIM_BITMASK_SHIFT(node)     ((node) & (PIM_BITMASKS_PER_64_BIT - 1))
+#define PIM_PARTITION_WORDS         (PARTITION_N_NODES / PIM_BITMASKS_PER_64_BIT)
+
+#if ((PARTITION_N_NODES % PIM_BITMASKS_PER_64_BIT) != 0) && (N_PARTITIONS > 1)
+#error "PARTITION_N_NODES must be a multiple of 64 to concatenate bitmasks"
+#endif
 
 /* Data structures associated with one allocation core */
 struct pim_core_state {
         u32 rand_state;
         struct admitted_traffic *admitted;
-        uint16_t grant_adj_index[PARTITION_N_NODES]; /* per src adj index of grant */
-        uint8_t src_endnodes[PARTITION_N_NODES / PIM_BITMASKS_PER_8_BIT];
-        uint8_t dst_endnodes[PARTITION_N_NODES / PIM_BITMASKS_PER_8_BIT];
+        uint64_t src_endnodes[PIM_PARTITION_WORDS]; /* allocated srcs */
+        uint64_t dst_endnodes[PIM_PARTITION_WORDS]; /* allocated dsts */
+        uint64_t src_has_requests[PIM_PARTITION_WORDS];
+        uint64_t src_reset_pending[PIM_PARTITION_WORDS]; /* not purged yet */
+        uint64_t dst_has_grants[PIM_PARTITION_WORDS];
         struct fp_ring *q_new_demands;
         struct admission_core_statistics stat;
 } __attribute__((aligned(64))) /* don't want sharing between cores */;
 
+/**
+ * Backlogs of the requests of one source, in the order of their destinations.
+ *   The backlog to a destination is at the rank of its bit in the source's
+ *   row of requests. Up to PIM_SRC_INLINE_REQUESTS live in @inline_count,
+ *   more in an array that doubles as needed.
+ */
+struct pim_src_backlog {
+        uint32_t *count;
+        uint16_t n;
+        uint16_t capacity;
+        uint32_t inline_count[PIM_SRC_INLINE_REQUESTS];
+};
+
+/**
+ * Requests of the sources in one partition: a bit for each destination
+ *   a source has backlog to, and the amount of that backlog. Only the core
+ *   of the partition touches these.
+ */
+struct pim_requests {
+        struct ga_bitmatrix bits;
+        struct pim_src_backlog backlog[PARTITION_N_NODES];
+} __attribute__((aligned(64))) /* don't want sharing between cores */;
+
 /* A structure for the state of a grant partition */
 struct pim_state {
-        struct ga_adj requests_by_src[N_PARTITIONS]; /* per src partition */
+        struct pim_requests requests_by_src[N_PARTITIONS]; /* per src partition */
         struct ga_partd_edgelist grants;
-        struct ga_adj grants_by_dst[N_PARTITIONS]; /* per dst partition */
+        struct ga_bitmatrix grants_by_dst[N_PARTITIONS]; /* per dst partition */
         struct ga_partd_edgelist accepts;
-        struct backlog backlog;
         struct bin *new_demands[N_PARTITIONS]; /* per src partition */
         struct fp_ring *q_admitted_out;
         struct fp_mempool *bin_mempool;
         struct fp_mempool *admitted_traffic_mempool;
+        uint8_t n_iterations;
         struct pim_core_state cores[N_PARTITIONS];
         struct admission_statistics stat;
         struct phase_state phase;
@@ -65,7 +98,8 @@ void pim_add_backlog(struct pim_state *state, uint16_t src, uint16_t dst,
 void pim_flush_backlog(struct pim_state *state);
 
 /**
- * Reset state of all flows for which src is the sender
+ * Reset state of all flows for which src is the sender. The core of src's
+ *    partition purges them after it processes demands added before the reset.
  */
 void pim_reset_sender(struct pim_state *state, uint16_t src);
 
@@ -104,18 +138,41 @@ void pim_process_accepts(struct pim_state *state, uint16_t partition_index);
  */
 void pim_complete_timeslot(struct pim_state *state, uint16_t partition_index);
 
+/**
+ * Sets the number of grant-accept iterations run for each timeslot. Call
+ *    only while no core is allocating.
+ */
+static inline
+void pim_set_iterations(struct pim_state *state, uint8_t n_iterations)
+{
+        assert(n_iterations > 0);
+        state->n_iterations = n_iterations;
+}
+
 /**
  * Initialize all demands to zero
  */
 static inline
 void pim_reset_state(struct pim_state *state)
 {
-        uint16_t src_partition;
+        uint16_t src_partition, src_index;
         for (src_partition = 0; src_partition < N_PARTITIONS; src_partition++) {
-                ga_reset_adj(&state->requests_by_src[src_partition]);
+                struct pim_requests *requests = &state->requests_by_src[src_partition];
+                ga_reset_bitmatrix(&requests->bits);
+                for (src_index = 0; src_index < PARTITION_N_NODES; src_index++) {
+                        struct pim_src_backlog *backlog = &requests->backlog[src_index];
+                        if (backlog->count != backlog->inline_count)
+                                fp_free(backlog->count);
+                        backlog->count = backlog->inline_count;
+                        backlog->capacity = PIM_SRC_INLINE_REQUESTS;
+                        backlog->n = 0;
+                }
+                memset(&state->cores[src_partition].src_has_requests, 0,
+                       sizeof(state->cores[src_partition].src_has_requests));
+                memset(&state->cores[src_partition].src_reset_pending, 0,
+                       sizeof(state->cores[src_partition].src_reset_pending));
                 ga_partd_edgelist_src_reset(&state->accepts, src_partition);
         }
-        backlog_init(&state->backlog);
 }
 
 /**
@@ -125,23 +182,30 @@ static inline
 void pim_init_state(struct pim_state *state, struct fp_ring **q_new_demands,
                     struct fp_ring *q_admitted_out,
                     struct fp_mempool *bin_mempool,
-                    struct fp_mempool *admitted_traffic_mempool,
-                    struct fp_ring **q_ready_partitions)
+                    struct fp_mempool *admitted_traffic_mempool)
 {
+        uint16_t partition, src_index;
+
+        /* no src has allocated backlogs yet */
+        for (partition = 0; partition < N_PARTITIONS; partition++)
+                for (src_index = 0; src_index < PARTITION_N_NODES; src_index++)
+                        state->requests_by_src[partition].backlog[src_index].count =
+                                state->requests_by_src[partition].backlog[src_index].inline_count;
+
         pim_reset_state(state);
+        pim_set_iterations(state, NUM_ITERATIONS);
 
         state->q_admitted_out = q_admitted_out;
         state->bin_mempool = bin_mempool;
         state->admitted_traffic_mempool = admitted_traffic_mempool;
 
-        uint16_t partition;
         for (partition = 0; partition < N_PARTITIONS; partition++) {
                 fp_mempool_get(bin_mempool, (void**) &state->new_demands[partition]);
                 init_bin(state->new_demands[partition]);
                 state->cores[partition].q_new_demands = q_new_demands[partition];
                 seed_random(&state->cores[partition].rand_state, rand());
         }
-        phase_state_init(&state->phase, q_ready_partitions);
+        phase_state_init(&state->phase);
 }
 
 #endif /* PIM_H_ */
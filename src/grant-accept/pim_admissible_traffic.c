@@ -29,7 +29,7 @@ void pim_get_admissible_traffic(struct pim_state *state)
         for (partition = 0; partition < N_PARTITIONS; partition++)
                 pim_process_accepts(state, partition);
         uint8_t i;
-        for (i = 1; i < NUM_ITERATIONS; i++) {
+        for (i = 1; i < state->n_iterations; i++) {
                 for (partition = 0; partition < N_PARTITIONS; partition++)
                         pim_do_grant(state, partition);
                 for (partition = 0; partition < N_PARTITIONS; partition++)
@@ -27,15 +27,14 @@ static inline
 struct pim_state *pim_create_state(struct fp_ring **q_new_demands,
                                    struct fp_ring *q_admitted_out,
                                    struct fp_mempool *bin_mempool,
-                                   struct fp_mempool *admitted_traffic_mempool,
-                                   struct fp_ring **q_ready_partitions)
+                                   struct fp_mempool *admitted_traffic_mempool)
 {
         struct pim_state *state = fp_malloc("pim_state", sizeof(struct pim_state));
         if (state == NULL)
                 return NULL;
 
         pim_init_state(state, q_new_demands, q_admitted_out, bin_mempool,
-                       admitted_traffic_mempool, q_ready_partitions);
+                       admitted_traffic_mempool);
 
         return state;
 }
@@ -8,46 +8,44 @@
 #include "pim.h"
 #include "pim_admissible_traffic.h"
 
-#include <time.h> /* for seeding srand */
+#include <stdlib.h>
+#include <time.h> /* for seeding srand, and timing the benchmark */
+#include <unistd.h>
 
 #define ADMITTED_TRAFFIC_MEMPOOL_SIZE           (N_PARTITIONS)
 #define ADMITTED_OUT_RING_LOG_SIZE		16
 #define BIN_MEMPOOL_SIZE                        (10*N_PARTITIONS)
 #define NEW_DEMANDS_Q_SIZE                      16
-#define READY_PARTITIONS_Q_SIZE                 2
+
+/* benchmark: flows per source, their backlog, and timeslots per run */
+#define BENCH_FLOWS_PER_SRC                     4
+#define BENCH_FLOW_BACKLOG                      1000
+#define BENCH_N_TIMESLOTS                       2000
+#define BENCH_MIN_NODES                         32
 
 /**
- * Simple test of pim for a few timeslots
+ * Returns admitted traffic of all partitions to the mempool, and the number
+ *    of admitted edges
  */
-int main() {
-        /* initialize rand */
-        srand(time(NULL));
-
-        /* initialize state */
-        struct fp_ring *q_new_demands[N_PARTITIONS];
-        struct fp_ring *q_admitted_out;
-        struct fp_mempool *bin_mempool;
-        struct fp_mempool *admitted_traffic_mempool;
-        struct fp_ring *q_ready_partitions[N_PARTITIONS];
-
-        uint16_t i;
-        for (i = 0; i < N_PARTITIONS; i++) {
-                q_new_demands[i] = fp_ring_create("", 1 << NEW_DEMANDS_Q_SIZE, 0, 0);
-                q_ready_partitions[i] = fp_ring_create("", 1 << READY_PARTITIONS_Q_SIZE, 0, 0);
+static uint32_t free_admitted(struct pim_state *state) {
+        struct admitted_traffic *admitted;
+        uint32_t n_admitted = 0;
+        uint16_t p;
+        for (p = 0; p < N_PARTITIONS; p++) {
+                fp_ring_dequeue(state->q_admitted_out, (void **) &admitted);
+                n_admitted += admitted->size;
+                fp_mempool_put(state->admitted_traffic_mempool, admitted);
         }
-        bin_mempool = fp_mempool_create("",BIN_MEMPOOL_SIZE, bin_num_bytes(SMALL_BIN_SIZE),
-        		0, 0, 0);
-        q_admitted_out = fp_ring_create("", 1 << ADMITTED_OUT_RING_LOG_SIZE, 0, 0);
-        admitted_traffic_mempool = fp_mempool_create("",
-        		ADMITTED_TRAFFIC_MEMPOOL_SIZE, sizeof(struct admitted_traffic),
-				0, 0, 0);
-        struct pim_state *state = pim_create_state(&q_new_demands[0], q_admitted_out,
-                                                   bin_mempool,
-                                                   admitted_traffic_mempool,
-                                                   q_ready_partitions);
+        return n_admitted;
+}
 
+/**
+ * Simple test of pim for a few timeslots
+ */
+static void run_simple_test(struct pim_state *state) {
         /* add some test edges */
         struct ga_edge test_edges[] = {{1, 3}, {4, 5}, {1, 5}};
+        uint16_t i;
         for (i = 0; i < sizeof(test_edges) / sizeof(struct ga_edge); i++) {
                 uint16_t src = test_edges[i].src;
                 uint16_t dst = test_edges[i].dst;
@@ -63,11 +61,145 @@ int main() {
                         printf("invalid admitted traffic\n");
 
                 /* return admitted to mempool */
-                uint16_t p;
+                free_admitted(state);
+        }
+}
+
+/**
+ * Test that after a sender is reset, only demands added after the reset are
+ *    allocated
+ */
+static void run_reset_test(struct pim_state *state) {
+        struct admitted_traffic *admitted;
+        uint16_t i, j, p;
+        uint32_t n_old = 0, n_new = 0;
+
+        pim_reset_state(state);
+        pim_add_backlog(state, 1, 3, 10);
+        pim_flush_backlog(state);
+        pim_get_admissible_traffic(state);
+        free_admitted(state);
+
+        /* 9 timeslots to 3 remain, then the reset and one to 5 */
+        pim_reset_sender(state, 1);
+        pim_add_backlog(state, 1, 5, 1);
+        pim_flush_backlog(state);
+
+        for (i = 0; i < 10; i++) {
+                pim_get_admissible_traffic(state);
                 for (p = 0; p < N_PARTITIONS; p++) {
-                        struct admitted_traffic *admitted;
                         fp_ring_dequeue(state->q_admitted_out, (void **) &admitted);
+                        for (j = 0; j < admitted->size; j++) {
+                                struct admitted_edge *edge = get_admitted_edge(admitted, j);
+                                n_old += (edge->dst == 3);
+                                n_new += (edge->dst == 5);
+                        }
                         fp_mempool_put(state->admitted_traffic_mempool, admitted);
                 }
         }
+
+        if (n_old != 0 || n_new != 1)
+                printf("reset sender failed: %u edges before the reset, %u after\n",
+                       n_old, n_new);
+        else
+                printf("reset sender ok\n");
+}
+
+/**
+ * Measures timeslots allocated per second, for node counts from
+ *    BENCH_MIN_NODES up to MAX_NODES. Each source has a few flows with
+ *    enough backlog to last the whole run.
+ */
+static void run_benchmark(struct pim_state *state) {
+        struct timespec start, end;
+        uint32_t n_nodes, src, i;
+        uint64_t n_admitted;
+        double secs;
+
+        printf("pim benchmark, %d iterations, %d timeslots per run\n",
+               state->n_iterations, BENCH_N_TIMESLOTS);
+        for (n_nodes = BENCH_MIN_NODES; n_nodes <= MAX_NODES; n_nodes *= 2) {
+                pim_reset_state(state);
+                for (src = 0; src < n_nodes; src++)
+                        for (i = 0; i < BENCH_FLOWS_PER_SRC; i++)
+                                pim_add_backlog(state, src, rand() % n_nodes,
+                                                BENCH_FLOW_BACKLOG);
+                pim_flush_backlog(state);
+
+                n_admitted = 0;
+                clock_gettime(CLOCK_MONOTONIC, &start);
+                for (i = 0; i < BENCH_N_TIMESLOTS; i++) {
+                        pim_get_admissible_traffic(state);
+                        n_admitted += free_admitted(state);
+                }
+                clock_gettime(CLOCK_MONOTONIC, &end);
+
+                secs = (end.tv_sec - start.tv_sec)
+                        + (end.tv_nsec - start.tv_nsec) * 1e-9;
+                printf("nodes %4u: %10.0f timeslots/s, %8.3f us/timeslot, "
+                       "%6.1f edges/timeslot\n", n_nodes,
+                       BENCH_N_TIMESLOTS / secs, secs * 1e6 / BENCH_N_TIMESLOTS,
+                       (double) n_admitted / BENCH_N_TIMESLOTS);
+        }
+}
+
+/**
+ * Test of pim. Usage: pim [-b] [-i ITERATIONS]
+ *    -b: run the benchmark instead of the simple test
+ *    -i: number of grant-accept iterations per timeslot
+ */
+int main(int argc, char **argv) {
+        bool benchmark = false;
+        int n_iterations = NUM_ITERATIONS;
+        int opt;
+
+        while ((opt = getopt(argc, argv, "bi:")) != -1) {
+                switch (opt) {
+                case 'b':
+                        benchmark = true;
+                        break;
+                case 'i':
+                        n_iterations = atoi(optarg);
+                        if (n_iterations < 1 || n_iterations > 255) {
+                                printf("invalid number of iterations %s\n", optarg);
+                                return -1;
+                        }
+                        break;
+                default:
+                        printf("usage: %s [-b] [-i ITERATIONS]\n", argv[0]);
+                        return -1;
+                }
+        }
+
+        /* initialize rand */
+        srand(time(NULL));
+
+        /* initialize state */
+        struct fp_ring *q_new_demands[N_PARTITIONS];
+        struct fp_ring *q_admitted_out;
+        struct fp_mempool *bin_mempool;
+        struct fp_mempool *admitted_traffic_mempool;
+
+        uint16_t i;
+        for (i = 0; i < N_PARTITIONS; i++) {
+                q_new_demands[i] = fp_ring_create("", 1 << NEW_DEMANDS_Q_SIZE, 0, 0);
+        }
+        bin_mempool = fp_mempool_create("",BIN_MEMPOOL_SIZE, bin_num_bytes(SMALL_BIN_SIZE),
+        		0, 0, 0);
+        q_admitted_out = fp_ring_create("", 1 << ADMITTED_OUT_RING_LOG_SIZE, 0, 0);
+        admitted_traffic_mempool = fp_mempool_create("",
+        		ADMITTED_TRAFFIC_MEMPOOL_SIZE, sizeof(struct admitted_traffic),
+				0, 0, 0);
+        struct pim_state *state = pim_create_state(&q_new_demands[0], q_admitted_out,
+                                                   bin_mempool,
+                                                   admitted_traffic_mempool);
+        pim_set_iterations(state, n_iterations);
+
+        if (benchmark)
+                run_benchmark(state);
+        else {
+                run_simple_test(state);
+                run_reset_test(state);
+        }
+        return 0;
 }
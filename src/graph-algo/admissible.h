@@ -43,7 +43,8 @@ void add_backlog(struct admissible_state *state, uint16_t src, uint16_t dst,
 }
 
 static inline
-void flush_backlog(struct admissible_state *state) {
+void flush_backlog(struct admissible_state *state, uint16_t comm_index) {
+	(void) comm_index; /* one comm core adds all demands */
 	pim_flush_backlog((struct pim_state *) state);
 };
 
@@ -63,9 +64,9 @@ create_admissible_state(bool a, uint16_t b, uint16_t c, uint16_t d,
 		enum RouterType g, void *h, enum EndpointType i, void *j)
 {
 	(void) q_spent; /* unused */
+	(void) q_ready_partitions; /* partitions sync on epochs in pim_state */
     struct pim_state *state = pim_create_state(q_new_demands,
-    		q_admitted_out[0], bin_mempool, admitted_traffic_mempool,
-    		q_ready_partitions);
+    		q_admitted_out[0], bin_mempool, admitted_traffic_mempool);
     return (struct admissible_state *) state;
 }
 
@@ -82,12 +83,6 @@ void reset_sender(struct admissible_state *status, uint16_t src)
 	pim_reset_sender((struct pim_state *) status, src);
 }
 
-static inline
-void handle_spent_demands(struct admissible_state *state)
-{
-	/* unused */
-}
-
 #endif
 
 /* pipelined algo */
@@ -110,8 +105,9 @@ void add_backlog(struct admissible_state *status, uint16_t src, uint16_t dst,
 }
 
 static inline
-void flush_backlog(struct admissible_state *status) {
-	seq_flush_backlog((struct seq_admissible_status *) status);
+void flush_backlog(struct admissible_state *status, uint16_t comm_index) {
+	/* each comm core has its own intake */
+	seq_flush_intake((struct seq_admissible_status *) status, comm_index);
 }
 
 static inline
@@ -133,8 +129,15 @@ create_admissible_state(bool oversubscribed, uint16_t inter_rack_capacity,
 		enum EndpointType e, void *f)
 {
 	struct seq_admissible_status *status;
+	/* one q_head, so one intake. use seq_create_admissible_status() for more */
+	if (SEQ_N_INTAKES != 1) {
+		printf("ERROR: create_admissible_state takes one q_head, but "
+				"SEQ_N_INTAKES is %d. Use seq_create_admissible_status().\n",
+				SEQ_N_INTAKES);
+		exit(-1);
+	}
     status = seq_create_admissible_status(oversubscribed, inter_rack_capacity,
-    		out_of_boundary_capacity, num_nodes, q_head, q_admitted_out[0],
+    		out_of_boundary_capacity, num_nodes, &q_head, q_admitted_out[0],
     		q_spent, head_bin_mempool, admitted_traffic_mempool, q_bin);
     return (struct admissible_state *) status;
 }
@@ -154,13 +157,6 @@ void reset_sender(struct admissible_state *status, uint16_t src)
 	seq_reset_sender((struct seq_admissible_status *) status, src);
 }
 
-static inline
-void handle_spent_demands(struct admissible_state *state)
-{
-    struct seq_admissible_status *status = (struct seq_admissible_status *) state;
-    seq_handle_spent(status);
-}
-
 #endif
 
 /* emulation algo */
@@ -197,16 +193,10 @@ void reset_sender(struct admissible_state *state, uint16_t src)
 }
 
 static inline
-void flush_backlog(struct admissible_state *state) {
-	/* unused */
+void flush_backlog(struct admissible_state *state, uint16_t comm_index) {
+	emu_flush_backlog(state, comm_index);
 };
 
-static inline
-void handle_spent_demands(struct admissible_state *state)
-{
-	/* unused */
-}
-
 static inline
 uint16_t get_admitted_partition(struct admitted_traffic *admitted)
 {
@@ -305,16 +295,10 @@ void reset_sender(struct admissible_state *state, uint16_t src)
 }
 
 static inline
-void flush_backlog(struct admissible_state *state) {
+void flush_backlog(struct admissible_state *state, uint16_t comm_index) {
 	/* unused */
 };
 
-static inline
-void handle_spent_demands(struct admissible_state *state)
-{
-	/* unused */
-}
-
 static inline
 uint16_t get_admitted_partition(struct admitted_traffic *admitted)
 {
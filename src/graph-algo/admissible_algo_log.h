@@ -57,7 +57,15 @@ struct admission_core_statistics {
         /* pim-only stats */
         uint64_t phase_finished;
         uint64_t phase_none_ready;
-        uint64_t phase_out_of_order;
+        /* time waiting for other partitions, in cycles. phases alternate
+         * between grants (odd epochs) and accepts (even epochs) */
+        uint64_t phase_waits[2];
+        uint64_t phase_wait_cycles[2];
+        uint64_t phase_wait_max_cycles[2];
+        uint64_t reset_senders_purged;
+        uint64_t reset_requests_purged;
+        uint64_t stale_grants_avoided;
+        uint64_t stale_accepts_dropped;
 };
 
 /**
@@ -79,6 +87,11 @@ struct admission_statistics {
 	uint64_t new_demands_bin_alloc_failed;
 	uint64_t backlog_flush_forced;
 	uint64_t backlog_flush_bin_full;
+	uint64_t backlog_pairs_reclaimed;
+	uint64_t backlog_table_full;
+
+	/* pim-only stats */
+	uint64_t reset_senders;
 };
 
 /* GLOBAL STATS (in admissible_status) */
@@ -89,6 +102,13 @@ void adm_log_wait_for_space_in_q_head(
 		st->wait_for_space_in_q_head++;
 }
 
+static inline __attribute__((always_inline))
+void adm_log_reset_sender(
+		struct admission_statistics *st) {
+	if (MAINTAIN_ADM_LOG_COUNTERS)
+		st->reset_senders++;
+}
+
 static inline __attribute__((always_inline))
 void adm_log_new_demands_bin_alloc_failed(
 		struct admission_statistics *st) {
@@ -131,6 +151,20 @@ void adm_log_backlog_flush_bin_full(
 		st->backlog_flush_bin_full++;
 }
 
+static inline __attribute__((always_inline))
+void adm_log_backlog_pair_reclaimed(
+		struct admission_statistics *st) {
+	if (MAINTAIN_ADM_LOG_COUNTERS)
+		st->backlog_pairs_reclaimed++;
+}
+
+static inline __attribute__((always_inline))
+void adm_log_backlog_table_full(
+		struct admission_statistics *st) {
+	if (MAINTAIN_ADM_LOG_COUNTERS)
+		st->backlog_table_full++;
+}
+
 static inline __attribute__((always_inline))
 void adm_log_processed_spent_demands(
 		struct admission_statistics *st, int num_bins, uint32_t num_demands) {
@@ -328,10 +362,38 @@ void adm_log_phase_none_ready(
 }
 
 static inline __attribute__((always_inline))
-void adm_log_phase_out_of_order(
+void adm_log_phase_wait(
+		struct admission_core_statistics *st, uint32_t epoch,
+		uint64_t cycles) {
+	if (MAINTAIN_ADM_LOG_COUNTERS) {
+		st->phase_waits[epoch & 1]++;
+		st->phase_wait_cycles[epoch & 1] += cycles;
+		if (cycles > st->phase_wait_max_cycles[epoch & 1])
+			st->phase_wait_max_cycles[epoch & 1] = cycles;
+	}
+}
+
+static inline __attribute__((always_inline))
+void adm_log_reset_sender_purged(
+		struct admission_core_statistics *st, uint32_t n_requests) {
+	if (MAINTAIN_ADM_LOG_COUNTERS) {
+		st->reset_senders_purged++;
+		st->reset_requests_purged += n_requests;
+	}
+}
+
+static inline __attribute__((always_inline))
+void adm_log_stale_grants_avoided(
+		struct admission_core_statistics *st, uint32_t n_srcs) {
+	if (MAINTAIN_ADM_LOG_COUNTERS)
+		st->stale_grants_avoided += n_srcs;
+}
+
+static inline __attribute__((always_inline))
+void adm_log_stale_accept_dropped(
 		struct admission_core_statistics *st) {
 	if (MAINTAIN_ADM_LOG_COUNTERS)
-		st->phase_out_of_order++;
+		st->stale_accepts_dropped++;
 }
 
 #endif /* ADMISSIBLE_ALGO_LOG_H_ */
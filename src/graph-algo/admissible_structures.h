@@ -25,13 +25,32 @@
 #include "admitted.h"
 
 #define SMALL_BIN_SIZE (32) // TODO: try smaller values
-#define LARGE_BIN_SIZE (MAX_NODES * MAX_NODES) // TODO: try smaller values
-#define NUM_BINS_SHIFT 5
-#define NUM_BINS 32 // 2^NUM_BINS_SHIFT
-#define NUM_SRC_DST_PAIRS (MAX_NODES * (MAX_NODES))  // include dst == out of boundary
+#define LARGE_BIN_SIZE (2 * MAX_NODES * BACKLOG_PAIRS_PER_SRC) // at most the pairs the backlog tracks
+#define NUM_BINS_SHIFT (BATCH_SHIFT + 1) // bin folding needs 2 * BATCH_SIZE bins
+#define NUM_BINS (1 << NUM_BINS_SHIFT)
 
 #define BIN_MASK_SIZE		((NUM_BINS + BATCH_SIZE + 63) / 64)
 
+/* intakes of new demands, one per comm core */
+#ifndef SEQ_N_INTAKES
+#define SEQ_N_INTAKES		1
+#endif
+
+/**
+ * Where one comm core hands new demands to the allocator. Sources are split
+ *    evenly among intakes, and only the comm core of those sources adds to
+ *    its intake. The allocation core taking new demands merges all q_heads
+ *    and spends demands in the backlogs.
+ * @backlog: backlogs of pairs whose source belongs to this intake
+ * @new_demands: demands not yet enqueued to q_head
+ * @q_head: bins of new demands for the allocation cores
+ */
+struct seq_intake {
+	struct backlog backlog;
+	struct bin *new_demands;
+	struct fp_ring *q_head;
+} __attribute__((aligned(64))) /* don't want sharing between comm cores */;
+
 // Data structures associated with one allocation core
 struct seq_admission_core_state {
 	struct bin *new_request_bins[NUM_BINS + BATCH_SIZE]; // pool of backlog bins for incoming requests
@@ -52,10 +71,9 @@ struct seq_admissible_status {
     uint16_t out_of_boundary_capacity;
     uint16_t inter_rack_capacity;  // Only valid if oversubscribed is true
     uint16_t num_nodes;
-    uint64_t last_alloc_tslot[NUM_SRC_DST_PAIRS];
-    struct backlog backlog;
-    struct bin *new_demands;
-    struct fp_ring *q_head;
+    /* the backlogs also hold the last send time of each pair */
+    struct seq_intake intakes[SEQ_N_INTAKES];
+    uint8_t intake_of_src[MAX_NODES];
     struct fp_ring *q_admitted_out;
     struct fp_ring *q_spent;
     struct fp_mempool *bin_mempool;
@@ -66,6 +84,23 @@ struct seq_admissible_status {
     struct admission_statistics stat;
 };
 
+/**
+ * Returns the first source of intake @intake, when @num_nodes sources are
+ *    split among the intakes
+ */
+static inline
+uint16_t seq_intake_first_src(uint16_t num_nodes, uint16_t intake)
+{
+	return ((uint32_t) intake * num_nodes) / SEQ_N_INTAKES;
+}
+
+static inline __attribute__((always_inline))
+struct seq_intake *seq_intake_of(struct seq_admissible_status *status,
+		uint16_t src)
+{
+	return &status->intakes[status->intake_of_src[src]];
+}
+
 // Initialize all timeslots and demands to zero
 static inline
 void seq_reset_admissible_status(struct seq_admissible_status *status, bool oversubscribed,
@@ -73,6 +108,7 @@ void seq_reset_admissible_status(struct seq_admissible_status *status, bool over
                                  uint16_t num_nodes)
 {
     assert(status != NULL);
+    uint32_t i, src;
 
     if (oversubscribed && !SUPPORTS_OVERSUBSCRIPTION) {
     	printf("ERROR: reset_admissible_status got oversubscribed network, "
@@ -85,17 +121,30 @@ void seq_reset_admissible_status(struct seq_admissible_status *status, bool over
     status->out_of_boundary_capacity = out_of_boundary_capacity;
     status->num_nodes = num_nodes;
 
-    uint32_t i;
-    for (i = 0; i < NUM_SRC_DST_PAIRS; i++)
-        status->last_alloc_tslot[i] = 0;
-
-    backlog_init(&status->backlog);
-}
-
-// Get the index of this flow in the status data structure
-static inline
-uint32_t get_status_index(uint16_t src, uint16_t dst) {
-    return (src << FP_NODES_SHIFT) + dst;
+    for (i = 0; i < SEQ_N_INTAKES; i++) {
+    	struct backlog *backlog = &status->intakes[i].backlog;
+    	uint16_t first_src = seq_intake_first_src(num_nodes, i);
+    	uint16_t num_srcs = seq_intake_first_src(num_nodes, i + 1) - first_src;
+
+    	for (src = first_src; src < first_src + num_srcs; src++)
+    		status->intake_of_src[src] = i;
+
+    	/* each backlog table is sized by the number of its sources */
+    	if (backlog->entries != NULL && backlog_n_slots(backlog) >=
+    			backlog_n_slots_for(num_srcs, num_nodes)) {
+    		backlog_reset(backlog);
+    		continue;
+    	}
+    	if (backlog->entries != NULL)
+    		backlog_free(backlog);
+    	if (backlog_init(backlog, num_srcs, num_nodes) != 0) {
+    		printf("ERROR: reset_admissible_status could not allocate backlog "
+    				"for %u nodes.\n", num_nodes);
+    		exit(-1);
+    	}
+    }
+    for (src = num_nodes; src < MAX_NODES; src++)
+    	status->intake_of_src[src] = SEQ_N_INTAKES - 1;
 }
 
 // Initializes data structures associated with one allocation core for
@@ -160,13 +209,14 @@ static inline int alloc_core_init(struct seq_admissible_status *status,
 }
 
 /**
- * Initializes an already-allocated struct admissible_status.
+ * Initializes an already-allocated struct admissible_status. @q_head holds the
+ *    ring of each of the SEQ_N_INTAKES intakes.
  */
 static inline
 int seq_init_admissible_status(struct seq_admissible_status *status,
                                bool oversubscribed, uint16_t inter_rack_capacity,
                                uint16_t out_of_boundary_capacity, uint16_t num_nodes,
-                               struct fp_ring *q_head, struct fp_ring *q_admitted_out,
+                               struct fp_ring **q_head, struct fp_ring *q_admitted_out,
                                struct fp_ring *q_spent,
                                struct fp_mempool *bin_mempool,
                                struct fp_mempool *admitted_traffic_mempool,
@@ -176,10 +226,11 @@ int seq_init_admissible_status(struct seq_admissible_status *status,
     uint32_t i;
     int rc;
 
+    for (i = 0; i < SEQ_N_INTAKES; i++)
+    	status->intakes[i].backlog.entries = NULL;
     seq_reset_admissible_status(status, oversubscribed, inter_rack_capacity,
                                 out_of_boundary_capacity, num_nodes);
 
-    status->q_head = q_head;
     status->q_admitted_out = q_admitted_out;
     status->q_spent = q_spent;
     status->bin_mempool = bin_mempool;
@@ -187,8 +238,13 @@ int seq_init_admissible_status(struct seq_admissible_status *status,
 
     memcpy(&status->q_bin, q_bin, sizeof(status->q_bin));
 
-    fp_mempool_get(bin_mempool, (void**)&status->new_demands);
-    init_bin(status->new_demands);
+    for (i = 0; i < SEQ_N_INTAKES; i++) {
+    	status->intakes[i].q_head = q_head[i];
+    	if (fp_mempool_get(bin_mempool,
+    			(void**)&status->intakes[i].new_demands) != 0)
+    		return -1;
+    	init_bin(status->intakes[i].new_demands);
+    }
 
     for (i = 0; i < ALGO_N_CORES; i++) {
     	rc = alloc_core_init(status, i, NUM_BINS + i * BATCH_SIZE);
@@ -205,7 +261,7 @@ static inline
 struct seq_admissible_status *
 seq_create_admissible_status(bool oversubscribed, uint16_t inter_rack_capacity,
                              uint16_t out_of_boundary_capacity, uint16_t num_nodes,
-                             struct fp_ring *q_head, struct fp_ring *q_admitted_out,
+                             struct fp_ring **q_head, struct fp_ring *q_admitted_out,
                              struct fp_ring *q_spent,
                              struct fp_mempool *head_bin_mempool,
                              struct fp_mempool *admitted_traffic_mempool,
@@ -109,87 +109,49 @@ void core_enqueue_to_q_out_edge(struct seq_admission_core_state *core,
 }
 
 /**
- * Flushes bin to queue, and allocates a new bin
+ * Flushes the intake's bin to its queue, and allocates a new bin
  */
 static inline __attribute__((always_inline))
-void _flush_backlog_now(struct seq_admissible_status *status)
+void _flush_backlog_now(struct seq_admissible_status *status,
+		struct seq_intake *intake)
 {
-	/* enqueue status->new_demands */
-	while(fp_ring_enqueue(status->q_head, status->new_demands) == -ENOBUFS)
+	/* enqueue intake->new_demands */
+	while(fp_ring_enqueue(intake->q_head, intake->new_demands) == -ENOBUFS)
 		adm_log_wait_for_space_in_q_head(&status->stat);
 
-	/* get a fresh bin for status->new_demands */
+	/* get a fresh bin for intake->new_demands */
 	while(fp_mempool_get(status->bin_mempool,
-						  (void**)&status->new_demands) == -ENOENT)
+						  (void**)&intake->new_demands) == -ENOENT)
 		adm_log_new_demands_bin_alloc_failed(&status->stat);
 
-	init_bin(status->new_demands);
+	init_bin(intake->new_demands);
 }
 
-
-void seq_flush_backlog(struct seq_admissible_status *status) {
-	if (unlikely(is_empty_bin(status->new_demands)))
+void seq_flush_intake(struct seq_admissible_status *status, uint16_t intake)
+{
+	if (unlikely(is_empty_bin(status->intakes[intake].new_demands)))
 		return;
 	adm_log_forced_backlog_flush(&status->stat);
-	_flush_backlog_now(status);
-}
-
-void enqueue_new_demand(struct seq_admissible_status* status, uint16_t src,
-		uint16_t dst, uint32_t amount)
-{
-	/* add to status->new_demands */
-	enqueue_bin(status->new_demands, src, dst, amount,
-			status->last_alloc_tslot[get_status_index(src, dst)]);
-
-	if (unlikely(bin_size(status->new_demands) == SMALL_BIN_SIZE)) {
-		adm_log_backlog_flush_bin_full(&status->stat);
-		_flush_backlog_now(status);
-	}
+	_flush_backlog_now(status, &status->intakes[intake]);
 }
 
 void seq_add_backlog(struct seq_admissible_status *status,
 		uint16_t src, uint16_t dst, uint32_t amount)
 {
-	if (backlog_increase(&status->backlog, src, dst, amount,
+	struct seq_intake *intake = seq_intake_of(status, src);
+
+	if (backlog_increase(&intake->backlog, src, dst, amount,
 			&status->stat) == false)
 		return; /* no need to enqueue */
 
-	/* add to status->new_demands */
-	enqueue_new_demand(status, src, dst, amount);
-}
+	/* add to intake->new_demands */
+	enqueue_bin(intake->new_demands, src, dst, amount,
+			backlog_get_last_alloc(&intake->backlog, src, dst));
 
-void seq_handle_spent(struct seq_admissible_status *status)
-{
-    assert(status != NULL);
-
-    struct bin *bins[SPENT_RING_DEQUEUE_SIZE];
-    int n, bin, i;
-    uint32_t num_entries = 0;
-    uint32_t num_bins = 0;
-
-    n = fp_ring_dequeue_burst(status->q_spent, (void **)&bins[0],
-    		SPENT_RING_DEQUEUE_SIZE);
-
-    for (bin = 0; bin < n; bin++) {
-    	num_entries += bin_size(bins[bin]);
-    	num_bins++;
-    	for (i = 0; i < bin_size(bins[bin]); i++) {
-    		struct backlog_edge *edge = bin_get(bins[bin], i);
-    		uint16_t src = edge->src;
-    		uint16_t dst = edge->dst;
-    		uint32_t backlog = backlog_get(&status->backlog, src, dst);
-
-    		if (backlog == 0) {
-    			status->last_alloc_tslot[get_status_index(src, dst)] = edge->metric;
-    			backlog_non_active(&status->backlog, src, dst);
-    		} else {
-    			backlog_reset_pair(&status->backlog, src, dst);
-    			enqueue_new_demand(status, src, dst, backlog);
-    		}
-    	}
-		fp_mempool_put(status->bin_mempool, bins[bin]);
-    }
-    adm_log_processed_spent_demands(&status->stat, num_bins, num_entries);
+	if (unlikely(bin_size(intake->new_demands) == SMALL_BIN_SIZE)) {
+		adm_log_backlog_flush_bin_full(&status->stat);
+		_flush_backlog_now(status, intake);
+	}
 }
 
 static inline __attribute__((always_inline))
@@ -215,6 +177,49 @@ void incoming_bin_to_core(struct seq_admissible_status *status,
 	}
 }
 
+/**
+ * Spends the demands allocation cores reported in q_spent. Backlog that
+ *    accumulated while a demand was allocated becomes a new demand, which goes
+ *    straight into this core's bins.
+ * Returns the number of new demands.
+ */
+static inline uint32_t handle_spent(struct seq_admissible_status *status,
+		struct seq_admission_core_state *core)
+{
+    struct bin *bins[SPENT_RING_DEQUEUE_SIZE];
+    int n, bin, i;
+    uint32_t num_entries = 0;
+    uint32_t num_demands = 0;
+
+    n = fp_ring_dequeue_burst(status->q_spent, (void **)&bins[0],
+    		SPENT_RING_DEQUEUE_SIZE);
+
+    for (bin = 0; bin < n; bin++) {
+    	num_entries += bin_size(bins[bin]);
+    	for (i = 0; i < bin_size(bins[bin]); i++) {
+    		struct backlog_edge *edge = bin_get(bins[bin], i);
+    		uint16_t src = edge->src;
+    		uint16_t dst = edge->dst;
+    		uint32_t backlog = backlog_spend(&seq_intake_of(status, src)->backlog,
+    				src, dst, edge->metric);
+    		uint16_t bin_index;
+
+    		if (backlog == 0)
+    			continue;
+
+    		bin_index = bin_index_from_timeslot(edge->metric,
+    				core->current_timeslot);
+    		enqueue_bin(core->new_request_bins[bin_index], src, dst, backlog,
+    				edge->metric);
+    		set_bin_non_empty(core, bin_index);
+    		num_demands++;
+    	}
+		fp_mempool_put(status->bin_mempool, bins[bin]);
+    }
+    adm_log_processed_spent_demands(&status->stat, n, num_entries);
+    return num_demands;
+}
+
 static inline __attribute__((always_inline))
 void move_bin_to_q_out(struct seq_admissible_status *status,
 		struct seq_admission_core_state *core, struct fp_ring *queue_out,
@@ -359,8 +364,8 @@ void try_allocation_core(struct seq_admission_core_state *core,
 	}
 }
 
-// Sets the last send time for new requests based on the contents of status
-// and sorts them
+// Spends demands, then merges new requests from all intakes into the core's
+// bins, sorted by their last send time
 static inline uint32_t process_new_requests(struct seq_admissible_status *status,
                           struct seq_admission_core_state *core,
                           uint16_t current_bin)
@@ -370,17 +375,22 @@ static inline uint32_t process_new_requests(struct seq_admissible_status *status
 
     struct bin *bins[RING_DEQUEUE_BURST_SIZE];
     int n, i;
+    uint16_t intake;
     uint32_t num_entries = 0;
     uint32_t num_bins = 0;
 
-    n = fp_ring_dequeue_burst(status->q_head, (void **)&bins[0],
-    		RING_DEQUEUE_BURST_SIZE);
+    num_entries += handle_spent(status, core);
+
+    for (intake = 0; intake < SEQ_N_INTAKES; intake++) {
+    	n = fp_ring_dequeue_burst(status->intakes[intake].q_head,
+    			(void **)&bins[0], RING_DEQUEUE_BURST_SIZE);
 
-    for (i = 0; i < n; i++) {
-    	num_entries += bin_size(bins[i]);
-    	num_bins++;
-    	incoming_bin_to_core(status, core, bins[i]);
-		fp_mempool_put(status->bin_mempool, bins[i]);
+    	for (i = 0; i < n; i++) {
+    		num_entries += bin_size(bins[i]);
+    		num_bins++;
+    		incoming_bin_to_core(status, core, bins[i]);
+    		fp_mempool_put(status->bin_mempool, bins[i]);
+    	}
     }
     adm_log_processed_new_requests(&core->stat, num_bins, num_entries);
     return num_entries;
@@ -564,8 +574,9 @@ void seq_reset_sender(struct seq_admissible_status *status, uint16_t src) {
     // Do not change last send timeslots
 
     // Reset pending demands
+    struct backlog *backlog = &seq_intake_of(status, src)->backlog;
     uint16_t dst;
-    for (dst = 0; dst < MAX_NODES; dst++) {
-        backlog_reset_pair(&status->backlog, src, dst);
+    for (dst = 0; dst < status->num_nodes; dst++) {
+        backlog_reset_pair(backlog, src, dst);
     }
 }
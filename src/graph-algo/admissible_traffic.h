@@ -18,8 +18,9 @@ void seq_add_backlog(struct seq_admissible_status *status,
                      uint16_t src, uint16_t dst,
                      uint32_t amount);
 
-// Flushes the backlog into admissible_status
-void seq_flush_backlog(struct seq_admissible_status *status);
+// Flushes the backlog of one intake into admissible_status. Called by the
+// comm core of the intake's sources
+void seq_flush_intake(struct seq_admissible_status *status, uint16_t intake);
 
 // Determine admissible traffic for one timeslot from queue_in
 void seq_get_admissible_traffic(struct seq_admissible_status *status,
@@ -29,9 +30,6 @@ void seq_get_admissible_traffic(struct seq_admissible_status *status,
 // Reset state of all flows for which src is the sender
 void seq_reset_sender(struct seq_admissible_status *status, uint16_t src);
 
-// Handles spent demands reported by get_admissible_traffic
-void seq_handle_spent(struct seq_admissible_status *status);
-
 /**
  * Returns the bin index a flow last allocated at timeslot @last_allocated
  *   should fit in, when allocating a batch that starts with @current_timeslot
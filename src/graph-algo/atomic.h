@@ -17,6 +17,9 @@ typedef int32_t atomic32_t;
 #define atomic32_add_return(xptr,inc)	(*(xptr) += (inc))
 #define atomic32_sub_return(xptr,sub)	(*(xptr) -= (sub))
 #define atomic32_set(xptr,val)			(*(xptr) = (val))
+/* on a plain uint32_t, returns non-zero if *xptr was old and is now new */
+#define atomic32_cmpset(xptr,old,new)	\
+		((*(xptr) == (old)) ? ((*(xptr) = (new)), 1) : 0)
 #else
 
 #include <rte_atomic.h>
@@ -28,6 +31,8 @@ typedef rte_atomic32_t atomic32_t;
 #define atomic32_add_return(xptr,inc)	rte_atomic32_add_return(xptr,inc)
 #define atomic32_sub_return(xptr,sub)	rte_atomic32_sub_return(xptr,sub)
 #define atomic32_set(xptr,val)			rte_atomic32_set(xptr,val)
+/* on a plain uint32_t, returns non-zero if *xptr was old and is now new */
+#define atomic32_cmpset(xptr,old,new)	rte_atomic32_cmpset(xptr,old,new)
 #endif
 
 
@@ -10,45 +10,239 @@
 
 #include "atomic.h"
 #include "admissible_algo_log.h"
+#include "platform.h"
 #include "../protocol/topology.h"
-#include "bitasm.h"
 
 #include <assert.h>
 
+/* pairs per source that the backlog table is sized for, by default */
+#define BACKLOG_PAIRS_PER_SRC		64
+
+/* after probing this many slots, reuse an idle pair's slot for a new pair */
+#define BACKLOG_RECLAIM_PROBE		8
+
+#define BACKLOG_KEY_EMPTY			0
+#define BACKLOG_ACTIVE				(1U << 31)
+
+/**
+ * State of one (src,dst) pair
+ * @key: pair index + 1, BACKLOG_KEY_EMPTY if the slot is unused
+ * @n: backlog accumulated while the pair is active, with BACKLOG_ACTIVE set
+ *    while the pair has demand in the allocator. The comm core adding backlog
+ *    and the allocation core spending the demand both change it, with
+ *    compare-and-set so that neither loses the other's update.
+ * @last_alloc_tslot: the last timeslot this pair was allocated
+ */
+struct backlog_entry {
+	uint32_t key;
+	uint32_t n;
+	uint64_t last_alloc_tslot;
+};
+
 /**
- * Keeps backlogs between every source and destination
- *    n: the backlog for each pair
+ * Keeps backlogs between sources and destinations that have demand, in an
+ *    open-addressed hash table with linear probing. Most pairs never
+ *    communicate, so this takes memory in the number of pairs that do,
+ *    rather than in the square of the number of nodes.
+ *
+ * Slots are never emptied while the table is in use, so lookups need no
+ *    tombstones and can run concurrently with inserts. Only one core (the
+ *    comm core of the sources in the table) inserts. When probing gets
+ *    long, or more than half of the slots are used, an idle pair (inactive
+ *    with no backlog) met while probing is evicted and its slot reused; the
+ *    evicted pair just looks like one that has not sent in a long time. The
+ *    table refuses new pairs when three quarters of the slots are used, and
+ *    their demands are dropped.
+ *
+ *    entries: the slots, a power of two of them
+ *    mask: number of slots minus one
+ *    hash_shift: 32 - log2(number of slots)
+ *    max_pairs: number of used slots above which idle pairs are reclaimed
+ *    n_used: number of slots in use
  */
 struct backlog {
-	uint32_t n[MAX_NODES * MAX_NODES];
-	uint64_t is_active[(MAX_NODES * MAX_NODES + 63) / 64];
+	struct backlog_entry *entries;
+	uint32_t mask;
+	uint32_t hash_shift;
+	uint32_t max_pairs;
+	uint32_t n_used;
 };
 
-static void backlog_init(struct backlog *backlog) {
-	int i;
-	memset(backlog->n, 0 , sizeof(backlog->n));
-	memset(backlog->is_active, 0, sizeof(backlog->is_active));
+/**
+ * Returns the number of slots in a table for pairs from @num_srcs sources to
+ *    @num_nodes nodes
+ */
+static inline
+uint32_t backlog_n_slots_for(uint16_t num_srcs, uint16_t num_nodes)
+{
+	uint32_t max_pairs = (uint32_t) num_srcs * num_nodes;
+	uint32_t n_slots = 2;
+
+	if (max_pairs > (uint32_t) num_srcs * BACKLOG_PAIRS_PER_SRC)
+		max_pairs = (uint32_t) num_srcs * BACKLOG_PAIRS_PER_SRC;
+
+	/* keep the load factor at most 1/2 */
+	while (n_slots < 2 * max_pairs)
+		n_slots <<= 1;
+
+	return n_slots;
+}
+
+/**
+ * Allocates a backlog table for pairs from @num_srcs sources to @num_nodes
+ *    nodes.
+ * Returns 0 if successful, -1 on error.
+ */
+static inline
+int backlog_init(struct backlog *backlog, uint16_t num_srcs,
+		uint16_t num_nodes)
+{
+	uint32_t n_slots = backlog_n_slots_for(num_srcs, num_nodes);
+
+	backlog->entries = (struct backlog_entry *) fp_calloc("backlog_entries",
+			n_slots, sizeof(struct backlog_entry));
+	if (backlog->entries == NULL)
+		return -1;
+
+	backlog->mask = n_slots - 1;
+	backlog->hash_shift = 32 - __builtin_ctz(n_slots);
+	backlog->max_pairs = n_slots / 2;
+	backlog->n_used = 0;
+	return 0;
+}
+
+/**
+ * Forgets all pairs
+ */
+static inline
+void backlog_reset(struct backlog *backlog)
+{
+	memset(backlog->entries, 0,
+			(backlog->mask + 1) * sizeof(struct backlog_entry));
+	backlog->n_used = 0;
+}
+
+static inline
+void backlog_free(struct backlog *backlog)
+{
+	fp_free(backlog->entries);
+	backlog->entries = NULL;
+}
+
+/**
+ * Returns the number of slots in the table, an upper bound on the number of
+ *    pairs it tracks
+ */
+static inline
+uint32_t backlog_n_slots(struct backlog *backlog)
+{
+	return backlog->mask + 1;
+}
+
+// Internal. Get the key of this pair in the table
+static inline __attribute__((always_inline))
+uint32_t _backlog_key(uint16_t src, uint16_t dst) {
+    return ((src << FP_NODES_SHIFT) + dst) + 1;
+}
+
+// Internal. Get the first slot to probe for a key
+static inline __attribute__((always_inline))
+uint32_t _backlog_slot(struct backlog *backlog, uint32_t key) {
+	/* multiplicative hashing, take the high bits */
+	return (uint32_t)(key * 2654435761U) >> backlog->hash_shift;
+}
+
+// Internal. Returns the entry of the pair, or NULL if the pair has no entry
+static inline __attribute__((always_inline))
+struct backlog_entry *_backlog_find(struct backlog *backlog, uint16_t src,
+		uint16_t dst)
+{
+	uint32_t key = _backlog_key(src, dst);
+	uint32_t i = _backlog_slot(backlog, key);
+	struct backlog_entry *e;
+
+	while (1) {
+		e = &backlog->entries[i];
+		if (e->key == key)
+			return e;
+		if (e->key == BACKLOG_KEY_EMPTY)
+			return NULL;
+		i = (i + 1) & backlog->mask;
+	}
 }
 
-// Internal. Get the index of this flow in the status data structure
+// Internal. Returns the entry of the pair, adding one if the pair has none.
+// Returns NULL if there is no space for the pair.
 static inline __attribute__((always_inline))
-uint32_t _backlog_index(uint16_t src, uint16_t dst) {
-    return (src << FP_NODES_SHIFT) + dst;
+struct backlog_entry *_backlog_find_or_add(struct backlog *backlog,
+		uint16_t src, uint16_t dst, struct admission_statistics *stat)
+{
+	uint32_t key = _backlog_key(src, dst);
+	uint32_t i = _backlog_slot(backlog, key);
+	uint32_t probe;
+	struct backlog_entry *e;
+	struct backlog_entry *idle = NULL;
+
+	for (probe = 0; ; probe++) {
+		e = &backlog->entries[i];
+		if (e->key == key)
+			return e;
+		if (e->key == BACKLOG_KEY_EMPTY)
+			break;
+		if (idle == NULL && e->n == 0)
+			idle = e;
+		i = (i + 1) & backlog->mask;
+	}
+
+	if (idle != NULL && (probe > BACKLOG_RECLAIM_PROBE
+			|| backlog->n_used >= backlog->max_pairs)) {
+		adm_log_backlog_pair_reclaimed(stat);
+		e = idle;
+	} else if (backlog->n_used < backlog->max_pairs + backlog->max_pairs / 2) {
+		backlog->n_used++;
+	} else {
+		adm_log_backlog_table_full(stat);
+		return NULL;
+	}
+
+	e->n = 0;
+	e->last_alloc_tslot = 0;
+	/* readers on other cores match on the key, so write it last */
+	asm volatile("" : : : "memory");
+	e->key = key;
+	return e;
 }
 
 static inline __attribute__((always_inline))
 uint32_t backlog_get(struct backlog *backlog, uint16_t src, uint16_t dst) {
-	uint32_t index = _backlog_index(src, dst);
-	return backlog->n[index];
+	struct backlog_entry *e = _backlog_find(backlog, src, dst);
+	return (e == NULL) ? 0 : (e->n & ~BACKLOG_ACTIVE);
 }
 
 /**
- * Decreases backlog for the (src,dst) pair by 1
+ * Called when the allocator has spent the demand of (src,dst), last
+ *    allocated at @tslot. Takes the backlog accumulated meanwhile, which
+ *    becomes the pair's next demand, or marks the pair inactive if there is
+ *    none.
+ * @return the backlog taken, 0 if the pair is no longer active
  */
 static inline __attribute__((always_inline))
-void backlog_non_active(struct backlog *backlog, uint16_t src, uint16_t dst) {
-	uint32_t index = _backlog_index(src, dst);
-	arr_unset_bit(backlog->is_active, index);
+uint32_t backlog_spend(struct backlog *backlog, uint16_t src, uint16_t dst,
+		uint64_t tslot) {
+	struct backlog_entry *e = _backlog_find(backlog, src, dst);
+	uint32_t old_n, new_n;
+
+	if (unlikely(e == NULL))
+		return 0;
+
+	/* the comm core reads this once the pair is inactive */
+	e->last_alloc_tslot = tslot;
+	do {
+		old_n = e->n;
+		new_n = (old_n == BACKLOG_ACTIVE) ? 0 : BACKLOG_ACTIVE;
+	} while (!atomic32_cmpset(&e->n, old_n, new_n));
+
+	return old_n & ~BACKLOG_ACTIVE;
 }
 
 // Resets the flow for this src/dst pair
@@ -58,7 +252,25 @@ void backlog_reset_pair(struct backlog *backlog, uint16_t src,
 {
     assert(backlog != NULL);
 
-    backlog->n[_backlog_index(src, dst)] = 0;
+    struct backlog_entry *e = _backlog_find(backlog, src, dst);
+    uint32_t old_n;
+
+    if (e == NULL)
+    	return;
+    do {
+    	old_n = e->n;
+    } while (!atomic32_cmpset(&e->n, old_n, old_n & BACKLOG_ACTIVE));
+}
+
+/**
+ * Returns the last timeslot allocated to (src,dst), 0 if unknown
+ */
+static inline __attribute__((always_inline))
+uint64_t backlog_get_last_alloc(struct backlog *backlog, uint16_t src,
+		uint16_t dst)
+{
+	struct backlog_entry *e = _backlog_find(backlog, src, dst);
+	return (e == NULL) ? 0 : e->last_alloc_tslot;
 }
 
 /**
@@ -69,6 +281,10 @@ void backlog_reset_pair(struct backlog *backlog, uint16_t src,
  * @param dst: destination endpoint
  * @param amount: the amount by which to increase the backlog
  * @param stat: statistics object, to keep aggregate stats on the increase
+ * @note: if the table has no space for the pair, the demand is dropped and
+ *    counted, and false is returned. Enqueueing it would let an untracked
+ *    pair have a demand in the allocator for every request, while bins are
+ *    sized for one demand per tracked pair.
  */
 static inline
 bool backlog_increase(struct backlog *backlog, uint16_t src,
@@ -77,28 +293,52 @@ bool backlog_increase(struct backlog *backlog, uint16_t src,
     assert(backlog != NULL);
     assert(amount != 0);
 
-    // Get full quantity from 16-bit LSB
-    uint32_t index = _backlog_index(src, dst);
-
-    #ifndef ASM_GOTO_UNSUPPORTED
-    set_and_jmp_if_was_set(backlog->is_active, index, already_active);
-    #else
-    uint64_t word = backlog->is_active[index >> 6];
-    uint8_t bit = (word >> (index & 0x3F)) & 0x1ULL;
-    backlog->is_active[index >> 6] = word | (1ULL << (index & 0x3F));
-    if (bit == 1)
-            goto already_active;
-    #endif
-
-    assert(backlog->n[index] == 0);
-    adm_log_increased_backlog_to_queue(stat, amount, amount);
-	return true;
-
-already_active:
-	/* the new backlog will get enqueued as the current one is spent */
-	backlog->n[index] += amount;
-	adm_log_increased_backlog_atomically(stat, amount, backlog->n[index]);
+    struct backlog_entry *e = _backlog_find_or_add(backlog, src, dst, stat);
+    uint32_t old_n, new_n;
+
+    if (unlikely(e == NULL))
+    	return false; /* counted as backlog_table_full */
+
+    do {
+    	old_n = e->n;
+    	/* while active, the new backlog will get enqueued as the current
+    	 * demand is spent */
+    	new_n = (old_n & BACKLOG_ACTIVE) ? (old_n + amount) : BACKLOG_ACTIVE;
+    } while (!atomic32_cmpset(&e->n, old_n, new_n));
+
+    if (!(old_n & BACKLOG_ACTIVE)) {
+    	adm_log_increased_backlog_to_queue(stat, amount, amount);
+    	return true;
+    }
+
+	adm_log_increased_backlog_atomically(stat, amount,
+			new_n & ~BACKLOG_ACTIVE);
 	return false;
 }
 
+/**
+ * Finds the first active pair in a slot at or after @pos.
+ * Returns the slot, or backlog_n_slots() if there are no more active pairs.
+ *    The pair and its backlog are written to @src, @dst and @n.
+ */
+static inline
+uint32_t backlog_next_active(struct backlog *backlog, uint32_t pos,
+		uint16_t *src, uint16_t *dst, uint32_t *n)
+{
+	struct backlog_entry *e;
+	uint32_t index;
+
+	for (; pos <= backlog->mask; pos++) {
+		e = &backlog->entries[pos];
+		if (!(e->n & BACKLOG_ACTIVE))
+			continue;
+		index = e->key - 1;
+		*src = index >> FP_NODES_SHIFT;
+		*dst = index & ((1 << FP_NODES_SHIFT) - 1);
+		*n = e->n & ~BACKLOG_ACTIVE;
+		return pos;
+	}
+	return backlog->mask + 1;
+}
+
 #endif /* BACKLOG_H_ */
@@ -14,25 +14,42 @@
 
 #include "bitasm.h"
 
+/* timeslots allocated together: 16, 32 or 64; e.g. -DBATCH_SIZE=64 */
 #ifndef BATCH_SIZE
 #define BATCH_SIZE 16  // must be consistent with bitmaps in batch_state
 #endif
 #ifndef BATCH_SHIFT
+#if (BATCH_SIZE == 64)
+#define BATCH_SHIFT 6
+#elif (BATCH_SIZE == 32)
+#define BATCH_SHIFT 5
+#else
 #define BATCH_SHIFT 4  // 2^BATCH_SHIFT = BATCH_SIZE
 #endif
+#endif
+
+#if (BATCH_SIZE > 64) || ((1 << BATCH_SHIFT) != BATCH_SIZE)
+#error "BATCH_SIZE must be a power of two of at most 64, and 2^BATCH_SHIFT"
+#endif
+
+/* a bit for every timeslot in the batch (shifting by 64 is undefined) */
+#define BATCH_MASK		((BATCH_SIZE == 64) ? ~0ULL : ((1ULL << BATCH_SIZE) - 1))
 
 #define SUPPORTS_OVERSUBSCRIPTION		0
 
-/* packing of bitmasks into 64 bit words */
-#if 0
+/* packing of bitmasks into 64 bit words: 4 nodes per word with batches of
+ * 16, 2 with batches of 32. Off by default: the unpacked bitmaps of all nodes
+ * fit in L1 anyway, and nodes sharing a word serialize their updates. */
+#ifdef BATCH_PACKED_BITMASKS
 #define BITMASKS_PER_64_BIT 	(64 >> BATCH_SHIFT)
-#define BITMASK_WORD(node)		(node >> (6 - BATCH_SHIFT))
-#define BITMASK_SHIFT(node)		((node << BATCH_SHIFT) & (64 - 1))
+#define BITMASK_WORD(node)		((node) >> (6 - BATCH_SHIFT))
+#define BITMASK_SHIFT(node)		(((node) << BATCH_SHIFT) & (64 - 1))
 #else
 #define BITMASKS_PER_64_BIT 	1
-#define BITMASK_WORD(node)		node
+#define BITMASK_WORD(node)		(node)
 #define BITMASK_SHIFT(node)		0
 #endif
+#define BITMASK_N_WORDS(n)		(((n) + BITMASKS_PER_64_BIT - 1) / BITMASKS_PER_64_BIT)
 
 #define MAX_DSTS MAX_NODES  // include dst == out of boundary
 #define MAX_SRCS MAX_NODES
@@ -41,8 +58,8 @@
 struct batch_state {
     bool oversubscribed;
     uint64_t allowed_mask;
-    uint64_t src_endnodes [MAX_SRCS / BITMASKS_PER_64_BIT];
-    uint64_t dst_endnodes [MAX_DSTS / BITMASKS_PER_64_BIT];
+    uint64_t src_endnodes [BITMASK_N_WORDS(MAX_SRCS)];
+    uint64_t dst_endnodes [BITMASK_N_WORDS(MAX_DSTS)];
     uint64_t src_rack_bitmaps [MAX_RACKS];
     uint64_t dst_rack_bitmaps [MAX_RACKS];
     uint16_t src_rack_counts [MAX_RACKS * BATCH_SIZE];  // rows are racks
@@ -59,10 +76,10 @@ void batch_state_init(struct batch_state *state, bool oversubscribed,
     assert(num_nodes <= MAX_NODES);
 
     state->oversubscribed = oversubscribed;
-    state->allowed_mask = (1ULL << BATCH_SIZE) - 1;
+    state->allowed_mask = BATCH_MASK;
 
     uint16_t i;
-    for (i = 0; i < num_nodes / BITMASKS_PER_64_BIT; i++) {
+    for (i = 0; i < BITMASK_N_WORDS(num_nodes); i++) {
         state->src_endnodes[i] = ~0ULL;
         state->dst_endnodes[i] = ~0ULL;
     }
@@ -100,12 +117,11 @@ uint64_t batch_state_get_avail_bitmap(struct batch_state *state,
     		& (state->dst_endnodes[BITMASK_WORD(dst)] >> BITMASK_SHIFT(dst));
 
     if (SUPPORTS_OVERSUBSCRIPTION && state->oversubscribed) {
-        uint64_t rack_bitmap;
-        if (dst == OUT_OF_BOUNDARY_NODE_ID)
-            rack_bitmap = state->src_rack_bitmaps[fp_rack_from_node_id(src)];
-        else
-            rack_bitmap = state->src_rack_bitmaps[fp_rack_from_node_id(src)] &
-                state->dst_rack_bitmaps[fp_rack_from_node_id(dst)];
+        /* out of boundary traffic is not limited by a destination rack */
+        uint64_t is_out_of_boundary = -(uint64_t)(dst == OUT_OF_BOUNDARY_NODE_ID);
+        uint64_t rack_bitmap = state->src_rack_bitmaps[fp_rack_from_node_id(src)] &
+                (state->dst_rack_bitmaps[fp_rack_from_node_id(dst)]
+                 | is_out_of_boundary);
 
         return endnode_bitmap & rack_bitmap;
     }
@@ -158,7 +174,7 @@ void batch_state_set_occupied_conditional(struct batch_state *state, uint16_t sr
 static inline
 void batch_state_disallow_lsb_timeslot(struct batch_state *state) {
 	state->allowed_mask <<= 1;
-	state->allowed_mask &= (1ULL << BATCH_SIZE) - 1;
+	state->allowed_mask &= BATCH_MASK;
 }
 
 #endif /* BATCH_H_ */
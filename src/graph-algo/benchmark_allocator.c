@@ -0,0 +1,831 @@
+/*
+ * benchmark_allocator.c
+ *
+ *  Created on: October 19, 2026
+ */
+
+/*
+ * One benchmark driver for all the allocators. The allocator is chosen at
+ * compile time, like in the arbiter: PIPELINED_ALGO (seq, or pipelined with
+ * ALGO_N_CORES > 1), PARALLEL_ALGO (pim), SJF_ALGO (sjf), ISJF_ALGO
+ * (incremental sjf) or EMULATION_ALGO (emulation, C++ only). All allocators get the same Poisson demand for the
+ * same seed and workload, and each run prints one CSV row or one JSON line.
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <linux/perf_event.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fp_ring.h"
+#include "generate_requests.h"
+#include "platform.h"
+#include "rdtsc.h"
+#include "../protocol/topology.h"
+
+#if defined(SJF_ALGO)
+#include "admissible_traffic_sjf.h"
+#include "admissible_structures_sjf.h"
+#define ALLOC_NAME				"sjf"
+#define ALLOC_N_CORES			1
+#elif defined(ISJF_ALGO)
+#include "isjf.h"
+#define ALLOC_NAME				"isjf"
+#define ALLOC_N_CORES			1
+#else
+#include "admissible.h"
+#endif
+
+#if defined(PIPELINED_ALGO)
+#define ALLOC_NAME				((ALGO_N_CORES == 1) ? "seq" : "pipelined")
+#define ALLOC_N_CORES			ALGO_N_CORES
+#define BIN_MEMPOOL_SIZE		(2048 * ALGO_N_CORES)
+#define ADMITTED_MEMPOOL_SIZE	(4 * BATCH_SIZE * ALGO_N_CORES)
+#define ADMITTED_OUT_RING_LOG_SIZE	12
+#elif defined(PARALLEL_ALGO)
+#define ALLOC_NAME				"pim"
+#define ALLOC_N_CORES			N_PARTITIONS
+#define BIN_MEMPOOL_SIZE		(10 * N_PARTITIONS)
+#define ADMITTED_MEMPOOL_SIZE	(2 * N_PARTITIONS)
+#define ADMITTED_OUT_RING_LOG_SIZE	12
+#define NEW_DEMANDS_Q_LOG_SIZE	16
+#elif defined(EMULATION_ALGO)
+#ifndef __cplusplus
+#error "the emulation allocator must be benchmarked from C++"
+#endif
+#include "../emulation/emulation_container.h"
+#include "../emulation/queue_managers/drop_tail.h"
+#define ALLOC_NAME				"emulation"
+#define ALLOC_N_CORES			ALGO_N_CORES
+#endif
+
+#define DEFAULT_DURATION		50000
+#define DEFAULT_WARM_UP			10000
+#define DEFAULT_MEAN_SIZE		10.0
+#define N_LATENCY_PERCENTILES	4
+
+const double latency_percentiles [N_LATENCY_PERCENTILES] =
+		{0.5, 0.9, 0.99, 0.999};
+
+/* parameters of one run */
+struct bench_params {
+	double load;
+	uint32_t num_nodes;
+	uint16_t num_racks;
+	uint32_t n_cores;
+	uint32_t duration;
+	uint32_t warm_up;
+	double mean_size;
+	const struct request_size_cdf *size_cdf; /* exponential sizes if NULL */
+	enum request_dst_pattern dst_pattern;
+	uint32_t dst_param;
+	uint32_t seed;
+	bool json;
+	bool header;
+};
+
+/* results of one run, over the timed timeslots only */
+struct bench_results {
+	uint64_t n_steps;
+	uint64_t n_tslots;
+	uint64_t n_admitted;
+	double secs;
+	double latency_ns[N_LATENCY_PERCENTILES];
+	double max_latency_ns;
+	int64_t cache_misses; /* -1 if the counters are unavailable */
+	int64_t cache_refs;
+};
+
+/*
+ * Allocator adapters. Each allocator implements alloc_init(), which returns
+ * 0 on success, alloc_add_backlog() and alloc_step(), which allocates the next
+ * TSLOTS_PER_STEP timeslots and returns the number of edges admitted in them.
+ */
+
+#if defined(PIPELINED_ALGO)
+
+#define TSLOTS_PER_STEP		BATCH_SIZE
+
+static struct admissible_state *alloc_status;
+static struct fp_ring *alloc_q_admitted_out;
+static struct fp_mempool *alloc_admitted_mempool;
+static uint32_t alloc_next_core;
+
+static int alloc_init(struct bench_params *params)
+{
+	struct fp_ring *q_head[SEQ_N_INTAKES], *q_spent;
+	struct fp_ring *q_bin[ALGO_N_CORES];
+	struct fp_mempool *bin_mempool;
+	uint32_t i;
+
+	for (i = 0; i < SEQ_N_INTAKES; i++) {
+		q_head[i] = fp_ring_create("", 1 << (2 * FP_NODES_SHIFT), 0, 0);
+		if (q_head[i] == NULL)
+			return -1;
+	}
+	q_spent = fp_ring_create("", 1 << (2 * FP_NODES_SHIFT), 0, 0);
+	alloc_q_admitted_out = fp_ring_create("", 1 << ADMITTED_OUT_RING_LOG_SIZE,
+			0, 0);
+	for (i = 0; i < ALGO_N_CORES; i++) {
+		q_bin[i] = fp_ring_create("", 1 << (2 * FP_NODES_SHIFT), 0, 0);
+		if (q_bin[i] == NULL)
+			return -1;
+	}
+	bin_mempool = fp_mempool_create("bin_mempool", BIN_MEMPOOL_SIZE,
+			bin_num_bytes(SMALL_BIN_SIZE), 0, 0, 0);
+	alloc_admitted_mempool = fp_mempool_create("admitted_traffic",
+			ADMITTED_MEMPOOL_SIZE, get_admitted_struct_size(), 0, 0, 0);
+	if (!q_spent || !alloc_q_admitted_out || !bin_mempool ||
+			!alloc_admitted_mempool)
+		return -1;
+
+	alloc_status = (struct admissible_state *) seq_create_admissible_status(
+			false, 0, 0, params->num_nodes, &q_head[0], alloc_q_admitted_out,
+			q_spent, bin_mempool, alloc_admitted_mempool, &q_bin[0]);
+	alloc_next_core = 0;
+	return (alloc_status == NULL) ? -1 : 0;
+}
+
+static inline
+void alloc_add_backlog(uint16_t src, uint16_t dst, uint32_t amount)
+{
+	add_backlog(alloc_status, src, dst, amount, 0, NULL);
+}
+
+static inline
+uint32_t alloc_step(void)
+{
+	struct admitted_traffic *admitted[BATCH_SIZE];
+	uint32_t i, n_admitted = 0;
+
+	/* this thread adds the demands of all intakes, as their comm cores */
+	for (i = 0; i < SEQ_N_INTAKES; i++)
+		flush_backlog(alloc_status, i);
+
+	/* cores take batches in turn, as they do in the arbiter */
+	get_admissible_traffic(alloc_status, alloc_next_core, 0, 1, 0);
+	alloc_next_core = (alloc_next_core + 1) % ALGO_N_CORES;
+
+	for (i = 0; i < BATCH_SIZE; i++) {
+		if (fp_ring_dequeue(alloc_q_admitted_out, (void **) &admitted[i]) != 0)
+			break;
+		n_admitted += get_num_admitted(admitted[i]);
+	}
+	fp_mempool_put_bulk(alloc_admitted_mempool, (void **) &admitted[0], i);
+	return n_admitted;
+}
+
+#elif defined(PARALLEL_ALGO)
+
+#define TSLOTS_PER_STEP		1
+
+static struct pim_state *alloc_state;
+
+static int alloc_init(struct bench_params *params)
+{
+	struct fp_ring *q_new_demands[N_PARTITIONS];
+	struct fp_ring *q_admitted_out;
+	struct fp_mempool *bin_mempool;
+	struct fp_mempool *admitted_mempool;
+	uint32_t i;
+
+	for (i = 0; i < N_PARTITIONS; i++) {
+		q_new_demands[i] = fp_ring_create("", 1 << NEW_DEMANDS_Q_LOG_SIZE, 0,
+				0);
+		if (q_new_demands[i] == NULL)
+			return -1;
+	}
+	bin_mempool = fp_mempool_create("", BIN_MEMPOOL_SIZE,
+			bin_num_bytes(SMALL_BIN_SIZE), 0, 0, 0);
+	q_admitted_out = fp_ring_create("", 1 << ADMITTED_OUT_RING_LOG_SIZE, 0, 0);
+	admitted_mempool = fp_mempool_create("", ADMITTED_MEMPOOL_SIZE,
+			sizeof(struct admitted_traffic), 0, 0, 0);
+	if (!bin_mempool || !q_admitted_out || !admitted_mempool)
+		return -1;
+
+	alloc_state = pim_create_state(&q_new_demands[0], q_admitted_out,
+			bin_mempool, admitted_mempool);
+	return (alloc_state == NULL) ? -1 : 0;
+}
+
+static inline
+void alloc_add_backlog(uint16_t src, uint16_t dst, uint32_t amount)
+{
+	pim_add_backlog(alloc_state, src, dst, amount);
+}
+
+static inline
+uint32_t alloc_step(void)
+{
+	struct admitted_traffic *admitted;
+	uint32_t n_admitted = 0;
+	uint16_t p;
+
+	pim_flush_backlog(alloc_state);
+	pim_get_admissible_traffic(alloc_state);
+
+	for (p = 0; p < N_PARTITIONS; p++) {
+		if (fp_ring_dequeue(alloc_state->q_admitted_out, (void **) &admitted)
+				!= 0)
+			continue;
+		n_admitted += admitted->size;
+		fp_mempool_put(alloc_state->admitted_traffic_mempool, admitted);
+	}
+	return n_admitted;
+}
+
+#elif defined(SJF_ALGO)
+
+#define TSLOTS_PER_STEP		BATCH_SIZE
+
+static struct admissible_status *alloc_status;
+static struct admission_core_state alloc_core;
+static struct admitted_traffic *alloc_admitted_batch[BATCH_SIZE];
+
+static int alloc_init(struct bench_params *params)
+{
+	struct fp_ring *q_bin, *q_urgent, *q_head, *q_admitted_out;
+	uint32_t i;
+
+	/* rings hold one element less than their size, so leave room for all
+	 * the bins and a whole batch of admitted traffic */
+	q_bin = fp_ring_create("", 1 << (NUM_BINS_SHIFT + 1), 0, 0);
+	q_urgent = fp_ring_create("", 1 << (2 * FP_NODES_SHIFT + 1), 0, 0);
+	q_head = fp_ring_create("", 1 << (2 * FP_NODES_SHIFT), 0, 0);
+	q_admitted_out = fp_ring_create("", 1 << (BATCH_SHIFT + 1), 0, 0);
+	if (!q_bin || !q_urgent || !q_head || !q_admitted_out)
+		return -1;
+
+	if (alloc_core_init(&alloc_core, q_bin, q_bin, q_urgent, q_urgent) != 0)
+		return -1;
+
+	alloc_status = create_admissible_status(false, 0, 0, params->num_nodes,
+			q_head, q_admitted_out);
+	if (alloc_status == NULL)
+		return -1;
+
+	for (i = 0; i < BATCH_SIZE; i++) {
+		alloc_admitted_batch[i] = create_admitted_traffic();
+		if (alloc_admitted_batch[i] == NULL)
+			return -1;
+	}
+	for (i = 0; i < NUM_BINS; i++)
+		fp_ring_enqueue(q_bin, create_bin(LARGE_BIN_SIZE));
+	fp_ring_enqueue(q_urgent, (void *) URGENT_Q_HEAD_TOKEN);
+	return 0;
+}
+
+static inline
+void alloc_add_backlog(uint16_t src, uint16_t dst, uint32_t amount)
+{
+	/* demands are 16 bits wide here, larger requests take several */
+	while (amount > UINT16_MAX) {
+		add_backlog(alloc_status, src, dst, UINT16_MAX);
+		amount -= UINT16_MAX;
+	}
+	add_backlog(alloc_status, src, dst, amount);
+}
+
+static inline
+uint32_t alloc_step(void)
+{
+	struct admitted_traffic *admitted;
+	uint32_t i, n_admitted = 0;
+
+	get_admissible_traffic(&alloc_core, alloc_status, alloc_admitted_batch, 0,
+			1, 0);
+
+	/* the core reuses the same admitted structs for the next batch */
+	for (i = 0; i < BATCH_SIZE; i++) {
+		fp_ring_dequeue(alloc_status->q_admitted_out, (void **) &admitted);
+		n_admitted += admitted->size;
+		alloc_admitted_batch[i] = admitted;
+	}
+	return n_admitted;
+}
+
+#elif defined(ISJF_ALGO)
+
+#define TSLOTS_PER_STEP		BATCH_SIZE
+
+static struct isjf_status *alloc_status;
+
+static int alloc_init(struct bench_params *params)
+{
+	struct fp_ring *q_head, *q_admitted_out;
+	struct fp_mempool *admitted_mempool;
+
+	/* requests are not coalesced before the allocation core, so leave room
+	 * for a few batches of them */
+	q_head = fp_ring_create("", 1 << 16, 0, 0);
+	q_admitted_out = fp_ring_create("", 1 << (BATCH_SHIFT + 1), 0, 0);
+	admitted_mempool = fp_mempool_create("", 2 * BATCH_SIZE,
+			sizeof(struct admitted_traffic), 0, 0, 0);
+	if (!q_head || !q_admitted_out || !admitted_mempool)
+		return -1;
+
+	alloc_status = isjf_create_status(false, 0, 0, params->num_nodes, q_head,
+			q_admitted_out, admitted_mempool);
+	return (alloc_status == NULL) ? -1 : 0;
+}
+
+static inline
+void alloc_add_backlog(uint16_t src, uint16_t dst, uint32_t amount)
+{
+	isjf_add_backlog(alloc_status, src, dst, amount);
+}
+
+static inline
+uint32_t alloc_step(void)
+{
+	struct admitted_traffic *admitted[BATCH_SIZE];
+	uint32_t i, n_admitted = 0;
+
+	isjf_get_admissible_traffic(alloc_status);
+
+	for (i = 0; i < BATCH_SIZE; i++) {
+		fp_ring_dequeue(alloc_status->q_admitted_out, (void **) &admitted[i]);
+		n_admitted += admitted[i]->size;
+	}
+	fp_mempool_put_bulk(alloc_status->admitted_traffic_mempool,
+			(void **) &admitted[0], BATCH_SIZE);
+	return n_admitted;
+}
+
+#elif defined(EMULATION_ALGO)
+
+#define TSLOTS_PER_STEP		1
+
+static EmulationContainer *alloc_container;
+static struct drop_tail_args alloc_r_args;
+/* the emulation keeps a pointer to its topology */
+static struct emu_topo_config alloc_topo_config;
+/* next packet id of each src-dst pair */
+static uint16_t alloc_next_packet_id[MAX_NODES * MAX_NODES];
+
+static int alloc_init(struct bench_params *params)
+{
+	struct emu_topo_config *topo_config = &alloc_topo_config;
+
+	alloc_r_args.q_capacity = 128;
+	topo_config->num_racks = params->num_racks;
+	topo_config->rack_shift = __builtin_ctz(params->num_nodes /
+			params->num_racks);
+	topo_config->num_core_rtrs = (params->num_racks > 1) ? 1 : 0;
+	topo_config->uplink_rate = 1;
+	topo_config->host_link_delay = 0;
+	topo_config->uplink_delay = 0;
+
+	alloc_container = new EmulationContainer(ADMITTED_MEMPOOL_SIZE,
+			1 << ADMITTED_Q_LOG_SIZE, PACKET_MEMPOOL_SIZE,
+			1 << PACKET_Q_LOG_SIZE, R_DropTail, &alloc_r_args, E_Simple, NULL,
+			topo_config);
+	memset(alloc_next_packet_id, 0, sizeof(alloc_next_packet_id));
+	return 0;
+}
+
+static inline
+void alloc_add_backlog(uint16_t src, uint16_t dst, uint32_t amount)
+{
+	uint16_t *next_id = &alloc_next_packet_id[src * MAX_NODES + dst];
+
+	alloc_container->add_backlog(src, dst, 0, amount, *next_id, NULL);
+	*next_id += amount;
+}
+
+static inline
+uint32_t alloc_step(void)
+{
+	struct emu_admitted_traffic *admitted;
+	uint32_t n_admitted = 0;
+
+	alloc_container->step();
+	while ((admitted = alloc_container->get_admitted()) != NULL) {
+		n_admitted += admitted->admitted;
+		alloc_container->free_admitted(admitted);
+	}
+	return n_admitted;
+}
+
+#endif
+
+/*
+ * Hardware cache counters, from perf_event_open(2). Only the allocator's own
+ * thread is counted, in user space. Unavailable counters (e.g. in a VM, or
+ * with perf_event_paranoid too high) are reported as -1.
+ */
+static int open_cache_counter(uint64_t config)
+{
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.size = sizeof(attr);
+	attr.config = config;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static int64_t read_counter(int fd)
+{
+	uint64_t count;
+
+	if (fd < 0 || read(fd, &count, sizeof(count)) != sizeof(count))
+		return -1;
+	return (int64_t) count;
+}
+
+static void set_counter_enabled(int fd, bool enabled)
+{
+	if (fd >= 0) {
+		ioctl(fd, enabled ? PERF_EVENT_IOC_RESET : PERF_EVENT_IOC_DISABLE, 0);
+		if (enabled)
+			ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+	}
+}
+
+static int compare_uint64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *) a;
+	uint64_t y = *(const uint64_t *) b;
+
+	return (x > y) - (x < y);
+}
+
+/**
+ * Issues requests and allocates timeslots from @start_tslot up to @end_tslot,
+ *    starting with @*next_request. Records the cycles of each step in
+ *    @step_cycles, if not NULL. Returns the number of edges admitted.
+ */
+static uint64_t run_steps(struct request_info *requests, uint32_t num_requests,
+		struct request_info **next_request, uint32_t start_tslot,
+		uint32_t end_tslot, uint64_t *step_cycles)
+{
+	struct request_info *current = *next_request;
+	uint64_t n_admitted = 0;
+	uint64_t start, s;
+	uint32_t b;
+
+	for (b = start_tslot / TSLOTS_PER_STEP, s = 0;
+			b < end_tslot / TSLOTS_PER_STEP; b++, s++) {
+		if (step_cycles != NULL)
+			start = current_time();
+
+		/* issue all new requests for this step, timeslots wrap at 2^16 */
+		while (current < requests + num_requests &&
+				(current->timeslot / TSLOTS_PER_STEP) ==
+				(b % (65536 / TSLOTS_PER_STEP))) {
+			alloc_add_backlog(current->src, current->dst, current->backlog);
+			current++;
+		}
+		n_admitted += alloc_step();
+
+		if (step_cycles != NULL)
+			step_cycles[s] = current_time() - start;
+	}
+
+	*next_request = current;
+	return n_admitted;
+}
+
+/**
+ * Runs one experiment with @params, filling in @results. Returns 0 on success.
+ */
+static int run_benchmark(struct bench_params *params,
+		struct bench_results *results)
+{
+	struct request_info *requests, *next_request;
+	struct timespec start_ts, end_ts;
+	uint64_t *step_cycles;
+	uint64_t start_tsc, end_tsc, n_steps, i;
+	uint32_t max_requests, num_requests;
+	double ns_per_cycle;
+	int fd_misses, fd_refs;
+
+	/* same seed, same demand, whichever allocator this is */
+	srand(params->seed);
+	max_requests = params->duration * params->num_nodes;
+	requests = (struct request_info *)
+			malloc(max_requests * sizeof(struct request_info));
+	if (requests == NULL)
+		return -1;
+	num_requests = generate_requests_workload(requests, max_requests,
+			params->num_nodes, params->duration, params->load,
+			params->mean_size, params->size_cdf, params->dst_pattern,
+			params->dst_param);
+	if (num_requests == 0) {
+		free(requests);
+		return -1;
+	}
+
+	n_steps = (params->duration / TSLOTS_PER_STEP) -
+			(params->warm_up / TSLOTS_PER_STEP);
+	step_cycles = (uint64_t *) malloc(n_steps * sizeof(uint64_t));
+	if (step_cycles == NULL) {
+		free(requests);
+		return -1;
+	}
+
+	/* warm up, so there is backlog once timing starts */
+	next_request = requests;
+	run_steps(requests, num_requests, &next_request, 0, params->warm_up, NULL);
+
+	fd_misses = open_cache_counter(PERF_COUNT_HW_CACHE_MISSES);
+	fd_refs = open_cache_counter(PERF_COUNT_HW_CACHE_REFERENCES);
+	set_counter_enabled(fd_misses, true);
+	set_counter_enabled(fd_refs, true);
+
+	clock_gettime(CLOCK_MONOTONIC, &start_ts);
+	start_tsc = current_time();
+	results->n_admitted = run_steps(requests, num_requests, &next_request,
+			params->warm_up, params->duration, step_cycles);
+	end_tsc = current_time();
+	clock_gettime(CLOCK_MONOTONIC, &end_ts);
+
+	set_counter_enabled(fd_misses, false);
+	set_counter_enabled(fd_refs, false);
+	results->cache_misses = read_counter(fd_misses);
+	results->cache_refs = read_counter(fd_refs);
+	if (fd_misses >= 0)
+		close(fd_misses);
+	if (fd_refs >= 0)
+		close(fd_refs);
+
+	/* the TSC rate comes from the same interval, no need for a constant */
+	results->n_steps = n_steps;
+	results->n_tslots = n_steps * TSLOTS_PER_STEP;
+	results->secs = (end_ts.tv_sec - start_ts.tv_sec) +
+			(end_ts.tv_nsec - start_ts.tv_nsec) * 1e-9;
+	ns_per_cycle = results->secs * 1e9 / (double) (end_tsc - start_tsc);
+
+	qsort(step_cycles, n_steps, sizeof(uint64_t), compare_uint64);
+	for (i = 0; i < N_LATENCY_PERCENTILES; i++) {
+		uint64_t index = (uint64_t) (latency_percentiles[i] * (n_steps - 1));
+		results->latency_ns[i] = step_cycles[index] * ns_per_cycle;
+	}
+	results->max_latency_ns = step_cycles[n_steps - 1] * ns_per_cycle;
+
+	free(step_cycles);
+	free(requests);
+	return 0;
+}
+
+static void print_csv_header(void)
+{
+	printf("allocator, cores, nodes, racks, load, tslots_per_step, timeslots, "
+			"tslots_per_sec, admitted_fraction, step_p50_ns, step_p90_ns, "
+			"step_p99_ns, step_p999_ns, step_max_ns, cache_misses_per_tslot, "
+			"cache_refs_per_tslot\n");
+}
+
+static double per_tslot(int64_t count, uint64_t n_tslots)
+{
+	return (count < 0) ? -1.0 : (double) count / n_tslots;
+}
+
+static void print_results(struct bench_params *params,
+		struct bench_results *results)
+{
+	double tslots_per_sec = results->n_tslots / results->secs;
+	double admitted_fraction = (double) results->n_admitted /
+			((double) results->n_tslots * params->num_nodes);
+
+	if (!params->json) {
+		printf("%s, %u, %u, %u, %f, %u, %" PRIu64 ", %f, %f, %f, %f, %f, %f, "
+				"%f, %f, %f\n", ALLOC_NAME, params->n_cores,
+				params->num_nodes, params->num_racks, params->load,
+				TSLOTS_PER_STEP, results->n_tslots, tslots_per_sec,
+				admitted_fraction, results->latency_ns[0],
+				results->latency_ns[1], results->latency_ns[2],
+				results->latency_ns[3], results->max_latency_ns,
+				per_tslot(results->cache_misses, results->n_tslots),
+				per_tslot(results->cache_refs, results->n_tslots));
+		return;
+	}
+
+	printf("{\"allocator\": \"%s\", \"cores\": %u, \"nodes\": %u, "
+			"\"racks\": %u, \"load\": %f, \"tslots_per_step\": %u, "
+			"\"timeslots\": %" PRIu64 ", \"tslots_per_sec\": %f, "
+			"\"admitted_fraction\": %f, \"step_latency_ns\": {\"p50\": %f, "
+			"\"p90\": %f, \"p99\": %f, \"p999\": %f, \"max\": %f}, ",
+			ALLOC_NAME, params->n_cores, params->num_nodes, params->num_racks,
+			params->load, TSLOTS_PER_STEP, results->n_tslots, tslots_per_sec,
+			admitted_fraction, results->latency_ns[0], results->latency_ns[1],
+			results->latency_ns[2], results->latency_ns[3],
+			results->max_latency_ns);
+	if (results->cache_misses < 0)
+		printf("\"cache_misses_per_tslot\": null, ");
+	else
+		printf("\"cache_misses_per_tslot\": %f, ",
+				per_tslot(results->cache_misses, results->n_tslots));
+	if (results->cache_refs < 0)
+		printf("\"cache_refs_per_tslot\": null}\n");
+	else
+		printf("\"cache_refs_per_tslot\": %f}\n",
+				per_tslot(results->cache_refs, results->n_tslots));
+}
+
+static void usage(char *prog_name)
+{
+	printf("usage: %s [-f LOAD] [-n NODES] [-r RACKS] [-c CORES] "
+			"[-d DURATION] [-w WARM_UP] [-m MEAN_SIZE] [-S SIZE_CDF] "
+			"[-p PATTERN[:PARAM]] [-s SEED] [-o csv|json] [-q]\n", prog_name);
+	printf("\tbenchmarks the %s allocator on Poisson demand of fraction LOAD "
+			"of capacity (default 0.8) among NODES endpoints (default %d) in "
+			"RACKS racks (default 1), for DURATION timeslots (default %d) of "
+			"which the first WARM_UP are not timed (default %d). CORES must "
+			"match the compiled number of cores (%d). Request sizes are "
+			"exponential with mean MEAN_SIZE, or drawn from the CDF in file "
+			"SIZE_CDF (e.g. ../rpc_tool/CDF_search.txt). PATTERN chooses "
+			"destinations: uniform (default), grouped:PERCENT_OUT_OF_GROUP, "
+			"hotspot:PERCENT, incast:N_TARGETS or permutation. -q omits the "
+			"CSV header.\n", ALLOC_NAME, NUM_NODES, DEFAULT_DURATION,
+			DEFAULT_WARM_UP, ALLOC_N_CORES);
+}
+
+/**
+ * Parses "PATTERN[:PARAM]" from @arg into @params. Returns 0 on success.
+ */
+static int parse_dst_pattern(struct bench_params *params, char *arg)
+{
+	static const char *names[] = {"uniform", "grouped", "hotspot", "incast",
+			"permutation"};
+	char *param = strchr(arg, ':');
+	uint32_t i;
+
+	if (param != NULL)
+		*param++ = '\0';
+	for (i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+		if (strcmp(arg, names[i]) == 0) {
+			params->dst_pattern = (enum request_dst_pattern) i;
+			params->dst_param = (param == NULL) ? 0 : atoi(param);
+			return 0;
+		}
+	}
+	return -1;
+}
+
+/**
+ * Checks @params against what this allocator supports. Returns 0 if they are
+ *    valid.
+ */
+static int check_params(struct bench_params *params)
+{
+	uint32_t nodes_per_rack;
+
+	if (params->load <= 0 || params->load > 1) {
+		printf("load must be in (0, 1]\n");
+		return -1;
+	}
+	if (params->num_nodes < 2 || params->num_nodes > MAX_NODES) {
+		printf("nodes must be between 2 and %d\n", MAX_NODES);
+		return -1;
+	}
+	if (params->n_cores != ALLOC_N_CORES) {
+		printf("this binary was compiled for %d cores, rebuild to change\n",
+				ALLOC_N_CORES);
+		return -1;
+	}
+	if (params->warm_up >= params->duration) {
+		printf("warm-up must be shorter than the duration\n");
+		return -1;
+	}
+	if (params->duration / TSLOTS_PER_STEP - params->warm_up / TSLOTS_PER_STEP
+			== 0) {
+		printf("duration too short for batches of %d timeslots\n",
+				TSLOTS_PER_STEP);
+		return -1;
+	}
+	if (params->num_racks == 0 || params->num_nodes % params->num_racks != 0) {
+		printf("nodes must be a multiple of racks\n");
+		return -1;
+	}
+#if defined(EMULATION_ALGO)
+	nodes_per_rack = params->num_nodes / params->num_racks;
+	if ((nodes_per_rack & (nodes_per_rack - 1)) != 0) {
+		printf("nodes per rack must be a power of 2\n");
+		return -1;
+	}
+#else
+	(void) nodes_per_rack;
+	if (params->num_racks != 1) {
+		printf("the %s allocator does not model racks\n", ALLOC_NAME);
+		return -1;
+	}
+#endif
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	struct bench_params params;
+	struct bench_results results;
+	static struct request_size_cdf size_cdf;
+	int opt, rc, saved_stdout;
+
+	params.load = 0.8;
+	params.num_nodes = NUM_NODES;
+	params.num_racks = 1;
+	params.n_cores = ALLOC_N_CORES;
+	params.duration = DEFAULT_DURATION;
+	params.warm_up = DEFAULT_WARM_UP;
+	params.mean_size = DEFAULT_MEAN_SIZE;
+	params.size_cdf = NULL;
+	params.dst_pattern = REQ_DST_UNIFORM;
+	params.dst_param = 0;
+	params.seed = 42;
+	params.json = false;
+	params.header = true;
+
+	while ((opt = getopt(argc, argv, "f:n:r:c:d:w:m:S:p:s:o:q")) != -1) {
+		switch (opt) {
+		case 'f':
+			params.load = atof(optarg);
+			break;
+		case 'n':
+			params.num_nodes = atoi(optarg);
+			break;
+		case 'r':
+			params.num_racks = atoi(optarg);
+			break;
+		case 'c':
+			params.n_cores = atoi(optarg);
+			break;
+		case 'd':
+			params.duration = atoi(optarg);
+			break;
+		case 'w':
+			params.warm_up = atoi(optarg);
+			break;
+		case 'm':
+			params.mean_size = atof(optarg);
+			break;
+		case 'S':
+			if (load_request_size_cdf(&size_cdf, optarg) != 0) {
+				printf("could not read a size CDF from %s\n", optarg);
+				return -1;
+			}
+			params.size_cdf = &size_cdf;
+			break;
+		case 'p':
+			if (parse_dst_pattern(&params, optarg) != 0) {
+				usage(argv[0]);
+				return -1;
+			}
+			break;
+		case 's':
+			params.seed = atoi(optarg);
+			break;
+		case 'o':
+			if (strcmp(optarg, "json") == 0)
+				params.json = true;
+			else if (strcmp(optarg, "csv") != 0) {
+				usage(argv[0]);
+				return -1;
+			}
+			break;
+		case 'q':
+			params.header = false;
+			break;
+		default:
+			usage(argv[0]);
+			return -1;
+		}
+	}
+
+	if (check_params(&params) != 0)
+		return -1;
+
+	/* keep stdout machine-readable: allocators may print while they set up */
+	fflush(stdout);
+	saved_stdout = dup(STDOUT_FILENO);
+	dup2(STDERR_FILENO, STDOUT_FILENO);
+	rc = alloc_init(&params);
+	fflush(stdout);
+	dup2(saved_stdout, STDOUT_FILENO);
+	close(saved_stdout);
+	if (rc != 0) {
+		printf("could not initialize the %s allocator\n", ALLOC_NAME);
+		return -1;
+	}
+
+	if (run_benchmark(&params, &results) != 0) {
+		printf("could not generate requests\n");
+		return -1;
+	}
+
+	if (!params.json && params.header)
+		print_csv_header();
+	print_results(&params, &results);
+	return 0;
+}
@@ -34,7 +34,7 @@
 
 #ifdef EMULATION_ALGO
 #define ENDPOINTS_PER_COMM	NUM_NODES
-#define TOTAL_FLOWS_PER_COMM	(ENDPOINTS_PER_COMM * NUM_NODES * FLOWS_PER_NODE)
+#define TOTAL_PAIRS_PER_COMM	(ENDPOINTS_PER_COMM * NUM_NODES)
 #define BIN_MEMPOOL_SIZE PACKET_MEMPOOL_SIZE
 #else
 #define BIN_MEMPOOL_SIZE 2048
@@ -66,16 +66,17 @@ struct simple_ep_args e_args = {
 };
 
 /**
- * Return the index of the flow within next_packet_id, for this @src, @dst,
- * 	and @flow. Used only for emulation.
+ * Return the index of the pair within next_packet_id, for this @src and @dst.
+ * 	Requests are all for flow 0, so ids are kept per pair rather than per
+ * 	flow. Used only for emulation.
  */
 static inline
-uint32_t flow_index(uint16_t src, uint16_t dst, uint16_t flow) {
-	return ((src * NUM_NODES) + dst) * FLOWS_PER_NODE + flow;
+uint32_t pair_index(uint16_t src, uint16_t dst) {
+	return (src * NUM_NODES) + dst;
 }
 
 #if defined(EMULATION_ALGO)
-uint16_t	next_packet_id[TOTAL_FLOWS_PER_COMM];
+uint16_t	next_packet_id[TOTAL_PAIRS_PER_COMM];
 #endif
 
 // Runs one experiment. Returns the number of packets admitted.
@@ -103,8 +104,8 @@ uint32_t run_experiment(struct request_info *requests, uint32_t start_time,
         while ((current_request->timeslot >> BATCH_SHIFT) == (b % (65536 >> BATCH_SHIFT)) &&
                current_request < requests + num_requests) {
 #if defined (EMULATION_ALGO)
-        	uint16_t start_id = next_packet_id[flow_index(current_request->src,
-        			current_request->dst, 0)]++;
+        	uint16_t start_id = next_packet_id[pair_index(current_request->src,
+        			current_request->dst)]++;
         	add_backlog(status, current_request->src, current_request->dst,
                         current_request->backlog, start_id, NULL);
 #else
@@ -113,11 +114,10 @@ uint32_t run_experiment(struct request_info *requests, uint32_t start_time,
 #endif
             current_request++;
         }
-        flush_backlog(status);
+        flush_backlog(status, 0);
  
         // Get admissible traffic
         get_admissible_traffic(status, 0, 0, 1, 0);
-        handle_spent_demands(status);
 
         for (i = 0; i < ADMITTED_PER_BATCH; i++) {
         	/* get admitted traffic */
@@ -162,8 +162,8 @@ void run_admissible(struct request_info *requests, uint32_t start_time, uint32_t
         while ((current_request->timeslot >> BATCH_SHIFT) == (b % (65536 >> BATCH_SHIFT)) &&
                current_request < requests + num_requests) {
 #if defined (EMULATION_ALGO)
-        	uint16_t start_id = next_packet_id[flow_index(current_request->src,
-        			current_request->dst, 0)]++;
+        	uint16_t start_id = next_packet_id[pair_index(current_request->src,
+        			current_request->dst)]++;
         	add_backlog(status, current_request->src, current_request->dst,
                         current_request->backlog, start_id, NULL);
 #else
@@ -172,11 +172,10 @@ void run_admissible(struct request_info *requests, uint32_t start_time, uint32_t
 #endif
             current_request++;
         }
-        flush_backlog(status);
+        flush_backlog(status, 0);
 
         // Get admissible traffic
         get_admissible_traffic(status, 0, 0, 1, 0);
-        handle_spent_demands(status);
     }
 
     *next_request = current_request;
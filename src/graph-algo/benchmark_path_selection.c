@@ -0,0 +1,227 @@
+/*
+ * benchmark_path_selection.c
+ *
+ *  Created on: October 19, 2026
+ */
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "admitted.h"
+#include "path_selection.h"
+#include "platform.h"
+#include "random.h"
+#include "../protocol/topology.h"
+
+#define NUM_RACK_COUNTS 6
+#define NUM_RATIOS 4
+#define NUM_TRAFFIC_SAMPLES 1024
+#define TIMESLOTS_PER_THREAD 20000
+#define MAX_THREADS 64
+
+const uint16_t rack_counts [NUM_RACK_COUNTS] = {4, 8, 16, 32, 64, 128};
+const uint16_t oversubscription_ratios [NUM_RATIOS] = {1, 2, 4, 8};
+
+/* what each thread selects paths for. each has its own copy of the samples,
+ * since selecting paths writes them */
+struct thread_args {
+    uint16_t num_racks;
+    uint8_t rack_shift;
+    struct admitted_traffic *samples;
+    uint64_t n_tslots;
+    int error;
+};
+
+/**
+ * Fills @admitted with a random matching between nodes, in which each rack
+ *    sends and receives at most @inter_rack_capacity edges to other racks.
+ */
+static void generate_admitted(struct admitted_traffic *admitted,
+                              uint16_t num_nodes, uint8_t rack_shift,
+                              uint16_t inter_rack_capacity, u32 *rand_state)
+{
+    uint16_t dsts[MAX_NODES];
+    uint16_t src_rack_out[MAX_NODES];
+    uint16_t dst_rack_in[MAX_NODES];
+    uint16_t i, j, tmp;
+
+    for (i = 0; i < num_nodes; i++) {
+        dsts[i] = i;
+        src_rack_out[i] = 0;
+        dst_rack_in[i] = 0;
+    }
+    /* shuffle destinations */
+    for (i = num_nodes - 1; i > 0; i--) {
+        j = random_int(rand_state, i + 1);
+        tmp = dsts[i];
+        dsts[i] = dsts[j];
+        dsts[j] = tmp;
+    }
+
+    init_admitted_traffic(admitted);
+    for (i = 0; i < num_nodes; i++) {
+        uint16_t src_rack = i >> rack_shift;
+        uint16_t dst_rack = dsts[i] >> rack_shift;
+
+        if (dsts[i] == i)
+            continue;
+        if (src_rack != dst_rack) {
+            if (src_rack_out[src_rack] == inter_rack_capacity ||
+                dst_rack_in[dst_rack] == inter_rack_capacity)
+                continue;
+            src_rack_out[src_rack]++;
+            dst_rack_in[dst_rack]++;
+        }
+        insert_admitted_edge(admitted, i, dsts[i]);
+    }
+}
+
+static double elapsed_sec(struct timespec *start, struct timespec *end)
+{
+    return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) * 1e-9;
+}
+
+/**
+ * Selects paths for timeslots over and over, each thread with its own state
+ */
+static void *run_path_selection(void *void_args)
+{
+    struct thread_args *args = (struct thread_args *) void_args;
+    struct path_sel_state *state;
+    uint64_t t;
+
+    state = create_path_sel_state(args->num_racks, args->rack_shift);
+    if (state == NULL) {
+        args->error = 1;
+        return NULL;
+    }
+
+    for (t = 0; t < args->n_tslots; t++)
+        select_paths_with_state(state, &args->samples[t % NUM_TRAFFIC_SAMPLES]);
+
+    destroy_path_sel_state(state);
+    return NULL;
+}
+
+static void usage(char *prog_name)
+{
+    printf("usage: %s [n_threads]\n", prog_name);
+    printf("\tselects paths for random timeslots with NUM_PATHS=%d, over rack "
+           "counts and oversubscription ratios, with n_threads threads each "
+           "taking its own timeslots (default 1)\n", NUM_PATHS);
+}
+
+int main(int argc, char **argv)
+{
+    struct admitted_traffic *samples;
+    struct path_sel_state *check_state;
+    struct thread_args args[MAX_THREADS];
+    pthread_t threads[MAX_THREADS];
+    struct timespec start, end;
+    uint32_t n_threads = 1;
+    uint32_t i, j, k, n;
+    u32 rand_state;
+
+    if (argc > 2) {
+        usage(argv[0]);
+        return -1;
+    }
+    if (argc == 2) {
+        n_threads = atoi(argv[1]);
+        if (n_threads == 0 || n_threads > MAX_THREADS) {
+            usage(argv[0]);
+            return -1;
+        }
+    }
+
+    samples = (struct admitted_traffic *)
+            malloc(NUM_TRAFFIC_SAMPLES * sizeof(struct admitted_traffic));
+    if (samples == NULL) {
+        printf("could not allocate traffic samples\n");
+        return -1;
+    }
+    for (n = 0; n < n_threads; n++) {
+        args[n].samples = (struct admitted_traffic *)
+                malloc(NUM_TRAFFIC_SAMPLES * sizeof(struct admitted_traffic));
+        if (args[n].samples == NULL) {
+            printf("could not allocate traffic samples\n");
+            return -1;
+        }
+    }
+    seed_random(&rand_state, 42);
+
+    printf("num_racks, oversubscription_ratio, threads, admitted_per_tslot, "
+           "ns_per_tslot, tslots_per_sec\n");
+
+    for (i = 0; i < NUM_RACK_COUNTS; i++) {
+        uint16_t num_racks = rack_counts[i];
+        uint16_t nodes_per_rack = MAX_NODES / num_racks;
+        uint8_t rack_shift = __builtin_ctz(nodes_per_rack);
+        if (nodes_per_rack < 2)
+            continue;
+
+        for (j = 0; j < NUM_RATIOS; j++) {
+            uint16_t ratio = oversubscription_ratios[j];
+            uint16_t capacity = nodes_per_rack / ratio;
+            uint64_t n_admitted = 0;
+            if (capacity == 0)
+                continue;
+
+            check_state = create_path_sel_state(num_racks, rack_shift);
+            if (check_state == NULL) {
+                printf("cannot select paths among %u racks, graphs are too "
+                       "small\n", num_racks);
+                continue;
+            }
+
+            /* generate traffic, and check selected paths once */
+            for (k = 0; k < NUM_TRAFFIC_SAMPLES; k++) {
+                generate_admitted(&samples[k], MAX_NODES, rack_shift, capacity,
+                                  &rand_state);
+                n_admitted += samples[k].size;
+                select_paths_with_state(check_state, &samples[k]);
+                if (!paths_are_valid_with_state(check_state, &samples[k])) {
+                    printf("invalid paths for %u racks, ratio %u\n", num_racks,
+                           ratio);
+                    return -1;
+                }
+            }
+            destroy_path_sel_state(check_state);
+            for (n = 0; n < n_threads; n++)
+                memcpy(args[n].samples, samples,
+                       NUM_TRAFFIC_SAMPLES * sizeof(struct admitted_traffic));
+
+            /* time path selection, threads take independent timeslots */
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            for (n = 0; n < n_threads; n++) {
+                args[n].num_racks = num_racks;
+                args[n].rack_shift = rack_shift;
+                args[n].n_tslots = TIMESLOTS_PER_THREAD;
+                args[n].error = 0;
+                pthread_create(&threads[n], NULL, run_path_selection, &args[n]);
+            }
+            for (n = 0; n < n_threads; n++) {
+                pthread_join(threads[n], NULL);
+                if (args[n].error) {
+                    printf("thread %u could not allocate state\n", n);
+                    return -1;
+                }
+            }
+            clock_gettime(CLOCK_MONOTONIC, &end);
+
+            double sec = elapsed_sec(&start, &end);
+            double total_tslots = (double) n_threads * TIMESLOTS_PER_THREAD;
+            printf("%u, %u, %u, %f, %f, %f\n", num_racks, ratio, n_threads,
+                   (double) n_admitted / NUM_TRAFFIC_SAMPLES,
+                   sec * 1e9 * n_threads / total_tslots, total_tslots / sec);
+        }
+    }
+
+    for (n = 0; n < n_threads; n++)
+        free(args[n].samples);
+    free(samples);
+    return 0;
+}
@@ -16,9 +16,9 @@ void split(struct graph_structure *structure, struct graph_edges *edges_in,
     assert(edges_1 != NULL);
     assert(edges_2 != NULL);
 
-    uint8_t n = structure->n;
+    uint16_t n = structure->n;
 
-    uint8_t node, cur_node, new_node;
+    uint16_t node, cur_node, new_node;
     for (node = 0; node < n; node++) {
         cur_node = node;
 
@@ -12,6 +12,8 @@
 #define		fp_ring					rte_ring
 #define		fp_ring_enqueue			rte_ring_enqueue
 #define		fp_ring_enqueue_bulk	rte_ring_enqueue_bulk
+#define		fp_ring_enqueue_burst	rte_ring_enqueue_burst
+#define		fp_ring_free_count		rte_ring_free_count
 #define		fp_ring_dequeue			rte_ring_dequeue
 #define		fp_ring_dequeue_burst	rte_ring_dequeue_burst
 #define		fp_ring_create			rte_ring_create
@@ -85,6 +87,28 @@ int fp_ring_enqueue_bulk(struct fp_ring *ring, void **elems, unsigned n) {
 	return 0;
 }
 
+/**
+ * Enqueues as many of @n elems as fit
+ * @returns the number of elems enqueued
+ */
+static inline
+unsigned fp_ring_enqueue_burst(struct fp_ring *ring, void **elems, unsigned n) {
+	unsigned i;
+
+	for (i = 0; i < n; i++)
+		if (fp_ring_enqueue(ring, elems[i]) != 0)
+			break;
+
+	return i;
+}
+
+/**
+ * Returns the number of elems that can be enqueued
+ */
+static inline unsigned fp_ring_free_count(struct fp_ring *ring) {
+	return ring->head + ring->mask - ring->tail;
+}
+
 /**
  * dequeue
  * @returns 0 on success, -ENOENT if no empty
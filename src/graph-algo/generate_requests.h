@@ -9,9 +9,14 @@
 #define GENERATE_REQUESTS_H_
 
 #include <assert.h>
+#include <inttypes.h>
 #include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
 
+#include "../protocol/topology.h"
+
 /**
  * Used Numerical Recipes
  * http://en.wikipedia.org/wiki/Linear_congruential_generator
@@ -21,6 +26,45 @@
 
 #define REQ_GEN_LOG_TABLE_SIZE		(1 << 12)
 
+/* resolution of the inverse of empirical size CDFs */
+#define REQ_GEN_CDF_TABLE_SHIFT		12
+#define REQ_GEN_CDF_TABLE_SIZE		(1 << REQ_GEN_CDF_TABLE_SHIFT)
+#define REQ_GEN_CDF_MAX_POINTS		64
+
+/* requests generated per call in generate_requests_workload */
+#define REQ_GEN_BATCH_SIZE			64
+
+/* nodes per group for REQ_DST_GROUPED */
+#define REQ_GEN_GROUP_SIZE			32
+/* seed of REQ_DST_PERMUTATION, shared so all generators pick the same one */
+#define REQ_GEN_PERMUTATION_SEED	0x9e3779b9
+
+/* How destinations are chosen, the meaning of dst_param is in parentheses */
+enum request_dst_pattern {
+	REQ_DST_UNIFORM,		/* any other node (unused) */
+	REQ_DST_GROUPED,		/* same group of REQ_GEN_GROUP_SIZE nodes, except
+							   for a percent of requests (percent out of
+							   group) */
+	REQ_DST_HOTSPOT,		/* node 0 for a percent of requests, any other
+							   node otherwise (percent to the hotspot) */
+	REQ_DST_INCAST,			/* one of the first nodes (number of targets) */
+	REQ_DST_PERMUTATION,	/* a fixed node per source, no node sends to
+							   itself (unused) */
+};
+
+/*
+ * An empirical distribution of request sizes, in MTUs. Read from files with
+ * lines of "size index cumulative_probability", like the ones in rpc_tool.
+ */
+struct request_size_cdf {
+	uint32_t n_points;
+	uint32_t values[REQ_GEN_CDF_MAX_POINTS];
+	double cum_probs[REQ_GEN_CDF_MAX_POINTS];
+	double mean;
+	/* the smallest size whose cumulative probability covers each bucket */
+	uint32_t inverse[REQ_GEN_CDF_TABLE_SIZE];
+};
+
 // Stores info needed to generate a stream of requests on demand
 struct request_generator {
     double mean_t_btwn_requests;  // mean t for all requests
@@ -32,13 +76,18 @@ struct request_generator {
     double fractional_demand;
     double mean_request_size; /* fixed at init */
     double exp_dist_table[REQ_GEN_LOG_TABLE_SIZE];
+    /* sizes from this distribution, or exponential if NULL */
+    const struct request_size_cdf *size_cdf;
+    enum request_dst_pattern dst_pattern;
+    uint32_t dst_param;
+    uint16_t permutation[MAX_NODES];
 };
 
 // Info about a request generated as part of a stream on demand
 struct request {
     uint16_t src;
     uint16_t dst;
-    uint16_t backlog;
+    uint32_t backlog;
     double time;
 };
 
@@ -46,10 +95,74 @@ struct request {
 struct request_info {
     uint16_t src;
     uint16_t dst;
-    uint16_t backlog;
+    uint32_t backlog;
     uint16_t timeslot;
 };
 
+/**
+ * Reads an empirical size distribution from @filename into @cdf. Returns 0 on
+ *    success, -1 if the file cannot be read or is not a valid CDF.
+ */
+static inline
+int load_request_size_cdf(struct request_size_cdf *cdf, const char *filename)
+{
+	FILE *f;
+	double value, prob, prev_prob = 0;
+	uint32_t i, point;
+
+	f = fopen(filename, "r");
+	if (f == NULL)
+		return -1;
+
+	cdf->n_points = 0;
+	cdf->mean = 0;
+	while (fscanf(f, "%lf %*u %lf", &value, &prob) == 2) {
+		if (cdf->n_points == REQ_GEN_CDF_MAX_POINTS || value < 1 ||
+				prob < prev_prob || prob > 1) {
+			fclose(f);
+			return -1;
+		}
+		cdf->values[cdf->n_points] = (uint32_t) value;
+		cdf->cum_probs[cdf->n_points] = prob;
+		cdf->mean += cdf->values[cdf->n_points] * (prob - prev_prob);
+		cdf->n_points++;
+		prev_prob = prob;
+	}
+	fclose(f);
+	if (cdf->n_points == 0 || prev_prob < 1)
+		return -1;
+
+	/* invert the CDF at the middle of each bucket */
+	point = 0;
+	for (i = 0; i < REQ_GEN_CDF_TABLE_SIZE; i++) {
+		double p = (i + 0.5) / REQ_GEN_CDF_TABLE_SIZE;
+		while (cdf->cum_probs[point] < p)
+			point++;
+		cdf->inverse[i] = cdf->values[point];
+	}
+	return 0;
+}
+
+/*
+ * Returns a uniform variate in [0, 2^16) and advances the LCG. @rand_state is
+ * the caller's copy of the generator's state, so that it stays in a register
+ * while requests are written.
+ */
+static inline
+uint32_t next_uniform(uint32_t *rand_state)
+{
+	uint32_t r = *rand_state >> 16;
+	*rand_state = *rand_state * REQ_GEN_RAND_A + REQ_GEN_RAND_C;
+	return r;
+}
+
+/* Returns a uniform variate in [0, @n) */
+static inline
+uint32_t next_uniform_int(uint32_t *rand_state, uint32_t n)
+{
+	return (next_uniform(rand_state) * n) >> 16;
+}
+
 static inline
 void reinit_request_generator(struct request_generator* gen,
 		double mean_t_btwn_requests, double start_time)
@@ -63,7 +176,8 @@ void reinit_request_generator(struct request_generator* gen,
 
 // Initialize a request_generator, to enable generation of a stream
 // of requests. Each sender generates a new request with a mean inter-arrival
-// mean_t_btwn_requests
+// mean_t_btwn_requests. Destinations are uniform and sizes exponential, until
+// set otherwise.
 static inline
 void init_request_generator(struct request_generator *gen,
 		double mean_t_btwn_requests, double start_time,
@@ -78,6 +192,9 @@ void init_request_generator(struct request_generator *gen,
 	reinit_request_generator(gen, mean_t_btwn_requests, start_time);
 
 	gen->rand_state = rand();
+	gen->size_cdf = NULL;
+	gen->dst_pattern = REQ_DST_UNIFORM;
+	gen->dst_param = 0;
 
 	// Based on a method suggested by wikipedia
 	// http://en.wikipedia.org/wiki/Exponential_distribution
@@ -87,101 +204,209 @@ void init_request_generator(struct request_generator *gen,
     }
 }
 
+/**
+ * Draws request sizes from @cdf instead of an exponential distribution, or
+ *    from the exponential again if @cdf is NULL. @cdf must outlive @gen.
+ */
+static inline
+void set_request_size_cdf(struct request_generator *gen,
+		const struct request_size_cdf *cdf)
+{
+	gen->size_cdf = cdf;
+	gen->fractional_demand = 0.0;
+}
+
+/**
+ * Chooses destinations with @pattern and @param, see enum request_dst_pattern.
+ *    Returns 0 on success, -1 if the pattern does not fit the nodes.
+ */
+static inline
+int set_request_dst_pattern(struct request_generator *gen,
+		enum request_dst_pattern pattern, uint32_t param)
+{
+	uint32_t seed = REQ_GEN_PERMUTATION_SEED;
+	uint16_t i, j, tmp;
+
+	switch (pattern) {
+	case REQ_DST_UNIFORM:
+		break;
+	case REQ_DST_GROUPED:
+		/* whole groups, and another group if any requests leave theirs */
+		if (param > 100 || gen->num_dst_nodes % REQ_GEN_GROUP_SIZE != 0 ||
+				gen->num_dst_nodes == 0 ||
+				(param > 0 && gen->num_dst_nodes == REQ_GEN_GROUP_SIZE))
+			return -1;
+		break;
+	case REQ_DST_HOTSPOT:
+		if (param > 100)
+			return -1;
+		break;
+	case REQ_DST_INCAST:
+		if (param == 0 || param > gen->num_dst_nodes)
+			return -1;
+		break;
+	case REQ_DST_PERMUTATION:
+		if (gen->num_dst_nodes < 2 || gen->num_dst_nodes > MAX_NODES)
+			return -1;
+		/* Sattolo's shuffle makes one cycle, so no node maps to itself */
+		for (i = 0; i < gen->num_dst_nodes; i++)
+			gen->permutation[i] = i;
+		for (i = gen->num_dst_nodes - 1; i > 0; i--) {
+			j = (((seed >> 16) * i) >> 16);
+			seed = seed * REQ_GEN_RAND_A + REQ_GEN_RAND_C;
+			tmp = gen->permutation[i];
+			gen->permutation[i] = gen->permutation[j];
+			gen->permutation[j] = tmp;
+		}
+		break;
+	default:
+		return -1;
+	}
+
+	gen->dst_pattern = pattern;
+	gen->dst_param = param;
+	return 0;
+}
+
 static inline
 double generate_exponential_variate(struct request_generator *gen,
-		double mean_t_btwn_requests)
+		uint32_t *rand_state, double mean_t_btwn_requests)
 {
 	uint32_t table_index;
   assert(mean_t_btwn_requests > 0);
 
-  table_index = ((gen->rand_state >> 16) * REQ_GEN_LOG_TABLE_SIZE) >> 16;
-  gen->rand_state = gen->rand_state * REQ_GEN_RAND_A + REQ_GEN_RAND_C;
+  table_index = (next_uniform(rand_state) * REQ_GEN_LOG_TABLE_SIZE) >> 16;
 
   return gen->exp_dist_table[table_index] * mean_t_btwn_requests;
 }
 
-// Populate a request with info about the next request
+/* Returns a destination other than @src among @num_dst_nodes, uniformly */
 static inline
-void get_next_request(struct request_generator *gen, struct request *req) {
-    assert(gen != NULL);
-    assert(req != NULL);
+uint16_t choose_uniform_dst(uint32_t *rand_state, uint16_t num_dst_nodes,
+		uint16_t src)
+{
+	uint16_t dst = next_uniform_int(rand_state, num_dst_nodes - 1);
+	if (dst >= src)
+		dst++;  // Don't send to self
+	return dst;
+}
 
-    double inter_arrival_t = 0.0;
-    double new_demand = gen->fractional_demand;
-
-    do {
-    	inter_arrival_t += generate_exponential_variate(gen, gen->mean_t_btwn_requests);
-    	new_demand += generate_exponential_variate(gen, gen->mean_request_size);
-    } while ((uint16_t)new_demand < 1);
-
-    req->time = gen->last_request_t + inter_arrival_t;
-    gen->last_request_t = req->time;
-    req->backlog = (uint16_t)new_demand;
-    gen->fractional_demand = new_demand - (uint16_t)new_demand;
-
-    req->src = ((gen->rand_state >> 16) * gen->num_src_nodes) >> 16;
-    req->src += gen->first_src_node;
-    gen->rand_state = gen->rand_state * REQ_GEN_RAND_A + REQ_GEN_RAND_C;
-    req->dst = ((gen->rand_state >> 16) * (gen->num_dst_nodes - 1)) >> 16;
-    gen->rand_state = gen->rand_state * REQ_GEN_RAND_A + REQ_GEN_RAND_C;
-    if (req->dst >= req->src)
-        req->dst++;  // Don't send to self
+/* Returns the destination of a request from @src, for skewed dst_patterns */
+static inline
+uint16_t choose_skewed_dst(struct request_generator *gen,
+		uint32_t *rand_state, uint16_t src)
+{
+	uint16_t dst;
+
+	switch (gen->dst_pattern) {
+	case REQ_DST_GROUPED:
+		if (next_uniform_int(rand_state, 100) < gen->dst_param) {
+			/* to a different group */
+			dst = next_uniform_int(rand_state,
+					gen->num_dst_nodes - REQ_GEN_GROUP_SIZE);
+			if (dst >= (src & ~(REQ_GEN_GROUP_SIZE - 1)))
+				dst += REQ_GEN_GROUP_SIZE; /* skip past the group of src */
+		} else {
+			/* in the same group */
+			dst = next_uniform_int(rand_state, REQ_GEN_GROUP_SIZE - 1);
+			if (dst >= (src & (REQ_GEN_GROUP_SIZE - 1)))
+				dst++;  // Don't send to self
+			dst += (src & ~(REQ_GEN_GROUP_SIZE - 1));
+		}
+		return dst;
+	case REQ_DST_HOTSPOT:
+		if (src != 0 && next_uniform_int(rand_state, 100) < gen->dst_param)
+			return 0;
+		break;
+	case REQ_DST_INCAST:
+		dst = next_uniform_int(rand_state, gen->dst_param);
+		if (dst != src)
+			return dst;
+		break;
+	case REQ_DST_PERMUTATION:
+		if (src < gen->num_dst_nodes)
+			return gen->permutation[src];
+		break;
+	default:
+		break;
+	}
+	return choose_uniform_dst(rand_state, gen->num_dst_nodes, src);
 }
 
-/*
- * Populate a request with info about the next request, but bias destinations
- * so that they're more likely to be in the same group. Each group has
- * 32 members and @percenter_out_of_group / 100 of requests will go to a
- * different group.
+/**
+ * Fills @reqs with the next @n requests. The generator's running state stays
+ *    in locals for the whole batch, rather than going back to memory with
+ *    every request written.
  */
 static inline
-void get_next_request_biased(struct request_generator *gen,
-		struct request *req, uint32_t percent_out_of_group) {
+void get_next_requests(struct request_generator *gen, struct request *reqs,
+		uint32_t n) {
     assert(gen != NULL);
-    assert(req != NULL);
-    uint16_t out_of_group;
-
-    double inter_arrival_t = 0.0;
-    double new_demand = gen->fractional_demand;
-
-    do {
-    	inter_arrival_t += generate_exponential_variate(gen, gen->mean_t_btwn_requests);
-    	new_demand += generate_exponential_variate(gen, gen->mean_request_size);
-    } while ((uint16_t)new_demand < 1);
-
-    req->time = gen->last_request_t + inter_arrival_t;
-    gen->last_request_t = req->time;
-    req->backlog = (uint16_t)new_demand;
-    gen->fractional_demand = new_demand - (uint16_t)new_demand;
-
-    /* choose source */
-    req->src = ((gen->rand_state >> 16) * gen->num_src_nodes) >> 16;
-    req->src += gen->first_src_node;
-    gen->rand_state = gen->rand_state * REQ_GEN_RAND_A + REQ_GEN_RAND_C;
-
-    /* determine if in same rack */
-    out_of_group = ((gen->rand_state >> 16) * 100) >> 16;
-    gen->rand_state = gen->rand_state * REQ_GEN_RAND_A + REQ_GEN_RAND_C;
-    if (out_of_group < percent_out_of_group) {
-    	/* to a different group */
-    	req->dst = ((gen->rand_state >> 16) * (gen->num_dst_nodes - 32)) >> 16;
-    	if (req->dst >= (req->src & ~0x1F))
-    		req->dst += 32; /* skip past the group of src */
-    } else {
-    	/* in the same group */
-    	req->dst = ((gen->rand_state >> 16) * 31) >> 16;
-    	if (req->dst >= req->src)
-    		req->dst++;  // Don't send to self
-    	req->dst += (req->src & ~0x1F); /* put in the same group as src */
+    assert(reqs != NULL);
+    uint32_t rand_state = gen->rand_state;
+    double last_t = gen->last_request_t;
+    double fractional_demand = gen->fractional_demand;
+    const double mean_t = gen->mean_t_btwn_requests;
+    const double mean_size = gen->mean_request_size;
+    const struct request_size_cdf *size_cdf = gen->size_cdf;
+    const uint16_t first_src = gen->first_src_node;
+    const uint16_t num_src_nodes = gen->num_src_nodes;
+    const uint16_t num_dst_nodes = gen->num_dst_nodes;
+    const bool uniform_dsts = (gen->dst_pattern == REQ_DST_UNIFORM);
+    uint32_t i;
+
+    for (i = 0; i < n; i++) {
+    	struct request *req = &reqs[i];
+    	double inter_arrival_t = 0.0;
+    	uint16_t src;
+
+    	if (size_cdf != NULL) {
+    		/* one request per arrival, sizes looked up in the inverse CDF */
+    		inter_arrival_t = generate_exponential_variate(gen, &rand_state,
+    				mean_t);
+    		req->backlog = size_cdf->inverse[next_uniform(&rand_state) >>
+    		                                 (16 - REQ_GEN_CDF_TABLE_SHIFT)];
+    	} else {
+    		double new_demand = fractional_demand;
+
+    		do {
+    			inter_arrival_t += generate_exponential_variate(gen,
+    					&rand_state, mean_t);
+    			new_demand += generate_exponential_variate(gen, &rand_state,
+    					mean_size);
+    		} while ((uint32_t)new_demand < 1);
+
+    		req->backlog = (uint32_t)new_demand;
+    		fractional_demand = new_demand - (uint32_t)new_demand;
+    	}
+
+    	last_t += inter_arrival_t;
+    	req->time = last_t;
+
+    	src = first_src + next_uniform_int(&rand_state, num_src_nodes);
+    	req->src = src;
+    	if (uniform_dsts)
+    		req->dst = choose_uniform_dst(&rand_state, num_dst_nodes, src);
+    	else
+    		req->dst = choose_skewed_dst(gen, &rand_state, src);
     }
-    gen->rand_state = gen->rand_state * REQ_GEN_RAND_A + REQ_GEN_RAND_C;
+
+    gen->rand_state = rand_state;
+    gen->last_request_t = last_t;
+    gen->fractional_demand = fractional_demand;
+}
+
+// Populate a request with info about the next request
+static inline
+void get_next_request(struct request_generator *gen, struct request *req) {
+    get_next_requests(gen, req, 1);
 }
 
 // Helper method for benchmarking schedule quality in Python
 static inline
 struct request *create_next_request(struct request_generator *gen) {
     assert(gen != NULL);
-    
+
     struct request *req = (struct request *) malloc(sizeof(struct request));
     if (req == NULL)
         return NULL;
@@ -216,45 +441,68 @@ struct request_generator *create_request_generator(double mean_t_btwn_requests,
     return gen;
 }
 
-// Generate a sequence of requests with Poisson arrival times, puts them in edges
-// Returns the number of requests generated
+// Generate a sequence of requests with Poisson arrival times per sender,
+// sizes from @size_cdf (exponential with @mean if NULL) and destinations
+// chosen with @dst_pattern, puts them in edges.
+// Returns the number of requests generated, or 0 if the pattern is invalid
 static inline
-uint32_t generate_requests_poisson(struct request_info *edges, uint32_t size,
-                                   uint32_t num_nodes, uint32_t duration,
-                                   double fraction, double mean)
+uint32_t generate_requests_workload(struct request_info *edges, uint32_t size,
+                                    uint32_t num_nodes, uint32_t duration,
+                                    double fraction, double mean,
+                                    const struct request_size_cdf *size_cdf,
+                                    enum request_dst_pattern dst_pattern,
+                                    uint32_t dst_param)
 {
     assert(edges != NULL);
 
-    // Generate a sequence of requests with Poisson arrival times per sender
-    // and receivers chosen uniformly at random
-
     // Uses the on-demand request generator to generate requests
     // Convert mean from micros to nanos
     struct request_generator gen;
-    struct request req;
+    struct request reqs[REQ_GEN_BATCH_SIZE];
+    if (size_cdf != NULL)
+        mean = size_cdf->mean;
     init_request_generator(&gen, mean / fraction, 0, 0, num_nodes, num_nodes,
     		mean);
+    set_request_size_cdf(&gen, size_cdf);
+    if (set_request_dst_pattern(&gen, dst_pattern, dst_param) != 0)
+        return 0;
 
     struct request_info *current_edge = edges;
     uint32_t num_generated = 0;
     double current_time = 0.0;
     while (current_time < duration) {
-        get_next_request(&gen, &req);
-        current_edge->src = req.src;
-        current_edge->dst = req.dst;
-        current_edge->backlog = req.backlog;
-        current_edge->timeslot = (uint16_t) req.time;
-        if (current_edge->backlog == 0) {
-            printf("oops\n");
+        uint32_t i;
+        get_next_requests(&gen, reqs, REQ_GEN_BATCH_SIZE);
+        for (i = 0; i < REQ_GEN_BATCH_SIZE && current_time < duration &&
+                 num_generated < size; i++) {
+            current_edge->src = reqs[i].src;
+            current_edge->dst = reqs[i].dst;
+            current_edge->backlog = reqs[i].backlog;
+            current_edge->timeslot = (uint16_t) reqs[i].time;
+            if (current_edge->backlog == 0) {
+                printf("oops\n");
+            }
+            num_generated++;
+            current_edge++;
+            current_time = reqs[i].time;
         }
-        num_generated++;
-        current_edge++;
-        current_time = req.time;
+        if (num_generated == size)
+            break;
     }
 
-    assert(num_generated <= size);
-
     return num_generated;
 }
 
+// Generate a sequence of requests with Poisson arrival times per sender
+// and receivers chosen uniformly at random, puts them in edges
+// Returns the number of requests generated
+static inline
+uint32_t generate_requests_poisson(struct request_info *edges, uint32_t size,
+                                   uint32_t num_nodes, uint32_t duration,
+                                   double fraction, double mean)
+{
+    return generate_requests_workload(edges, size, num_nodes, duration,
+                                      fraction, mean, NULL, REQ_DST_UNIFORM, 0);
+}
+
 #endif /* GENERATE_REQUESTS_H_ */
@@ -13,20 +13,42 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #define MAX(X, Y) ((X) > (Y) ? (X) : (Y))
-#define MAX_DEGREE 64  // This cannot exceed 64, the width of the bitmaps
-#define MAX_GRAPH_NODES 64
+
+// Either can be overridden at compile time. Each vertex keeps its edges in
+// a bitmap of GRAPH_BITMAP_WORDS 64-bit words. By default a vertex can have
+// an edge from each of 256 nodes, and graphs can have up to 128 racks.
+#ifndef MAX_DEGREE
+#define MAX_DEGREE 256
+#endif
+#ifndef MAX_GRAPH_NODES
+#define MAX_GRAPH_NODES 128
+#endif
+#define GRAPH_BITMAP_WORDS ((MAX_DEGREE + 63) / 64)
+
+// Keep neighbor lists small when ids and indices fit in a byte
+#if (2 * MAX_GRAPH_NODES <= 256)
+typedef uint8_t graph_vertex_t;
+#else
+typedef uint16_t graph_vertex_t;
+#endif
+#if (MAX_DEGREE <= 256)
+typedef uint8_t graph_index_t;
+#else
+typedef uint16_t graph_index_t;
+#endif
 
 // The active edges in this graph
 struct graph_edges {
-    uint64_t neighbor_bitmaps[2 * MAX_GRAPH_NODES];
-} __attribute__((__packed__));
+    uint64_t neighbor_bitmaps[2 * MAX_GRAPH_NODES][GRAPH_BITMAP_WORDS];
+};
 
 // This tracks the id and index of a neighbor
 struct neighbor {
-    uint8_t id;
-    uint8_t index;
+    graph_vertex_t id;
+    graph_index_t index;
 } __attribute__((__packed__));
 
 // This tracks the neighbors of this vertex
@@ -38,65 +60,115 @@ struct vertex_info {
 // Active edges in a specific graph are stored in a graph_edges struct
 // n is the number of nodes on each side of the bipartite graph
 struct graph_structure {
-    uint8_t n;
+    uint16_t n;
     struct vertex_info vertices[2 * MAX_GRAPH_NODES];
 } __attribute__((__packed__));
 
 // Helper method for debugging
 static void print_graph(struct graph_structure *structure, struct graph_edges *edges);
 
+// Internal. Returns the index of the least significant set bit in word,
+// which must not be zero
+static inline __attribute__((always_inline))
+uint16_t _graph_bsf(uint64_t word) {
+    assert(word != 0);  // otherwise, results of bsfq are undefined
+    uint64_t result;
+    asm("bsfq %1,%0" : "=r"(result) : "r"(word));
+    return (uint16_t) result;
+}
+
+// Internal. Returns the index of the first set bit in a vertex's bitmap,
+// which must not be empty
+static inline __attribute__((always_inline))
+uint16_t _graph_first_set(const uint64_t *bitmap) {
+    uint16_t w;
+    for (w = 0; w < GRAPH_BITMAP_WORDS - 1; w++) {
+        if (bitmap[w] != 0)
+            break;
+    }
+    return w * 64 + _graph_bsf(bitmap[w]);
+}
+
+// Internal. Returns the index of the first clear bit in a vertex's bitmap,
+// which must not be full
+static inline __attribute__((always_inline))
+uint16_t _graph_first_clear(const uint64_t *bitmap) {
+    uint16_t w;
+    for (w = 0; w < GRAPH_BITMAP_WORDS - 1; w++) {
+        if (~bitmap[w] != 0)
+            break;
+    }
+    return w * 64 + _graph_bsf(~bitmap[w]);
+}
+
+static inline __attribute__((always_inline))
+bool _graph_test_bit(const uint64_t *bitmap, uint16_t index) {
+    return (bitmap[index >> 6] >> (index & 63)) & 0x1ULL;
+}
+
+static inline __attribute__((always_inline))
+void _graph_set_bit(uint64_t *bitmap, uint16_t index) {
+    bitmap[index >> 6] |= (0x1ULL << (index & 63));
+}
+
+static inline __attribute__((always_inline))
+void _graph_clear_bit(uint64_t *bitmap, uint16_t index) {
+    bitmap[index >> 6] &= ~(0x1ULL << (index & 63));
+}
+
 // Initialize the bipartite graph structure
 static inline
-void graph_structure_init(struct graph_structure *structure, uint8_t n) {
+void graph_structure_init(struct graph_structure *structure, uint16_t n) {
     assert(structure != NULL);
     assert(n <= MAX_GRAPH_NODES);
 
     structure->n = n;
 }
 
-// Initialize the active edges
+// Initialize the active edges. Only the 2n vertices in use are cleared.
 static inline
-void graph_edges_init(struct graph_edges *edges, uint8_t n) {
+void graph_edges_init(struct graph_edges *edges, uint16_t n) {
     assert(edges != NULL);
     assert(n <= MAX_GRAPH_NODES);
-    
-    int i;
-    for (i = 0; i < 2 * n; i++)
-        edges->neighbor_bitmaps[i] = 0;
+
+    memset(&edges->neighbor_bitmaps[0][0], 0,
+           2 * n * sizeof(edges->neighbor_bitmaps[0]));
 }
 
 // Returns true if vertex has at least one neighbor, false otherwise
 static inline
-bool has_neighbor(struct graph_edges *edges, uint8_t vertex) {
+bool has_neighbor(struct graph_edges *edges, uint16_t vertex) {
     assert(edges != NULL);
     assert(vertex < 2 * MAX_GRAPH_NODES);
 
-    return (edges->neighbor_bitmaps[vertex] != 0);
+    uint64_t any = 0;
+    uint16_t w;
+    for (w = 0; w < GRAPH_BITMAP_WORDS; w++)
+        any |= edges->neighbor_bitmaps[vertex][w];
+    return (any != 0);
 }
 
 // Returns the degree of vertex
 static inline
-uint8_t get_degree(struct graph_edges *edges, uint8_t vertex) {
+uint16_t get_degree(struct graph_edges *edges, uint16_t vertex) {
     assert(edges != NULL);
     assert(vertex < 2 * MAX_GRAPH_NODES);
 
-    uint8_t degree = 0;
-    uint64_t bitmap = edges->neighbor_bitmaps[vertex];
-    while (bitmap > 0) {
-        degree += bitmap & 0x1ULL;
-        bitmap = bitmap >> 1;
-    }
-    
+    uint16_t degree = 0;
+    uint16_t w;
+    for (w = 0; w < GRAPH_BITMAP_WORDS; w++)
+        degree += __builtin_popcountll(edges->neighbor_bitmaps[vertex][w]);
+
     return degree;
 }
 
 // Returns the max degree
 static inline
-uint8_t get_max_degree(struct graph_edges *edges, uint8_t n) {
+uint16_t get_max_degree(struct graph_edges *edges, uint16_t n) {
     assert(edges != NULL);
     assert(n <= MAX_GRAPH_NODES);
 
-    uint8_t max_degree = 0;
+    uint16_t max_degree = 0;
     int i;
     for (i = 0; i < 2 * n; i++)
         max_degree = MAX(max_degree, get_degree(edges, i));
@@ -107,33 +179,26 @@ uint8_t get_max_degree(struct graph_edges *edges, uint8_t n) {
 // Splits an edge off from u in src_edges and adds it to dst_edges
 // Returns the other vertex of the split off edge
 static inline
-uint8_t split_edge(struct graph_structure *structure, struct graph_edges *src_edges,
-                   struct graph_edges *dst_edges, uint8_t u) {
+uint16_t split_edge(struct graph_structure *structure, struct graph_edges *src_edges,
+                    struct graph_edges *dst_edges, uint16_t u) {
     assert(structure != NULL);
     assert(src_edges != NULL);
     assert(dst_edges != NULL);
     assert(u < 2 * structure->n);
 
     // Find a neighbor
-    uint64_t u_bitmap = src_edges->neighbor_bitmaps[u];
-    assert(u_bitmap != 0);  // otherwise, results of bsfq are undefined
-    uint64_t result;
-    asm("bsfq %1,%0" : "=r"(result) : "r"(u_bitmap));
-    uint8_t edge_index_u = (uint8_t) result;
+    uint16_t edge_index_u = _graph_first_set(src_edges->neighbor_bitmaps[u]);
+
+    uint16_t v = structure->vertices[u].neighbors[edge_index_u].id;
+    uint16_t edge_index_v = structure->vertices[u].neighbors[edge_index_u].index;
 
-    uint8_t v = structure->vertices[u].neighbors[edge_index_u].id;
-    uint8_t edge_index_v = structure->vertices[u].neighbors[edge_index_u].index;
-    uint64_t v_bitmap = src_edges->neighbor_bitmaps[v];
-    
     // Remove the edge in both source bitmaps
-    src_edges->neighbor_bitmaps[u] = u_bitmap & ~(0x1ULL << edge_index_u);
-    src_edges->neighbor_bitmaps[v] = v_bitmap & ~(0x1ULL << edge_index_v);
- 
+    _graph_clear_bit(src_edges->neighbor_bitmaps[u], edge_index_u);
+    _graph_clear_bit(src_edges->neighbor_bitmaps[v], edge_index_v);
+
     // Add the edge in both dest bitmaps
-    u_bitmap = dst_edges->neighbor_bitmaps[u];
-    v_bitmap = dst_edges->neighbor_bitmaps[v];
-    dst_edges->neighbor_bitmaps[u] = u_bitmap | (0x1ULL << edge_index_u);
-    dst_edges->neighbor_bitmaps[v] = v_bitmap | (0x1ULL << edge_index_v);
+    _graph_set_bit(dst_edges->neighbor_bitmaps[u], edge_index_u);
+    _graph_set_bit(dst_edges->neighbor_bitmaps[v], edge_index_v);
 
     return v;
 }
@@ -141,56 +206,45 @@ uint8_t split_edge(struct graph_structure *structure, struct graph_edges *src_ed
 // Removes an edge from u in src_edges
 // Returns the other vertex of the removed edge
 static inline
-uint8_t remove_edge_to_neighbor(struct graph_structure *structure,
-                                struct graph_edges *src_edges,
-                                uint8_t u) {
+uint16_t remove_edge_to_neighbor(struct graph_structure *structure,
+                                 struct graph_edges *src_edges,
+                                 uint16_t u) {
     assert(structure != NULL);
     assert(src_edges != NULL);
     assert(u < 2 * structure->n);
 
     // Find a neighbor
-    uint64_t u_bitmap = src_edges->neighbor_bitmaps[u];
-    assert(u_bitmap != 0);  // otherwise, results of bsfq are undefined
-    uint64_t result;
-    asm("bsfq %1,%0" : "=r"(result) : "r"(u_bitmap));
-    uint8_t edge_index_u = (uint8_t) result;
+    uint16_t edge_index_u = _graph_first_set(src_edges->neighbor_bitmaps[u]);
+
+    uint16_t v = structure->vertices[u].neighbors[edge_index_u].id;
+    uint16_t edge_index_v = structure->vertices[u].neighbors[edge_index_u].index;
 
-    uint8_t v = structure->vertices[u].neighbors[edge_index_u].id;
-    uint8_t edge_index_v = structure->vertices[u].neighbors[edge_index_u].index;
-    uint64_t v_bitmap = src_edges->neighbor_bitmaps[v];
-    
     // Remove the edge in both source bitmaps
-    src_edges->neighbor_bitmaps[u] = u_bitmap & ~(0x1ULL << edge_index_u);
-    src_edges->neighbor_bitmaps[v] = v_bitmap & ~(0x1ULL << edge_index_v);
- 
+    _graph_clear_bit(src_edges->neighbor_bitmaps[u], edge_index_u);
+    _graph_clear_bit(src_edges->neighbor_bitmaps[v], edge_index_v);
+
     return v;
 }
 
 // Adds an edge from vertex u to vertex v in the graph structure and edges
 static inline
 void add_edge(struct graph_structure *structure, struct graph_edges *edges,
-              uint8_t u, uint8_t v) {
+              uint16_t u, uint16_t v) {
     assert(structure != NULL);
     assert(edges != NULL);
-    uint8_t n = structure->n;
+    uint16_t n = structure->n;
     assert(u < 2 * n);
     assert(v < 2 * n);
- 
+
     // Find empty spots for the edge
-    uint64_t u_bitmap = edges->neighbor_bitmaps[u];
-    assert(~u_bitmap != 0);  // otherwise, results of bsfq are undefined
-    uint64_t result;
-    asm("bsfq %1,%0" : "=r"(result) : "r"(~u_bitmap));
-    uint8_t edge_index_u = (uint8_t) result;
-
-    uint64_t v_bitmap = edges->neighbor_bitmaps[v];
-    assert(~v_bitmap != 0);
-    asm("bsfq %1,%0" : "=r"(result) : "r"(~v_bitmap));
-    uint8_t edge_index_v = (uint8_t) result;
- 
+    uint16_t edge_index_u = _graph_first_clear(edges->neighbor_bitmaps[u]);
+    uint16_t edge_index_v = _graph_first_clear(edges->neighbor_bitmaps[v]);
+    assert(edge_index_u < MAX_DEGREE);
+    assert(edge_index_v < MAX_DEGREE);
+
     // Add edge to edges
-    edges->neighbor_bitmaps[u] = u_bitmap | (0x1ULL << edge_index_u);
-    edges->neighbor_bitmaps[v] = v_bitmap | (0x1ULL << edge_index_v);
+    _graph_set_bit(edges->neighbor_bitmaps[u], edge_index_u);
+    _graph_set_bit(edges->neighbor_bitmaps[v], edge_index_v);
 
     // Add edge to structure
     struct vertex_info *u_info = &structure->vertices[u];
@@ -204,50 +258,50 @@ void add_edge(struct graph_structure *structure, struct graph_edges *edges,
 // Adds the edges from graph_2 to graph_1
 static inline
 void add_edges(struct graph_edges *edges_1, struct graph_edges *edges_2,
-               uint8_t n) {
+               uint16_t n) {
     assert(edges_1 != NULL);
     assert(edges_2 != NULL);
 
-    int i;
+    int i, w;
     for (i = 0; i < 2 * n; i++) {
-        uint64_t bitmap_1 = edges_1->neighbor_bitmaps[i];
-        uint64_t bitmap_2 = edges_2->neighbor_bitmaps[i];
-        assert((bitmap_1 & bitmap_2) == 0);
-        edges_1->neighbor_bitmaps[i] = bitmap_1 | bitmap_2;
+        for (w = 0; w < GRAPH_BITMAP_WORDS; w++) {
+            uint64_t bitmap_1 = edges_1->neighbor_bitmaps[i][w];
+            uint64_t bitmap_2 = edges_2->neighbor_bitmaps[i][w];
+            assert((bitmap_1 & bitmap_2) == 0);
+            edges_1->neighbor_bitmaps[i][w] = bitmap_1 | bitmap_2;
+        }
     }
 }
 
 // Copies an edge set
 static inline
 void copy_edges(struct graph_edges *src_edges, struct graph_edges *dst_edges,
-                uint8_t n) {
+                uint16_t n) {
     assert(src_edges != NULL);
     assert(dst_edges != NULL);
 
-    int i;
-    for (i = 0; i < 2 * n; i++)
-        dst_edges->neighbor_bitmaps[i] = src_edges->neighbor_bitmaps[i];
+    memcpy(&dst_edges->neighbor_bitmaps[0][0], &src_edges->neighbor_bitmaps[0][0],
+           2 * n * sizeof(src_edges->neighbor_bitmaps[0]));
 }
 
 // Finds an edge from u to v and marks it as set. Excludes edges set in existing_edges
 // Assumes the edge already exists in the structure!
 static inline
 void set_edge(struct graph_structure *structure, struct graph_edges *existing_edges,
-              struct graph_edges *edges, uint8_t u, uint8_t v) {
+              struct graph_edges *edges, uint16_t u, uint16_t v) {
     assert(structure != NULL);
     assert(existing_edges != NULL);
     assert(edges != NULL);
 
     struct vertex_info *u_info = &structure->vertices[u];
-    uint64_t u_bitmap_existing = existing_edges->neighbor_bitmaps[u];
-    uint64_t u_bitmap = edges->neighbor_bitmaps[u];
-    uint64_t v_bitmap = edges->neighbor_bitmaps[v];
+    uint64_t *u_bitmap_existing = existing_edges->neighbor_bitmaps[u];
+    uint64_t *u_bitmap = edges->neighbor_bitmaps[u];
     int i;
     for (i = 0; i < MAX_DEGREE; i++) {
-        if ((u_info->neighbors[i].id == v) && !(u_bitmap & (0x1ULL << i)) &&
-            !(u_bitmap_existing & (0x1ULL << i))) {
-            edges->neighbor_bitmaps[u] = u_bitmap | (0x1ULL << i);
-            edges->neighbor_bitmaps[v] = v_bitmap | (0x1ULL << u_info->neighbors[i].index);
+        if ((u_info->neighbors[i].id == v) && !_graph_test_bit(u_bitmap, i) &&
+            !_graph_test_bit(u_bitmap_existing, i)) {
+            _graph_set_bit(u_bitmap, i);
+            _graph_set_bit(edges->neighbor_bitmaps[v], u_info->neighbors[i].index);
             return;
         }
     }
@@ -256,24 +310,17 @@ void set_edge(struct graph_structure *structure, struct graph_edges *existing_ed
 // Returns true if the two graphs are equivalent, false otherwise
 static inline
 bool are_equal(struct graph_edges *edges_1, struct graph_edges *edges_2,
-               uint8_t n) {
+               uint16_t n) {
     assert(edges_1 != NULL);
     assert(edges_2 != NULL);
 
-    int i;
-    for (i = 0; i < 2 * n; i++) {
-        uint64_t bitmap_1 = edges_1->neighbor_bitmaps[i];
-        uint64_t bitmap_2 = edges_2->neighbor_bitmaps[i];
-        if (bitmap_1 != bitmap_2)
-            return false;
-    }
-
-    return true;
+    return memcmp(&edges_1->neighbor_bitmaps[0][0], &edges_2->neighbor_bitmaps[0][0],
+                  2 * n * sizeof(edges_1->neighbor_bitmaps[0])) == 0;
 }
 
 // Returns true if the graph is a perfect matching, false otherwise
 static inline
-bool is_perfect_matching(struct graph_edges *edges, uint8_t n) {
+bool is_perfect_matching(struct graph_edges *edges, uint16_t n) {
     assert(edges != NULL);
 
     int i;
@@ -287,7 +334,7 @@ bool is_perfect_matching(struct graph_edges *edges, uint8_t n) {
 
 // Helper methods for testing in python
 static inline
-struct graph_structure *create_graph_structure_test(uint8_t n) {
+struct graph_structure *create_graph_structure_test(uint16_t n) {
 
     struct graph_structure *structure_out =
     		(struct graph_structure *) malloc(sizeof(struct graph_structure));
@@ -304,7 +351,7 @@ void destroy_graph_structure_test(struct graph_structure *structure) {
 }
 
 static inline
-struct graph_edges *create_graph_edges_test(uint8_t n) {
+struct graph_edges *create_graph_edges_test(uint16_t n) {
 
     struct graph_edges *edges_out =
     		(struct graph_edges *) malloc(sizeof(struct graph_edges));
@@ -330,9 +377,12 @@ void print_graph(struct graph_structure *structure, struct graph_edges *edges) {
     int i, j;
     for (i = 0; i < 2 * structure->n; i++) {
         struct vertex_info *v_info = &structure->vertices[i];
-        printf("neighbors of %d: %"PRIx64"\t", i, edges->neighbor_bitmaps[i]);
+        printf("neighbors of %d: ", i);
+        for (j = GRAPH_BITMAP_WORDS - 1; j >= 0; j--)
+            printf("%016" PRIx64, edges->neighbor_bitmaps[i][j]);
+        printf("\t");
         for (j = 0; j < MAX_DEGREE; j++) {
-            if ((edges->neighbor_bitmaps[i] >> j) & 0x1ULL)
+            if (_graph_test_bit(edges->neighbor_bitmaps[i], j))
                 printf("%d (%d), ", v_info->neighbors[j].id, v_info->neighbors[j].index);
         }
         printf("\n");
@@ -349,10 +399,10 @@ bool is_consistent(struct graph_structure *structure, struct graph_edges *edges)
     for (i = 0; i < 2 * structure->n; i++) {
         struct vertex_info *v_info = &structure->vertices[i];
         for (j = 0; j < MAX_DEGREE; j++) {
-            if ((edges->neighbor_bitmaps[i] >> j) & 0x1ULL) {
+            if (_graph_test_bit(edges->neighbor_bitmaps[i], j)) {
                 // There is an edge here!
-                uint8_t other = v_info->neighbors[j].id;
-                uint8_t v_index_for_other = v_info->neighbors[j].index;
+                uint16_t other = v_info->neighbors[j].id;
+                uint16_t v_index_for_other = v_info->neighbors[j].index;
                 struct vertex_info *other_info = &structure->vertices[other];
                 
                 // Check that other id is consistent
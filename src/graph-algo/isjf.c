@@ -0,0 +1,313 @@
+/*
+ * isjf.c
+ *
+ *  Created on: October 19, 2026
+ */
+
+#include "isjf.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+void isjf_add_backlog(struct isjf_status *status, uint16_t src, uint16_t dst,
+		uint32_t amount)
+{
+	assert(status != NULL);
+
+	if (amount == 0)
+		return; /* amount 0 would reset src */
+
+	while (fp_ring_enqueue(status->q_head,
+			ISJF_MAKE_REQUEST(src, dst, amount)) == -ENOBUFS)
+		status->stat.wait_for_space_in_q_head++;
+}
+
+void isjf_reset_sender(struct isjf_status *status, uint16_t src)
+{
+	assert(status != NULL);
+
+	while (fp_ring_enqueue(status->q_head,
+			ISJF_MAKE_REQUEST(src, 0, 0)) == -ENOBUFS)
+		status->stat.wait_for_space_in_q_head++;
+}
+
+// Get the key of this pair in the flow table
+static inline __attribute__((always_inline))
+uint32_t flow_key(uint16_t src, uint16_t dst) {
+	return ((src << FP_NODES_SHIFT) + dst) + 1;
+}
+
+// Get the first slot to probe for a key
+static inline __attribute__((always_inline))
+uint32_t home_slot(struct isjf_status *status, uint32_t key) {
+	/* multiplicative hashing, take the high bits */
+	return (uint32_t)(key * 2654435761U) >> status->hash_shift;
+}
+
+// Returns the slot of the key, or the empty slot where it would go
+static inline __attribute__((always_inline))
+uint32_t find_slot(struct isjf_status *status, uint32_t key)
+{
+	uint32_t i = home_slot(status, key);
+
+	while (status->slots[i].key != key
+			&& status->slots[i].key != ISJF_KEY_EMPTY)
+		i = (i + 1) & status->slot_mask;
+	return i;
+}
+
+// Empties slot @i, moving back later slots of the probe sequence so lookups
+// never stop early at the hole
+static inline
+void delete_slot(struct isjf_status *status, uint32_t i)
+{
+	uint32_t j = i;
+	uint32_t home;
+
+	while (1) {
+		j = (j + 1) & status->slot_mask;
+		if (status->slots[j].key == ISJF_KEY_EMPTY)
+			break;
+		/* an entry can move to i if its home is not in (i,j] cyclically */
+		home = home_slot(status, status->slots[j].key);
+		if (((j - home) & status->slot_mask) >= ((j - i) & status->slot_mask)) {
+			status->slots[i] = status->slots[j];
+			i = j;
+		}
+	}
+	status->slots[i].key = ISJF_KEY_EMPTY;
+}
+
+static inline __attribute__((always_inline))
+void bucket_append(struct isjf_status *status, uint32_t index, uint16_t bucket)
+{
+	struct isjf_flow *flow = &status->flows[index];
+	uint32_t tail = status->bucket_tail[bucket];
+
+	flow->prev = tail;
+	flow->next = ISJF_NONE;
+	if (tail == ISJF_NONE) {
+		status->bucket_head[bucket] = index;
+		status->non_empty_buckets[bucket >> 6] |= (1ULL << (bucket & 63));
+	} else {
+		status->flows[tail].next = index;
+	}
+	status->bucket_tail[bucket] = index;
+}
+
+static inline __attribute__((always_inline))
+void bucket_remove(struct isjf_status *status, uint32_t index, uint16_t bucket)
+{
+	struct isjf_flow *flow = &status->flows[index];
+
+	if (flow->prev == ISJF_NONE)
+		status->bucket_head[bucket] = flow->next;
+	else
+		status->flows[flow->prev].next = flow->next;
+
+	if (flow->next == ISJF_NONE)
+		status->bucket_tail[bucket] = flow->prev;
+	else
+		status->flows[flow->next].prev = flow->prev;
+
+	if (status->bucket_head[bucket] == ISJF_NONE)
+		status->non_empty_buckets[bucket >> 6] &= ~(1ULL << (bucket & 63));
+}
+
+// Removes the flow in slot @i from its bucket and from the table
+static inline
+void remove_flow(struct isjf_status *status, uint32_t i)
+{
+	uint32_t index = status->slots[i].flow;
+	struct isjf_flow *flow = &status->flows[index];
+
+	bucket_remove(status, index, isjf_bucket_index(flow->remaining));
+	delete_slot(status, i);
+
+	flow->next = status->free_flow;
+	status->free_flow = index;
+	status->n_flows--;
+}
+
+// Adds @amount to the backlog of (src,dst), moving it to its new bucket
+static inline
+void add_request(struct isjf_status *status, uint16_t src, uint16_t dst,
+		uint32_t amount)
+{
+	uint32_t key = flow_key(src, dst);
+	uint32_t i = find_slot(status, key);
+	uint32_t index;
+	struct isjf_flow *flow;
+	uint16_t old_bucket, new_bucket;
+
+	if (unlikely(src >= status->num_nodes || dst >= status->num_nodes)) {
+		/* the pool only has flows for pairs of the configured nodes */
+		status->stat.invalid_pair++;
+		return;
+	}
+
+	if (status->slots[i].key == key) {
+		index = status->slots[i].flow;
+		flow = &status->flows[index];
+		old_bucket = isjf_bucket_index(flow->remaining);
+		flow->remaining += amount;
+		new_bucket = isjf_bucket_index(flow->remaining);
+		if (new_bucket != old_bucket) {
+			bucket_remove(status, index, old_bucket);
+			bucket_append(status, index, new_bucket);
+		}
+		return;
+	}
+
+	/* there is a flow for every valid pair */
+	index = status->free_flow;
+	assert(index != ISJF_NONE);
+	flow = &status->flows[index];
+	status->free_flow = flow->next;
+	status->n_flows++;
+	status->stat.flows_added++;
+
+	flow->src = src;
+	flow->dst = dst;
+	flow->remaining = amount;
+	status->slots[i].key = key;
+	status->slots[i].flow = index;
+	bucket_append(status, index, isjf_bucket_index(amount));
+}
+
+// Drops all flows from src
+static inline
+void reset_src(struct isjf_status *status, uint16_t src)
+{
+	uint32_t key, i;
+	uint16_t dst;
+
+	for (dst = 0; dst < MAX_NODES; dst++) {
+		key = flow_key(src, dst);
+		i = find_slot(status, key);
+		if (status->slots[i].key == key)
+			remove_flow(status, i);
+	}
+}
+
+// Applies all requests and resets in q_head to the flows
+static void process_new_requests(struct isjf_status *status)
+{
+	uint64_t reqs[ISJF_RING_DEQUEUE_BURST_SIZE];
+	int n, i;
+
+	do {
+		n = fp_ring_dequeue_burst(status->q_head, (void **)&reqs[0],
+				ISJF_RING_DEQUEUE_BURST_SIZE);
+		for (i = 0; i < n; i++) {
+			uint64_t req = reqs[i];
+			uint32_t amount = ISJF_REQUEST_AMOUNT(req);
+
+			if (likely(amount != 0))
+				add_request(status, ISJF_REQUEST_SRC(req),
+						ISJF_REQUEST_DST(req), amount);
+			else
+				reset_src(status, ISJF_REQUEST_SRC(req));
+		}
+	} while (n > 0);
+}
+
+/**
+ * Allocates as many timeslots of the batch as @flow can get, up to its
+ *    remaining backlog. Returns the number allocated.
+ */
+static inline __attribute__((always_inline))
+uint32_t try_allocation(struct isjf_status *status, struct isjf_flow *flow)
+{
+	uint16_t src = flow->src;
+	uint16_t dst = flow->dst;
+	uint64_t timeslot_bitmap = batch_state_get_avail_bitmap(
+			&status->batch_state, src, dst);
+	uint32_t n = 0;
+
+	while (timeslot_bitmap != 0 && n < flow->remaining) {
+		uint64_t batch_timeslot = __builtin_ctzll(timeslot_bitmap);
+		uint64_t set_bit = timeslot_bitmap & (-timeslot_bitmap);
+
+		/* other timeslots of the bitmap stay available for the pair */
+		batch_state_set_occupied_conditional(&status->batch_state, src, dst,
+				batch_timeslot, set_bit);
+		insert_admitted_edge(status->admitted[batch_timeslot], src, dst);
+		timeslot_bitmap ^= set_bit;
+		n++;
+	}
+	return n;
+}
+
+/**
+ * Allocates the flows of one bucket, in order. Allocated flows only get
+ *    smaller, so they move to buckets this batch has already visited.
+ */
+static inline
+void allocate_bucket(struct isjf_status *status, uint16_t bucket)
+{
+	uint32_t index = status->bucket_head[bucket];
+
+	while (index != ISJF_NONE) {
+		struct isjf_flow *flow = &status->flows[index];
+		uint32_t next = flow->next;
+		uint32_t n = try_allocation(status, flow);
+
+		status->stat.flows_visited++;
+		if (n == flow->remaining) {
+			remove_flow(status, find_slot(status,
+					flow_key(flow->src, flow->dst)));
+			status->stat.flows_done++;
+		} else if (n != 0) {
+			uint16_t new_bucket = isjf_bucket_index(flow->remaining - n);
+
+			flow->remaining -= n;
+			if (new_bucket != bucket) {
+				bucket_remove(status, index, bucket);
+				bucket_append(status, index, new_bucket);
+				status->stat.flows_moved++;
+			}
+		}
+		index = next;
+	}
+}
+
+void isjf_get_admissible_traffic(struct isjf_status *status)
+{
+	uint32_t word, i;
+
+	assert(status != NULL);
+
+	process_new_requests(status);
+
+	while (fp_mempool_get_bulk(status->admitted_traffic_mempool,
+			(void **)&status->admitted[0], BATCH_SIZE) != 0)
+		status->stat.wait_for_admitted_struct++;
+	for (i = 0; i < BATCH_SIZE; i++)
+		init_admitted_traffic(status->admitted[i]);
+
+	batch_state_init(&status->batch_state, status->oversubscribed,
+			status->inter_rack_capacity, status->out_of_boundary_capacity,
+			status->num_nodes);
+
+	/* smallest remaining backlog first */
+	for (word = 0; word < ISJF_BUCKET_MASK_WORDS; word++) {
+		uint64_t mask = status->non_empty_buckets[word];
+
+		while (mask) {
+			uint16_t bucket = (word << 6) + __builtin_ctzll(mask);
+
+			mask &= mask - 1;
+			allocate_bucket(status, bucket);
+		}
+	}
+
+	for (i = 0; i < BATCH_SIZE; i++)
+		while (fp_ring_enqueue(status->q_admitted_out, status->admitted[i])
+				== -ENOBUFS)
+			status->stat.wait_for_space_in_q_admitted_out++;
+
+	status->current_timeslot += BATCH_SIZE;
+}
@@ -0,0 +1,255 @@
+/*
+ * isjf.h
+ *
+ *  Created on: October 19, 2026
+ */
+
+/*
+ * Incremental shortest-job-first allocator. Unlike the SJF allocator in
+ * admissible_traffic_sjf.c, which moves every flow through per-size bins of
+ * MAX_NODES^2 edges on every batch, this one keeps each flow in a bucket of
+ * its remaining size across batches. A batch visits non-empty buckets from
+ * the smallest, and a flow only moves when it is allocated. The flow pool has
+ * room for every pair of nodes, so backlog is never dropped for lack of a
+ * flow; batches only visit the flows with backlog.
+ *
+ * A single allocation core owns all of the state. Comm cores only enqueue
+ * (src,dst,amount) requests to q_head.
+ */
+
+#ifndef ISJF_H_
+#define ISJF_H_
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "admitted.h"
+#include "batch.h"
+#include "fp_ring.h"
+#include "platform.h"
+#include "../protocol/topology.h"
+
+/* flows with up to this much backlog each get a bucket of their own size.
+ * larger flows share a bucket with flows within 25% of their size. */
+#define ISJF_EXACT_BUCKETS			128
+#define ISJF_EXACT_SHIFT			7  // 2^ISJF_EXACT_SHIFT = ISJF_EXACT_BUCKETS
+#define ISJF_NUM_BUCKETS			256
+#define ISJF_BUCKET_MASK_WORDS		(ISJF_NUM_BUCKETS / 64)
+
+#define ISJF_NONE					0xFFFFFFFF
+#define ISJF_KEY_EMPTY				0
+
+/* requests in q_head pack the pair and the amount, amount 0 resets src */
+#define ISJF_MAKE_REQUEST(src,dst,amount) \
+	((void *)(((uint64_t)(amount) << 32) | ((uint32_t)(src) << 16) | (dst)))
+#define ISJF_REQUEST_SRC(req)		((uint16_t)((req) >> 16))
+#define ISJF_REQUEST_DST(req)		((uint16_t)((req)      ))
+#define ISJF_REQUEST_AMOUNT(req)	((uint32_t)((req) >> 32))
+
+#define ISJF_RING_DEQUEUE_BURST_SIZE	256
+
+/**
+ * A flow with backlog, linked into the bucket of its remaining size
+ * @remaining: timeslots still to allocate, never 0 while in a bucket
+ * @prev, @next: neighbours in the bucket, ISJF_NONE at the ends. A free flow
+ *    is linked into the free list through @next.
+ */
+struct isjf_flow {
+	uint16_t src;
+	uint16_t dst;
+	uint32_t remaining;
+	uint32_t prev;
+	uint32_t next;
+};
+
+/* A slot of the flow table: pair key, and the index of its flow */
+struct isjf_slot {
+	uint32_t key;
+	uint32_t flow;
+};
+
+struct isjf_statistics {
+	uint64_t wait_for_space_in_q_head;
+	uint64_t wait_for_space_in_q_admitted_out;
+	uint64_t wait_for_admitted_struct;
+	uint64_t invalid_pair;
+	uint64_t flows_added;
+	uint64_t flows_done;
+	uint64_t flows_visited;
+	uint64_t flows_moved;
+};
+
+/**
+ * State of the allocator.
+ * Flows live in @flows, free ones on the @free_flow list. @slots is an
+ *    open-addressed hash table with linear probing from (src,dst) to the
+ *    pair's flow. Only the allocation core touches it, so removals shift
+ *    the following slots back instead of leaving tombstones.
+ */
+struct isjf_status {
+	uint64_t current_timeslot;
+	bool oversubscribed;
+	uint16_t inter_rack_capacity;
+	uint16_t out_of_boundary_capacity;
+	uint16_t num_nodes;
+	struct isjf_flow *flows;
+	uint32_t max_flows;
+	uint32_t n_flows;
+	uint32_t free_flow;
+	struct isjf_slot *slots;
+	uint32_t slot_mask;
+	uint32_t hash_shift;
+	uint32_t bucket_head[ISJF_NUM_BUCKETS];
+	uint32_t bucket_tail[ISJF_NUM_BUCKETS];
+	uint64_t non_empty_buckets[ISJF_BUCKET_MASK_WORDS];
+	struct batch_state batch_state;
+	struct admitted_traffic *admitted[BATCH_SIZE];
+	struct fp_ring *q_head;
+	struct fp_ring *q_admitted_out;
+	struct fp_mempool *admitted_traffic_mempool;
+	struct isjf_statistics stat;
+};
+
+/**
+ * Increase the backlog from src to dst. Called by the comm core.
+ */
+void isjf_add_backlog(struct isjf_status *status, uint16_t src, uint16_t dst,
+		uint32_t amount);
+
+/**
+ * Reset state of all flows for which src is the sender. Called by the comm
+ *    core; the allocation core drops the flows after demands added before.
+ */
+void isjf_reset_sender(struct isjf_status *status, uint16_t src);
+
+/**
+ * Allocates the next BATCH_SIZE timeslots, and enqueues their admitted
+ *    traffic to q_admitted_out. Takes requests from q_head first. The caller
+ *    paces batches.
+ */
+void isjf_get_admissible_traffic(struct isjf_status *status);
+
+/**
+ * Returns the bucket of a flow with @remaining timeslots of backlog.
+ * Flows with x timeslots go to bucket x - 1 up to ISJF_EXACT_BUCKETS, then
+ *    each power of two is split into 4 buckets.
+ */
+static inline __attribute__((always_inline))
+uint16_t isjf_bucket_index(uint32_t remaining)
+{
+	uint32_t log;
+
+	assert(remaining != 0);
+
+	if (remaining <= ISJF_EXACT_BUCKETS)
+		return remaining - 1;
+
+	log = 31 - __builtin_clz(remaining);
+	return ISJF_EXACT_BUCKETS + ((log - ISJF_EXACT_SHIFT) << 2)
+			+ ((remaining >> (log - 2)) & 3);
+}
+
+/**
+ * Returns the number of flow table slots for @max_flows flows
+ */
+static inline
+uint32_t isjf_n_slots_for(uint32_t max_flows)
+{
+	uint32_t n_slots = 2;
+
+	/* keep the load factor at most 1/2 */
+	while (n_slots < 2 * max_flows)
+		n_slots <<= 1;
+
+	return n_slots;
+}
+
+/**
+ * Forgets all flows and starts over at timeslot 0
+ */
+static inline
+void isjf_reset_status(struct isjf_status *status)
+{
+	uint32_t i;
+
+	status->current_timeslot = 0;
+	status->n_flows = 0;
+	memset(status->slots, 0, (status->slot_mask + 1) * sizeof(struct isjf_slot));
+
+	status->free_flow = 0;
+	for (i = 0; i < status->max_flows; i++)
+		status->flows[i].next = i + 1;
+	status->flows[status->max_flows - 1].next = ISJF_NONE;
+
+	for (i = 0; i < ISJF_NUM_BUCKETS; i++) {
+		status->bucket_head[i] = ISJF_NONE;
+		status->bucket_tail[i] = ISJF_NONE;
+	}
+	for (i = 0; i < ISJF_BUCKET_MASK_WORDS; i++)
+		status->non_empty_buckets[i] = 0;
+
+	memset(&status->stat, 0, sizeof(status->stat));
+}
+
+/**
+ * Returns an initialized struct isjf_status with room for a flow per pair of
+ *    the @num_nodes nodes, or NULL on error.
+ */
+static inline
+struct isjf_status *isjf_create_status(bool oversubscribed,
+		uint16_t inter_rack_capacity, uint16_t out_of_boundary_capacity,
+		uint16_t num_nodes, struct fp_ring *q_head,
+		struct fp_ring *q_admitted_out,
+		struct fp_mempool *admitted_traffic_mempool)
+{
+	struct isjf_status *status;
+	uint32_t max_flows = (uint32_t) num_nodes * num_nodes;
+	uint32_t n_slots;
+
+	if (num_nodes == 0 || num_nodes > MAX_NODES)
+		return NULL;
+	n_slots = isjf_n_slots_for(max_flows);
+
+	status = (struct isjf_status *) fp_malloc("isjf_status",
+			sizeof(struct isjf_status));
+	if (status == NULL)
+		return NULL;
+
+	status->flows = (struct isjf_flow *) fp_calloc("isjf_flows", max_flows,
+			sizeof(struct isjf_flow));
+	status->slots = (struct isjf_slot *) fp_calloc("isjf_slots", n_slots,
+			sizeof(struct isjf_slot));
+	if (status->flows == NULL || status->slots == NULL) {
+		fp_free(status->flows);
+		fp_free(status->slots);
+		fp_free(status);
+		return NULL;
+	}
+
+	status->oversubscribed = oversubscribed;
+	status->inter_rack_capacity = inter_rack_capacity;
+	status->out_of_boundary_capacity = out_of_boundary_capacity;
+	status->num_nodes = num_nodes;
+	status->max_flows = max_flows;
+	status->slot_mask = n_slots - 1;
+	status->hash_shift = 32 - __builtin_ctz(n_slots);
+	status->q_head = q_head;
+	status->q_admitted_out = q_admitted_out;
+	status->admitted_traffic_mempool = admitted_traffic_mempool;
+
+	isjf_reset_status(status);
+	return status;
+}
+
+static inline
+void isjf_destroy_status(struct isjf_status *status)
+{
+	fp_free(status->flows);
+	fp_free(status->slots);
+	fp_free(status);
+}
+
+#endif /* ISJF_H_ */
@@ -5,108 +5,96 @@
  *      Author: aousterh
  */
 
-#include "admissible_structures.h"
 #include "euler_split.h"
 #include "graph.h"
+#include "admitted.h"
 #include "path_selection.h"
+#include "platform.h"
 
 #define NUM_GRAPHS 3
 
-// Data structure for holding all admitted edge indices
-// for a particular pair of src/dst racks
-struct racks_to_nodes {
-    uint16_t size;
-    uint16_t admitted_indices[MAX_NODES_PER_RACK];
-};
-
-// Data structure for mapping from rack numbers back to
-// src/dst ids
-struct racks_to_nodes_mapping {
-    struct racks_to_nodes mappings[MAX_RACKS * MAX_RACKS];
+#define MAX_PATH_SEL_RACKS MAX_GRAPH_NODES
+
+// Scratch state of one path selection core, reused every timeslot so that
+// its working set stays in cache.
+// Admitted edges are chained by their pair of src/dst racks, to map edges of
+// the rack graph back to src/dst ids.
+struct path_sel_state {
+    uint16_t num_racks;
+    uint8_t rack_shift;
+    uint16_t pair_head[MAX_PATH_SEL_RACKS * MAX_PATH_SEL_RACKS]; // first edge index + 1, 0 if none
+    uint16_t next[MAX_NODES]; // next edge index + 1 of the same rack pair
+    uint16_t src_rack_counts[MAX_PATH_SEL_RACKS];
+    uint16_t dst_rack_counts[MAX_PATH_SEL_RACKS];
+    struct graph_structure structure;
+    struct graph_edges edges[NUM_GRAPHS];
 };
 
-// Initialize a rack to nodes mapping as empty
-static void init_racks_to_nodes_mapping(struct racks_to_nodes_mapping *map) {
-    assert(map != NULL);
+// Obtain the index in the rack pair chains of a particular
+// source and destination rack
+static inline
+uint32_t get_rack_pair_index(struct path_sel_state *state, uint16_t src_rack,
+                             uint16_t dst_rack) {
+    assert(src_rack < state->num_racks);
+    assert(dst_rack < state->num_racks);
 
-    uint16_t i;
-    for (i = 0; i < MAX_RACKS * MAX_RACKS; i++)
-        map->mappings[i].size = 0;
+    return src_rack * state->num_racks + dst_rack;
 }
 
-// Obtain the index in a racks_to_nodes_mapping of a particular
-// source and destination rack
-static uint32_t get_rack_pair_index(uint16_t src_rack, uint16_t dst_rack) {
-    assert(src_rack < MAX_RACKS);
-    assert(dst_rack < MAX_RACKS);
-
-    return src_rack * MAX_RACKS + dst_rack;
+static inline
+uint16_t rack_of(struct path_sel_state *state, uint16_t node) {
+    return node >> state->rack_shift;
 }
 
-// Print the mapping, useful for debugging
+// Print the rack pair counts, useful for debugging
 static inline
-void print_racks_to_nodes_mapping_counts(struct racks_to_nodes_mapping *map,
-                                         uint8_t num_racks) {
-    assert(map != NULL);
+void print_rack_pair_counts(struct path_sel_state *state) {
+    assert(state != NULL);
 
     uint16_t total_count = 0;
-    uint16_t src, dst;
-    for (src = 0; src < num_racks; src++) {
-        for (dst = 0; dst < num_racks; dst++) {
-            uint32_t index = get_rack_pair_index(src, dst);
-            printf("src %d dst %d: %d\n", src, dst, map->mappings[index].size);
-            total_count += map->mappings[index].size;
+    uint16_t src, dst, count, i;
+    for (src = 0; src < state->num_racks; src++) {
+        for (dst = 0; dst < state->num_racks; dst++) {
+            count = 0;
+            for (i = state->pair_head[get_rack_pair_index(state, src, dst)];
+                 i != 0; i = state->next[i - 1])
+                count++;
+            printf("src %d dst %d: %d\n", src, dst, count);
+            total_count += count;
         }
     }
     printf("total count: %d\n", total_count);
 }
 
-// Populate the mapping from rack ids to node ids for the given
-// admitted traffic
-static void map_racks_to_nodes(struct admitted_traffic *admitted,
-                        struct racks_to_nodes_mapping *map) {
+// Construct the graph structure and edges for the admitted traffic, chaining
+// admitted edges by rack pair along the way. Ensure that it is a regular graph
+static void construct_graph(struct path_sel_state *state,
+                            struct admitted_traffic *admitted) {
+    assert(state != NULL);
     assert(admitted != NULL);
-    assert(map != NULL);
 
-    struct admitted_edge *edge;
-    uint16_t i;
-    for (i = 0; i < admitted->size; i++) {
-        edge = &admitted->edges[i];
-        uint16_t src_rack = fp_rack_from_node_id(edge->src);
-        uint16_t dst_rack = fp_rack_from_node_id(edge->dst);
-
-        uint32_t rack_pair_index = get_rack_pair_index(src_rack, dst_rack);
-        struct racks_to_nodes *rack_pair = &map->mappings[rack_pair_index];
-        rack_pair->admitted_indices[rack_pair->size] = i;
-        rack_pair->size++;
-    }
-}
-
-// Construct the graph structure and edges for the admitted traffic
-// Ensure that it is a regular graph
-static void construct_graph(struct admitted_traffic *admitted,
-                     struct graph_structure *structure,
-                     struct graph_edges *edges) {
-    assert(structure != NULL);
-    assert(edges != NULL);
+    struct graph_structure *structure = &state->structure;
+    struct graph_edges *edges = &state->edges[0];
+    uint16_t num_racks = state->num_racks;
+    uint16_t *src_rack_counts = state->src_rack_counts;
+    uint16_t *dst_rack_counts = state->dst_rack_counts;
 
     // Set all rack counts to zero initially
-    uint8_t num_racks = structure->n;
-    uint8_t src_rack_counts[num_racks];
-    uint8_t dst_rack_counts[num_racks];
-    uint16_t i;
-    for (i = 0; i < num_racks; i++) {
-        src_rack_counts[i] = 0;
-        dst_rack_counts[i] = 0;
-    }
+    memset(src_rack_counts, 0, num_racks * sizeof(uint16_t));
+    memset(dst_rack_counts, 0, num_racks * sizeof(uint16_t));
 
     // Add admitted edges to graph
-    uint16_t num_edges = 0;
+    uint32_t num_edges = 0;
     struct admitted_edge *edge;
+    uint16_t i;
     for (i = 0; i < admitted->size; i++) {
         edge = &admitted->edges[i];
-        uint16_t src_rack = fp_rack_from_node_id(edge->src);
-        uint16_t dst_rack = fp_rack_from_node_id(edge->dst);
+        uint16_t src_rack = rack_of(state, edge->src);
+        uint16_t dst_rack = rack_of(state, edge->dst & DST_MASK);
+
+        uint32_t rack_pair_index = get_rack_pair_index(state, src_rack, dst_rack);
+        state->next[i] = state->pair_head[rack_pair_index];
+        state->pair_head[rack_pair_index] = i + 1;
 
         // Note: graph.h assumes that sources and destinations
         // use different numbers, so we must map carefully
@@ -117,7 +105,7 @@ static void construct_graph(struct admitted_traffic *admitted,
     }
 
     // Find maximum necessary degree
-    uint8_t max_degree = 0;
+    uint16_t max_degree = 0;
     for (i = 0; i < num_racks; i++) {
         if (src_rack_counts[i] > max_degree)
             max_degree = src_rack_counts[i];
@@ -129,12 +117,13 @@ static void construct_graph(struct admitted_traffic *admitted,
     if (max_degree % NUM_PATHS != 0) {
         max_degree = (max_degree / NUM_PATHS + 1) * NUM_PATHS;
     }
+    assert(max_degree <= MAX_DEGREE);
 
     // Add dummy edges so that all racks have max_degree
     // TODO: implement merging approach instead?
-    uint8_t src = 0;
-    uint8_t dst = 0;
-    while (num_edges < max_degree * num_racks) {
+    uint16_t src = 0;
+    uint16_t dst = 0;
+    while (num_edges < (uint32_t) max_degree * num_racks) {
         while (src_rack_counts[src] == max_degree)
             src++;
         while (dst_rack_counts[dst] == max_degree)
@@ -149,46 +138,46 @@ static void construct_graph(struct admitted_traffic *admitted,
 }
 
 // Assign an edge from src_rack to dst_rack in the admitted traffic to path.
-// Use map to find a specific pair of src and dst nodes.
-static void assign_to_path(struct racks_to_nodes_mapping *map,
+// Use the rack pair chains to find a specific pair of src and dst nodes.
+static inline
+void assign_to_path(struct path_sel_state *state,
                     struct admitted_traffic *admitted,
-                    uint8_t src_rack, uint8_t dst_rack, uint8_t path) {
-    assert(map != NULL);
+                    uint16_t src_rack, uint16_t dst_rack, uint8_t path) {
+    assert(state != NULL);
     assert(admitted != NULL);
     assert(path < NUM_PATHS);
 
-    uint32_t rack_pair_index = get_rack_pair_index(src_rack, dst_rack);
-    struct racks_to_nodes *rack_pair = &map->mappings[rack_pair_index];
-    
-    if (rack_pair->size > 0) {
+    uint32_t rack_pair_index = get_rack_pair_index(state, src_rack, dst_rack);
+    uint16_t head = state->pair_head[rack_pair_index];
+
+    if (head != 0) {
         // This is not a dummy edge
-        uint16_t admitted_index = rack_pair->admitted_indices[rack_pair->size - 1];
+        uint16_t admitted_index = head - 1;
         assert(admitted_index < admitted->size);
         struct admitted_edge *edge = &admitted->edges[admitted_index];
         edge->dst = (edge->dst & DST_MASK) + (path << PATH_SHIFT);
-        rack_pair->size--;
+        state->pair_head[rack_pair_index] = state->next[admitted_index];
     }
-} 
+}
 
 // Split the edges into two sets of edges and set the path information
 // for these edges.
 // This effectively performs an Euler split, but does not add the split
 // edges to new graphs.
-static void split_and_populate_paths(struct graph_structure *structure,
-                              struct graph_edges *edges,
-                              struct racks_to_nodes_mapping *map,
-                              struct admitted_traffic *admitted,
-                              uint8_t path_0, uint8_t path_1) {
-    assert(structure != NULL);
+static void split_and_populate_paths(struct path_sel_state *state,
+                                     struct graph_edges *edges,
+                                     struct admitted_traffic *admitted,
+                                     uint8_t path_0, uint8_t path_1) {
+    assert(state != NULL);
     assert(edges != NULL);
-    assert(map != NULL);
     assert(admitted != NULL);
     assert(path_0 < NUM_PATHS);
     assert(path_1 < NUM_PATHS);
 
-    uint8_t num_racks = structure->n;
+    struct graph_structure *structure = &state->structure;
+    uint16_t num_racks = structure->n;
 
-    uint8_t node, cur_node, new_node;
+    uint16_t node, cur_node, new_node;
     for (node = 0; node < num_racks; node++) {
         cur_node = node;
 
@@ -197,28 +186,62 @@ static void split_and_populate_paths(struct graph_structure *structure,
             new_node = remove_edge_to_neighbor(structure, edges, cur_node);
 
             // Map back to system where src/dst racks use same indices
-            assign_to_path(map, admitted, cur_node, new_node - num_racks, path_0);
-            cur_node = new_node;       
+            assign_to_path(state, admitted, cur_node, new_node - num_racks, path_0);
+            cur_node = new_node;
             assert(is_consistent(structure, edges));
- 
+
             new_node = remove_edge_to_neighbor(structure, edges, cur_node);
 
             // Map back to system where src/dst racks use same indices and be sure
             // to get the src rack and dst rack correct
-            assign_to_path(map, admitted, new_node, cur_node - num_racks, path_1);
-            cur_node = new_node;       
+            assign_to_path(state, admitted, new_node, cur_node - num_racks, path_1);
+            cur_node = new_node;
             assert(is_consistent(structure, edges));
         }
     }
 }
 
+struct path_sel_state *create_path_sel_state(uint16_t num_racks,
+                                             uint8_t rack_shift) {
+    uint32_t max_rack_degree = MAX_NODES;
+
+    if (num_racks == 0 || num_racks > MAX_PATH_SEL_RACKS)
+        return NULL;
+
+    // A rack can't send or receive more than it has nodes
+    if (rack_shift < 16 && (1U << rack_shift) < max_rack_degree)
+        max_rack_degree = 1U << rack_shift;
+    max_rack_degree = (max_rack_degree + NUM_PATHS - 1) / NUM_PATHS * NUM_PATHS;
+    if (max_rack_degree > MAX_DEGREE)
+        return NULL;
+
+    struct path_sel_state *state = (struct path_sel_state *)
+            fp_malloc("path_sel_state", sizeof(struct path_sel_state));
+    if (state == NULL)
+        return NULL;
+
+    state->num_racks = num_racks;
+    state->rack_shift = rack_shift;
+    memset(state->pair_head, 0, sizeof(state->pair_head));
+    return state;
+}
+
+void destroy_path_sel_state(struct path_sel_state *state) {
+    assert(state != NULL);
+
+    fp_free(state);
+}
+
 // Returns true if the assignment of paths is valid; false otherwise
-bool paths_are_valid(struct admitted_traffic *admitted, uint8_t num_racks) {
+bool paths_are_valid_with_state(struct path_sel_state *state,
+                                struct admitted_traffic *admitted) {
+    assert(state != NULL);
     assert(admitted != NULL);
 
+    uint16_t num_racks = state->num_racks;
     uint16_t i, j;
-    uint8_t src_rack_path_counts [MAX_RACKS * NUM_PATHS];
-    uint8_t dst_rack_path_counts [MAX_RACKS * NUM_PATHS];
+    uint16_t src_rack_path_counts [MAX_PATH_SEL_RACKS * NUM_PATHS];
+    uint16_t dst_rack_path_counts [MAX_PATH_SEL_RACKS * NUM_PATHS];
 
     for (i = 0; i < num_racks * NUM_PATHS; i++) {
         src_rack_path_counts[i] = 0;
@@ -229,8 +252,8 @@ bool paths_are_valid(struct admitted_traffic *admitted, uint8_t num_racks) {
     for (i = 0; i < admitted->size; i++) {
         struct admitted_edge *edge = &admitted->edges[i];
         uint8_t path = (edge->dst & PATH_MASK) >> PATH_SHIFT;
-        uint16_t src_rack = fp_rack_from_node_id(edge->src);
-        uint16_t dst_rack = fp_rack_from_node_id(edge->dst & DST_MASK);
+        uint16_t src_rack = rack_of(state, edge->src);
+        uint16_t dst_rack = rack_of(state, edge->dst & DST_MASK);
         src_rack_path_counts[src_rack * NUM_PATHS + path]++;
         dst_rack_path_counts[dst_rack * NUM_PATHS + path]++;
     }
@@ -266,33 +289,71 @@ bool paths_are_valid(struct admitted_traffic *admitted, uint8_t num_racks) {
     return true;
 }
 
-// Selects paths for traffic in admitted. Modifies the highest two
-// bits of the destination to specify the path_id.
-void select_paths(struct admitted_traffic *admitted, uint8_t num_racks) {
+// Selects paths for traffic in admitted. Modifies the highest bits of the
+// destination to specify the path_id.
+void select_paths_with_state(struct path_sel_state *state,
+                             struct admitted_traffic *admitted) {
+    assert(state != NULL);
     assert(admitted != NULL);
-    assert(num_racks <= MAX_RACKS);
 
-    // Compute the mapping from rack ids to node ids
-    struct racks_to_nodes_mapping map;
-    init_racks_to_nodes_mapping(&map);
-    map_racks_to_nodes(admitted, &map);
+    uint16_t num_racks = state->num_racks;
+    uint8_t i;
+
+    // Every edge takes the only path
+    if (NUM_PATHS == 1)
+        return;
 
     // Initialize the graphs
-    struct graph_structure structure;
-    graph_structure_init(&structure, num_racks);
-    struct graph_edges edges[NUM_GRAPHS];
-    uint8_t i;
+    graph_structure_init(&state->structure, num_racks);
     for (i = 0; i < NUM_GRAPHS; i++)
-        graph_edges_init(&edges[i], num_racks);
- 
+        graph_edges_init(&state->edges[i], num_racks);
+
     // Construct the input graph, make it regular
-    construct_graph(admitted, &structure, &edges[0]);
+    construct_graph(state, admitted);
 
-    // Perform an Euler splits to get NUM_COLOR/2 sets of edges
-    split(&structure, &edges[0], &edges[1], &edges[2]);
+#if (NUM_PATHS == 2)
+    // One split gives both paths
+    split_and_populate_paths(state, &state->edges[0], admitted, 0, 1);
+#else
+    // Perform an Euler split to get NUM_PATHS/2 sets of edges
+    split(&state->structure, &state->edges[0], &state->edges[1], &state->edges[2]);
 
-    // Perform the remaining two splits to get NUM_COLOR sets of edges
+    // Perform the remaining two splits to get NUM_PATHS sets of edges
     // and simultaneously mark the paths in admitted
-    split_and_populate_paths(&structure, &edges[1], &map, admitted, 0, 1);
-    split_and_populate_paths(&structure, &edges[2], &map, admitted, 2, 3);
+    split_and_populate_paths(state, &state->edges[1], admitted, 0, 1);
+    split_and_populate_paths(state, &state->edges[2], admitted, 2, 3);
+#endif
+}
+
+// Returns the path selection state of this thread, for the topology's racks
+static struct path_sel_state *get_thread_path_sel_state(uint16_t num_racks) {
+    static __thread struct path_sel_state *thread_state = NULL;
+
+    if (thread_state != NULL && thread_state->num_racks != num_racks) {
+        destroy_path_sel_state(thread_state);
+        thread_state = NULL;
+    }
+    if (thread_state == NULL)
+        thread_state = create_path_sel_state(num_racks, TOR_SHIFT);
+    assert(thread_state != NULL);
+
+    return thread_state;
+}
+
+// Returns true if the assignment of paths is valid; false otherwise
+bool paths_are_valid(struct admitted_traffic *admitted, uint16_t num_racks) {
+    assert(admitted != NULL);
+    assert(num_racks <= MAX_PATH_SEL_RACKS);
+
+    return paths_are_valid_with_state(get_thread_path_sel_state(num_racks),
+                                      admitted);
+}
+
+// Selects paths for traffic in admitted. Modifies the highest bits of the
+// destination to specify the path_id.
+void select_paths(struct admitted_traffic *admitted, uint16_t num_racks) {
+    assert(admitted != NULL);
+    assert(num_racks <= MAX_PATH_SEL_RACKS);
+
+    select_paths_with_state(get_thread_path_sel_state(num_racks), admitted);
 }
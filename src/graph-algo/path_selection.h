@@ -9,6 +9,7 @@
 #define PATH_SELECTION_H_
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -16,29 +17,59 @@ extern "C" {
 
 #if (defined(PARALLEL_ALGO) || defined(PIPELINED_ALGO))
 /* uppermost 2 bits encode the path, remaining bits encode dst id */
-#define NUM_PATHS 4  // if not 4, NUM_GRAPHS and related code must be modified
-#define DST_MASK 0x3FFF  // 2^PATH_SHIFT - 1
-#define PATH_MASK (0xFFFF & ~DST_MASK)
-#define PATH_SHIFT 14
+#define NUM_PATHS 4
 #endif
 
 #if (defined(EMULATION_ALGO) || defined(BENCHMARK_ALGO))
-/* TODO: add support for path selection with emulation */
+/* TODO: add support for path selection with emulation. benchmarks of path
+ * selection can ask for more paths with -DNUM_PATHS */
+#ifndef NUM_PATHS
 #define NUM_PATHS 1
-#define DST_MASK 0xFFFF
-#define PATH_MASK (0xFFFF & ~DST_MASK)
+#endif
+#endif
+
+/* paths are encoded in the uppermost bits of the dst id */
+#if (NUM_PATHS == 1)
 #define PATH_SHIFT 16
+#elif (NUM_PATHS == 2)
+#define PATH_SHIFT 15
+#elif (NUM_PATHS == 4)
+#define PATH_SHIFT 14
+#else
+#error "NUM_PATHS must be 1, 2, or 4"
 #endif
+#define DST_MASK ((1 << PATH_SHIFT) - 1)
+#define PATH_MASK (0xFFFF & ~DST_MASK)
 
-/* dummy struct declaration */
+/* dummy struct declarations */
 struct admitted_traffic;
+struct path_sel_state;
+
+/**
+ * Returns scratch state for selecting paths among @num_racks racks of
+ *    2^@rack_shift nodes each, or NULL if the graphs can't be that large.
+ *    Each core selecting paths should have its own.
+ */
+struct path_sel_state *create_path_sel_state(uint16_t num_racks,
+                                             uint8_t rack_shift);
+
+void destroy_path_sel_state(struct path_sel_state *state);
+
+// Selects paths for traffic in admitted, using the racks and scratch memory
+// of state
+void select_paths_with_state(struct path_sel_state *state,
+                             struct admitted_traffic *admitted);
 
 // Selects paths for traffic in admitted and writes the path ids
 // to the most significant bits of the destination ip addrs
-void select_paths(struct admitted_traffic *admitted, uint8_t num_racks);
+void select_paths(struct admitted_traffic *admitted, uint16_t num_racks);
+
+// Returns true if the assignment of paths is valid; false otherwise
+bool paths_are_valid_with_state(struct path_sel_state *state,
+                                struct admitted_traffic *admitted);
 
 // Returns true if the assignment of paths is valid; false otherwise
-bool paths_are_valid(struct admitted_traffic *admitted, uint8_t num_racks);
+bool paths_are_valid(struct admitted_traffic *admitted, uint16_t num_racks);
 
 #ifdef __cplusplus
 }
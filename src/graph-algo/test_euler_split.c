@@ -10,7 +10,7 @@
 
 // Constructs a complete bipartite graph
 void create_complete_bipartite_graph(struct graph_structure *structure,
-                                     struct graph_edges *edges, uint8_t n) {
+                                     struct graph_edges *edges, uint16_t n) {
   
     int i, j;
     for (i = 0; i < n; i++) {
@@ -6,6 +6,7 @@
 
 #include "platform.h"
 #include "outwnd.h"
+#include "probes.h"
 
 #undef FASTPASS_PERFORM_RUNTIME_TESTS
 
@@ -194,6 +195,7 @@ void fpproto_handle_timeout(struct fpproto_conn *conn, u64 now)
 			goto set_next_timer;
 
 		conn->stat.timeout_pkts++;
+		FP_PROBE3(retransmit, conn, seqno, now + conn->send_timeout - timeout);
 		do_neg_ack_seqno(conn, seqno);
 
 		seqno++;
@@ -0,0 +1,62 @@
+/*
+ * probes.h
+ *
+ * Static tracepoints (USDT) in the arbiter and emulation hot paths.
+ *
+ *  Created on: October 19, 2026
+ */
+
+#ifndef FASTPASS_PROBES_H_
+#define FASTPASS_PROBES_H_
+
+/*
+ * Each probe compiles to a single nop plus a note in the binary, so probes
+ * stay in production builds. perf or bpftrace attach to them by name on a
+ * running arbiter, e.g.
+ *   bpftrace -e 'usdt:./build/fast:fastpass:queue_drop { @[arg4] = count(); }'
+ * Probes are defined when <sys/sdt.h> (systemtap-sdt-dev) is available, and
+ * never in the kernel module. Build with -DFASTPASS_PROBES=0 to remove them.
+ *
+ * Probes, all in provider "fastpass", and their arguments:
+ *   emu_admit        src, dst, flow, id, n_mtus
+ *   emu_drop         src, dst, flow, id, n_mtus
+ *   queue_drop       src, dst, flow, id, port
+ *   queue_mark_ecn   src, dst, flow, id, port
+ *   queue_enqueue    src, dst, flow, id, port, occupancy after enqueue
+ *   queue_dequeue    src, dst, flow, id, port, occupancy after dequeue
+ *   router_ring_full output index, packets that did not fit
+ *   add_backlog      src, dst, flow, amount, start_id
+ *   retrans_timer    node, conn
+ *   retransmit       conn, seqno, ns since the packet was sent
+ */
+
+#ifndef FASTPASS_PROBES
+#if !defined(__KERNEL__) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#define FASTPASS_PROBES		1
+#endif
+#endif
+#endif
+
+#ifndef FASTPASS_PROBES
+#define FASTPASS_PROBES		0
+#endif
+
+#if FASTPASS_PROBES
+#include <sys/sdt.h>
+
+#define FP_PROBE2(name,a,b)				DTRACE_PROBE2(fastpass,name,a,b)
+#define FP_PROBE3(name,a,b,c)			DTRACE_PROBE3(fastpass,name,a,b,c)
+#define FP_PROBE5(name,a,b,c,d,e)		DTRACE_PROBE5(fastpass,name,a,b,c,d,e)
+#define FP_PROBE6(name,a,b,c,d,e,f)		DTRACE_PROBE6(fastpass,name,a,b,c,d,e,f)
+
+#else
+
+#define FP_PROBE2(name,a,b)				do {} while (0)
+#define FP_PROBE3(name,a,b,c)			do {} while (0)
+#define FP_PROBE5(name,a,b,c,d,e)		do {} while (0)
+#define FP_PROBE6(name,a,b,c,d,e,f)		do {} while (0)
+
+#endif /* FASTPASS_PROBES */
+
+#endif /* FASTPASS_PROBES_H_ */
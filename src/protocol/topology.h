@@ -8,6 +8,9 @@
 extern "C" {
 #endif /* __cplusplus */
 
+/* NUM_NODES is the default number of nodes, the arbiter can be given another
+ * count at startup. per-pair allocator state grows with active pairs, not
+ * MAX_NODES^2, so the 1024-node config below is practical. */
 //#define MAX_NODES 1024
 //#define FP_NODES_SHIFT 10  // 2^FP_NODES_SHIFT = MAX_NODES
 #define NUM_NODES 64